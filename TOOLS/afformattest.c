@@ -0,0 +1,187 @@
+/*
+ * test for the SIMD sample format conversions of af_format
+ *
+ * Converts the same samples between every pair of linear PCM formats (8
+ * to 32 bit integer, signed and unsigned, both endiannesses, and float)
+ * with the CPU features limited to none (plain C), SSE2, SSSE3 and AVX2,
+ * and checks that the output is bit-identical to the C one. The
+ * input starts with the extreme values of its format (and floats beyond
+ * +-1.0 for saturation), and several lengths are used so the C code
+ * handles the tails after the SIMD blocks.
+ *
+ * usage: afformattest
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "libaf/af.h"
+
+extern af_info_t af_info_format;
+
+#define MAX_SAMPLES 1027
+
+static const int formats[] = {
+    AF_FORMAT_U8, AF_FORMAT_S8,
+    AF_FORMAT_U16_LE, AF_FORMAT_U16_BE, AF_FORMAT_S16_LE, AF_FORMAT_S16_BE,
+    AF_FORMAT_U24_LE, AF_FORMAT_U24_BE, AF_FORMAT_S24_LE, AF_FORMAT_S24_BE,
+    AF_FORMAT_U32_LE, AF_FORMAT_U32_BE, AF_FORMAT_S32_LE, AF_FORMAT_S32_BE,
+    AF_FORMAT_FLOAT_LE, AF_FORMAT_FLOAT_BE,
+};
+
+static const int lengths[] = { 1, 3, 8, 17, 33, 64, MAX_SAMPLES };
+
+static const float float_extremes[] = {
+    -INFINITY, -1e10, -2.0, -1.0000001, -1.0, -0.99999994, -1.0 / 32768,
+    -0.0, 0.0, 1.0 / 32768, 0.99999994, 1.0, 1.0000001, 2.0, 1e10, INFINITY,
+};
+
+static const int32_t int_extremes[] = {
+    INT32_MIN, INT32_MIN + 1, -65536, -1, 0, 1, 65535, INT32_MAX - 1,
+    INT32_MAX,
+};
+
+static void store(uint8_t *p, uint32_t v, int bps, int be)
+{
+    int i;
+    for (i = 0; i < bps; i++)
+        p[be ? bps - 1 - i : i] = v >> (8 * i);
+}
+
+// extreme values first, random ones after them
+static void make_input(uint8_t *buf, int format, int bps, int len)
+{
+    int be = (format & AF_FORMAT_END_MASK) == AF_FORMAT_BE;
+    int n_float = sizeof(float_extremes) / sizeof(*float_extremes);
+    int n_int = sizeof(int_extremes) / sizeof(*int_extremes);
+    int i;
+
+    for (i = 0; i < len; i++) {
+        uint32_t v;
+        if ((format & AF_FORMAT_POINT_MASK) == AF_FORMAT_F) {
+            union { float f; uint32_t i; } u;
+            u.f = i < n_float ? float_extremes[i]
+                              : (float)rand() / RAND_MAX * 2.4 - 1.2;
+            v = u.i;
+        } else {
+            v = i < n_int ? int_extremes[i] : rand() ^ (uint32_t)rand() << 16;
+            v >>= 32 - 8 * bps;
+            if ((format & AF_FORMAT_SIGN_MASK) == AF_FORMAT_US)
+                v ^= 1u << (8 * bps - 1);
+        }
+        store(buf + i * bps, v, bps, be);
+    }
+}
+
+// returns the output length in bytes, -1 if the conversion failed
+static int convert(int from, int to, const uint8_t *in, int len,
+                   uint8_t *out)
+{
+    af_instance_t af = { .info = &af_info_format };
+    af_data_t fmt = { .rate = 48000, .nch = 1, .format = from,
+                      .bps = af_fmt2bits(from) / 8 };
+    af_data_t d = fmt, *r;
+    // play() converts in place; the offset keeps it off 16 byte alignment
+    uint8_t *buf = malloc(len * 4 + 4);
+    int ret = -1;
+
+    if (af.info->open(&af) != AF_OK)
+        goto done;
+    af.control(&af, AF_CONTROL_FORMAT_FMT | AF_CONTROL_SET, &to);
+    if (af.control(&af, AF_CONTROL_REINIT, &fmt) != AF_OK)
+        goto done;
+    d.audio = buf + 4;
+    d.len = len * d.bps;
+    memcpy(d.audio, in, d.len);
+    r = af.play(&af, &d);
+    if (r && r->format == to) {
+        memcpy(out, r->audio, r->len);
+        ret = r->len;
+    }
+done:
+    af.uninit(&af);
+    free(buf);
+    return ret;
+}
+
+int main(void)
+{
+    static const char *levels[] = { "C", "SSE2", "SSSE3", "AVX2" };
+    int n_formats = sizeof(formats) / sizeof(*formats);
+    uint8_t in[MAX_SAMPLES * 4], ref[MAX_SAMPLES * 4], out[MAX_SAMPLES * 4];
+    int checked[4] = {0}, failed = 0;
+    CpuCaps caps;
+    int f, t, n, l;
+
+    GetCpuCaps(&caps);
+
+    for (f = 0; f < n_formats; f++)
+        for (t = 0; t < n_formats; t++) {
+            int bps;
+            if (f == t)
+                continue;
+            bps = af_fmt2bits(formats[f]) / 8;
+            for (n = 0; n < sizeof(lengths) / sizeof(*lengths); n++) {
+                int len = lengths[n], ref_len = 0;
+                make_input(in, formats[f], bps, len);
+                for (l = 0; l < 4; l++) {
+                    int out_len;
+                    if ((l == 1 && !caps.hasSSE2) ||
+                        (l == 2 && !caps.hasSSSE3) ||
+                        (l == 3 && !caps.hasAVX2))
+                        continue;
+                    memset(&gCpuCaps, 0, sizeof(gCpuCaps));
+                    gCpuCaps.hasSSE2  = l >= 1;
+                    gCpuCaps.hasSSSE3 = l >= 2;
+                    gCpuCaps.hasAVX2  = l >= 3;
+                    out_len = convert(formats[f], formats[t], in, len,
+                                      l ? out : ref);
+                    if (!l) {
+                        ref_len = out_len;
+                        continue;
+                    }
+                    checked[l]++;
+                    if (out_len != ref_len ||
+                        (out_len > 0 && memcmp(ref, out, out_len))) {
+                        int i = 0;
+                        while (out_len > 0 && i < out_len && ref[i] == out[i])
+                            i++;
+                        printf("%s -> %s, %d samples, %s: MISMATCH at byte %d"
+                               " of %d\n", af_fmt2str_short(formats[f]),
+                               af_fmt2str_short(formats[t]), len, levels[l],
+                               i, ref_len);
+                        failed++;
+                    }
+                }
+            }
+        }
+    gCpuCaps = caps;
+
+    for (l = 1; l < 4; l++) {
+        if (checked[l])
+            printf("%-6s %d conversions checked\n", levels[l], checked[l]);
+        else
+            printf("%-6s not supported by this CPU\n", levels[l]);
+    }
+    printf("%d mismatches\n", failed);
+    return !!failed;
+}
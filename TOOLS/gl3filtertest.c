@@ -0,0 +1,335 @@
+/*
+ * Check the deint and denoise shaders of vo_gl3 against C versions
+ *
+ * Runs the frag_deint and frag_denoise sections of vo_gl3_shaders.glsl on
+ * synthetic interlaced frames in a headless (EGL surfaceless) OpenGL 3.2
+ * context, the way vo_gl3 runs them: video-sized viewport on textures padded
+ * past the video size. The padding is filled with garbage, so reading it
+ * shows up as a mismatch.
+ *
+ * This file is part of MPlayer.
+ *
+ * MPlayer is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * MPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with MPlayer; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// video size, and the padded texture size
+#define W 61
+#define H 45
+#define TW 64
+#define TH 48
+
+#define MAX_ERR 1e-5
+
+static char *get_section(const char *src, const char *name)
+{
+    char *res = calloc(1, strlen(src) + 1);
+    int copy = 0;
+    const char *l = src;
+    while (*l) {
+        const char *e = strchr(l, '\n');
+        if (!e)
+            e = l + strlen(l);
+        if (!strncmp(l, "#!section ", 10))
+            copy = e - l - 10 == strlen(name)
+                   && !strncmp(l + 10, name, strlen(name));
+        else if (copy)
+            strncat(res, l, e - l + 1);
+        l = *e ? e + 1 : e;
+    }
+    return res;
+}
+
+static GLuint compile(GLenum type, const char *header, const char *src)
+{
+    GLuint s = glCreateShader(type);
+    const char *srcs[2] = {header, src};
+    GLint ok;
+    char log[4096];
+
+    glShaderSource(s, 2, srcs, NULL);
+    glCompileShader(s);
+    glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    glGetShaderInfoLog(s, sizeof(log), NULL, log);
+    if (!ok || *log)
+        printf("shader compile log:\n%s\n", log);
+    if (!ok)
+        exit(1);
+    return s;
+}
+
+static GLuint create_program(const char *src, const char *frag)
+{
+    const char *header = "#version 150\n#define FIXED_SCALE 1\n";
+    GLuint p = glCreateProgram();
+    GLint ok;
+
+    glAttachShader(p, compile(GL_VERTEX_SHADER, header,
+                              get_section(src, "vertex_all")));
+    glAttachShader(p, compile(GL_FRAGMENT_SHADER, header,
+                              get_section(src, frag)));
+    glBindAttribLocation(p, 0, "vertex_position");
+    glLinkProgram(p);
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[4096];
+        glGetProgramInfoLog(p, sizeof(log), NULL, log);
+        printf("program link log:\n%s\n", log);
+        exit(1);
+    }
+    glUseProgram(p);
+    glUniform1i(glGetUniformLocation(p, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(p, "texture2"), 1);
+    return p;
+}
+
+// img is W x H RGBA; the rest of the TW x TH texture is garbage.
+static GLuint create_texture(const float *img)
+{
+    float *data = malloc(TW * TH * 16);
+    GLuint t;
+
+    for (int y = 0; y < TH; y++)
+        for (int x = 0; x < TW; x++)
+            for (int c = 0; c < 4; c++)
+                data[(y * TW + x) * 4 + c] = img && x < W && y < H ?
+                    img[(y * W + x) * 4 + c] : 1e3 + rand() % 100;
+    glGenTextures(1, &t);
+    glBindTexture(GL_TEXTURE_2D, t);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, TW, TH, 0, GL_RGBA, GL_FLOAT,
+                 data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    free(data);
+    return t;
+}
+
+static void run(GLuint program, GLuint tex1, GLuint tex2, float *out)
+{
+    GLuint tex = create_texture(NULL), fbo;
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, tex, 0);
+    glViewport(0, 0, W, H);
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, tex2);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex1);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glReadPixels(0, 0, W, H, GL_RGBA, GL_FLOAT, out);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &tex);
+}
+
+static float *cur, *prev;
+
+static float px(const float *img, int x, int y, int c)
+{
+    x = x < 0 ? 0 : x >= W ? W - 1 : x;
+    y = y < 0 ? 0 : y >= H ? H - 1 : y;
+    return img[(y * W + x) * 4 + c];
+}
+
+static float diff3(int x1, int y1, int x2, int y2)
+{
+    float s = 0;
+    for (int c = 0; c < 3; c++)
+        s += fabsf(px(cur, x1, y1, c) - px(cur, x2, y2, c));
+    return s;
+}
+
+static void deint_c(int parity, float *out)
+{
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float *o = &out[(y * W + x) * 4];
+            o[3] = 1;
+            if ((y & 1) == parity) {
+                for (int c = 0; c < 3; c++)
+                    o[c] = px(cur, x, y, c);
+                continue;
+            }
+            float score = diff3(x - 1, y + 1, x - 1, y - 1)
+                        + diff3(x, y + 1, x, y - 1)
+                        + diff3(x + 1, y + 1, x + 1, y - 1);
+            int dir = 0;
+            for (int j = -2; j <= 2; j++) {
+                if (!j)
+                    continue;
+                float s = diff3(x + j - 1, y + 1, x - j - 1, y - 1)
+                        + diff3(x + j, y + 1, x - j, y - 1)
+                        + diff3(x + j + 1, y + 1, x - j + 1, y - 1);
+                if (s < score) {
+                    score = s;
+                    dir = j;
+                }
+            }
+            for (int c = 0; c < 3; c++) {
+                float a = px(cur, x, y + 1, c), e = px(cur, x, y - 1, c);
+                float p0 = px(prev, x, y, c), n0 = px(cur, x, y, c);
+                float d = (p0 + n0) / 2;
+                float diff = fmaxf(fabsf(p0 - n0) / 2,
+                                   (fabsf(px(prev, x, y + 1, c) - a)
+                                    + fabsf(px(prev, x, y - 1, c) - e)) / 2);
+                float spatial = (px(cur, x + dir, y + 1, c)
+                                 + px(cur, x - dir, y - 1, c)) / 2;
+                float b = (px(prev, x, y + 2, c) + px(cur, x, y + 2, c)) / 2;
+                float f = (px(prev, x, y - 2, c) + px(cur, x, y - 2, c)) / 2;
+                float hi = fmaxf(fmaxf(d - e, d - a), fminf(b - a, f - e));
+                float lo = fminf(fminf(d - e, d - a), fmaxf(b - a, f - e));
+                diff = fmaxf(fmaxf(diff, lo), -hi);
+                o[c] = fminf(fmaxf(spatial, d - diff), d + diff);
+            }
+        }
+    }
+}
+
+static void denoise_c(float strength, float *out)
+{
+    for (int i = 0; i < W * H * 4; i++) {
+        float c = cur[i], p = prev[i];
+        float t = fminf(fmaxf(fabsf(c - p) / (16.0f / 255), 0), 1);
+        float w = strength * (1 - t * t * (3 - 2 * t));
+        out[i] = (i & 3) == 3 ? 1 : c + (p - c) * w;
+    }
+}
+
+static double max_diff(const float *a, const float *b)
+{
+    double m = 0;
+    for (int i = 0; i < W * H * 4; i++)
+        m = fmax(m, fabs(a[i] - b[i]));
+    return m;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "libvo/vo_gl3_shaders.glsl";
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (void *)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLint ctx_attr[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLDisplay dpy;
+    EGLContext ctx;
+    static char src[1 << 20];
+    FILE *f;
+    int fail = 0;
+
+    if (!get_platform_display) {
+        printf("No eglGetPlatformDisplayEXT.\n");
+        return 1;
+    }
+    dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                               EGL_DEFAULT_DISPLAY, NULL);
+    if (!eglInitialize(dpy, NULL, NULL)) {
+        printf("Could not initialize EGL.\n");
+        return 1;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+    ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, ctx_attr);
+    if (!ctx || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        printf("Could not create an OpenGL 3.2 context.\n");
+        return 1;
+    }
+    printf("GL renderer: %s\n", glGetString(GL_RENDERER));
+
+    f = fopen(path, "rb");
+    if (!f) {
+        printf("Could not open %s.\n", path);
+        return 1;
+    }
+    src[fread(src, 1, sizeof(src) - 1, f)] = 0;
+    fclose(f);
+
+    GLuint vao, vbo;
+    float quad[] = {-1, -1, 1, -1, -1, 1, 1, 1};
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+    GLuint deint = create_program(src, "frag_deint");
+    GLuint denoise = create_program(src, "frag_denoise");
+    glUseProgram(deint);
+    glUniform2i(glGetUniformLocation(deint, "video_size"), W, H);
+
+    cur = malloc(W * H * 16);
+    prev = malloc(W * H * 16);
+    float *out = malloc(W * H * 16), *ref = malloc(W * H * 16);
+
+    // A bar moving right over a noisy gradient, with the odd lines half a
+    // frame later than the even ones. It touches the right edge.
+    srand(1);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int xc = W - 12 + (y & 1) * 2, xp = W - 20 + (y & 1) * 2;
+            for (int c = 0; c < 4; c++) {
+                float bg = (float)(x + y) / (W + H) + rand() % 100 / 5000.0f;
+                cur[(y * W + x) * 4 + c] = x >= xc && x < xc + 8 ? 1 : bg;
+                prev[(y * W + x) * 4 + c] = x >= xp && x < xp + 8 ? 1 : bg;
+            }
+        }
+    }
+    GLuint tex_cur = create_texture(cur), tex_prev = create_texture(prev);
+
+    for (int parity = 0; parity < 2; parity++) {
+        glUseProgram(deint);
+        glUniform1i(glGetUniformLocation(deint, "field_parity"), parity);
+        run(deint, tex_cur, tex_prev, out);
+        deint_c(parity, ref);
+        double d = max_diff(out, ref);
+        printf("deint, field parity %d: max difference %g\n", parity, d);
+        fail |= d > MAX_ERR;
+    }
+
+    int comb_in = 0, comb_out = 0;
+    for (int y = 1; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int i = (y * W + x) * 4;
+            comb_in += fabsf(cur[i] - cur[i - W * 4]) > 0.5f;
+            comb_out += fabsf(out[i] - out[i - W * 4]) > 0.5f;
+        }
+    }
+    printf("deint: %d combing edges in, %d out\n", comb_in, comb_out);
+
+    glUseProgram(denoise);
+    glUniform1f(glGetUniformLocation(denoise, "denoise_strength"), 0.5);
+    run(denoise, tex_cur, tex_prev, out);
+    denoise_c(0.5, ref);
+    double d = max_diff(out, ref);
+    printf("denoise: max difference %g\n", d);
+    fail |= d > MAX_ERR;
+
+    printf(fail ? "FAILED\n" : "OK\n");
+    return fail;
+}
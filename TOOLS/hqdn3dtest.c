@@ -0,0 +1,192 @@
+/*
+ * test for the SIMD versions of the hqdn3d filter
+ *
+ * Runs the same sequence of noisy, moving YV12 frames through vf_hqdn3d
+ * with the CPU features limited to none (plain C), SSE4.1 and AVX2, with
+ * spatial-only, temporal-only and combined parameters, and checks that
+ * every output frame is bit-identical to the C one. Also prints the
+ * frames per second of each version.
+ *
+ * usage: hqdn3dtest [width [height [frames]]]
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "libmpcodecs/img_format.h"
+#include "libmpcodecs/mp_image.h"
+#include "libmpcodecs/vf.h"
+#include "libmpcodecs/vfcap.h"
+
+// the sink filter appends every frame it gets to its buffer
+struct vf_priv_s {
+    unsigned char *buf;
+    int pos;
+};
+
+static int sink_query_format(struct vf_instance *vf, unsigned int fmt)
+{
+    return VFCAP_CSP_SUPPORTED | VFCAP_ACCEPT_STRIDE;
+}
+
+static int sink_config(struct vf_instance *vf, int width, int height,
+                       int d_width, int d_height, unsigned int flags,
+                       unsigned int outfmt)
+{
+    return 1;
+}
+
+static int sink_put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
+{
+    int n, y;
+
+    for (n = 0; n < 3; n++) {
+        int w = n ? mpi->chroma_width : mpi->w;
+        int h = n ? mpi->chroma_height : mpi->h;
+        for (y = 0; y < h; y++) {
+            memcpy(vf->priv->buf + vf->priv->pos,
+                   mpi->planes[n] + y * mpi->stride[n], w);
+            vf->priv->pos += w;
+        }
+    }
+    return 1;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// noise on a pattern that moves by a pixel per frame, in parts static
+static void make_frame(mp_image_t *mpi, int frame)
+{
+    int n, x, y;
+
+    for (n = 0; n < 3; n++) {
+        int w = n ? mpi->chroma_width : mpi->w;
+        int h = n ? mpi->chroma_height : mpi->h;
+        for (y = 0; y < h; y++) {
+            unsigned char *line = mpi->planes[n] + y * mpi->stride[n];
+            for (x = 0; x < w; x++) {
+                int shift = y < h / 2 ? frame : 0;
+                int v = ((x + shift) * 3 + y * 5) % 200 + 28 + n * 10;
+                line[x] = v + rand() % 25 - 12;
+            }
+        }
+    }
+}
+
+// returns the frames per second, or -1 if the filter could not be set up
+static double run(const char *params, int w, int h, int frames,
+                  unsigned char *out)
+{
+    struct vf_priv_s priv = { .buf = out };
+    vf_instance_t sink = {
+        .query_format = sink_query_format,
+        .config       = sink_config,
+        .put_image    = sink_put_image,
+        .priv         = &priv,
+    };
+    char *args[] = { "_oldargs_", (char *)params, NULL };
+    vf_instance_t *vf = vf_open_filter(NULL, &sink, "hqdn3d", args);
+    mp_image_t *mpi;
+    double t = 0;
+    int i;
+
+    if (!vf)
+        return -1;
+    if (!vf_config_wrapper(vf, w, h, w, h, 0, IMGFMT_YV12)) {
+        vf_uninit_filter(vf);
+        return -1;
+    }
+    mpi = alloc_mpi(w, h, IMGFMT_YV12);
+    srand(1);
+    for (i = 0; i < frames; i++) {
+        double t0;
+        make_frame(mpi, i);
+        t0 = now();
+        vf->put_image(vf, mpi, MP_NOPTS_VALUE);
+        t += now() - t0;
+    }
+    free_mp_image(mpi);
+    free_mp_image(sink.imgctx.temp_images[0]);
+    vf_uninit_filter(vf);
+    return t > 0 ? frames / t : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *params[] = { "4:3:6:4.5", "4:3:0:0", "0:0:6:4.5" };
+    static const char *levels[] = { "C", "SSE4.1", "AVX2" };
+    int w = argc > 1 ? atoi(argv[1]) : 723;
+    int h = argc > 2 ? atoi(argv[2]) : 401;
+    int frames = argc > 3 ? atoi(argv[3]) : 10;
+    int size, p, l, failed = 0;
+    unsigned char *ref, *out;
+    CpuCaps caps;
+
+    if (w < 2 || h < 2 || frames <= 0)
+        return 1;
+    GetCpuCaps(&caps);
+    size = (w * h + 2 * (w >> 1) * (h >> 1)) * frames;
+    ref = malloc(size);
+    out = malloc(size);
+
+    printf("%dx%d, %d frames\n", w, h, frames);
+    for (p = 0; p < sizeof(params) / sizeof(*params); p++) {
+        for (l = 0; l < 3; l++) {
+            double fps;
+            if ((l == 1 && !caps.hasSSE4) || (l == 2 && !caps.hasAVX2)) {
+                printf("%-10s %-7s not supported by this CPU\n",
+                       params[p], levels[l]);
+                continue;
+            }
+            memset(&gCpuCaps, 0, sizeof(gCpuCaps));
+            gCpuCaps.hasSSE4 = l >= 1;
+            gCpuCaps.hasAVX2 = l >= 2;
+            memset(out, 0, size);
+            fps = run(params[p], w, h, frames, l ? out : ref);
+            if (fps < 0) {
+                printf("%-10s %-7s could not open the filter\n",
+                       params[p], levels[l]);
+                failed++;
+                continue;
+            }
+            if (l && memcmp(ref, out, size)) {
+                int i = 0;
+                while (ref[i] == out[i])
+                    i++;
+                printf("%-10s %-7s MISMATCH at byte %d: %d instead of %d\n",
+                       params[p], levels[l], i, out[i], ref[i]);
+                failed++;
+                continue;
+            }
+            printf("%-10s %-7s %s %8.1f fps\n", params[p], levels[l],
+                   l ? "ok " : "ref", fps);
+        }
+    }
+    gCpuCaps = caps;
+    free(ref);
+    free(out);
+    return !!failed;
+}
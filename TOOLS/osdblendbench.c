@@ -0,0 +1,130 @@
+/*
+ * benchmark for the OSD alpha blenders
+ *
+ * Blends a synthetic OSD bitmap (partly transparent, like rendered text)
+ * into a frame with vo_draw_alpha_yv12/yuy2/rgb24/rgb32 and prints the
+ * megapixels per second of each blender with the CPU features limited to
+ * none (plain C or x86), MMX, SSE2/SSSE3 and AVX2.
+ *
+ * usage: osdblendbench [width [height [iterations]]]
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "libvo/osd.h"
+
+typedef void (*blend_fn)(int w, int h, unsigned char *src,
+                         unsigned char *srca, int srcstride,
+                         unsigned char *dstbase, int dststride);
+
+static const struct {
+    const char *name;
+    blend_fn fn;
+    int bpp;
+} blenders[] = {
+    { "yv12",  vo_draw_alpha_yv12,  1 },
+    { "yuy2",  vo_draw_alpha_yuy2,  2 },
+    { "rgb24", vo_draw_alpha_rgb24, 3 },
+    { "rgb32", vo_draw_alpha_rgb32, 4 },
+};
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double run(blend_fn fn, int bpp, int w, int h, int iterations,
+                  unsigned char *src, unsigned char *srca, int stride)
+{
+    int dststride = (w * bpp + 31) & ~31;
+    unsigned char *dst = malloc(dststride * h);
+    double t;
+    int i;
+
+    for (i = 0; i < dststride * h; i++)
+        dst[i] = i * 7;
+    t = now();
+    for (i = 0; i < iterations; i++)
+        fn(w, h, src, srca, stride, dst, dststride);
+    t = now() - t;
+    free(dst);
+    return t > 0 ? (double)w * h * iterations / t / 1e6 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *levels[] = { "plain", "MMX", "SSE2", "AVX2" };
+    int w = argc > 1 ? atoi(argv[1]) : 1280;
+    int h = argc > 2 ? atoi(argv[2]) : 120;
+    int iterations = argc > 3 ? atoi(argv[3]) : 500;
+    // the MMX blenders read up to 8 pixels past w
+    int stride = (w + 15) & ~7;
+    unsigned char *src, *srca;
+    CpuCaps caps;
+    int b, l, i;
+
+    if (w <= 0 || h <= 0 || iterations <= 0)
+        return 1;
+    GetCpuCaps(&caps);
+
+    // glyph-like runs of opaque, antialiased and transparent pixels
+    src  = malloc(stride * h);
+    srca = malloc(stride * h);
+    for (i = 0; i < stride * h; i++) {
+        int x = i % stride;
+        int run = (x / 8 + i / stride / 4) % 4;
+        srca[i] = run == 0 ? 0 : run == 1 ? 1 : rand() & 0xff;
+        src[i]  = srca[i] ? (256 - srca[i]) & 0xff : 0;
+    }
+
+    printf("%dx%d OSD, %d iterations, megapixels per second\n",
+           w, h, iterations);
+    printf("%-6s", "");
+    for (l = 0; l < 4; l++)
+        printf(" %9s", levels[l]);
+    printf("\n");
+    for (b = 0; b < sizeof(blenders) / sizeof(*blenders); b++) {
+        printf("%-6s", blenders[b].name);
+        for (l = 0; l < 4; l++) {
+            memset(&gCpuCaps, 0, sizeof(gCpuCaps));
+            if (l >= 1) {
+                gCpuCaps.hasMMX  = caps.hasMMX;
+                gCpuCaps.hasMMX2 = caps.hasMMX2;
+            }
+            if (l >= 2) {
+                gCpuCaps.hasSSE2  = caps.hasSSE2;
+                gCpuCaps.hasSSSE3 = caps.hasSSSE3;
+            }
+            if (l >= 3)
+                gCpuCaps.hasAVX2 = caps.hasAVX2;
+            printf(" %9.1f", run(blenders[b].fn, blenders[b].bpp, w, h,
+                                 iterations, src, srca, stride));
+        }
+        printf("\n");
+    }
+    gCpuCaps = caps;
+    free(src);
+    free(srca);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * benchmark for the scaletempo audio filter
+ *
+ * Feeds noise through af_scaletempo at several speeds and channel counts
+ * and prints the input sample rate the filter sustains, once with the
+ * plain C correlation and once with the SIMD version picked for this CPU.
+ *
+ * usage: scaletempobench [seconds of audio per run]
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "cpudetect.h"
+#include "libaf/af.h"
+
+extern af_info_t af_info_scaletempo;
+
+#define RATE  48000
+#define CHUNK 4096      // frames per play() call
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double run(int format, int nch, float speed, int seconds)
+{
+    af_instance_t af = { .info = &af_info_scaletempo };
+    af_data_t in = { .rate = RATE, .nch = nch, .format = format };
+    char opts[32];
+    int bps = format == AF_FORMAT_S16_NE ? 2 : 4;
+    int chunks = seconds * RATE / CHUNK;
+    void *buf = malloc(CHUNK * nch * bps);
+    double t;
+    int i;
+
+    for (i = 0; i < CHUNK * nch; i++) {
+        if (bps == 2)
+            ((int16_t *)buf)[i] = rand() - RAND_MAX / 2;
+        else
+            ((float *)buf)[i] = (float)rand() / RAND_MAX * 2 - 1;
+    }
+    in.bps = bps;
+
+    if (af.info->open(&af) != AF_OK)
+        return 0;
+    snprintf(opts, sizeof(opts), "scale=%f", speed);
+    af.control(&af, AF_CONTROL_COMMAND_LINE, opts);
+    if (af.control(&af, AF_CONTROL_REINIT, &in) != AF_OK)
+        return 0;
+
+    t = now();
+    for (i = 0; i < chunks; i++) {
+        af_data_t d = in;
+        d.audio = buf;
+        d.len   = CHUNK * nch * bps;
+        af.play(&af, &d);
+    }
+    t = now() - t;
+
+    af.uninit(&af);
+    free(buf);
+    return t > 0 ? (double)chunks * CHUNK * nch / t : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const float speeds[] = { 1.25, 1.5, 2.0 };
+    static const int channels[] = { 1, 2, 6, 8 };
+    static const int formats[] = { AF_FORMAT_S16_NE, AF_FORMAT_FLOAT_NE };
+    CpuCaps caps;
+    int seconds = argc > 1 ? atoi(argv[1]) : 20;
+    int f, c, s;
+
+    GetCpuCaps(&caps);
+    if (seconds <= 0)
+        seconds = 20;
+
+    printf("%-6s %3s %5s %14s %14s %7s\n",
+           "format", "nch", "speed", "C samples/s", "SIMD samples/s", "gain");
+    for (f = 0; f < 2; f++)
+        for (c = 0; c < sizeof(channels) / sizeof(*channels); c++)
+            for (s = 0; s < sizeof(speeds) / sizeof(*speeds); s++) {
+                double plain, simd;
+                memset(&gCpuCaps, 0, sizeof(gCpuCaps));
+                plain = run(formats[f], channels[c], speeds[s], seconds);
+                gCpuCaps = caps;
+                simd = run(formats[f], channels[c], speeds[s], seconds);
+                printf("%-6s %3d %5.2f %14.0f %14.0f %6.2fx\n",
+                       f ? "float" : "s16", channels[c], speeds[s],
+                       plain, simd, plain > 0 ? simd / plain : 0);
+            }
+    return 0;
+}
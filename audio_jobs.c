@@ -0,0 +1,305 @@
+/*
+ * Batch audio decoding on worker threads
+ *
+ * This file is part of mplayer2.
+ *
+ * mplayer2 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mplayer2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mplayer2; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* Every job opens its own stream and demuxer, so jobs share no playback
+ * state. Several tracks of one file are decoded by reading the file once
+ * per track. Opening and closing (stream probing, codec, filter and ao
+ * init, also a filter rebuild after a format change) is not thread-safe in
+ * several libraries and runs under open_lock; decoding,
+ * filtering and writing run in parallel. Decoders that keep global state
+ * between calls (liba52, faad, ...) hold driver_lock from codec init until
+ * after uninit, so only one job at a time uses them. Codec init always
+ * takes driver_lock, as the driver is only known after it; when both locks
+ * are held, driver_lock is taken first. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "config.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#include <libavutil/common.h>
+
+#include "talloc.h"
+#include "mp_msg.h"
+#include "options.h"
+#include "path.h"
+#include "mplayer.h"
+#include "audio_jobs.h"
+#include "stream/stream.h"
+#include "libmpdemux/demuxer.h"
+#include "libmpdemux/stheader.h"
+#include "codec-cfg.h"
+#include "libmpcodecs/dec_audio.h"
+#include "libaf/af.h"
+#include "libao2/audio_out.h"
+
+#define DECODE_CHUNK 65536
+
+struct audio_job {
+    const char *filename;
+    int aid;
+    char *ao_spec;      // "pcm:file=..." or "null"
+    bool failed;
+};
+
+struct job_queue {
+    struct MPOpts *opts;
+    int force_srate;
+    struct audio_job *jobs;
+    int num_jobs;
+    int next;
+#ifdef HAVE_PTHREADS
+    pthread_mutex_t lock;       // protects next
+#endif
+};
+
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t driver_lock = PTHREAD_MUTEX_INITIALIZER;
+#define OPEN_LOCK()     pthread_mutex_lock(&open_lock)
+#define OPEN_UNLOCK()   pthread_mutex_unlock(&open_lock)
+#define DRIVER_LOCK()   pthread_mutex_lock(&driver_lock)
+#define DRIVER_UNLOCK() pthread_mutex_unlock(&driver_lock)
+#else
+#define OPEN_LOCK()
+#define OPEN_UNLOCK()
+#define DRIVER_LOCK()
+#define DRIVER_UNLOCK()
+#endif
+
+// audio decoders known to keep all their state in the sh_audio
+static const char * const reentrant_drivers[] = {
+    "ffmpeg", "pcm", "dvdpcm", "alaw", "imaadpcm", "msadpcm", "dk3adpcm",
+    "libvorbis", "speex", "mpg123", "libmad", NULL
+};
+
+static bool driver_is_reentrant(sh_audio_t *sh)
+{
+    for (int i = 0; reentrant_drivers[i]; i++)
+        if (!strcmp(sh->codec->drv, reentrant_drivers[i]))
+            return true;
+    return false;
+}
+
+static char *make_ao_spec(void *ctx, char **ao_list, const char *filename,
+                          int aid, bool multi_track)
+{
+    if (ao_list && ao_list[0] && !strcmp(ao_list[0], "null"))
+        return talloc_strdup(ctx, "null");
+
+    char *name = talloc_strdup(ctx, mp_basename(filename));
+    char *ext = strrchr(name, '.');
+    if (ext && ext != name)
+        *ext = '\0';
+    if (multi_track)
+        name = talloc_asprintf(ctx, "%s.a%d.wav", name, aid);
+    else
+        name = talloc_asprintf(ctx, "%s.wav", name);
+    // length-prefixed so that ':' and ',' in file names survive subopt parsing
+    return talloc_asprintf(ctx, "pcm:file=%%%zu%%%s", strlen(name), name);
+}
+
+static bool run_job(struct job_queue *q, struct audio_job *job)
+{
+    struct MPOpts *opts = q->opts;
+    int file_format = DEMUXER_TYPE_UNKNOWN;
+    stream_t *stream = NULL;
+    demuxer_t *demuxer = NULL;
+    sh_audio_t *sh = NULL;
+    struct ao *ao = NULL;
+    char *ao_list[] = { job->ao_spec, NULL };
+    bool ok = false, serialize = false;
+
+    OPEN_LOCK();
+    stream = open_stream(job->filename, opts, &file_format);
+    if (!stream)
+        goto open_fail;
+    demuxer = demux_open(opts, stream, file_format, job->aid, -2, -2,
+                         (char *)job->filename);
+    if (!demuxer || !demuxer->audio || !demuxer->audio->sh) {
+        mp_msg(MSGT_CPLAYER, MSGL_ERR, "[audio-jobs] %s: no audio track %d\n",
+               job->filename, job->aid);
+        goto open_fail;
+    }
+    OPEN_UNLOCK();
+
+    DRIVER_LOCK();
+    OPEN_LOCK();
+    serialize = true;
+    sh = demuxer->audio->sh;
+    if (!init_best_audio_codec(sh, audio_codec_list, audio_fm_list)) {
+        sh = NULL;
+        goto open_fail;
+    }
+    if (driver_is_reentrant(sh)) {
+        serialize = false;
+        DRIVER_UNLOCK();
+    }
+
+    ao = ao_create(opts, NULL);
+    ao->samplerate = q->force_srate;
+    ao->format = opts->audio_output_format;
+    // preliminary init to find the ao parameters, then the real chain
+    if (!init_audio_filters(sh, sh->samplerate,
+                            &ao->samplerate, &ao->channels, &ao->format))
+        goto open_fail;
+    ao_init(ao, ao_list);
+    if (!ao->initialized) {
+        mp_msg(MSGT_CPLAYER, MSGL_ERR, "[audio-jobs] %s: could not open "
+               "audio output '%s'\n", job->filename, job->ao_spec);
+        goto open_fail;
+    }
+    ao->buffer.start = talloc_new(ao);
+    if (!init_audio_filters(sh, sh->samplerate,
+                            &ao->samplerate, &ao->channels, &ao->format))
+        goto open_fail;
+    OPEN_UNLOCK();
+
+    mp_msg(MSGT_CPLAYER, MSGL_INFO, "[audio-jobs] %s (aid %d) -> %s\n",
+           job->filename, job->aid, job->ao_spec);
+
+    int unitsize = ao->channels * af_fmt2bits(ao->format) / 8;
+    while (1) {
+        int res = decode_audio(sh, &ao->buffer, DECODE_CHUNK);
+        if (res == -2) {
+            // format change: rebuild the chain towards the same output
+            int rate = ao->samplerate, nch = ao->channels, fmt = ao->format;
+            OPEN_LOCK();
+            int ok = init_audio_filters(sh, sh->samplerate, &rate, &nch, &fmt);
+            OPEN_UNLOCK();
+            if (!ok || rate != ao->samplerate || nch != ao->channels
+                || fmt != ao->format) {
+                mp_msg(MSGT_CPLAYER, MSGL_ERR, "[audio-jobs] %s: audio "
+                       "format changed mid-stream, stopping\n", job->filename);
+                res = -1;
+            }
+        }
+        if (res == -2)
+            continue;
+
+        bool eof = res < 0;
+        int len = ao->buffer.len - ao->buffer.len % unitsize;
+        if (len) {
+            int played = ao_play(ao, ao->buffer.start, len,
+                                 eof ? AOPLAY_FINAL_CHUNK : 0);
+            if (played > 0) {
+                ao->buffer.len -= played;
+                memmove(ao->buffer.start, ao->buffer.start + played,
+                        ao->buffer.len);
+            }
+        }
+        if (eof)
+            break;
+    }
+    ok = demuxer->audio->eof;
+    if (!ok)
+        mp_msg(MSGT_CPLAYER, MSGL_ERR, "[audio-jobs] %s: decoding error\n",
+               job->filename);
+    OPEN_LOCK();
+
+open_fail:
+    if (ao) {
+        ao->buffer.len = ao->buffer_playable_size = 0;
+        ao_uninit(ao, false);
+    }
+    if (sh)
+        uninit_audio(sh);
+    if (demuxer)
+        free_demuxer(demuxer);
+    if (stream)
+        free_stream(stream);
+    OPEN_UNLOCK();
+    if (serialize)
+        DRIVER_UNLOCK();
+    return ok;
+}
+
+static void *worker(void *arg)
+{
+    struct job_queue *q = arg;
+    while (1) {
+#ifdef HAVE_PTHREADS
+        pthread_mutex_lock(&q->lock);
+#endif
+        int n = q->next < q->num_jobs ? q->next++ : -1;
+#ifdef HAVE_PTHREADS
+        pthread_mutex_unlock(&q->lock);
+#endif
+        if (n < 0)
+            return NULL;
+        q->jobs[n].failed = !run_job(q, &q->jobs[n]);
+    }
+}
+
+int audio_jobs_run(struct MPOpts *opts, char **files, int num_files,
+                   int force_srate)
+{
+    void *ctx = talloc_new(NULL);
+    struct job_queue q = { .opts = opts, .force_srate = force_srate };
+    char **aids = opts->audio_jobs_aid;
+    int num_aids = 0, failed = 0;
+
+    while (aids && aids[num_aids])
+        num_aids++;
+    q.jobs = talloc_zero_array(ctx, struct audio_job,
+                               num_files * FFMAX(num_aids, 1));
+    for (int f = 0; f < num_files; f++) {
+        for (int a = 0; a < FFMAX(num_aids, 1); a++) {
+            struct audio_job *job = &q.jobs[q.num_jobs++];
+            job->filename = files[f];
+            job->aid = num_aids ? atoi(aids[a]) : opts->audio_id;
+            job->ao_spec = make_ao_spec(ctx, opts->audio_driver_list, files[f],
+                                        job->aid, num_aids > 1);
+        }
+    }
+
+    int threads = FFMIN(opts->audio_jobs, q.num_jobs);
+    mp_msg(MSGT_CPLAYER, MSGL_INFO, "[audio-jobs] %d jobs on %d threads\n",
+           q.num_jobs, threads);
+#ifdef HAVE_PTHREADS
+    pthread_t *tids = talloc_array(ctx, pthread_t, threads);
+    int started = 0;
+    pthread_mutex_init(&q.lock, NULL);
+    for (; started < threads; started++)
+        if (pthread_create(&tids[started], NULL, worker, &q))
+            break;
+    if (!started)
+        worker(&q);
+    for (int i = 0; i < started; i++)
+        pthread_join(tids[i], NULL);
+    pthread_mutex_destroy(&q.lock);
+#else
+    worker(&q);
+#endif
+
+    for (int i = 0; i < q.num_jobs; i++) {
+        if (q.jobs[i].failed) {
+            mp_msg(MSGT_CPLAYER, MSGL_ERR, "[audio-jobs] failed: %s (aid %d)\n",
+                   q.jobs[i].filename, q.jobs[i].aid);
+            failed++;
+        }
+    }
+    talloc_free(ctx);
+    return failed;
+}
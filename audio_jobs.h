@@ -0,0 +1,30 @@
+/*
+ * This file is part of mplayer2.
+ *
+ * mplayer2 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mplayer2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mplayer2; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPLAYER_AUDIO_JOBS_H
+#define MPLAYER_AUDIO_JOBS_H
+
+struct MPOpts;
+
+// Decode the audio of every file (and every track in opts->audio_jobs_aid)
+// on opts->audio_jobs worker threads. Each job has its own demuxer,
+// decoder, filter chain and ao. Returns the number of failed jobs.
+int audio_jobs_run(struct MPOpts *opts, char **files, int num_files,
+                   int force_srate);
+
+#endif /* MPLAYER_AUDIO_JOBS_H */
@@ -676,6 +676,10 @@ const m_option_t mplayer_opts[]={
     OPT_MAKE_FLAGS("gapless-audio", gapless_audio, 0),
     // override audio buffer size (used only by -ao oss/win32, obsolete)
     OPT_INT("abs", ao_buffersize, 0),
+    OPT_INTRANGE("ao-thread", ao_thread_ms, 0, 0, 10000),
+    // decode all files (and tracks) to pcm/null on worker threads
+    OPT_INTRANGE("audio-jobs", audio_jobs, 0, 0, 64),
+    OPT_STRINGLIST("audio-jobs-aid", audio_jobs_aid, 0),
 
     {"edlout", &edl_output_filename,  CONF_TYPE_STRING, 0, 0, 0, NULL},
 
@@ -732,6 +736,8 @@ const m_option_t mplayer_opts[]={
     {"grabpointer", &vo_grabpointer, CONF_TYPE_FLAG, 0, 0, 1, NULL},
     {"nograbpointer", &vo_grabpointer, CONF_TYPE_FLAG, 0, 1, 0, NULL},
     OPT_INTRANGE("cursor-autohide-delay", cursor_autohide_delay, 0, -2, 30000),
+    OPT_INTRANGE("vo-pacing", vo_pacing, 0, 0, 8),
+    OPT_FLOATRANGE("display-fps", vo_display_fps, 0, 0, 1000),
 
     {"adapter", &vo_adapter_num, CONF_TYPE_INT, CONF_RANGE, 0, 5, NULL},
     {"refreshrate",&vo_refresh_rate,CONF_TYPE_INT,CONF_RANGE, 0,100, NULL},
@@ -783,6 +789,7 @@ const m_option_t mplayer_opts[]={
 
     {"framedrop", &frame_dropping, CONF_TYPE_FLAG, 0, 0, 1, NULL},
     {"hardframedrop", &frame_dropping, CONF_TYPE_FLAG, 0, 0, 2, NULL},
+    {"adaptive-framedrop", &frame_dropping, CONF_TYPE_FLAG, 0, 0, 3, NULL},
     {"noframedrop", &frame_dropping, CONF_TYPE_FLAG, 0, 1, 0, NULL},
 
     OPT_INTRANGE("autoq", auto_quality, 0, 0, 100),
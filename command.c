@@ -907,6 +907,28 @@ static int mp_property_balance(m_option_t *prop, int action, void *arg,
     return M_PROPERTY_NOT_IMPLEMENTED;
 }
 
+/// Loudness measured by the loudnorm filter (RO)
+static int mp_property_loudness(m_option_t *prop, int action, void *arg,
+                                MPContext *mpctx)
+{
+    float l[3];
+    int i = !strcmp(prop->name, "loudness_momentary") ? 0 :
+            !strcmp(prop->name, "loudness_shortterm") ? 1 : 2;
+    if (!mpctx->sh_audio || !mpctx->sh_audio->afilter
+        || !af_control_any_rev(mpctx->sh_audio->afilter,
+                               AF_CONTROL_LOUDNORM_LOUDNESS | AF_CONTROL_GET,
+                               l))
+        return M_PROPERTY_UNAVAILABLE;
+    switch (action) {
+    case M_PROPERTY_PRINT:
+        if (!arg)
+            return M_PROPERTY_ERROR;
+        *(char **)arg = talloc_asprintf(NULL, "%.1f LUFS", l[i]);
+        return M_PROPERTY_OK;
+    }
+    return m_property_float_ro(prop, action, arg, l[i]);
+}
+
 /// Selected audio id (RW)
 static int mp_property_audio(m_option_t *prop, int action, void *arg,
                              MPContext *mpctx)
@@ -1362,13 +1384,24 @@ static int mp_property_framedropping(m_option_t *prop, int action,
         *(char **) arg = talloc_strdup(NULL, frame_dropping == 1 ?
                                        mp_gtext("enabled") :
                                        (frame_dropping == 2 ? mp_gtext("hard") :
-                                        mp_gtext("disabled")));
+                                       (frame_dropping == 3 ? mp_gtext("adaptive") :
+                                        mp_gtext("disabled"))));
         return M_PROPERTY_OK;
     default:
         return m_property_choice(prop, action, arg, &frame_dropping);
     }
 }
 
+/// Decoder skip level chosen by adaptive framedrop (RO)
+static int mp_property_framedrop_level(m_option_t *prop, int action,
+                                       void *arg, MPContext *mpctx)
+{
+    if (!mpctx->sh_video)
+        return M_PROPERTY_UNAVAILABLE;
+    return m_property_int_ro(prop, action, arg,
+                             mpctx->sh_video->framedrop_level);
+}
+
 /// Color settings, try to use vf/vo then fall back on TV. (RW)
 static int mp_property_gamma(m_option_t *prop, int action, void *arg,
                              MPContext *mpctx)
@@ -1432,6 +1465,31 @@ static int mp_property_vsync(m_option_t *prop, int action, void *arg,
     return m_property_flag(prop, action, arg, &vo_vsync);
 }
 
+/// Flip pacing statistics, only if flips wait for vsync (RO)
+static int mp_property_vo_pacer(m_option_t *prop, int action, void *arg,
+                                MPContext *mpctx)
+{
+    struct vo *vo = mpctx->video_out;
+    if (!vo || !vo->config_ok || !vo->pacer.ahead || !vo->flip_waits_vsync)
+        return M_PROPERTY_UNAVAILABLE;
+    struct vo_pacer *q = &vo->pacer;
+    if (!strcmp(prop->name, "vo_skipped_frames"))
+        return m_property_int_ro(prop, action, arg, q->skipped);
+    if (!strcmp(prop->name, "vo_duplicated_frames"))
+        return m_property_int_ro(prop, action, arg, q->duplicated);
+    if (!(q->vsync_interval > 0))
+        return M_PROPERTY_UNAVAILABLE;
+    switch (action) {
+    case M_PROPERTY_PRINT:
+        if (!arg)
+            return M_PROPERTY_ERROR;
+        *(char **)arg = talloc_asprintf(NULL, "%.3f ms",
+                                        q->vsync_interval * 1e3);
+        return M_PROPERTY_OK;
+    }
+    return m_property_float_ro(prop, action, arg, q->vsync_interval * 1e3);
+}
+
 /// Video codec tag (RO)
 static int mp_property_video_format(m_option_t *prop, int action,
                                     void *arg, MPContext *mpctx)
@@ -2258,6 +2316,12 @@ static const m_option_t mp_properties[] = {
       CONF_RANGE, -2, 65535, NULL },
     { "balance", mp_property_balance, CONF_TYPE_FLOAT,
       M_OPT_RANGE, -1, 1, NULL },
+    { "loudness_momentary", mp_property_loudness, CONF_TYPE_FLOAT,
+      0, 0, 0, NULL },
+    { "loudness_shortterm", mp_property_loudness, CONF_TYPE_FLOAT,
+      0, 0, 0, NULL },
+    { "loudness_integrated", mp_property_loudness, CONF_TYPE_FLOAT,
+      0, 0, 0, NULL },
 
     // Video
     { "fullscreen", mp_property_fullscreen, CONF_TYPE_FLAG,
@@ -2277,7 +2341,9 @@ static const m_option_t mp_properties[] = {
     { "border", mp_property_border, CONF_TYPE_FLAG,
       M_OPT_RANGE, 0, 1, NULL },
     { "framedropping", mp_property_framedropping, CONF_TYPE_INT,
-      M_OPT_RANGE, 0, 2, NULL },
+      M_OPT_RANGE, 0, 3, NULL },
+    { "framedrop_level", mp_property_framedrop_level, CONF_TYPE_INT,
+      M_OPT_RANGE, 0, 3, NULL },
     { "gamma", mp_property_gamma, CONF_TYPE_INT,
       M_OPT_RANGE, -100, 100, .offset = offsetof(struct MPOpts, vo_gamma_gamma)},
     { "brightness", mp_property_gamma, CONF_TYPE_INT,
@@ -2292,6 +2358,12 @@ static const m_option_t mp_properties[] = {
       M_OPT_RANGE, 0, 1, NULL },
     { "vsync", mp_property_vsync, CONF_TYPE_FLAG,
       M_OPT_RANGE, 0, 1, NULL },
+    { "vsync_interval", mp_property_vo_pacer, CONF_TYPE_FLOAT,
+      0, 0, 0, NULL },
+    { "vo_skipped_frames", mp_property_vo_pacer, CONF_TYPE_INT,
+      0, 0, 0, NULL },
+    { "vo_duplicated_frames", mp_property_vo_pacer, CONF_TYPE_INT,
+      0, 0, 0, NULL },
     { "video_format", mp_property_video_format, CONF_TYPE_INT,
       0, 0, 0, NULL },
     { "video_codec", mp_property_video_codec, CONF_TYPE_STRING,
@@ -238,7 +238,7 @@ do_cpuid(unsigned int ax, unsigned int *p)
          "xchg %%"REG_b", %%"REG_S
          : "=a" (p[0]), "=S" (p[1]),
            "=c" (p[2]), "=d" (p[3])
-         : "0" (ax));
+         : "0" (ax), "2" (0));
 }
 
 void GetCpuCaps( CpuCaps *caps)
@@ -284,7 +284,20 @@ void GetCpuCaps( CpuCaps *caps)
         caps->hasSSE2 = (regs2[3] & (1 << 26 )) >> 26; // 0x4000000
         caps->hasSSE3 = (regs2[2] & 1);        // 0x0000001
         caps->hasSSSE3 = (regs2[2] & (1 << 9 )) >>  9; // 0x0000200
+        caps->hasSSE4 = (regs2[2] & (1 << 19 )) >> 19; // 0x0080000
         caps->hasMMX2 = caps->hasSSE; // SSE cpus supports mmxext too
+        // AVX2 additionally needs the OS to save the ymm registers, which
+        // it announces with OSXSAVE and the SSE and AVX bits in XCR0.
+        if (regs[0] >= 0x00000007 && (regs2[2] & (1 << 27))) {
+            unsigned int regs7[4];
+            unsigned int xcr0, xcr0_hi;
+            // xgetbv, spelled out for assemblers that do not know it
+            __asm__ volatile (".byte 0x0f, 0x01, 0xd0"
+                              : "=a" (xcr0), "=d" (xcr0_hi) : "c" (0));
+            do_cpuid(0x00000007, regs7);
+            if ((xcr0 & 6) == 6)
+                caps->hasAVX2 = (regs7[1] & (1 << 5 )) >> 5; // 0x0000020
+        }
         cl_size = ((regs2[1] >> 8) & 0xFF)*8;
         if(cl_size) caps->cl_size = cl_size;
 
@@ -330,6 +343,8 @@ void GetCpuCaps( CpuCaps *caps)
             check_os_katmai_support();
         if (!caps->hasSSE)
             caps->hasSSE2 = 0;
+        if (!caps->hasSSE2)
+            caps->hasSSE4 = caps->hasAVX2 = 0;
 //          caps->has3DNow=1;
 //          caps->hasMMX2 = 0;
 //          caps->hasMMX = 0;
@@ -351,6 +366,14 @@ void GetCpuCaps( CpuCaps *caps)
         if(caps->hasSSE2) mp_msg(MSGT_CPUDETECT,MSGL_WARN,"SSE2 supported but disabled\n");
         caps->hasSSE2=0;
 #endif
+#if !HAVE_SSE4
+        if(caps->hasSSE4) mp_msg(MSGT_CPUDETECT,MSGL_WARN,"SSE4 supported but disabled\n");
+        caps->hasSSE4=0;
+#endif
+#if !HAVE_AVX2
+        if(caps->hasAVX2) mp_msg(MSGT_CPUDETECT,MSGL_WARN,"AVX2 supported but disabled\n");
+        caps->hasAVX2=0;
+#endif
 #if !HAVE_AMD3DNOW
         if(caps->has3DNow) mp_msg(MSGT_CPUDETECT,MSGL_WARN,"3DNow supported but disabled\n");
         caps->has3DNow=0;
@@ -427,6 +450,8 @@ void GetCpuCaps( CpuCaps *caps)
     caps->hasSSE3=0;
     caps->hasSSSE3=0;
     caps->hasSSE4a=0;
+    caps->hasSSE4=0;
+    caps->hasAVX2=0;
     caps->isX86=0;
     caps->hasAltiVec = 0;
 #if HAVE_ALTIVEC
@@ -40,6 +40,8 @@ typedef struct cpucaps_s {
     int hasSSE2;
     int hasSSE3;
     int hasSSSE3;
+    int hasSSE4;  /* SSE4.1 */
+    int hasAVX2;
     int hasSSE4a;
     int isX86;
     unsigned cl_size; /* size of cache line */
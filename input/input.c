@@ -399,6 +399,10 @@ struct key_name modifier_names[] = {
 
 #define KEY_MODIFIER_MASK (KEY_MODIFIER_SHIFT | KEY_MODIFIER_CTRL | KEY_MODIFIER_ALT | KEY_MODIFIER_META)
 
+#ifndef MP_MAX_EVENT_FD
+#define MP_MAX_EVENT_FD 8
+#endif
+
 #ifndef MP_MAX_KEY_FD
 #define MP_MAX_KEY_FD 10
 #endif
@@ -470,6 +474,14 @@ struct input_ctx {
     struct input_fd cmd_fds[MP_MAX_CMD_FD];
     unsigned int num_cmd_fd;
 
+    // fds that only interrupt the wait, see mp_input_add_event_fd()
+    struct {
+        int fd;
+        bool write;
+        bool armed;
+    } event_fds[MP_MAX_EVENT_FD];
+    unsigned int num_event_fd;
+
     struct cmd_queue key_cmd_queue;
     struct cmd_queue control_cmd_queue;
 
@@ -689,6 +701,38 @@ int mp_input_add_key_fd(struct input_ctx *ictx, int fd, int select,
     return 1;
 }
 
+int mp_input_add_event_fd(struct input_ctx *ictx, int fd, bool write)
+{
+#ifdef HAVE_POSIX_SELECT
+    if (ictx->num_event_fd == MP_MAX_EVENT_FD || fd < 0)
+        return 0;
+    ictx->event_fds[ictx->num_event_fd].fd = fd;
+    ictx->event_fds[ictx->num_event_fd].write = write;
+    ictx->event_fds[ictx->num_event_fd].armed = false;
+    ictx->num_event_fd++;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void mp_input_rm_event_fd(struct input_ctx *ictx, int fd)
+{
+    for (int i = 0; i < ictx->num_event_fd; i++) {
+        if (ictx->event_fds[i].fd == fd) {
+            ictx->event_fds[i] = ictx->event_fds[--ictx->num_event_fd];
+            return;
+        }
+    }
+}
+
+void mp_input_arm_event_fd(struct input_ctx *ictx, int fd, bool arm)
+{
+    for (int i = 0; i < ictx->num_event_fd; i++)
+        if (ictx->event_fds[i].fd == fd)
+            ictx->event_fds[i].armed = arm;
+}
+
 mp_cmd_t *mp_input_parse_cmd(char *str)
 {
     int i, l;
@@ -1204,8 +1248,9 @@ static void read_events(struct input_ctx *ictx, int time)
     if (ictx->got_new_events)
         time = 0;
 #ifdef HAVE_POSIX_SELECT
-    fd_set fds;
+    fd_set fds, wfds;
     FD_ZERO(&fds);
+    FD_ZERO(&wfds);
     int max_fd = 0;
     for (int i = 0; i < ictx->num_key_fd; i++) {
         if (key_fds[i].no_select)
@@ -1221,6 +1266,13 @@ static void read_events(struct input_ctx *ictx, int time)
             max_fd = cmd_fds[i].fd;
         FD_SET(cmd_fds[i].fd, &fds);
     }
+    for (int i = 0; i < ictx->num_event_fd; i++) {
+        if (!ictx->event_fds[i].armed)
+            continue;
+        int fd = ictx->event_fds[i].fd;
+        max_fd = FFMAX(max_fd, fd);
+        FD_SET(fd, ictx->event_fds[i].write ? &wfds : &fds);
+    }
     struct timeval tv, *time_val;
     if (time >= 0) {
         tv.tv_sec = time / 1000;
@@ -1228,11 +1280,17 @@ static void read_events(struct input_ctx *ictx, int time)
         time_val = &tv;
     } else
         time_val = NULL;
-    if (select(max_fd + 1, &fds, NULL, NULL, time_val) < 0) {
+    if (select(max_fd + 1, &fds, &wfds, NULL, time_val) < 0) {
         if (errno != EINTR)
             mp_tmsg(MSGT_INPUT, MSGL_ERR, "Select error: %s\n",
                     strerror(errno));
         FD_ZERO(&fds);
+        FD_ZERO(&wfds);
+    }
+    for (int i = 0; i < ictx->num_event_fd; i++) {
+        int fd = ictx->event_fds[i].fd;
+        if (FD_ISSET(fd, ictx->event_fds[i].write ? &wfds : &fds))
+            ictx->event_fds[i].armed = false;
     }
 #else
     if (time)
@@ -218,6 +218,17 @@ int mp_input_add_key_fd(struct input_ctx *ictx, int fd, int select,
                         int read_func(void *ctx, int fd),
                         int close_func(int fd), void *ctx);
 
+/* Make the input loop return from waiting when "fd" becomes writable (or
+ * readable if "write" is false). Nothing is read from the fd; this is for
+ * AOs that want the player to wake up when the device needs data. The fd
+ * is only watched while armed, and is disarmed after it triggered, so that
+ * a device which stays ready doesn't keep the player busy.
+ * Returns 0 if not supported on this platform.
+ */
+int mp_input_add_event_fd(struct input_ctx *ictx, int fd, bool write);
+void mp_input_rm_event_fd(struct input_ctx *ictx, int fd);
+void mp_input_arm_event_fd(struct input_ctx *ictx, int fd, bool arm);
+
 // Feed a keypress (alternative to being returned from read_func above)
 void mp_input_feed_key(struct input_ctx *ictx, int code);
 
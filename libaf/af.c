@@ -49,6 +49,7 @@ extern af_info_t af_info_sinesuppress;
 extern af_info_t af_info_karaoke;
 extern af_info_t af_info_scaletempo;
 extern af_info_t af_info_stats;
+extern af_info_t af_info_loudnorm;
 extern af_info_t af_info_bs2b;
 
 static af_info_t* filter_list[]={
@@ -80,6 +81,7 @@ static af_info_t* filter_list[]={
    &af_info_karaoke,
    &af_info_scaletempo,
    &af_info_stats,
+   &af_info_loudnorm,
 #ifdef CONFIG_LIBBS2B
    &af_info_bs2b,
 #endif
@@ -443,6 +445,50 @@ static int fixup_output_format(af_stream_t* s)
     return AF_OK;
 }
 
+static int af_count_filters(af_stream_t* s, const char* name)
+{
+    int n = 0;
+    for (af_instance_t* af = s->first; af; af = af->next)
+        n += !strcmp(af->info->name, name);
+    return n;
+}
+
+/**
+ * If a filter in the middle of the chain needs float input, convert to
+ * float once at the start of the chain instead. Filters that handle both
+ * formats then run on float too, and the conversions between them go away.
+ * The change is undone if it would need more format filters.
+ * \return AF_ERROR on error, AF_OK if successful.
+ */
+static int af_float_chain(af_stream_t* s)
+{
+    af_instance_t* af;
+    int nformat;
+
+    if (s->input.format == AF_FORMAT_FLOAT_NE ||
+        AF_FORMAT_IS_AC3(s->input.format) ||
+        !strcmp(s->first->info->name, "format"))
+        return AF_OK;
+    for (af = s->first->next; af; af = af->next)
+        if (!strcmp(af->info->name, "format") &&
+            af->data->format == AF_FORMAT_FLOAT_NE)
+            break;
+    if (!af)
+        return AF_OK;
+
+    nformat = af_count_filters(s, "format");
+    if (!(af = af_prepend(s, s->first, "format=floatne")))
+        return AF_ERROR;
+    if (AF_OK != af_reinit(s, s->first))
+        return AF_ERROR;
+    if (af_count_filters(s, "format") > nformat) {
+        af_remove(s, af);
+        if (AF_OK != af_reinit(s, s->first))
+            return AF_ERROR;
+    }
+    return AF_OK;
+}
+
 /**
  * Automatic downmix to stereo in case the codec does not implement it.
  */
@@ -520,6 +566,8 @@ int af_init(af_stream_t* s)
   // Check output format
   if((AF_INIT_TYPE_MASK & s->cfg.force) != AF_INIT_FORCE){
     af_instance_t* af = NULL; // New filter
+    if (AF_OK != af_float_chain(s))
+      return -1;
     // Check output frequency if not OK fix with resample
     if(s->output.rate && s->last->data->rate!=s->output.rate){
       // try to find a filter that can change samplrate
@@ -599,6 +647,18 @@ af_data_t* af_play(af_stream_t* s, af_data_t* data)
   return data;
 }
 
+af_data_t* af_drain(af_stream_t* s, af_data_t* data)
+{
+  af_instance_t* af=s->first;
+  // Filters that don't drain don't get empty chunks
+  do{
+    if (af->control(af, AF_CONTROL_DRAIN, NULL) == AF_OK || data->len > 0)
+      data=af->play(af,data);
+    af=af->next;
+  }while(af && data);
+  return data;
+}
+
 /* Calculate the minimum output buffer size for given input data d
  * when using the RESIZE_LOCAL_BUFFER macro. The +t+1 part ensures the
  * value is >= len*mul rounded upwards to whole samples even if the
@@ -670,6 +730,15 @@ af_instance_t *af_control_any_rev (af_stream_t* s, int cmd, void* arg) {
   return NULL;
 }
 
+// documentation in af.h
+void af_control_all(af_stream_t* s, int cmd, void* arg) {
+  af_instance_t* filt = s->first;
+  while (filt) {
+    filt->control(filt, cmd, arg);
+    filt = filt->next;
+  }
+}
+
 void af_help (void) {
   int i = 0;
   mp_msg(MSGT_AFILTER, MSGL_INFO, "Available audio filters:\n");
@@ -203,6 +203,15 @@ af_instance_t* af_get(af_stream_t* s, char* name);
  */
 af_data_t* af_play(af_stream_t* s, af_data_t* data);
 
+/**
+ * \brief filter the last data chunk at the end of the input, followed by
+ *        what the filters still hold back (see AF_CONTROL_DRAIN)
+ * \param data data to play, may be empty
+ * \return resulting data
+ * \ingroup af_chain
+ */
+af_data_t* af_drain(af_stream_t* s, af_data_t* data);
+
 /**
  * \brief send control to all filters, starting with the last until
  *        one accepts the command with AF_OK.
@@ -212,6 +221,13 @@ af_data_t* af_play(af_stream_t* s, af_data_t* data);
  */
 af_instance_t *af_control_any_rev (af_stream_t* s, int cmd, void* arg);
 
+/**
+ * \brief send control to all filters, starting with the first
+ * \param cmd filter control command
+ * \param arg argument for filter command
+ */
+void af_control_all(af_stream_t* s, int cmd, void* arg);
+
 /**
  * \brief calculate average ratio of filter output lenth to input length
  * \return the ratio
@@ -321,6 +337,8 @@ void af_fix_parameters(af_data_t *data);
 /** Memory reallocation macro: if a local buffer is used (i.e. if the
    filter doesn't operate on the incoming buffer this macro must be
    called to ensure the buffer is big enough.
+   The incoming buffer belongs to the filter during play(), so filters
+   whose output is not larger than their input should work in place.
  * \ingroup af_filter
  */
 #define RESIZE_LOCAL_BUFFER(a,d)\
@@ -48,6 +48,9 @@ static void si2us(void* data, int len, int bps);
 static void change_bps(void* in, void* out, int len, int inbps, int outbps);
 // From float to int signed
 static void float2int(float* in, void* out, int len, int bps);
+// From float to 8 or 16 bit int signed, with TPDF dither
+static void float2int_dither(float* in, void* out, int len, int bps,
+                             unsigned int* seed);
 // From signed int to float
 static void int2float(void* in, float* out, int len, int bps);
 
@@ -56,6 +59,13 @@ static af_data_t* play_swapendian(struct af_instance_s* af, af_data_t* data);
 static af_data_t* play_float_s16(struct af_instance_s* af, af_data_t* data);
 static af_data_t* play_s16_float(struct af_instance_s* af, af_data_t* data);
 
+// Data for specific instances of this filter
+typedef struct af_format_s
+{
+  int dither;           // dither when reducing float to 8 or 16 bits
+  unsigned int seed;    // dither noise generator state
+}af_format_t;
+
 // Helper functions to check sanity for input arguments
 
 // Sanity check for bytes per sample
@@ -143,7 +153,18 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
     return AF_OK;
   }
   case AF_CONTROL_COMMAND_LINE:{
-    int format = af_str2fmt_short(arg);
+    af_format_t* s = af->setup;
+    char* opt = strchr(arg, ':');
+    int format;
+    if (opt) {
+      if (strcmp(opt + 1, "dither")) {
+        mp_msg(MSGT_AFILTER, MSGL_ERR, "[format] Unknown option %s\n", opt + 1);
+        return AF_ERROR;
+      }
+      *opt = '\0';
+      s->dither = 1;
+    }
+    format = af_str2fmt_short(arg);
     if (format == -1) {
       mp_msg(MSGT_AFILTER, MSGL_ERR, "[format] %s is not a valid format\n", (char *)arg);
       return AF_ERROR;
@@ -172,21 +193,20 @@ static void uninit(struct af_instance_s* af)
   if (af->data)
       free(af->data->audio);
   free(af->data);
-  af->setup = 0;
+  free(af->setup);
 }
 
+/* The conversions below that don't make the data larger work directly
+ * in the incoming buffer; all loops run forwards and never write ahead of
+ * the samples they read. */
 static af_data_t* play_swapendian(struct af_instance_s* af, af_data_t* data)
 {
   af_data_t*   l   = af->data;	// Local data
   af_data_t*   c   = data;	// Current working data
   int 	       len = c->len/c->bps; // Length in samples of current audio block
 
-  if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
-    return NULL;
-
-  endian(c->audio,l->audio,len,c->bps);
+  endian(c->audio,c->audio,len,c->bps);
 
-  c->audio = l->audio;
   c->format = l->format;
 
   return c;
@@ -196,14 +216,14 @@ static af_data_t* play_float_s16(struct af_instance_s* af, af_data_t* data)
 {
   af_data_t*   l   = af->data;	// Local data
   af_data_t*   c   = data;	// Current working data
+  af_format_t* s   = af->setup;
   int 	       len = c->len/4; // Length in samples of current audio block
 
-  if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
-    return NULL;
-
-  float2int(c->audio, l->audio, len, 2);
+  if(s->dither)
+    float2int_dither(c->audio, c->audio, len, 2, &s->seed);
+  else
+    float2int(c->audio, c->audio, len, 2);
 
-  c->audio = l->audio;
   c->len = len*2;
   c->bps = 2;
   c->format = l->format;
@@ -235,10 +255,16 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
 {
   af_data_t*   l   = af->data;	// Local data
   af_data_t*   c   = data;	// Current working data
+  af_format_t* s   = af->setup;
   int 	       len = c->len/c->bps; // Length in samples of current audio block
+  void*        out = c->audio;
 
-  if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
-    return NULL;
+  if(l->bps > c->bps ||
+     (c->format|l->format) & AF_FORMAT_SPECIAL_MASK){
+    if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
+      return NULL;
+    out = l->audio;
+  }
 
   // Change to cpu native endian format
   if((c->format&AF_FORMAT_END_MASK)!=AF_FORMAT_NE)
@@ -266,9 +292,12 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
       to_alaw(c->audio, l->audio, len, c->bps, c->format&AF_FORMAT_POINT_MASK);
       break;
     default:
-      float2int(c->audio, l->audio, len, l->bps);
+      if(s->dither && l->bps <= 2)
+        float2int_dither(c->audio, out, len, l->bps, &s->seed);
+      else
+        float2int(c->audio, out, len, l->bps);
       if((l->format&AF_FORMAT_SIGN_MASK) == AF_FORMAT_US)
-	si2us(l->audio,len,l->bps);
+	si2us(out,len,l->bps);
       break;
     }
   } else {
@@ -287,24 +316,24 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
       to_alaw(c->audio, l->audio, len, c->bps, c->format&AF_FORMAT_POINT_MASK);
       break;
     case(AF_FORMAT_F):
-      int2float(c->audio, l->audio, len, c->bps);
+      int2float(c->audio, out, len, c->bps);
       break;
     default:
       // Change the number of bits
       if(c->bps != l->bps)
-	change_bps(c->audio,l->audio,len,c->bps,l->bps);
-      else
-	fast_memcpy(l->audio,c->audio,len*c->bps);
+	change_bps(c->audio,out,len,c->bps,l->bps);
+      else if(out != c->audio)
+	fast_memcpy(out,c->audio,len*c->bps);
       break;
     }
   }
 
   // Switch from cpu native endian to the correct endianness
   if((l->format&AF_FORMAT_END_MASK)!=AF_FORMAT_NE)
-    endian(l->audio,l->audio,len,l->bps);
+    endian(out,out,len,l->bps);
 
   // Set output data
-  c->audio  = l->audio;
+  c->audio  = out;
   c->len    = len*l->bps;
   c->bps    = l->bps;
   c->format = l->format;
@@ -318,7 +347,8 @@ static int af_open(af_instance_t* af){
   af->play=play;
   af->mul=1;
   af->data=calloc(1,sizeof(af_data_t));
-  if(af->data == NULL)
+  af->setup=calloc(1,sizeof(af_format_t));
+  if(af->data == NULL || af->setup == NULL)
     return AF_ERROR;
   return AF_OK;
 }
@@ -357,13 +387,619 @@ static inline void store24bit(void* data, int pos, uint32_t expanded_value) {
 #endif
 }
 
+/* SIMD versions of the conversions below. Each one handles a whole number
+ * of blocks from the start of the buffer and returns how many samples it
+ * converted; the C code does the rest. The results are identical to the C
+ * code, and like it they never write ahead of the input they read, so the
+ * shrinking conversions can run in place. */
+
+#if HAVE_SSE2
+// the kernels get inlined next to float C code, so say what they touch
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", \
+                     "xmm4", "xmm5", "xmm6", "xmm7"
+
+static const float __attribute__((aligned(16))) ps_m1[4] =
+    { -1.0f, -1.0f, -1.0f, -1.0f };
+static const float __attribute__((aligned(16))) ps_1[4] =
+    { 1.0f, 1.0f, 1.0f, 1.0f };
+static const float __attribute__((aligned(16))) ps_32767[4] =
+    { 32767.0f, 32767.0f, 32767.0f, 32767.0f };
+static const float __attribute__((aligned(16))) ps_2p31[4] =
+    { 2147483648.0f, 2147483648.0f, 2147483648.0f, 2147483648.0f };
+static const float __attribute__((aligned(16))) ps_1d32768[4] =
+    { 1.0f / 32768, 1.0f / 32768, 1.0f / 32768, 1.0f / 32768 };
+static const float __attribute__((aligned(16))) ps_1d2p31[4] =
+    { 1.0f / 2147483648.0f, 1.0f / 2147483648.0f,
+      1.0f / 2147483648.0f, 1.0f / 2147483648.0f };
+
+#define SSE2_LOAD_CLAMP(scale) \
+        "movaps   %[m1], %%xmm5 \n\t"\
+        "movaps   %[p1], %%xmm6 \n\t"\
+        "movaps "scale", %%xmm7 \n\t"
+
+/* clamp to [-1,1] and scale; values that reach 2^31 overflow cvtps2dq to
+ * INT32_MIN, the mask in tmp flips those to INT32_MAX */
+#define SSE2_FLOAT2S32(reg, tmp) \
+        "maxps   %%xmm5, "reg" \n\t"\
+        "minps   %%xmm6, "reg" \n\t"\
+        "mulps   %%xmm7, "reg" \n\t"\
+        "movaps   "reg", "tmp" \n\t"\
+        "cmpnltps %%xmm7, "tmp" \n\t"\
+        "cvtps2dq "reg", "reg" \n\t"\
+        "pxor     "tmp", "reg" \n\t"
+
+static int float2s16_sse2(float* in, int16_t* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    SSE2_LOAD_CLAMP("%[k]")
+    "1: \n\t"
+    "movups   (%[in],%[x],4), %%xmm0 \n\t"
+    "movups 16(%[in],%[x],4), %%xmm1 \n\t"
+    "maxps    %%xmm5, %%xmm0 \n\t"
+    "maxps    %%xmm5, %%xmm1 \n\t"
+    "minps    %%xmm6, %%xmm0 \n\t"
+    "minps    %%xmm6, %%xmm1 \n\t"
+    "mulps    %%xmm7, %%xmm0 \n\t"
+    "mulps    %%xmm7, %%xmm1 \n\t"
+    "cvtps2dq %%xmm0, %%xmm0 \n\t"
+    "cvtps2dq %%xmm1, %%xmm1 \n\t"
+    "packssdw %%xmm1, %%xmm0 \n\t"
+    "movdqu   %%xmm0, (%[out],%[x],2) \n\t"
+    "add          $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7)),
+     [m1]"m"(*ps_m1), [p1]"m"(*ps_1), [k]"m"(*ps_32767)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+
+static int float2s32_sse2(float* in, int32_t* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    SSE2_LOAD_CLAMP("%[k]")
+    "1: \n\t"
+    "movups   (%[in],%[x],4), %%xmm0 \n\t"
+    "movups 16(%[in],%[x],4), %%xmm1 \n\t"
+    SSE2_FLOAT2S32("%%xmm0", "%%xmm2")
+    SSE2_FLOAT2S32("%%xmm1", "%%xmm3")
+    "movdqu   %%xmm0,   (%[out],%[x],4) \n\t"
+    "movdqu   %%xmm1, 16(%[out],%[x],4) \n\t"
+    "add          $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7)),
+     [m1]"m"(*ps_m1), [p1]"m"(*ps_1), [k]"m"(*ps_2p31)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+
+static int s16float_sse2(int16_t* in, float* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    "movaps        %[k], %%xmm7 \n\t"
+    "1: \n\t"
+    "movdqu (%[in],%[x],2), %%xmm0 \n\t"
+    "movdqa      %%xmm0, %%xmm1 \n\t"
+    "punpcklwd   %%xmm0, %%xmm0 \n\t"
+    "punpckhwd   %%xmm1, %%xmm1 \n\t"
+    "psrad          $16, %%xmm0 \n\t"
+    "psrad          $16, %%xmm1 \n\t"
+    "cvtdq2ps    %%xmm0, %%xmm0 \n\t"
+    "cvtdq2ps    %%xmm1, %%xmm1 \n\t"
+    "mulps       %%xmm7, %%xmm0 \n\t"
+    "mulps       %%xmm7, %%xmm1 \n\t"
+    "movups      %%xmm0,   (%[out],%[x],4) \n\t"
+    "movups      %%xmm1, 16(%[out],%[x],4) \n\t"
+    "add             $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7)),
+     [k]"m"(*ps_1d32768)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+
+static int s32float_sse2(int32_t* in, float* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    "movaps        %[k], %%xmm7 \n\t"
+    "1: \n\t"
+    "movdqu   (%[in],%[x],4), %%xmm0 \n\t"
+    "movdqu 16(%[in],%[x],4), %%xmm1 \n\t"
+    "cvtdq2ps    %%xmm0, %%xmm0 \n\t"
+    "cvtdq2ps    %%xmm1, %%xmm1 \n\t"
+    "mulps       %%xmm7, %%xmm0 \n\t"
+    "mulps       %%xmm7, %%xmm1 \n\t"
+    "movups      %%xmm0,   (%[out],%[x],4) \n\t"
+    "movups      %%xmm1, 16(%[out],%[x],4) \n\t"
+    "add             $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7)),
+     [k]"m"(*ps_1d2p31)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+
+// bytes: number of bytes to process, multiple of 16
+static void bswap16_sse2(uint8_t* in, uint8_t* out, int bytes)
+{
+  x86_reg x = -bytes;
+  __asm__ volatile(
+    "1: \n\t"
+    "movdqu (%[in],%[x]), %%xmm0 \n\t"
+    "movdqa      %%xmm0, %%xmm1 \n\t"
+    "psllw           $8, %%xmm0 \n\t"
+    "psrlw           $8, %%xmm1 \n\t"
+    "por         %%xmm1, %%xmm0 \n\t"
+    "movdqu      %%xmm0, (%[out],%[x]) \n\t"
+    "add            $16, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + bytes), [out]"r"(out + bytes)
+    :"memory", XMM_CLOBBERS
+  );
+}
+
+static void bswap32_sse2(uint8_t* in, uint8_t* out, int bytes)
+{
+  x86_reg x = -bytes;
+  __asm__ volatile(
+    "1: \n\t"
+    "movdqu (%[in],%[x]), %%xmm0 \n\t"
+    "movdqa      %%xmm0, %%xmm1 \n\t"
+    "psllw           $8, %%xmm0 \n\t"
+    "psrlw           $8, %%xmm1 \n\t"
+    "por         %%xmm1, %%xmm0 \n\t"
+    "pshuflw  $0xB1, %%xmm0, %%xmm0 \n\t"
+    "pshufhw  $0xB1, %%xmm0, %%xmm0 \n\t"
+    "movdqu      %%xmm0, (%[out],%[x]) \n\t"
+    "add            $16, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + bytes), [out]"r"(out + bytes)
+    :"memory", XMM_CLOBBERS
+  );
+}
+
+static void xor_sse2(uint8_t* data, int bytes, uint32_t mask)
+{
+  x86_reg x = -bytes;
+  __asm__ volatile(
+    "movd        %[m], %%xmm7 \n\t"
+    "pshufd $0, %%xmm7, %%xmm7 \n\t"
+    "1: \n\t"
+    "movdqu (%[p],%[x]), %%xmm0 \n\t"
+    "pxor       %%xmm7, %%xmm0 \n\t"
+    "movdqu     %%xmm0, (%[p],%[x]) \n\t"
+    "add           $16, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[p]"r"(data + bytes), [m]"r"(mask)
+    :"memory", XMM_CLOBBERS
+  );
+}
+
+static int s16s32_sse2(int16_t* in, int32_t* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    "1: \n\t"
+    "movdqu (%[in],%[x],2), %%xmm0 \n\t"
+    "pxor        %%xmm1, %%xmm1 \n\t"
+    "pxor        %%xmm2, %%xmm2 \n\t"
+    "punpcklwd   %%xmm0, %%xmm1 \n\t"
+    "punpckhwd   %%xmm0, %%xmm2 \n\t"
+    "movdqu      %%xmm1,   (%[out],%[x],4) \n\t"
+    "movdqu      %%xmm2, 16(%[out],%[x],4) \n\t"
+    "add             $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7))
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+
+static int s32s16_sse2(int32_t* in, int16_t* out, int len)
+{
+  x86_reg x = -(len & ~7);
+  if (x)
+  __asm__ volatile(
+    "1: \n\t"
+    "movdqu   (%[in],%[x],4), %%xmm0 \n\t"
+    "movdqu 16(%[in],%[x],4), %%xmm1 \n\t"
+    "psrad          $16, %%xmm0 \n\t"
+    "psrad          $16, %%xmm1 \n\t"
+    "packssdw    %%xmm1, %%xmm0 \n\t"
+    "movdqu      %%xmm0, (%[out],%[x],2) \n\t"
+    "add             $8, %[x] \n\t"
+    "jl 1b \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~7)), [out]"r"(out + (len & ~7))
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~7;
+}
+#endif /* HAVE_SSE2 */
+
+#if HAVE_SSSE3
+/* pshufb masks for 24 bit samples, 4 samples per register: unpack to the
+ * upper 3 bytes of a dword (like load24bit), pack the upper 3 bytes of
+ * each dword (like store24bit), and 16 <-> 24 bit */
+static const uint8_t __attribute__((aligned(16))) pb_unpack24[16] = {
+    0x80, 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11,
+};
+static const uint8_t __attribute__((aligned(16))) pb_pack24[16] = {
+    1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint8_t __attribute__((aligned(16))) pb_24to16[16] = {
+    1, 2, 4, 5, 7, 8, 10, 11, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint8_t __attribute__((aligned(16))) pb_16to24[16] = {
+    0x80, 0, 1, 0x80, 2, 3, 0x80, 4, 5, 0x80, 6, 7, 0x80, 0x80, 0x80, 0x80,
+};
+
+// read and write exactly 12 bytes, there may be nothing behind them
+#define LOAD24(ptr, reg, tmp) \
+        "movq    "ptr", "reg" \n\t"\
+        "movd   8"ptr", "tmp" \n\t"\
+        "punpcklqdq "tmp", "reg" \n\t"
+#define STORE24(reg, ptr) \
+        "movq    "reg", "ptr" \n\t"\
+        "psrldq   $8, "reg" \n\t"\
+        "movd    "reg", 8"ptr" \n\t"
+
+/* Generic 4 samples per iteration loop over 24 bit data. The pointers
+ * are advanced by the sample sizes of the two sides. */
+#define LOOP24(body, insize, outsize) \
+        "1: \n\t"\
+        body\
+        "add $"#insize", %[in] \n\t"\
+        "add $"#outsize", %[out] \n\t"\
+        "sub  $4, %[n] \n\t"\
+        "jg 1b \n\t"
+
+static int s24s32_ssse3(uint8_t* in, int32_t* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    "movdqa %[shuf], %%xmm7 \n\t"
+    LOOP24(
+      LOAD24("(%[in])", "%%xmm0", "%%xmm1")
+      "pshufb %%xmm7, %%xmm0 \n\t"
+      "movdqu %%xmm0, (%[out]) \n\t",
+      12, 16)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[shuf]"m"(*pb_unpack24)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+
+static int s32s24_ssse3(int32_t* in, uint8_t* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    "movdqa %[shuf], %%xmm7 \n\t"
+    LOOP24(
+      "movdqu (%[in]), %%xmm0 \n\t"
+      "pshufb %%xmm7, %%xmm0 \n\t"
+      STORE24("%%xmm0", "(%[out])"),
+      16, 12)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[shuf]"m"(*pb_pack24)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+
+static int s24s16_ssse3(uint8_t* in, int16_t* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    "movdqa %[shuf], %%xmm7 \n\t"
+    LOOP24(
+      LOAD24("(%[in])", "%%xmm0", "%%xmm1")
+      "pshufb %%xmm7, %%xmm0 \n\t"
+      "movq   %%xmm0, (%[out]) \n\t",
+      12, 8)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[shuf]"m"(*pb_24to16)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+
+static int s16s24_ssse3(int16_t* in, uint8_t* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    "movdqa %[shuf], %%xmm7 \n\t"
+    LOOP24(
+      "movq   (%[in]), %%xmm0 \n\t"
+      "pshufb %%xmm7, %%xmm0 \n\t"
+      STORE24("%%xmm0", "(%[out])"),
+      8, 12)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[shuf]"m"(*pb_16to24)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+
+static int float2s24_ssse3(float* in, uint8_t* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    SSE2_LOAD_CLAMP("%[k]")
+    "movdqa %[shuf], %%xmm4 \n\t"
+    LOOP24(
+      "movups (%[in]), %%xmm0 \n\t"
+      SSE2_FLOAT2S32("%%xmm0", "%%xmm2")
+      "pshufb %%xmm4, %%xmm0 \n\t"
+      STORE24("%%xmm0", "(%[out])"),
+      16, 12)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[m1]"m"(*ps_m1), [p1]"m"(*ps_1), [k]"m"(*ps_2p31),
+     [shuf]"m"(*pb_pack24)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+
+static int s24float_ssse3(uint8_t* in, float* out, int len)
+{
+  x86_reg n = len & ~3;
+  if (n)
+  __asm__ volatile(
+    "movdqa %[shuf], %%xmm6 \n\t"
+    "movaps    %[k], %%xmm7 \n\t"
+    LOOP24(
+      LOAD24("(%[in])", "%%xmm0", "%%xmm1")
+      "pshufb   %%xmm6, %%xmm0 \n\t"
+      "cvtdq2ps %%xmm0, %%xmm0 \n\t"
+      "mulps    %%xmm7, %%xmm0 \n\t"
+      "movups   %%xmm0, (%[out]) \n\t",
+      12, 16)
+    :[n]"+&r"(n), [in]"+&r"(in), [out]"+&r"(out)
+    :[shuf]"m"(*pb_unpack24), [k]"m"(*ps_1d2p31)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~3;
+}
+#endif /* HAVE_SSSE3 */
+
+#if HAVE_AVX2
+static int float2s16_avx2(float* in, int16_t* out, int len)
+{
+  x86_reg x = -(len & ~15);
+  if (x)
+  __asm__ volatile(
+    "vbroadcastss %[m1], %%ymm5 \n\t"
+    "vbroadcastss %[p1], %%ymm6 \n\t"
+    "vbroadcastss  %[k], %%ymm7 \n\t"
+    "1: \n\t"
+    "vmaxps    (%[in],%[x],4), %%ymm5, %%ymm0 \n\t"
+    "vmaxps  32(%[in],%[x],4), %%ymm5, %%ymm1 \n\t"
+    "vminps   %%ymm6, %%ymm0, %%ymm0 \n\t"
+    "vminps   %%ymm6, %%ymm1, %%ymm1 \n\t"
+    "vmulps   %%ymm7, %%ymm0, %%ymm0 \n\t"
+    "vmulps   %%ymm7, %%ymm1, %%ymm1 \n\t"
+    "vcvtps2dq %%ymm0, %%ymm0 \n\t"
+    "vcvtps2dq %%ymm1, %%ymm1 \n\t"
+    "vpackssdw %%ymm1, %%ymm0, %%ymm0 \n\t"
+    "vpermq  $0xD8, %%ymm0, %%ymm0 \n\t" /* undo the per lane packing */
+    "vmovdqu  %%ymm0, (%[out],%[x],2) \n\t"
+    "add         $16, %[x] \n\t"
+    "jl 1b \n\t"
+    "vzeroupper \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~15)), [out]"r"(out + (len & ~15)),
+     [m1]"m"(*ps_m1), [p1]"m"(*ps_1), [k]"m"(*ps_32767)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~15;
+}
+
+static int float2s32_avx2(float* in, int32_t* out, int len)
+{
+  x86_reg x = -(len & ~15);
+  if (x)
+  __asm__ volatile(
+    "vbroadcastss %[m1], %%ymm5 \n\t"
+    "vbroadcastss %[p1], %%ymm6 \n\t"
+    "vbroadcastss  %[k], %%ymm7 \n\t"
+    "1: \n\t"
+    "vmaxps    (%[in],%[x],4), %%ymm5, %%ymm0 \n\t"
+    "vmaxps  32(%[in],%[x],4), %%ymm5, %%ymm1 \n\t"
+    "vminps   %%ymm6, %%ymm0, %%ymm0 \n\t"
+    "vminps   %%ymm6, %%ymm1, %%ymm1 \n\t"
+    "vmulps   %%ymm7, %%ymm0, %%ymm0 \n\t"
+    "vmulps   %%ymm7, %%ymm1, %%ymm1 \n\t"
+    "vcmpps $5, %%ymm7, %%ymm0, %%ymm2 \n\t" /* >= 2^31 */
+    "vcmpps $5, %%ymm7, %%ymm1, %%ymm3 \n\t"
+    "vcvtps2dq %%ymm0, %%ymm0 \n\t"
+    "vcvtps2dq %%ymm1, %%ymm1 \n\t"
+    "vpxor    %%ymm2, %%ymm0, %%ymm0 \n\t"
+    "vpxor    %%ymm3, %%ymm1, %%ymm1 \n\t"
+    "vmovdqu  %%ymm0,   (%[out],%[x],4) \n\t"
+    "vmovdqu  %%ymm1, 32(%[out],%[x],4) \n\t"
+    "add         $16, %[x] \n\t"
+    "jl 1b \n\t"
+    "vzeroupper \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~15)), [out]"r"(out + (len & ~15)),
+     [m1]"m"(*ps_m1), [p1]"m"(*ps_1), [k]"m"(*ps_2p31)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~15;
+}
+
+static int s16float_avx2(int16_t* in, float* out, int len)
+{
+  x86_reg x = -(len & ~15);
+  if (x)
+  __asm__ volatile(
+    "vbroadcastss %[k], %%ymm7 \n\t"
+    "1: \n\t"
+    "vpmovsxwd   (%[in],%[x],2), %%ymm0 \n\t"
+    "vpmovsxwd 16(%[in],%[x],2), %%ymm1 \n\t"
+    "vcvtdq2ps %%ymm0, %%ymm0 \n\t"
+    "vcvtdq2ps %%ymm1, %%ymm1 \n\t"
+    "vmulps   %%ymm7, %%ymm0, %%ymm0 \n\t"
+    "vmulps   %%ymm7, %%ymm1, %%ymm1 \n\t"
+    "vmovups  %%ymm0,   (%[out],%[x],4) \n\t"
+    "vmovups  %%ymm1, 32(%[out],%[x],4) \n\t"
+    "add         $16, %[x] \n\t"
+    "jl 1b \n\t"
+    "vzeroupper \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~15)), [out]"r"(out + (len & ~15)),
+     [k]"m"(*ps_1d32768)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~15;
+}
+
+static int s32float_avx2(int32_t* in, float* out, int len)
+{
+  x86_reg x = -(len & ~15);
+  if (x)
+  __asm__ volatile(
+    "vbroadcastss %[k], %%ymm7 \n\t"
+    "1: \n\t"
+    "vcvtdq2ps   (%[in],%[x],4), %%ymm0 \n\t"
+    "vcvtdq2ps 32(%[in],%[x],4), %%ymm1 \n\t"
+    "vmulps   %%ymm7, %%ymm0, %%ymm0 \n\t"
+    "vmulps   %%ymm7, %%ymm1, %%ymm1 \n\t"
+    "vmovups  %%ymm0,   (%[out],%[x],4) \n\t"
+    "vmovups  %%ymm1, 32(%[out],%[x],4) \n\t"
+    "add         $16, %[x] \n\t"
+    "jl 1b \n\t"
+    "vzeroupper \n\t"
+    :[x]"+&r"(x)
+    :[in]"r"(in + (len & ~15)), [out]"r"(out + (len & ~15)),
+     [k]"m"(*ps_1d2p31)
+    :"memory", XMM_CLOBBERS
+  );
+  return len & ~15;
+}
+#endif /* HAVE_AVX2 */
+
+static int float2int_simd(float* in, void* out, int len, int bps)
+{
+#if HAVE_AVX2
+  if (gCpuCaps.hasAVX2) {
+    if (bps == 2) return float2s16_avx2(in, out, len);
+    if (bps == 4) return float2s32_avx2(in, out, len);
+  }
+#endif
+#if HAVE_SSSE3
+  if (gCpuCaps.hasSSSE3 && bps == 3)
+    return float2s24_ssse3(in, out, len);
+#endif
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2) {
+    if (bps == 2) return float2s16_sse2(in, out, len);
+    if (bps == 4) return float2s32_sse2(in, out, len);
+  }
+#endif
+  return 0;
+}
+
+static int int2float_simd(void* in, float* out, int len, int bps)
+{
+#if HAVE_AVX2
+  if (gCpuCaps.hasAVX2) {
+    if (bps == 2) return s16float_avx2(in, out, len);
+    if (bps == 4) return s32float_avx2(in, out, len);
+  }
+#endif
+#if HAVE_SSSE3
+  if (gCpuCaps.hasSSSE3 && bps == 3)
+    return s24float_ssse3(in, out, len);
+#endif
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2) {
+    if (bps == 2) return s16float_sse2(in, out, len);
+    if (bps == 4) return s32float_sse2(in, out, len);
+  }
+#endif
+  return 0;
+}
+
+static int change_bps_simd(void* in, void* out, int len, int inbps, int outbps)
+{
+#if HAVE_SSSE3
+  if (gCpuCaps.hasSSSE3) {
+    if (inbps == 3 && outbps == 4) return s24s32_ssse3(in, out, len);
+    if (inbps == 4 && outbps == 3) return s32s24_ssse3(in, out, len);
+    if (inbps == 3 && outbps == 2) return s24s16_ssse3(in, out, len);
+    if (inbps == 2 && outbps == 3) return s16s24_ssse3(in, out, len);
+  }
+#endif
+#if HAVE_SSE2
+  if (gCpuCaps.hasSSE2) {
+    if (inbps == 2 && outbps == 4) return s16s32_sse2(in, out, len);
+    if (inbps == 4 && outbps == 2) return s32s16_sse2(in, out, len);
+  }
+#endif
+  return 0;
+}
+
+// endian() and si2us() for 2 and 4 byte samples, 16 bytes at a time
+static int endian_simd(void* in, void* out, int len, int bps)
+{
+#if HAVE_SSE2
+  int n = (len * bps & ~15) / bps;
+  if (gCpuCaps.hasSSE2 && n) {
+    if (bps == 2) { bswap16_sse2(in, out, n * 2); return n; }
+    if (bps == 4) { bswap32_sse2(in, out, n * 4); return n; }
+  }
+#endif
+  return 0;
+}
+
+static int si2us_simd(void* data, int len, int bps)
+{
+#if HAVE_SSE2
+  int n = (len * bps & ~15) / bps;
+  if (gCpuCaps.hasSSE2 && n && bps != 3) {
+    xor_sse2(data, n * bps, bps == 1 ? 0x80808080 :
+                            bps == 2 ? 0x80008000 : 0x80000000);
+    return n;
+  }
+#endif
+  return 0;
+}
+
 // Function implementations used by play
 static void endian(void* in, void* out, int len, int bps)
 {
-  register int i;
+  register int i = endian_simd(in, out, len, bps);
   switch(bps){
     case(2):{
-      for(i=0;i<len;i++){
+      for(;i<len;i++){
 	((uint16_t*)out)[i]=bswap_16(((uint16_t*)in)[i]);
       }
       break;
@@ -380,7 +1016,7 @@ static void endian(void* in, void* out, int len, int bps)
       break;
     }
     case(4):{
-      for(i=0;i<len;i++){
+      for(;i<len;i++){
 	((uint32_t*)out)[i]=bswap_32(((uint32_t*)in)[i]);
       }
       break;
@@ -390,12 +1026,13 @@ static void endian(void* in, void* out, int len, int bps)
 
 static void si2us(void* data, int len, int bps)
 {
-  register long i = -(len * bps);
+  int n = si2us_simd(data, len, bps);
+  register long i = -((len - n) * bps);
   register uint8_t *p = &((uint8_t *)data)[len * bps];
 #if AF_FORMAT_NE == AF_FORMAT_LE
   p += bps - 1;
 #endif
-  if (len <= 0) return;
+  if (len - n <= 0) return;
   do {
     p[i] ^= 0x80;
   } while (i += bps);
@@ -403,20 +1040,20 @@ static void si2us(void* data, int len, int bps)
 
 static void change_bps(void* in, void* out, int len, int inbps, int outbps)
 {
-  register int i;
+  register int i = change_bps_simd(in, out, len, inbps, outbps);
   switch(inbps){
   case(1):
     switch(outbps){
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=((uint16_t)((uint8_t*)in)[i])<<8;
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	store24bit(out, i, ((uint32_t)((uint8_t*)in)[i])<<24);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=((uint32_t)((uint8_t*)in)[i])<<24;
       break;
     }
@@ -424,15 +1061,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(2):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)((((uint16_t*)in)[i])>>8);
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	store24bit(out, i, ((uint32_t)((uint16_t*)in)[i])<<16);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=((uint32_t)((uint16_t*)in)[i])<<16;
       break;
     }
@@ -440,15 +1077,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(3):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)(load24bit(in, i)>>24);
       break;
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=(uint16_t)(load24bit(in, i)>>16);
       break;
     case(4):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint32_t*)out)[i]=(uint32_t)load24bit(in, i);
       break;
     }
@@ -456,15 +1093,15 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   case(4):
     switch(outbps){
     case(1):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint8_t*)out)[i]=(uint8_t)((((uint32_t*)in)[i])>>24);
       break;
     case(2):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
 	((uint16_t*)out)[i]=(uint16_t)((((uint32_t*)in)[i])>>16);
       break;
     case(3):
-      for(i=0;i<len;i++)
+      for(;i<len;i++)
         store24bit(out, i, ((uint32_t*)in)[i]);
       break;
     }
@@ -472,47 +1109,81 @@ static void change_bps(void* in, void* out, int len, int inbps, int outbps)
   }
 }
 
+/* Scale to the full 32 bit range. +1.0 becomes 2^31, which lrintf()
+   can't represent in an int32_t, so saturate. */
+static inline int32_t float2s32(float f)
+{
+  f = clamp(f, -1.0f, +1.0f) * 2147483648.0f;
+  return f >= 2147483648.0f ? INT32_MAX : lrintf(f);
+}
+
 static void float2int(float* in, void* out, int len, int bps)
 {
-  register int i;
+  register int i = float2int_simd(in, out, len, bps);
   switch(bps){
   case(1):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       ((int8_t*)out)[i] = lrintf(127.0 * clamp(in[i], -1.0f, +1.0f));
     break;
   case(2):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       ((int16_t*)out)[i] = lrintf(32767.0 * clamp(in[i], -1.0f, +1.0f));
     break;
   case(3):
-    for(i=0;i<len;i++)
-      store24bit(out, i, lrintf(2147483647.0 * clamp(in[i], -1.0f, +1.0f)));
+    for(;i<len;i++)
+      store24bit(out, i, float2s32(in[i]));
     break;
   case(4):
-    for(i=0;i<len;i++)
-      ((int32_t*)out)[i] = lrintf(2147483647.0 * clamp(in[i], -1.0f, +1.0f));
+    for(;i<len;i++)
+      ((int32_t*)out)[i] = float2s32(in[i]);
     break;
   }
 }
 
-static void int2float(void* in, float* out, int len, int bps)
+/* Adds triangular noise of +-1 LSB before rounding. The noise comes from
+   a LCG whose state is kept across calls. */
+static void float2int_dither(float* in, void* out, int len, int bps,
+                             unsigned int* seed)
 {
+  float scale = bps == 1 ? 127.0f : 32767.0f;
+  int max = bps == 1 ? INT8_MAX : INT16_MAX;
+  unsigned int r = *seed;
   register int i;
+  for(i=0;i<len;i++){
+    float d;
+    long v;
+    r = r * 1664525 + 1013904223;
+    d = (int32_t)r;
+    r = r * 1664525 + 1013904223;
+    d = (d + (int32_t)r) * (1.0f / 4294967296.0f);
+    v = lrintf(scale * clamp(in[i], -1.0f, +1.0f) + d);
+    v = clamp(v, -max - 1, max);
+    if (bps == 1)
+      ((int8_t*)out)[i] = v;
+    else
+      ((int16_t*)out)[i] = v;
+  }
+  *seed = r;
+}
+
+static void int2float(void* in, float* out, int len, int bps)
+{
+  register int i = int2float_simd(in, out, len, bps);
   switch(bps){
   case(1):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/128.0)*((int8_t*)in)[i];
     break;
   case(2):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/32768.0)*((int16_t*)in)[i];
     break;
   case(3):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/2147483648.0)*((int32_t)load24bit(in, i));
     break;
   case(4):
-    for(i=0;i<len;i++)
+    for(;i<len;i++)
       out[i]=(1.0/2147483648.0)*((int32_t*)in)[i];
     break;
   }
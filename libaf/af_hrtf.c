@@ -26,6 +26,7 @@
 #include <inttypes.h>
 
 #include <math.h>
+#include <libavutil/common.h>
 
 #include "af.h"
 #include "dsp.h"
@@ -33,6 +34,15 @@
 /* HRTF filter coefficients and adjustable parameters */
 #include "af_hrtf.h"
 
+/* Filter outputs of one block */
+enum {
+    CONV_CF, CONV_CR,
+    CONV_LF_AF, CONV_RF_OF, CONV_LR_AR, CONV_RR_OR,
+    CONV_RF_AF, CONV_LF_OF, CONV_RR_AR, CONV_LR_OR,
+    CONV_BA_L, CONV_BA_R,
+    CONV_NUM
+};
+
 typedef struct af_hrtf_s {
     /* Lengths */
     int dlbuflen, hrflen, basslen;
@@ -68,6 +78,8 @@ typedef struct af_hrtf_s {
     /* Cyclic position on the ring buffer */
     int cyc_pos;
     int print_flag;
+    /* Filter outputs of the current block, oldest sample last */
+    float conv_out[CONV_NUM][HRTFBLOCKLEN];
 } af_hrtf_t;
 
 /* Convolution on a ring buffer
@@ -90,6 +102,29 @@ static float conv(const int nx, const int nk, const float *sx, const float *sk,
 	    af_filter_fir(nx - k, sx + k, sk);
 }
 
+/* Block version of conv(), for the n ring positions offset,
+ * offset - 1, ..., offset - n + 1 (the order of time). The results are
+ * stored by ascending ring position, so the output for offset - i ends
+ * up in y[n - 1 - i]. n + nk - 1 must not exceed nx.
+ */
+static void conv_block(const int nx, const int nk, const float *sx,
+		       const float *sk, const int offset, const int n,
+		       float *y)
+{
+    const int pos = ((offset - (n - 1)) % nx + nx) % nx;
+    int i = FFMAX(FFMIN(n, nx - nk - pos + 1), 0);
+
+    /* Windows before the end of the ring */
+    if(i > 0)
+	af_filter_fir_block(nk, sk, sx + pos, y, i);
+    /* Windows wrapping around */
+    for(; i < n && pos + i < nx; i++)
+	y[i] = conv(nx, nk, sx, sk, pos + i);
+    /* Windows past the wrap */
+    if(i < n)
+	af_filter_fir_block(nk, sk, sx + pos + i - nx, y + i, n - i);
+}
+
 /* Detect when the impulse response starts (significantly) */
 static int pulse_detect(const float *sx)
 {
@@ -444,122 +479,155 @@ static af_data_t* play(struct af_instance_s *af, af_data_t *data)
      */
 
     while(in < end) {
-	const int k = s->cyc_pos;
-
-	update_ch(s, in, k);
+	const int k0 = s->cyc_pos;
+	const int n = FFMIN(HRTFBLOCKLEN, (end - in) / data->nch);
+	float (*c)[HRTFBLOCKLEN] = s->conv_out;
+	int i;
+
+	/* Feed the block into the ring buffers first. The decoders
+	   depend on the previous sample, so this stays sequential; a
+	   block is short enough to not overwrite anything the filters
+	   below still read. */
+	for(i = 0; i < n; i++) {
+	    short *x = &in[i * data->nch];
+	    const int k = s->cyc_pos;
+
+	    update_ch(s, x, k);
+
+	    /* Simulate a 7.5 ms -20 dB echo of the center channel in
+	       the front channels (like reflection from a room wall) -
+	       a kind of psycho-acoustically "cheating" to focus the
+	       center front channel, which is normally hard to be
+	       perceived as front */
+	    s->lf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
+	    s->rf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
+
+	    if(s->matrix_mode && s->decode_mode != HRTF_MIX_STEREO) {
+	       /* In matrix decoding mode, the rear channel gain must be
+		  renormalized, as there is an additional channel. */
+	       matrix_decode(x, k, 2, 3, 0, s->dlbuflen,
+			     s->lr_fwr, s->rr_fwr,
+			     s->lrprr_fwr, s->lrmrr_fwr,
+			     &(s->adapt_lr_gain), &(s->adapt_rr_gain),
+			     &(s->adapt_lrprr_gain), &(s->adapt_lrmrr_gain),
+			     s->lr, s->rr, NULL, NULL, s->cr);
+	    }
 
-	/* Simulate a 7.5 ms -20 dB echo of the center channel in the
-	   front channels (like reflection from a room wall) - a kind of
-	   psycho-acoustically "cheating" to focus the center front
-	   channel, which is normally hard to be perceived as front */
-	s->lf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
-	s->rf[k] += CFECHOAMPL * s->cf[(k + CFECHODELAY) % s->dlbuflen];
+	    (s->cyc_pos)--;
+	    if(s->cyc_pos < 0)
+		s->cyc_pos += dblen;
+	}
 
+	/* Mixer filter matrix, one block per filter */
 	switch (s->decode_mode) {
 	case HRTF_MIX_51:
 	case HRTF_MIX_MATRIX2CH:
-	   /* Mixer filter matrix */
-	   common = conv(dblen, hlen, s->cf, s->cf_ir, k + s->cf_o);
-	   if(s->matrix_mode) {
-	      /* In matrix decoding mode, the rear channel gain must be
-		 renormalized, as there is an additional channel. */
-	      matrix_decode(in, k, 2, 3, 0, s->dlbuflen,
-			    s->lr_fwr, s->rr_fwr,
-			    s->lrprr_fwr, s->lrmrr_fwr,
-			    &(s->adapt_lr_gain), &(s->adapt_rr_gain),
-			    &(s->adapt_lrprr_gain), &(s->adapt_lrmrr_gain),
-			    s->lr, s->rr, NULL, NULL, s->cr);
-	      common +=
-		 conv(dblen, hlen, s->cr, s->cr_ir, k + s->cr_o) *
-		 M1_76DB;
-	      left    =
-		 ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o) +
-		   (conv(dblen, hlen, s->lr, s->ar_ir, k + s->ar_o) +
-		    conv(dblen, hlen, s->rr, s->or_ir, k + s->or_o)) *
-		   M1_76DB + common);
-	      right   =
-		 ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o) +
-		   (conv(dblen, hlen, s->rr, s->ar_ir, k + s->ar_o) +
-		    conv(dblen, hlen, s->lr, s->or_ir, k + s->or_o)) *
-		   M1_76DB + common);
-	   } else {
-	      left    =
-		 ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o) +
-		   conv(dblen, hlen, s->lr, s->ar_ir, k + s->ar_o) +
-		   conv(dblen, hlen, s->rr, s->or_ir, k + s->or_o) +
-		   common);
-	      right   =
-		 ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		   conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o) +
-		   conv(dblen, hlen, s->rr, s->ar_ir, k + s->ar_o) +
-		   conv(dblen, hlen, s->lr, s->or_ir, k + s->or_o) +
-		   common);
-	   }
-	   break;
+	   conv_block(dblen, hlen, s->cf, s->cf_ir, k0 + s->cf_o, n, c[CONV_CF]);
+	   if(s->matrix_mode)
+	      conv_block(dblen, hlen, s->cr, s->cr_ir, k0 + s->cr_o, n,
+			 c[CONV_CR]);
+	   conv_block(dblen, hlen, s->lr, s->ar_ir, k0 + s->ar_o, n,
+		      c[CONV_LR_AR]);
+	   conv_block(dblen, hlen, s->rr, s->or_ir, k0 + s->or_o, n,
+		      c[CONV_RR_OR]);
+	   conv_block(dblen, hlen, s->rr, s->ar_ir, k0 + s->ar_o, n,
+		      c[CONV_RR_AR]);
+	   conv_block(dblen, hlen, s->lr, s->or_ir, k0 + s->or_o, n,
+		      c[CONV_LR_OR]);
+	   /* Fall through */
 	case HRTF_MIX_STEREO:
-	   left    =
-	      ( conv(dblen, hlen, s->lf, s->af_ir, k + s->af_o) +
-		conv(dblen, hlen, s->rf, s->of_ir, k + s->of_o));
-	   right   =
-	      ( conv(dblen, hlen, s->rf, s->af_ir, k + s->af_o) +
-		conv(dblen, hlen, s->lf, s->of_ir, k + s->of_o));
+	   conv_block(dblen, hlen, s->lf, s->af_ir, k0 + s->af_o, n,
+		      c[CONV_LF_AF]);
+	   conv_block(dblen, hlen, s->rf, s->of_ir, k0 + s->of_o, n,
+		      c[CONV_RF_OF]);
+	   conv_block(dblen, hlen, s->rf, s->af_ir, k0 + s->af_o, n,
+		      c[CONV_RF_AF]);
+	   conv_block(dblen, hlen, s->lf, s->of_ir, k0 + s->of_o, n,
+		      c[CONV_LF_OF]);
 	   break;
-	default:
-	    /* make gcc happy */
-	    left = 0.0;
-	    right = 0.0;
-	    break;
 	}
+	conv_block(dblen, blen, s->ba_l, s->ba_ir, k0, n, c[CONV_BA_L]);
+	conv_block(dblen, blen, s->ba_r, s->ba_ir, k0, n, c[CONV_BA_R]);
+
+	for(i = 0; i < n; i++) {
+	    const int r = n - 1 - i;
+
+	    switch (s->decode_mode) {
+	    case HRTF_MIX_51:
+	    case HRTF_MIX_MATRIX2CH:
+	       common = c[CONV_CF][r];
+	       if(s->matrix_mode) {
+		  common += c[CONV_CR][r] * M1_76DB;
+		  left    =
+		     ( c[CONV_LF_AF][r] + c[CONV_RF_OF][r] +
+		       (c[CONV_LR_AR][r] + c[CONV_RR_OR][r]) * M1_76DB + common);
+		  right   =
+		     ( c[CONV_RF_AF][r] + c[CONV_LF_OF][r] +
+		       (c[CONV_RR_AR][r] + c[CONV_LR_OR][r]) * M1_76DB + common);
+	       } else {
+		  left    =
+		     ( c[CONV_LF_AF][r] + c[CONV_RF_OF][r] +
+		       c[CONV_LR_AR][r] + c[CONV_RR_OR][r] + common);
+		  right   =
+		     ( c[CONV_RF_AF][r] + c[CONV_LF_OF][r] +
+		       c[CONV_RR_AR][r] + c[CONV_LR_OR][r] + common);
+	       }
+	       break;
+	    case HRTF_MIX_STEREO:
+	       left    = c[CONV_LF_AF][r] + c[CONV_RF_OF][r];
+	       right   = c[CONV_RF_AF][r] + c[CONV_LF_OF][r];
+	       break;
+	    default:
+		/* make gcc happy */
+		left = 0.0;
+		right = 0.0;
+		break;
+	    }
 
-	/* Bass compensation for the lower frequency cut of the HRTF.  A
-	   cross talk of the left and right channel is introduced to
-	   match the directional characteristics of higher frequencies.
-	   The bass will not have any real 3D perception, but that is
-	   OK (note at 180 Hz, the wavelength is about 2 m, and any
-	   spatial perception is impossible). */
-	left_b  = conv(dblen, blen, s->ba_l, s->ba_ir, k);
-	right_b = conv(dblen, blen, s->ba_r, s->ba_ir, k);
-	left  += (1 - BASSCROSS) * left_b  + BASSCROSS * right_b;
-	right += (1 - BASSCROSS) * right_b + BASSCROSS * left_b;
-	/* Also mix the LFE channel (if available) */
-	if(data->nch >= 6) {
-	    left  += in[5] * M3_01DB;
-	    right += in[5] * M3_01DB;
-	}
+	    /* Bass compensation for the lower frequency cut of the HRTF.  A
+	       cross talk of the left and right channel is introduced to
+	       match the directional characteristics of higher frequencies.
+	       The bass will not have any real 3D perception, but that is
+	       OK (note at 180 Hz, the wavelength is about 2 m, and any
+	       spatial perception is impossible). */
+	    left_b  = c[CONV_BA_L][r];
+	    right_b = c[CONV_BA_R][r];
+	    left  += (1 - BASSCROSS) * left_b  + BASSCROSS * right_b;
+	    right += (1 - BASSCROSS) * right_b + BASSCROSS * left_b;
+	    /* Also mix the LFE channel (if available) */
+	    if(data->nch >= 6) {
+		left  += in[5] * M3_01DB;
+		right += in[5] * M3_01DB;
+	    }
 
-	/* Amplitude renormalization. */
-	left  *= AMPLNORM;
-	right *= AMPLNORM;
+	    /* Amplitude renormalization. */
+	    left  *= AMPLNORM;
+	    right *= AMPLNORM;
+
+	    switch (s->decode_mode) {
+	    case HRTF_MIX_51:
+	    case HRTF_MIX_STEREO:
+	       /* "Cheating": linear stereo expansion to amplify the 3D
+		  perception.  Note: Too much will destroy the acoustic space
+		  and may even result in headaches. */
+	       diff = STEXPAND2 * (left - right);
+	       out[0] = (int16_t)(left  + diff);
+	       out[1] = (int16_t)(right - diff);
+	       break;
+	    case HRTF_MIX_MATRIX2CH:
+	       /* Do attempt any stereo expansion with matrix encoded
+		  sources.  The L, R channels are already stereo expanded
+		  by the steering, any further stereo expansion will sound
+		  very unnatural. */
+	       out[0] = (int16_t)left;
+	       out[1] = (int16_t)right;
+	       break;
+	    }
 
-	switch (s->decode_mode) {
-	case HRTF_MIX_51:
-	case HRTF_MIX_STEREO:
-	   /* "Cheating": linear stereo expansion to amplify the 3D
-	      perception.  Note: Too much will destroy the acoustic space
-	      and may even result in headaches. */
-	   diff = STEXPAND2 * (left - right);
-	   out[0] = (int16_t)(left  + diff);
-	   out[1] = (int16_t)(right - diff);
-	   break;
-	case HRTF_MIX_MATRIX2CH:
-	   /* Do attempt any stereo expansion with matrix encoded
-	      sources.  The L, R channels are already stereo expanded
-	      by the steering, any further stereo expansion will sound
-	      very unnatural. */
-	   out[0] = (int16_t)left;
-	   out[1] = (int16_t)right;
-	   break;
+	    /* Next sample... */
+	    in = &in[data->nch];
+	    out = &out[af->data->nch];
 	}
-
-	/* Next sample... */
-	in = &in[data->nch];
-	out = &out[af->data->nch];
-	(s->cyc_pos)--;
-	if(s->cyc_pos < 0)
-	    s->cyc_pos += dblen;
     }
 
     /* Set output data */
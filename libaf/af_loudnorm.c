@@ -0,0 +1,675 @@
+/*
+ * EBU R128 / ITU BS.1770 loudness measurement and normalization
+ *
+ * This file is part of mplayer2.
+ *
+ * mplayer2 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mplayer2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mplayer2; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "config.h"
+#include "af.h"
+#include "cpudetect.h"
+#include "libavutil/common.h"
+#include "subopt-helper.h"
+
+// The signal is K-weighted (a high shelf followed by a high pass) and the
+// weighted channel energies are summed per 100 ms block. Momentary and
+// short-term loudness are the mean over the last 4 and 30 blocks. Gating
+// blocks (400 ms, 75% overlap) go into a histogram from which integrated
+// loudness is computed with the absolute (-70 LUFS) and relative (-10 LU)
+// gates.
+//
+// The normalizer delays the output by the lookahead and derives a gain
+// from the short-term loudness of each block. Gain is lowered early enough
+// to reach the value needed by any block inside the lookahead by the time
+// that block is played, and raised slowly afterwards.
+
+#define BLOCK_MS        100
+#define MOMENTARY       4       // blocks
+#define SHORTTERM       30      // blocks
+#define ABS_GATE        -70.0
+#define REL_GATE        -10.0
+#define HIST_MIN        ABS_GATE
+#define HIST_BINS       800     // 0.1 LU each, -70 .. +10 LUFS
+#define QUIET_GATE      -20.0   // hold gain below integrated - 20 LU
+
+// K-weighting coefficients: 2 stages of b0 b1 b2 a1 a2, 4 lanes each
+#define NCOEF           10
+
+struct af_loudnorm {
+    // command line
+    int measure;
+    float target;
+    float lookahead;
+    float maxgain;
+    float peak;
+    float release;
+
+    int nch;
+    int block_frames;
+    float weight[AF_NCH];
+
+    // K-weighting
+    double coef[NCOEF];
+    double state[AF_NCH][4];
+    void *simd_mem;
+    float *simd_coef;           // 16-byte aligned [NCOEF][4]
+    float *simd_state;          // [chunks][4][4] following simd_coef
+    int use_sse;
+
+    // current block
+    int block_pos;
+    double block_sum;
+    float block_peak;
+
+    // history
+    double energy[SHORTTERM];
+    long long blocks;
+    long long start_block;      // blocks before the last reset
+    int hist_count[HIST_BINS];
+    double hist_energy[HIST_BINS];
+    double momentary, shortterm, integrated;
+    double max_momentary, max_shortterm;
+    float sample_peak;
+
+    // normalizer
+    float *queue;
+    int queue_frames;           // allocated
+    int queued;
+    float *gains;               // wanted gain [dB] per block, ring
+    int la_blocks;
+    long long blocks_out;
+    int draining;               // the next play() call ends the input
+    double gain;                // at the start of the next output block
+    double min_gain, max_gain;
+};
+
+static double loudness(double energy)
+{
+    return energy > 0 ? -0.691 + 10 * log10(energy) : -HUGE_VAL;
+}
+
+static void kweight_init(struct af_loudnorm *s, int rate)
+{
+    // BS.1770 stage 1: high shelf, +4 dB above ~1.7 kHz
+    double f0 = 1681.974450955533, G = 3.999843853973347;
+    double Q = 0.7071752369554196;
+    double K = tan(M_PI * f0 / rate);
+    double Vh = pow(10.0, G / 20.0), Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    s->coef[0] = (Vh + Vb * K / Q + K * K) / a0;
+    s->coef[1] = 2.0 * (K * K - Vh) / a0;
+    s->coef[2] = (Vh - Vb * K / Q + K * K) / a0;
+    s->coef[3] = 2.0 * (K * K - 1.0) / a0;
+    s->coef[4] = (1.0 - K / Q + K * K) / a0;
+
+    // stage 2: RLB high pass at ~38 Hz
+    f0 = 38.13547087602444;
+    Q = 0.5003270373238773;
+    K = tan(M_PI * f0 / rate);
+    a0 = 1.0 + K / Q + K * K;
+    s->coef[5] = 1.0;
+    s->coef[6] = -2.0;
+    s->coef[7] = 1.0;
+    s->coef[8] = 2.0 * (K * K - 1.0) / a0;
+    s->coef[9] = (1.0 - K / Q + K * K) / a0;
+}
+
+// Channel weights for the default (ALSA) channel orders
+static void channel_weights(struct af_loudnorm *s)
+{
+    for (int i = 0; i < s->nch; i++)
+        s->weight[i] = 1.0;
+    if (s->nch >= 4)
+        s->weight[2] = s->weight[3] = 1.41;     // Ls Rs
+    if (s->nch >= 6)
+        s->weight[5] = 0.0;                     // LFE
+    if (s->nch == 8)
+        s->weight[6] = s->weight[7] = 1.41;     // Rls Rrs
+}
+
+static void kweight_c(struct af_loudnorm *s, float *in, int frames)
+{
+    const double *c = s->coef;
+    for (int ch = 0; ch < s->nch; ch++) {
+        double *st = s->state[ch];
+        double s1 = st[0], s2 = st[1], s3 = st[2], s4 = st[3];
+        double sum = 0;
+        float *p = in + ch;
+        for (int i = 0; i < frames; i++, p += s->nch) {
+            double x = *p;
+            double y = c[0] * x + s1;
+            s1 = c[1] * x - c[3] * y + s2;
+            s2 = c[2] * x - c[4] * y;
+            double z = c[5] * y + s3;
+            s3 = c[6] * y - c[8] * z + s4;
+            s4 = c[7] * y - c[9] * z;
+            sum += z * z;
+        }
+        st[0] = s1; st[1] = s2; st[2] = s3; st[3] = s4;
+        s->block_sum += s->weight[ch] * sum;
+    }
+}
+
+#if HAVE_SSE
+// Runs both stages for up to 4 interleaved channels at once, one channel
+// per lane. xmm3-xmm6 hold the filter state, xmm7 the sum of squares. FTZ
+// is set while running so decaying state never turns into denormals.
+#define KWEIGHT_SSE(LOAD)                                               \
+    __asm__ volatile(                                                   \
+        "ldmxcsr  %[ftz]                \n\t"                           \
+        "movaps     (%[st]), %%xmm3     \n\t"                           \
+        "movaps   16(%[st]), %%xmm4     \n\t"                           \
+        "movaps   32(%[st]), %%xmm5     \n\t"                           \
+        "movaps   48(%[st]), %%xmm6     \n\t"                           \
+        "xorps    %%xmm7, %%xmm7        \n\t"                           \
+        "1:                             \n\t"                           \
+        "xorps    %%xmm0, %%xmm0        \n\t"                           \
+        LOAD "    (%[in]), %%xmm0       \n\t"                           \
+        "movaps   %%xmm0, %%xmm1        \n\t"                           \
+        "mulps       (%[c]), %%xmm1     \n\t"                           \
+        "addps    %%xmm3, %%xmm1        \n\t" /* y = b0 x + s1 */       \
+        "movaps   %%xmm0, %%xmm3        \n\t"                           \
+        "mulps     16(%[c]), %%xmm3     \n\t"                           \
+        "addps    %%xmm4, %%xmm3        \n\t"                           \
+        "movaps   %%xmm1, %%xmm2        \n\t"                           \
+        "mulps     48(%[c]), %%xmm2     \n\t"                           \
+        "subps    %%xmm2, %%xmm3        \n\t" /* s1 = b1 x - a1 y + s2 */ \
+        "movaps   %%xmm0, %%xmm4        \n\t"                           \
+        "mulps     32(%[c]), %%xmm4     \n\t"                           \
+        "movaps   %%xmm1, %%xmm2        \n\t"                           \
+        "mulps     64(%[c]), %%xmm2     \n\t"                           \
+        "subps    %%xmm2, %%xmm4        \n\t" /* s2 = b2 x - a2 y */    \
+        "movaps   %%xmm1, %%xmm0        \n\t"                           \
+        "mulps     80(%[c]), %%xmm0     \n\t"                           \
+        "addps    %%xmm5, %%xmm0        \n\t" /* z = b0' y + s3 */      \
+        "movaps   %%xmm1, %%xmm5        \n\t"                           \
+        "mulps     96(%[c]), %%xmm5     \n\t"                           \
+        "addps    %%xmm6, %%xmm5        \n\t"                           \
+        "movaps   %%xmm0, %%xmm2        \n\t"                           \
+        "mulps    128(%[c]), %%xmm2     \n\t"                           \
+        "subps    %%xmm2, %%xmm5        \n\t"                           \
+        "movaps   %%xmm1, %%xmm6        \n\t"                           \
+        "mulps    112(%[c]), %%xmm6     \n\t"                           \
+        "movaps   %%xmm0, %%xmm2        \n\t"                           \
+        "mulps    144(%[c]), %%xmm2     \n\t"                           \
+        "subps    %%xmm2, %%xmm6        \n\t"                           \
+        "mulps    %%xmm0, %%xmm0        \n\t"                           \
+        "addps    %%xmm0, %%xmm7        \n\t"                           \
+        "add      %[stride], %[in]      \n\t"                           \
+        "dec      %[n]                  \n\t"                           \
+        "jnz      1b                    \n\t"                           \
+        "movaps   %%xmm3,   (%[st])     \n\t"                           \
+        "movaps   %%xmm4, 16(%[st])     \n\t"                           \
+        "movaps   %%xmm5, 32(%[st])     \n\t"                           \
+        "movaps   %%xmm6, 48(%[st])     \n\t"                           \
+        "movaps   %%xmm7, 64(%[st])     \n\t"                           \
+        "ldmxcsr  %[csr]                \n\t"                           \
+        : [in] "+r" (p), [n] "+r" (n)                                   \
+        : [c] "r" (s->simd_coef), [st] "r" (st), [stride] "r" (stride), \
+          [csr] "m" (csr), [ftz] "m" (ftz)                              \
+        : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",     \
+          "xmm6", "xmm7")
+
+// Channels are split into groups of 4, 2 and 1 lanes; each group has
+// 5 vectors in simd_state: 4 of filter state and the sum of squares.
+static void kweight_sse(struct af_loudnorm *s, float *in, int frames)
+{
+    float *st = s->simd_state;
+    x86_reg stride = s->nch * sizeof(float);
+    uint32_t csr, ftz;
+
+    __asm__ volatile("stmxcsr %0" : "=m" (csr));
+    ftz = csr | 0x8000;
+    for (int ch = 0; ch < s->nch; st += 5 * 4) {
+        int width = s->nch - ch >= 4 ? 4 : s->nch - ch >= 2 ? 2 : 1;
+        float *p = in + ch;
+        x86_reg n = frames;
+
+        if (width == 4)
+            KWEIGHT_SSE("movups");
+        else if (width == 2)
+            KWEIGHT_SSE("movlps");
+        else
+            KWEIGHT_SSE("movss ");
+        for (int i = 0; i < width; i++)
+            s->block_sum += s->weight[ch + i] * st[16 + i];
+        ch += width;
+    }
+}
+#endif
+
+static int simd_chunks(int nch)
+{
+    return nch / 4 + (nch & 2) / 2 + (nch & 1);
+}
+
+static void reset_state(struct af_loudnorm *s)
+{
+    memset(s->state, 0, sizeof(s->state));
+    if (s->simd_state)
+        memset(s->simd_state, 0, simd_chunks(s->nch) * 5 * 4 * sizeof(float));
+    s->block_pos = 0;
+    s->block_sum = 0;
+    s->block_peak = 0;
+    memset(s->energy, 0, sizeof(s->energy));
+    s->blocks = 0;
+    s->start_block = 0;
+    memset(s->hist_count, 0, sizeof(s->hist_count));
+    memset(s->hist_energy, 0, sizeof(s->hist_energy));
+    s->momentary = s->shortterm = s->integrated = -HUGE_VAL;
+    s->max_momentary = s->max_shortterm = -HUGE_VAL;
+    s->sample_peak = 0;
+    s->queued = 0;
+    s->blocks_out = 0;
+    s->draining = 0;
+    s->gain = 0;
+    s->min_gain = HUGE_VAL;
+    s->max_gain = -HUGE_VAL;
+}
+
+// After a seek: drop the queued audio and the current block, and start the
+// loudness windows and the gain smoother anew. The integrated loudness and
+// the statistics keep what was measured before.
+static void restart(struct af_loudnorm *s)
+{
+    memset(s->state, 0, sizeof(s->state));
+    if (s->simd_state)
+        memset(s->simd_state, 0, simd_chunks(s->nch) * 5 * 4 * sizeof(float));
+    s->block_pos = 0;
+    s->block_sum = 0;
+    s->block_peak = 0;
+    s->start_block = s->blocks;
+    s->queued = 0;
+    s->blocks_out = s->blocks;
+    s->draining = 0;
+    s->gain = 0;
+}
+
+static double integrated_loudness(struct af_loudnorm *s)
+{
+    double sum = 0;
+    long long count = 0;
+    int b;
+
+    for (b = 0; b < HIST_BINS; b++) {
+        sum += s->hist_energy[b];
+        count += s->hist_count[b];
+    }
+    if (!count)
+        return -HUGE_VAL;
+    b = (loudness(sum / count) + REL_GATE - HIST_MIN) * 10;
+    if (b <= 0)
+        return loudness(sum / count);
+    sum = 0;
+    count = 0;
+    for (; b < HIST_BINS; b++) {
+        sum += s->hist_energy[b];
+        count += s->hist_count[b];
+    }
+    return count ? loudness(sum / count) : -HUGE_VAL;
+}
+
+static double mean_energy(struct af_loudnorm *s, int n)
+{
+    double sum = 0;
+    n = FFMIN(n, s->blocks - s->start_block);
+    for (int i = 1; i <= n; i++)
+        sum += s->energy[(s->blocks - i) % SHORTTERM];
+    return n ? sum / n : 0;
+}
+
+static void end_block(struct af_loudnorm *s)
+{
+    double e = s->block_sum / s->block_frames;
+
+    s->energy[s->blocks % SHORTTERM] = e;
+    s->blocks++;
+    e = mean_energy(s, MOMENTARY);
+    s->momentary = loudness(e);
+    s->shortterm = loudness(mean_energy(s, SHORTTERM));
+    s->max_momentary = FFMAX(s->max_momentary, s->momentary);
+    s->max_shortterm = FFMAX(s->max_shortterm, s->shortterm);
+    if (s->blocks - s->start_block >= MOMENTARY
+        && s->momentary >= ABS_GATE) {
+        int b = FFMIN((s->momentary - HIST_MIN) * 10, HIST_BINS - 1);
+        s->hist_count[b]++;
+        s->hist_energy[b] += e;
+        s->integrated = integrated_loudness(s);
+    }
+
+    if (!s->measure) {
+        float *g = &s->gains[s->blocks % (s->la_blocks + 1)];
+        float prev = s->blocks - s->start_block > 1 ?
+            s->gains[(s->blocks - 1) % (s->la_blocks + 1)] : 0;
+        // hold the gain through silence and quiet passages
+        if (s->shortterm < ABS_GATE
+            || s->shortterm < s->integrated + QUIET_GATE)
+            *g = prev;
+        else
+            *g = FFMIN(s->target - s->shortterm, s->maxgain);
+        if (s->block_peak > 0)
+            *g = FFMIN(*g, s->peak - 20 * log10(s->block_peak));
+    }
+    s->block_pos = 0;
+    s->block_sum = 0;
+    s->block_peak = 0;
+}
+
+static void analyze(struct af_loudnorm *s, float *in, int frames)
+{
+    while (frames > 0) {
+        int n = FFMIN(frames, s->block_frames - s->block_pos);
+        float peak = s->block_peak;
+        for (int i = 0; i < n * s->nch; i++)
+            peak = FFMAX(peak, fabsf(in[i]));
+        s->block_peak = peak;
+#if HAVE_SSE
+        if (s->use_sse)
+            kweight_sse(s, in, n);
+        else
+#endif
+            kweight_c(s, in, n);
+        s->block_pos += n;
+        in += n * s->nch;
+        frames -= n;
+        if (s->block_pos == s->block_frames) {
+            s->sample_peak = FFMAX(s->sample_peak, s->block_peak);
+            end_block(s);
+        }
+    }
+}
+
+// Output the oldest queued block, ramping the gain so that the wanted gain
+// of every block in the lookahead is reached by the time it is played.
+static void output_block(struct af_loudnorm *s, float *out)
+{
+    int size = s->la_blocks + 1;
+    long long k = s->blocks_out;
+    double g0 = s->gain, g1;
+
+    if (k == s->start_block) {
+        g0 = s->gains[0];
+        for (int j = 1; j < size; j++)
+            g0 = FFMIN(g0, s->gains[j]);
+    }
+    // gains[] is indexed by block count, block k ends at count k + 1
+    g1 = FFMIN(g0 + s->release * BLOCK_MS / 1000.0, s->gains[(k + 1) % size]);
+    for (int j = 1; j <= s->la_blocks && k + 1 + j <= s->blocks; j++) {
+        double want = s->gains[(k + 1 + j) % size];
+        if (want < g0)
+            g1 = FFMIN(g1, g0 - (g0 - want) / j);
+    }
+
+    double a0 = pow(10.0, g0 / 20), a1 = pow(10.0, g1 / 20);
+    double step = (a1 - a0) / s->block_frames;
+    float *in = s->queue;
+    for (int i = 0; i < s->block_frames; i++) {
+        float a = a0 + step * i;
+        for (int ch = 0; ch < s->nch; ch++)
+            *out++ = *in++ * a;
+    }
+    s->gain = g1;
+    s->min_gain = FFMIN(s->min_gain, g1);
+    s->max_gain = FFMAX(s->max_gain, g1);
+    s->blocks_out++;
+    s->queued -= s->block_frames;
+    memmove(s->queue, s->queue + s->block_frames * s->nch,
+            s->queued * s->nch * sizeof(float));
+}
+
+// At the end of the input: output the whole lookahead and the unfinished
+// block at the gain reached, and start the next input on a new block.
+static float *drain(struct af_loudnorm *s, float *out)
+{
+    while (s->blocks_out < s->blocks) {
+        output_block(s, out);
+        out += s->block_frames * s->nch;
+    }
+    float a = pow(10.0, s->gain / 20);
+    for (int i = 0; i < s->queued * s->nch; i++)
+        *out++ = s->queue[i] * a;
+    s->queued = 0;
+    s->block_pos = 0;
+    s->block_sum = 0;
+    s->block_peak = 0;
+    s->draining = 0;
+    return out;
+}
+
+static void print_stats(struct af_loudnorm *s)
+{
+    if (!s->blocks)
+        return;
+    mp_msg(MSGT_AFILTER, MSGL_INFO,
+           "[loudnorm] integrated: %.1f LUFS, max momentary: %.1f LUFS, "
+           "max short-term: %.1f LUFS, sample peak: %.1f dBFS\n",
+           s->integrated, s->max_momentary, s->max_shortterm,
+           20 * log10(s->sample_peak));
+    if (!s->measure && s->blocks_out)
+        mp_msg(MSGT_AFILTER, MSGL_INFO, "[loudnorm] gain: %.1f .. %.1f dB\n",
+               s->min_gain, s->max_gain);
+    mp_msg(MSGT_IDENTIFY, MSGL_INFO, "ID_LOUDNESS_INTEGRATED=%.1f\n",
+           s->integrated);
+    mp_msg(MSGT_IDENTIFY, MSGL_INFO, "ID_LOUDNESS_PEAK=%.1f\n",
+           20 * log10(s->sample_peak));
+}
+
+static int control(struct af_instance_s *af, int cmd, void *arg)
+{
+    struct af_loudnorm *s = af->setup;
+
+    switch (cmd) {
+    case AF_CONTROL_REINIT: {
+        af_data_t *data = arg;
+        int chunks;
+
+        if (!data)
+            return AF_ERROR;
+        print_stats(s);
+        af->data->rate   = data->rate;
+        af->data->nch    = data->nch;
+        af->data->format = AF_FORMAT_FLOAT_NE;
+        af->data->bps    = 4;
+        af->delay = 0;
+        af->mul   = 1;
+
+        s->nch = data->nch;
+        s->block_frames = FFMAX(data->rate * BLOCK_MS / 1000, 1);
+        kweight_init(s, data->rate);
+        channel_weights(s);
+
+        chunks = simd_chunks(s->nch);
+        free(s->simd_mem);
+        s->simd_mem = malloc((NCOEF + chunks * 5) * 4 * sizeof(float) + 15);
+        if (!s->simd_mem)
+            return AF_ERROR;
+        s->simd_coef = (float *)(((uintptr_t)s->simd_mem + 15) & ~15);
+        s->simd_state = s->simd_coef + NCOEF * 4;
+        for (int i = 0; i < NCOEF; i++)
+            for (int j = 0; j < 4; j++)
+                s->simd_coef[i * 4 + j] = s->coef[i];
+        s->use_sse = HAVE_SSE && gCpuCaps.hasSSE;
+
+        if (!s->measure) {
+            s->la_blocks = FFMAX(lrintf(s->lookahead / BLOCK_MS), 1);
+            free(s->queue);
+            s->queue = NULL;
+            s->queue_frames = 0;
+            free(s->gains);
+            s->gains = calloc(s->la_blocks + 1, sizeof(float));
+            if (!s->gains)
+                return AF_ERROR;
+        }
+        reset_state(s);
+        return af_test_output(af, data);
+    }
+    case AF_CONTROL_COMMAND_LINE: {
+        opt_t subopts[] = {
+            {"measure",   OPT_ARG_BOOL,  &s->measure,   NULL},
+            {"target",    OPT_ARG_FLOAT, &s->target,    NULL},
+            {"lookahead", OPT_ARG_FLOAT, &s->lookahead, NULL},
+            {"maxgain",   OPT_ARG_FLOAT, &s->maxgain,   NULL},
+            {"peak",      OPT_ARG_FLOAT, &s->peak,      NULL},
+            {"release",   OPT_ARG_FLOAT, &s->release,   NULL},
+            {NULL},
+        };
+        if (subopt_parse(arg, subopts) != 0)
+            return AF_ERROR;
+        if (s->lookahead < BLOCK_MS || s->lookahead > 10000) {
+            mp_msg(MSGT_AFILTER, MSGL_ERR, "[loudnorm] %s: %s: "
+                   "100 <= lookahead <= 10000\n",
+                   mp_gtext("error parsing command line"),
+                   mp_gtext("value out of range"));
+            return AF_ERROR;
+        }
+        if (s->release <= 0) {
+            mp_msg(MSGT_AFILTER, MSGL_ERR, "[loudnorm] %s: %s: release > 0\n",
+                   mp_gtext("error parsing command line"),
+                   mp_gtext("value out of range"));
+            return AF_ERROR;
+        }
+        return AF_OK;
+    }
+    case AF_CONTROL_LOUDNORM_LOUDNESS | AF_CONTROL_GET: {
+        float *l = arg;
+        l[0] = s->momentary;
+        l[1] = s->shortterm;
+        l[2] = s->integrated;
+        return AF_OK;
+    }
+    case AF_CONTROL_DRAIN:
+        if (s->measure)
+            return AF_UNKNOWN;
+        s->draining = 1;
+        return AF_OK;
+    case AF_CONTROL_RESET:
+        restart(s);
+        af->delay = 0;
+        return AF_OK;
+    case AF_CONTROL_PRE_DESTROY:
+        print_stats(s);
+        return AF_OK;
+    }
+    return AF_UNKNOWN;
+}
+
+static void uninit(struct af_instance_s *af)
+{
+    struct af_loudnorm *s = af->setup;
+    if (s) {
+        free(s->simd_mem);
+        free(s->queue);
+        free(s->gains);
+    }
+    if (af->data)
+        free(af->data->audio);
+    free(af->data);
+    free(af->setup);
+}
+
+static af_data_t *play(struct af_instance_s *af, af_data_t *data)
+{
+    struct af_loudnorm *s = af->setup;
+    int frames = data->len / (s->nch * sizeof(float));
+    float *in = data->audio;
+    int max_out;
+    float *out;
+
+    if (s->measure) {
+        analyze(s, data->audio, frames);
+        return data;
+    }
+
+    if (s->queued + frames > s->queue_frames) {
+        s->queue_frames = s->queued + frames;
+        s->queue = realloc(s->queue, s->queue_frames * s->nch * sizeof(float));
+        if (!s->queue) {
+            mp_msg(MSGT_AFILTER, MSGL_FATAL, "[libaf] Could not allocate memory\n");
+            return NULL;
+        }
+    }
+    // RESIZE_LOCAL_BUFFER - can't use macro
+    max_out = s->queued + frames;
+    if (!s->draining)
+        max_out -= max_out % s->block_frames;
+    max_out *= s->nch * sizeof(float);
+    if (max_out > af->data->len) {
+        af->data->audio = realloc(af->data->audio, max_out);
+        if (!af->data->audio) {
+            mp_msg(MSGT_AFILTER, MSGL_FATAL, "[libaf] Could not allocate memory\n");
+            return NULL;
+        }
+        af->data->len = max_out;
+    }
+
+    // one block at a time, the gain ring only covers the lookahead
+    out = af->data->audio;
+    while (frames > 0) {
+        int n = FFMIN(frames, s->block_frames - s->block_pos);
+        memcpy(s->queue + s->queued * s->nch, in, n * s->nch * sizeof(float));
+        s->queued += n;
+        analyze(s, in, n);
+        in += n * s->nch;
+        frames -= n;
+        while (s->blocks - s->blocks_out > s->la_blocks) {
+            output_block(s, out);
+            out += s->block_frames * s->nch;
+        }
+    }
+    if (s->draining)
+        out = drain(s, out);
+    af->delay = s->queued * s->nch * sizeof(float);
+
+    data->audio = af->data->audio;
+    data->len   = (char *)out - (char *)af->data->audio;
+    return data;
+}
+
+static int af_open(af_instance_t *af)
+{
+    struct af_loudnorm *s;
+
+    af->control = control;
+    af->uninit  = uninit;
+    af->play    = play;
+    af->mul     = 1;
+    af->data    = calloc(1, sizeof(af_data_t));
+    af->setup   = s = calloc(1, sizeof(struct af_loudnorm));
+    if (af->data == NULL || af->setup == NULL)
+        return AF_ERROR;
+
+    s->target    = -23;
+    s->lookahead = 1500;
+    s->maxgain   = 12;
+    s->peak      = -1;
+    s->release   = 3;
+    return AF_OK;
+}
+
+af_info_t af_info_loudnorm = {
+    "EBU R128 loudness meter and normalizer",
+    "loudnorm",
+    "",
+    "",
+    AF_FLAGS_REENTRANT,
+    af_open
+};
@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <inttypes.h>
 #include <math.h>
@@ -158,12 +159,17 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
   float*	end  = in+c->len/4; 	// End of loop
   int		nchi = c->nch;		// Number of input channels
   int		ncho = l->nch;		// Number of output channels
+  float		tmp[AF_NCH];		// Output of one sample frame
   register int  j,k;
 
-  if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
-    return NULL;
+  // Mixing down to fewer channels can overwrite the input buffer
+  if(ncho > nchi){
+    if(AF_OK != RESIZE_LOCAL_BUFFER(af,data))
+      return NULL;
+    c->audio = l->audio;
+  }
+  out = c->audio;
 
-  out = l->audio;
   // Execute panning
   // FIXME: Too slow
   while(in < end){
@@ -172,14 +178,14 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data)
       register float* tin = in;
       for(k=0;k<nchi;k++)
 	x += tin[k] * s->level[j][k];
-      out[j] = x;
+      tmp[j] = x;
     }
+    memcpy(out, tmp, ncho * sizeof(float));
     out+= ncho;
     in+= nchi;
   }
 
   // Set output data
-  c->audio = l->audio;
   c->len   = c->len / c->nch * l->nch;
   c->nch   = l->nch;
 
@@ -36,7 +36,9 @@
 #include <limits.h>
 #include <assert.h>
 
+#include "config.h"
 #include "af.h"
+#include "cpudetect.h"
 #include "libavutil/common.h"
 #include "subopt-helper.h"
 
@@ -116,7 +118,7 @@ static int fill_queue(struct af_instance_s* af, af_data_t* data, int offset)
   return offset - offset_unchanged;
 }
 
-#define UNROLL_PADDING (4*4)
+#define UNROLL_PADDING (4*16)
 
 static int best_overlap_offset_float(af_scaletempo_t* s)
 {
@@ -193,6 +195,261 @@ static int best_overlap_offset_s16(af_scaletempo_t* s)
   return best_off * 2 * s->num_channels;
 }
 
+#if HAVE_SSE
+/* The correlation loops below run over the window rounded up to the
+ * vector width; buf_pre_corr is zero padded and buf_queue has
+ * UNROLL_PADDING zeroed bytes at the end, so the extra products are 0.
+ * Sums are reordered relative to the C version, so near-ties may resolve
+ * to a different offset. */
+static int best_overlap_offset_float_sse(af_scaletempo_t* s)
+{
+  float *pw, *po, *ppc, *search_start;
+  float best_corr = INT_MIN;
+  int best_off = 0;
+  int i, off;
+  x86_reg n = (s->samples_overlap - s->num_channels + 7) & ~7;
+
+  pw  = s->table_window;
+  po  = s->buf_overlap;
+  po += s->num_channels;
+  ppc = s->buf_pre_corr;
+  for (i=s->num_channels; i<s->samples_overlap; i++) {
+    *ppc++ = *pw++ * *po++;
+  }
+
+  ppc = (float*)s->buf_pre_corr + n;
+  search_start = (float*)s->buf_queue + s->num_channels + n;
+  for (off=0; off<s->frames_search; off++) {
+    float corr;
+    x86_reg x = -4 * n;
+    __asm__ volatile(
+      "xorps     %%xmm0, %%xmm0      \n\t"
+      "xorps     %%xmm1, %%xmm1      \n\t"
+      "1:                            \n\t"
+      "movups  (%[pc],%[x]), %%xmm2       \n\t"
+      "movups  (%[ps],%[x]), %%xmm3       \n\t"
+      "movups 16(%[pc],%[x]), %%xmm4      \n\t"
+      "movups 16(%[ps],%[x]), %%xmm5      \n\t"
+      "mulps     %%xmm3, %%xmm2      \n\t"
+      "mulps     %%xmm5, %%xmm4      \n\t"
+      "addps     %%xmm2, %%xmm0      \n\t"
+      "addps     %%xmm4, %%xmm1      \n\t"
+      "add         $32, %[x]           \n\t"
+      "js 1b                         \n\t"
+      "addps     %%xmm1, %%xmm0      \n\t"
+      "movhlps   %%xmm0, %%xmm1      \n\t"
+      "addps     %%xmm1, %%xmm0      \n\t"
+      "movaps    %%xmm0, %%xmm1      \n\t"
+      "shufps $1, %%xmm1, %%xmm1     \n\t"
+      "addss     %%xmm1, %%xmm0      \n\t"
+      "movss     %%xmm0, %[corr]          \n\t"
+      :[corr]"=m"(corr), [x]"+&r"(x)
+      :[pc]"r"(ppc), [ps]"r"(search_start)
+      :"memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+    );
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_off  = off;
+    }
+    search_start += s->num_channels;
+  }
+
+  return best_off * 4 * s->num_channels;
+}
+#endif
+
+#if HAVE_SSE2
+/* pmaddwd needs 16 bit factors, but the s16 pre-correlation values take
+ * up to 17 bits. They are split into hi * 2^15 + lo with lo in [0, 2^15)
+ * and both halves correlated separately, which gives the same 64 bit sums
+ * as the C version. The lo sums are widened to 64 bit as they go; the hi
+ * sums stay within 32 bit for windows below 2^17 samples. */
+static void split_pre_corr_s16(af_scaletempo_t* s, x86_reg n)
+{
+  int32_t *pw = s->table_window;
+  int16_t *po = (int16_t*)s->buf_overlap + s->num_channels;
+  int16_t *lo = s->buf_pre_corr;
+  int16_t *hi = lo + n;
+  int i, len = s->samples_overlap - s->num_channels;
+
+  for (i=0; i<len; i++) {
+    int32_t v = ( pw[i] * po[i] ) >> 15;
+    hi[i] = v >> 15;
+    lo[i] = v - (hi[i] << 15);
+  }
+  for (; i<n; i++) {
+    hi[i] = lo[i] = 0;
+  }
+}
+
+static int best_overlap_offset_s16_sse2(af_scaletempo_t* s)
+{
+  int16_t *lo, *hi, *search_start;
+  int64_t best_corr = INT64_MIN;
+  int best_off = 0;
+  int off;
+  x86_reg n = (s->samples_overlap - s->num_channels + 7) & ~7;
+
+  split_pre_corr_s16(s, n);
+  lo = (int16_t*)s->buf_pre_corr + n;
+  hi = lo + n;
+  search_start = (int16_t*)s->buf_queue + s->num_channels + n;
+  for (off=0; off<s->frames_search; off++) {
+    int64_t sum_lo[2] __attribute__((aligned(16)));
+    int32_t sum_hi[4] __attribute__((aligned(16)));
+    int64_t corr;
+    x86_reg x = -2 * n;
+    __asm__ volatile(
+      "pxor      %%xmm0, %%xmm0      \n\t"
+      "pxor      %%xmm1, %%xmm1      \n\t"
+      "1:                            \n\t"
+      "movdqu  (%[ps],%[x]), %%xmm2       \n\t"
+      "movdqu  (%[hi],%[x]), %%xmm4       \n\t"
+      "movdqu  (%[lo],%[x]), %%xmm3       \n\t"
+      "pmaddwd   %%xmm2, %%xmm4      \n\t"
+      "pmaddwd   %%xmm3, %%xmm2      \n\t"
+      "paddd     %%xmm4, %%xmm1      \n\t"
+      "movdqa    %%xmm2, %%xmm4      \n\t"
+      "movdqa    %%xmm2, %%xmm5      \n\t"
+      "psrad       $31, %%xmm4       \n\t"
+      "punpckldq %%xmm4, %%xmm2      \n\t"
+      "punpckhdq %%xmm4, %%xmm5      \n\t"
+      "paddq     %%xmm2, %%xmm0      \n\t"
+      "paddq     %%xmm5, %%xmm0      \n\t"
+      "add         $16, %[x]           \n\t"
+      "js 1b                         \n\t"
+      "movdqa    %%xmm0, %[sl]          \n\t"
+      "movdqa    %%xmm1, %[sh]          \n\t"
+      :[sl]"=m"(sum_lo), [sh]"=m"(sum_hi), [x]"+&r"(x)
+      :[ps]"r"(search_start), [hi]"r"(hi), [lo]"r"(lo)
+      :"memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+    );
+    corr = sum_lo[0] + sum_lo[1]
+         + (((int64_t)sum_hi[0] + sum_hi[1] + sum_hi[2] + sum_hi[3]) << 15);
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_off  = off;
+    }
+    search_start += s->num_channels;
+  }
+
+  return best_off * 2 * s->num_channels;
+}
+#endif
+
+#if HAVE_AVX2
+static int best_overlap_offset_float_avx2(af_scaletempo_t* s)
+{
+  float *pw, *po, *ppc, *search_start;
+  float best_corr = INT_MIN;
+  int best_off = 0;
+  int i, off;
+  x86_reg n = (s->samples_overlap - s->num_channels + 15) & ~15;
+
+  pw  = s->table_window;
+  po  = s->buf_overlap;
+  po += s->num_channels;
+  ppc = s->buf_pre_corr;
+  for (i=s->num_channels; i<s->samples_overlap; i++) {
+    *ppc++ = *pw++ * *po++;
+  }
+
+  ppc = (float*)s->buf_pre_corr + n;
+  search_start = (float*)s->buf_queue + s->num_channels + n;
+  for (off=0; off<s->frames_search; off++) {
+    float corr;
+    x86_reg x = -4 * n;
+    __asm__ volatile(
+      "vxorps    %%ymm0, %%ymm0, %%ymm0      \n\t"
+      "vxorps    %%ymm1, %%ymm1, %%ymm1      \n\t"
+      "1:                                    \n\t"
+      "vmovups   (%[pc],%[x]), %%ymm2             \n\t"
+      "vmovups 32(%[pc],%[x]), %%ymm3             \n\t"
+      "vmulps    (%[ps],%[x]), %%ymm2, %%ymm2     \n\t"
+      "vmulps  32(%[ps],%[x]), %%ymm3, %%ymm3     \n\t"
+      "vaddps    %%ymm2, %%ymm0, %%ymm0      \n\t"
+      "vaddps    %%ymm3, %%ymm1, %%ymm1      \n\t"
+      "add          $64, %[x]                  \n\t"
+      "js 1b                                 \n\t"
+      "vaddps    %%ymm1, %%ymm0, %%ymm0      \n\t"
+      "vextractf128 $1, %%ymm0, %%xmm1       \n\t"
+      "vaddps    %%xmm1, %%xmm0, %%xmm0      \n\t"
+      "vmovhlps  %%xmm0, %%xmm0, %%xmm1      \n\t"
+      "vaddps    %%xmm1, %%xmm0, %%xmm0      \n\t"
+      "vshufps $1, %%xmm0, %%xmm0, %%xmm1    \n\t"
+      "vaddss    %%xmm1, %%xmm0, %%xmm0      \n\t"
+      "vmovss    %%xmm0, %[corr]                  \n\t"
+      "vzeroupper                            \n\t"
+      :[corr]"=m"(corr), [x]"+&r"(x)
+      :[pc]"r"(ppc), [ps]"r"(search_start)
+      :"memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+    );
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_off  = off;
+    }
+    search_start += s->num_channels;
+  }
+
+  return best_off * 4 * s->num_channels;
+}
+
+static int best_overlap_offset_s16_avx2(af_scaletempo_t* s)
+{
+  int16_t *lo, *hi, *search_start;
+  int64_t best_corr = INT64_MIN;
+  int best_off = 0;
+  int off;
+  x86_reg n = (s->samples_overlap - s->num_channels + 15) & ~15;
+
+  split_pre_corr_s16(s, n);
+  lo = (int16_t*)s->buf_pre_corr + n;
+  hi = lo + n;
+  search_start = (int16_t*)s->buf_queue + s->num_channels + n;
+  for (off=0; off<s->frames_search; off++) {
+    int64_t sum_lo[2] __attribute__((aligned(16)));
+    int32_t sum_hi[4] __attribute__((aligned(16)));
+    int64_t corr;
+    x86_reg x = -2 * n;
+    __asm__ volatile(
+      "vpxor     %%ymm0, %%ymm0, %%ymm0      \n\t"
+      "vpxor     %%ymm1, %%ymm1, %%ymm1      \n\t"
+      "1:                                    \n\t"
+      "vmovdqu   (%[ps],%[x]), %%ymm2             \n\t"
+      "vpmaddwd  (%[hi],%[x]), %%ymm2, %%ymm4     \n\t"
+      "vpmaddwd  (%[lo],%[x]), %%ymm2, %%ymm2     \n\t"
+      "vpaddd    %%ymm4, %%ymm1, %%ymm1      \n\t"
+      "vpsrad       $31, %%ymm2, %%ymm4      \n\t"
+      "vpunpckldq %%ymm4, %%ymm2, %%ymm5     \n\t"
+      "vpunpckhdq %%ymm4, %%ymm2, %%ymm2     \n\t"
+      "vpaddq    %%ymm5, %%ymm0, %%ymm0      \n\t"
+      "vpaddq    %%ymm2, %%ymm0, %%ymm0      \n\t"
+      "add          $32, %[x]                  \n\t"
+      "js 1b                                 \n\t"
+      "vextracti128 $1, %%ymm0, %%xmm2       \n\t"
+      "vpaddq    %%xmm2, %%xmm0, %%xmm0      \n\t"
+      "vextracti128 $1, %%ymm1, %%xmm2       \n\t"
+      "vpaddd    %%xmm2, %%xmm1, %%xmm1      \n\t"
+      "vmovdqa   %%xmm0, %[sl]                  \n\t"
+      "vmovdqa   %%xmm1, %[sh]                  \n\t"
+      "vzeroupper                            \n\t"
+      :[sl]"=m"(sum_lo), [sh]"=m"(sum_hi), [x]"+&r"(x)
+      :[ps]"r"(search_start), [hi]"r"(hi), [lo]"r"(lo)
+      :"memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+    );
+    corr = sum_lo[0] + sum_lo[1]
+         + (((int64_t)sum_hi[0] + sum_hi[1] + sum_hi[2] + sum_hi[3]) << 15);
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_off  = off;
+    }
+    search_start += s->num_channels;
+  }
+
+  return best_off * 2 * s->num_channels;
+}
+#endif
+
 static void output_overlap_float(af_scaletempo_t* s, void* buf_out,
 				  int bytes_off)
 {
@@ -386,7 +643,7 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
           mp_msg(MSGT_AFILTER, MSGL_FATAL, "[scaletempo] Out of memory\n");
           return AF_ERROR;
         }
-        memset((char *)s->buf_pre_corr + s->bytes_overlap * 2, 0, UNROLL_PADDING);
+        memset(s->buf_pre_corr, 0, s->bytes_overlap * 2 + UNROLL_PADDING);
         pw = s->table_window;
         for (i=1; i<frames_overlap; i++) {
           int32_t v = ( i * (t - i) * n ) >> 15;
@@ -395,14 +652,23 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
           }
         }
         s->best_overlap_offset = best_overlap_offset_s16;
+#if HAVE_SSE2
+        if (gCpuCaps.hasSSE2 && s->samples_overlap < 1 << 17)
+          s->best_overlap_offset = best_overlap_offset_s16_sse2;
+#endif
+#if HAVE_AVX2
+        if (gCpuCaps.hasAVX2 && s->samples_overlap < 1 << 17)
+          s->best_overlap_offset = best_overlap_offset_s16_avx2;
+#endif
       } else {
         float* pw;
-        s->buf_pre_corr = realloc(s->buf_pre_corr, s->bytes_overlap);
+        s->buf_pre_corr = realloc(s->buf_pre_corr, s->bytes_overlap + UNROLL_PADDING);
         s->table_window = realloc(s->table_window, s->bytes_overlap - nch * bps);
         if(!s->buf_pre_corr || !s->table_window) {
           mp_msg(MSGT_AFILTER, MSGL_FATAL, "[scaletempo] Out of memory\n");
           return AF_ERROR;
         }
+        memset(s->buf_pre_corr, 0, s->bytes_overlap + UNROLL_PADDING);
         pw = s->table_window;
         for (i=1; i<frames_overlap; i++) {
           float v = i * (frames_overlap - i);
@@ -411,6 +677,14 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
           }
         }
         s->best_overlap_offset = best_overlap_offset_float;
+#if HAVE_SSE
+        if (gCpuCaps.hasSSE)
+          s->best_overlap_offset = best_overlap_offset_float_sse;
+#endif
+#if HAVE_AVX2
+        if (gCpuCaps.hasAVX2)
+          s->best_overlap_offset = best_overlap_offset_float_avx2;
+#endif
       }
     }
 
@@ -424,6 +698,7 @@ static int control(struct af_instance_s* af, int cmd, void* arg)
       mp_msg(MSGT_AFILTER, MSGL_FATAL, "[scaletempo] Out of memory\n");
       return AF_ERROR;
     }
+    memset(s->buf_queue + s->bytes_queue, 0, UNROLL_PADDING);
 
     s->bytes_queued = 0;
     s->bytes_to_slide = 0;
@@ -39,34 +39,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <libavutil/common.h>
+
 #include "af.h"
 #include "dsp.h"
 
 #define L  32    // Length of fir filter
 #define LD 65536 // Length of delay buffer
-
-// 32 Tap fir filter loop unrolled
-#define FIR(x,w,y) \
-  y = ( w[0] *x[0] +w[1] *x[1] +w[2] *x[2] +w[3] *x[3]  \
-      + w[4] *x[4] +w[5] *x[5] +w[6] *x[6] +w[7] *x[7]  \
-      + w[8] *x[8] +w[9] *x[9] +w[10]*x[10]+w[11]*x[11] \
-      + w[12]*x[12]+w[13]*x[13]+w[14]*x[14]+w[15]*x[15] \
-      + w[16]*x[16]+w[17]*x[17]+w[18]*x[18]+w[19]*x[19] \
-      + w[20]*x[20]+w[21]*x[21]+w[22]*x[22]+w[23]*x[23] \
-      + w[24]*x[24]+w[25]*x[25]+w[26]*x[26]+w[27]*x[27] \
-      + w[28]*x[28]+w[29]*x[29]+w[30]*x[30]+w[31]*x[31])
-
-// Add to circular queue macro + update index
-#ifdef SPLITREAR
-#define ADDQUE(qi,rq,lq,r,l)\
-  lq[qi]=lq[qi+L]=(l);\
-  rq[qi]=rq[qi+L]=(r);\
-  qi=(qi-1)&(L-1);
-#else
-#define ADDQUE(qi,lq,l)\
-  lq[qi]=lq[qi+L]=(l);\
-  qi=(qi-1)&(L-1);
-#endif
+#define BL 1024  // Frames low-pass filtered per pass
 
 // Macro for updating queue index in delay queues
 #define UPDATEQI(qi) qi=(qi+1)&(LD-1)
@@ -74,13 +54,14 @@
 // instance data
 typedef struct af_surround_s
 {
-  float lq[2*L]; // Circular queue for filtering left rear channel
-  float rq[2*L]; // Circular queue for filtering right rear channel
+  float lq[L+BL]; // Surround history + current block, left rear channel
+  float rq[L+BL]; // Surround history + current block, right rear channel
+  float lf[BL];   // Low-passed left rear block
+  float rf[BL];   // Low-passed right rear block
   float w[L]; 	 // FIR filter coefficients for surround sound 7kHz low-pass
   float* dr;	 // Delay queue right rear channel
   float* dl;	 // Delay queue left rear channel
   float  d;	 // Delay time
-  int i;       	 // Position in circular buffer
   int wi;	 // Write index for delay queue
   int ri;	 // Read index for delay queue
 }af_surround_t;
@@ -173,7 +154,6 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data){
   float*     	 in  = data->audio; 	// Input audio data
   float*     	 out = NULL;		// Output audio data
   float*	 end = in + data->len / sizeof(float); // Loop end
-  int 		 i   = s->i;	// Filter queue index
   int 		 ri  = s->ri;	// Read index for delay queue
   int 		 wi  = s->wi;	// Write index for delay queue
 
@@ -183,11 +163,8 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data){
   out = af->data->audio;
 
   while(in < end){
-    /* Dominance:
-       abs(in[0])  abs(in[1]);
-       abs(in[0]+in[1])  abs(in[0]-in[1]);
-       10 * log( abs(in[0]) / (abs(in[1])|1) );
-       10 * log( abs(in[0]+in[1]) / (abs(in[0]-in[1])|1) ); */
+    int n = FFMIN(BL, (end - in) / data->nch);
+    int k;
 
     /* About volume balancing...
        Surround encoding does the following:
@@ -202,44 +179,58 @@ static af_data_t* play(struct af_instance_s* af, af_data_t* data){
        6dB (/2). This keeps the overall balance, but guarantees no
        overflow. */
 
-    // Output front left and right
-    out[0] = m[0]*in[0] + m[1]*in[1];
-    out[1] = m[2]*in[0] + m[3]*in[1];
+    // Calculate surround for the block behind the last L samples
+    for(k = 0; k < n; k++){
+      float* x = &in[k*data->nch];
+#ifdef SPLITREAR
+      s->lq[L+k] = m[8]*x[0]+m[9]*x[1];
+      s->rq[L+k] = m[6]*x[0]+m[7]*x[1];
+#else
+      s->lq[L+k] = m[4]*x[0]+m[5]*x[1];
+#endif
+    }
 
-    // Low-pass output @ 7kHz
-    FIR((&s->lq[i]), s->w, s->dl[wi]);
+    /* Low-pass @ 7kHz, output k is made of the L samples before
+       surround sample k. The taps are symmetric, so they need not be
+       reversed for the block filter. */
+    af_filter_fir_block(L, s->w, s->lq, s->lf, n);
+#ifdef SPLITREAR
+    af_filter_fir_block(L, s->w, s->rq, s->rf, n);
+#endif
 
-    // Delay output by d ms
-    out[2] = s->dl[ri];
+    for(k = 0; k < n; k++){
+      // Output front left and right
+      out[0] = m[0]*in[0] + m[1]*in[1];
+      out[1] = m[2]*in[0] + m[3]*in[1];
 
+      // Delay output by d ms
+      s->dl[wi] = s->lf[k];
+      out[2] = s->dl[ri];
 #ifdef SPLITREAR
-    // Low-pass output @ 7kHz
-    FIR((&s->rq[i]), s->w, s->dr[wi]);
-
-    // Delay output by d ms
-    out[3] = s->dr[ri];
+      s->dr[wi] = s->rf[k];
+      out[3] = s->dr[ri];
 #else
-    out[3] = -out[2];
+      out[3] = -out[2];
 #endif
 
-    // Update delay queues indexes
-    UPDATEQI(ri);
-    UPDATEQI(wi);
+      // Update delay queues indexes
+      UPDATEQI(ri);
+      UPDATEQI(wi);
 
-    // Calculate and save surround in circular queue
+      // Next sample...
+      in = &in[data->nch];
+      out = &out[af->data->nch];
+    }
+
+    // Keep the last L surround samples as history for the next block
+    memmove(s->lq, &s->lq[n], L*sizeof(float));
 #ifdef SPLITREAR
-    ADDQUE(i, s->rq, s->lq, m[6]*in[0]+m[7]*in[1], m[8]*in[0]+m[9]*in[1]);
-#else
-    ADDQUE(i, s->lq, m[4]*in[0]+m[5]*in[1]);
+    memmove(s->rq, &s->rq[n], L*sizeof(float));
 #endif
-
-    // Next sample...
-    in = &in[data->nch];
-    out = &out[af->data->nch];
   }
 
   // Save indexes
-  s->i  = i; s->ri = ri; s->wi = wi;
+  s->ri = ri; s->wi = wi;
 
   // Set output data
   data->audio = af->data->audio;
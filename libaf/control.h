@@ -111,6 +111,16 @@ typedef struct af_control_ext_s{
    argument */
 #define AF_CONTROL_COMMAND_LINE		0x00000300 | AF_CONTROL_OPTIONAL
 
+/* The input ends with the next play() call. A filter that delays its
+   output returns AF_OK and outputs everything it holds back from that
+   call, which may have an empty input. */
+#define AF_CONTROL_DRAIN		0x00000400 | AF_CONTROL_OPTIONAL
+
+/* The input continues from an unrelated position (seek). Filters drop the
+   audio they hold back and the state derived from it. Sent to all filters,
+   the return value is ignored. */
+#define AF_CONTROL_RESET		0x00000500 | AF_CONTROL_OPTIONAL
+
 
 // FILTER SPECIFIC CALLS
 
@@ -254,4 +264,7 @@ typedef struct af_control_ext_s{
 #define AF_CONTROL_PLAYBACK_SPEED	0x00003500 | AF_CONTROL_FILTER_SPECIFIC
 #define AF_CONTROL_SCALETEMPO_AMOUNT	0x00003600 | AF_CONTROL_FILTER_SPECIFIC
 
+// Loudness [LUFS], arg is float[3]: momentary, short-term, integrated
+#define AF_CONTROL_LOUDNORM_LOUDNESS	0x00003700 | AF_CONTROL_FILTER_SPECIFIC
+
 #endif /* MPLAYER_CONTROL_H */
@@ -22,6 +22,9 @@
 
 #include <string.h>
 #include <math.h>
+
+#include "config.h"
+#include "cpudetect.h"
 #include "dsp.h"
 
 /******************************************************************************
@@ -46,6 +49,78 @@ inline FLOAT_TYPE af_filter_fir(register unsigned int n, const FLOAT_TYPE* w,
   return y;
 }
 
+#if HAVE_SSE
+/* SSE part of af_filter_fir_block(), does len & ~15 outputs. Each pass
+   keeps 16 outputs in xmm0-xmm3 and walks the taps, broadcasting one tap
+   at a time, so the input is read unaligned but never shuffled.
+*/
+static unsigned int fir_block_sse(unsigned int n, const FLOAT_TYPE* w,
+                                  const FLOAT_TYPE* x, FLOAT_TYPE* y,
+                                  unsigned int len)
+{
+  unsigned int i;
+  for(i = 0; i + 16 <= len; i += 16){
+    x86_reg j = -4 * (x86_reg)n;
+    __asm__ volatile(
+      "xorps    %%xmm0, %%xmm0          \n\t"
+      "xorps    %%xmm1, %%xmm1          \n\t"
+      "xorps    %%xmm2, %%xmm2          \n\t"
+      "xorps    %%xmm3, %%xmm3          \n\t"
+      "1:                               \n\t"
+      "movss      (%[w],%[j]), %%xmm4   \n\t"
+      "shufps   $0, %%xmm4, %%xmm4      \n\t"
+      "movups     (%[x],%[j]), %%xmm5   \n\t"
+      "movups   16(%[x],%[j]), %%xmm6   \n\t"
+      "movups   32(%[x],%[j]), %%xmm7   \n\t"
+      "mulps    %%xmm4, %%xmm5          \n\t"
+      "mulps    %%xmm4, %%xmm6          \n\t"
+      "mulps    %%xmm4, %%xmm7          \n\t"
+      "addps    %%xmm5, %%xmm0          \n\t"
+      "addps    %%xmm6, %%xmm1          \n\t"
+      "addps    %%xmm7, %%xmm2          \n\t"
+      "movups   48(%[x],%[j]), %%xmm5   \n\t"
+      "mulps    %%xmm4, %%xmm5          \n\t"
+      "addps    %%xmm5, %%xmm3          \n\t"
+      "add      $4, %[j]                \n\t"
+      "jnz      1b                      \n\t"
+      "movups   %%xmm0,   (%[y])        \n\t"
+      "movups   %%xmm1, 16(%[y])        \n\t"
+      "movups   %%xmm2, 32(%[y])        \n\t"
+      "movups   %%xmm3, 48(%[y])        \n\t"
+      : [j] "+r" (j)
+      : [w] "r" (w + n), [x] "r" (x + i + n), [y] "r" (y + i)
+      : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+        "xmm7");
+  }
+  return i;
+}
+#endif
+
+/* Block FIR filter y[i]=w*x[i], where x[i] are the n samples starting at x+i
+
+   n   number of filter taps, any n > 0
+   w   filter taps
+   x   input signal, linear and at least len+n-1 samples long
+   y   output buffer, len samples
+   len number of output samples
+*/
+void af_filter_fir_block(unsigned int n, const FLOAT_TYPE* w,
+                         const FLOAT_TYPE* x, FLOAT_TYPE* y, unsigned int len)
+{
+  unsigned int i = 0;
+#if HAVE_SSE
+  if(gCpuCaps.hasSSE)
+    i = fir_block_sse(n, w, x, y, len);
+#endif
+  for(; i < len; i++){
+    unsigned int j;
+    FLOAT_TYPE t = 0.0;
+    for(j = 0; j < n; j++)
+      t += w[j]*x[i+j];
+    y[i] = t;
+  }
+}
+
 /* C implementation of parallel FIR filter y(k)=w(k) * x(k) (where * denotes convolution)
 
    n  number of filter taps, where mod(n,4)==0
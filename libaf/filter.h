@@ -55,6 +55,8 @@
 
 // Exported functions
 FLOAT_TYPE af_filter_fir(unsigned int n, const FLOAT_TYPE* w, const FLOAT_TYPE* x);
+void af_filter_fir_block(unsigned int n, const FLOAT_TYPE* w,
+                         const FLOAT_TYPE* x, FLOAT_TYPE* y, unsigned int len);
 
 FLOAT_TYPE* af_filter_pfir(unsigned int n, unsigned int k,
                            unsigned int xi, const FLOAT_TYPE** w,
@@ -24,6 +24,9 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
+
+#include "config.h"
+#include "cpudetect.h"
 #include "libvo/fastmemcpy.h"
 
 #include "reorder_ch.h"
@@ -34,247 +37,278 @@
 #include "mp_msg.h"
 #endif
 
+#define MAX_CH 8
+
+enum { CH_L, CH_R, CH_C, CH_LFE, CH_LS, CH_RS, CH_CS, CH_RLS, CH_RRS };
+
+/* Channel order of each layout, indexed by the layout id in bits 8..15
+ * (starting at 100). Unused entries are left zero. */
+static const struct layout_def {
+    int layout;
+    int8_t ch[MAX_CH];
+} layouts[] = {
+#define L(name, ...) { AF_CHANNEL_LAYOUT_ ## name, { __VA_ARGS__ } }
+    L(MONO,   CH_C),
+    L(STEREO, CH_L, CH_R),
+    L(2_1,    CH_L, CH_R, CH_LFE),
+    L(3_0_A,  CH_L, CH_R, CH_C),
+    L(3_0_B,  CH_C, CH_L, CH_R),
+    L(4_0_A,  CH_L, CH_R, CH_C, CH_CS),
+    L(4_0_B,  CH_C, CH_L, CH_R, CH_CS),
+    L(4_0_C,  CH_L, CH_R, CH_LS, CH_RS),
+    L(5_0_A,  CH_L, CH_R, CH_C, CH_LS, CH_RS),
+    L(5_0_B,  CH_L, CH_R, CH_LS, CH_RS, CH_C),
+    L(5_0_C,  CH_L, CH_C, CH_R, CH_LS, CH_RS),
+    L(5_0_D,  CH_C, CH_L, CH_R, CH_LS, CH_RS),
+    L(5_1_A,  CH_L, CH_R, CH_C, CH_LFE, CH_LS, CH_RS),
+    L(5_1_B,  CH_L, CH_R, CH_LS, CH_RS, CH_C, CH_LFE),
+    L(5_1_C,  CH_L, CH_C, CH_R, CH_LS, CH_RS, CH_LFE),
+    L(5_1_D,  CH_C, CH_L, CH_R, CH_LS, CH_RS, CH_LFE),
+    L(5_1_E,  CH_LFE, CH_L, CH_C, CH_R, CH_LS, CH_RS),
+    L(5_1_F,  CH_C, CH_L, CH_R, CH_LFE, CH_LS, CH_RS),
+    L(6_1_A,  CH_L, CH_R, CH_C, CH_LFE, CH_LS, CH_RS, CH_CS),
+    L(7_1_A,  CH_L, CH_R, CH_C, CH_LFE, CH_LS, CH_RS, CH_RLS, CH_RRS),
+    L(7_1_B,  CH_L, CH_R, CH_LS, CH_RS, CH_C, CH_LFE, CH_RLS, CH_RRS),
+    L(7_1_C,  CH_L, CH_C, CH_R, CH_LS, CH_RS, CH_LFE, CH_RLS, CH_RRS),
+    L(7_1_D,  CH_C, CH_L, CH_R, CH_LS, CH_RS, CH_RLS, CH_RRS, CH_LFE),
+    L(7_1_F,  CH_C, CH_L, CH_R, CH_LFE, CH_LS, CH_RS, CH_RLS, CH_RRS),
+#undef L
+};
+
+#define NUM_LAYOUTS (sizeof(layouts) / sizeof(layouts[0]))
 
-#define REORDER_COPY_5(DEST,SRC,SAMPLES,S0,S1,S2,S3,S4) \
-for (i = 0; i < SAMPLES; i += 5) {\
-    DEST[i]   = SRC[i+S0];\
-    DEST[i+1] = SRC[i+S1];\
-    DEST[i+2] = SRC[i+S2];\
-    DEST[i+3] = SRC[i+S3];\
-    DEST[i+4] = SRC[i+S4];\
+static int layout_index(int layout)
+{
+    int i = (layout >> 8) - 100;
+    if (i < 0 || i >= NUM_LAYOUTS || layouts[i].layout != layout)
+        return -1;
+    return i;
 }
 
-static int reorder_copy_5ch(void *dest, const void *src,
-                            unsigned int samples, unsigned int samplesize,
-                            int s0, int s1, int s2, int s3, int s4)
+#if HAVE_SSSE3
+/* Frames are shuffled in blocks of lcm(frame size, 16) bytes. Every 16
+ * byte chunk of the output block is the OR of pshufb'd source chunks; one
+ * term describes one such source chunk. */
+#define MAX_BLOCK_BYTES (21 * 16)    // 7 channels of 24 bit
+#define MAX_TERMS (MAX_BLOCK_BYTES / 16 * 5)
+
+struct reorder_term {
+    uint8_t mask[16];
+    x86_reg src;        // offset of the source chunk in the block
+    x86_reg store;      // the output chunk is complete after this term
+} __attribute__((aligned(16)));
+#endif
+
+struct reorder_plan {
+    int nch;
+    int samplesize;
+    int8_t map[MAX_CH];  // source channel of each output channel
+#if HAVE_SSSE3
+    int block;           // bytes per block, 0 if there are no terms
+    int nterms;
+    struct reorder_term terms[MAX_TERMS];
+#endif
+    void *alloc;
+};
+
+#define SAMPLESIZE_SLOTS 5   // 1, 2, 3, 4 and 8 byte samples
+
+// Plans are built on first use and kept; readers never see partial ones.
+static struct reorder_plan *plans[NUM_LAYOUTS][NUM_LAYOUTS][SAMPLESIZE_SLOTS];
+
+#if HAVE_SSSE3
+static int gcd(int a, int b)
 {
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        REORDER_COPY_5(dest_8,src_8,samples,s0,s1,s2,s3,s4);
-        break;
-    }
-    case 2:
-    {
-        int16_t *dest_16 = dest;
-        const int16_t *src_16 = src;
-        REORDER_COPY_5(dest_16,src_16,samples,s0,s1,s2,s3,s4);
-        break;
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
     }
-    case 3:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        for (i = 0; i < samples * 3; i += 15) {
-            dest_8[i]    = src_8[i+s0*3];
-            dest_8[i+1]  = src_8[i+s0*3+1];
-            dest_8[i+2]  = src_8[i+s0*3+2];
-            dest_8[i+3]  = src_8[i+s1*3];
-            dest_8[i+4]  = src_8[i+s1*3+1];
-            dest_8[i+5]  = src_8[i+s1*3+2];
-            dest_8[i+6]  = src_8[i+s2*3];
-            dest_8[i+7]  = src_8[i+s2*3+1];
-            dest_8[i+8]  = src_8[i+s2*3+2];
-            dest_8[i+9]  = src_8[i+s3*3];
-            dest_8[i+10] = src_8[i+s3*3+1];
-            dest_8[i+11] = src_8[i+s3*3+2];
-            dest_8[i+12] = src_8[i+s4*3];
-            dest_8[i+13] = src_8[i+s4*3+1];
-            dest_8[i+14] = src_8[i+s4*3+2];
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *dest_32 = dest;
-        const int32_t *src_32 = src;
-        REORDER_COPY_5(dest_32,src_32,samples,s0,s1,s2,s3,s4);
-        break;
-    }
-    case 8:
-    {
-        int64_t *dest_64 = dest;
-        const int64_t *src_64 = src;
-        REORDER_COPY_5(dest_64,src_64,samples,s0,s1,s2,s3,s4);
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
+    return a;
 }
 
-#define REORDER_COPY_6(DEST,SRC,SAMPLES,S0,S1,S2,S3,S4,S5) \
-for (i = 0; i < SAMPLES; i += 6) {\
-    DEST[i]   = SRC[i+S0];\
-    DEST[i+1] = SRC[i+S1];\
-    DEST[i+2] = SRC[i+S2];\
-    DEST[i+3] = SRC[i+S3];\
-    DEST[i+4] = SRC[i+S4];\
-    DEST[i+5] = SRC[i+S5];\
+static void build_terms(struct reorder_plan *p)
+{
+    int frame = p->nch * p->samplesize;
+    int out, chunk, k;
+
+    p->block = frame / gcd(frame, 16) * 16;
+    p->nterms = 0;
+    for (out = 0; out < p->block; out += 16) {
+        for (chunk = 0; chunk < p->block; chunk += 16) {
+            struct reorder_term *t = &p->terms[p->nterms];
+            int used = 0;
+            for (k = 0; k < 16; k++) {
+                int pos = out + k;
+                int base = pos - pos % frame;
+                int ch = pos % frame / p->samplesize;
+                int src = base + p->map[ch] * p->samplesize
+                          + pos % p->samplesize;
+                if (src >= chunk && src < chunk + 16) {
+                    t->mask[k] = src - chunk;
+                    used = 1;
+                } else
+                    t->mask[k] = 0x80;
+            }
+            if (used) {
+                t->src = chunk;
+                t->store = 0;
+                p->nterms++;
+            }
+        }
+        p->terms[p->nterms - 1].store = 1;
+    }
 }
 
-static int reorder_copy_6ch(void *dest, const void *src,
-                            unsigned int samples, uint8_t samplesize,
-                            int s0, int s1, int s2, int s3, int s4, int s5)
+/* Reorders count blocks; src and dst must not overlap. */
+static void reorder_blocks_ssse3(const struct reorder_plan *p,
+                                 const uint8_t *src, uint8_t *dst, int count)
 {
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        REORDER_COPY_6(dest_8,src_8,samples,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 2:
-    {
-        int16_t *dest_16 = dest;
-        const int16_t *src_16 = src;
-        REORDER_COPY_6(dest_16,src_16,samples,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 3:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        for (i = 0; i < samples * 3; i += 18) {
-            dest_8[i]    = src_8[i+s0*3];
-            dest_8[i+1]  = src_8[i+s0*3+1];
-            dest_8[i+2]  = src_8[i+s0*3+2];
-            dest_8[i+3]  = src_8[i+s1*3];
-            dest_8[i+4]  = src_8[i+s1*3+1];
-            dest_8[i+5]  = src_8[i+s1*3+2];
-            dest_8[i+6]  = src_8[i+s2*3];
-            dest_8[i+7]  = src_8[i+s2*3+1];
-            dest_8[i+8]  = src_8[i+s2*3+2];
-            dest_8[i+9]  = src_8[i+s3*3];
-            dest_8[i+10] = src_8[i+s3*3+1];
-            dest_8[i+11] = src_8[i+s3*3+2];
-            dest_8[i+12] = src_8[i+s4*3];
-            dest_8[i+13] = src_8[i+s4*3+1];
-            dest_8[i+14] = src_8[i+s4*3+2];
-            dest_8[i+15] = src_8[i+s5*3];
-            dest_8[i+16] = src_8[i+s5*3+1];
-            dest_8[i+17] = src_8[i+s5*3+2];
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *dest_32 = dest;
-        const int32_t *src_32 = src;
-        REORDER_COPY_6(dest_32,src_32,samples,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 8:
-    {
-        int64_t *dest_64 = dest;
-        const int64_t *src_64 = src;
-        REORDER_COPY_6(dest_64,src_64,samples,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
+    const struct reorder_term *t;
+    const struct reorder_term *first = p->terms, *last = p->terms + p->nterms;
+    const uint8_t *end = src + count * p->block;
+    x86_reg block = p->block, o;
+    __asm__ volatile(
+        "1: \n\t"
+        "mov         %[b], %[t] \n\t"
+        "pxor      %%xmm1, %%xmm1 \n\t"
+        "2: \n\t"
+        "mov     16(%[t]), %[o] \n\t"
+        "movdqu (%[s],%[o]), %%xmm0 \n\t"
+        "pshufb    (%[t]), %%xmm0 \n\t"
+        "por       %%xmm0, %%xmm1 \n\t"
+        "cmpb  $0, 16+"PTR_SIZE"(%[t]) \n\t"
+        "je 3f \n\t"
+        "movdqu    %%xmm1, (%[d]) \n\t"
+        "add          $16, %[d] \n\t"
+        "pxor      %%xmm1, %%xmm1 \n\t"
+        "3: \n\t"
+        "add          $32, %[t] \n\t"
+        "cmp         %[e], %[t] \n\t"
+        "jb 2b \n\t"
+        "add         %[n], %[s] \n\t"
+        "cmp       %[end], %[s] \n\t"
+        "jb 1b \n\t"
+        :[t]"=&r"(t), [s]"+&r"(src), [d]"+&r"(dst), [o]"=&r"(o)
+        :[b]"m"(first), [e]"m"(last), [n]"m"(block), [end]"m"(end)
+        :"memory", "xmm0", "xmm1"
+    );
 }
+#endif
 
-#define REORDER_COPY_8(DEST,SRC,SAMPLES,S0,S1,S2,S3,S4,S5,S6,S7) \
-for (i = 0; i < SAMPLES; i += 8) {\
-    DEST[i]   = SRC[i+S0];\
-    DEST[i+1] = SRC[i+S1];\
-    DEST[i+2] = SRC[i+S2];\
-    DEST[i+3] = SRC[i+S3];\
-    DEST[i+4] = SRC[i+S4];\
-    DEST[i+5] = SRC[i+S5];\
-    DEST[i+6] = SRC[i+S6];\
-    DEST[i+7] = SRC[i+S7];\
+static struct reorder_plan *get_plan(int src_layout, int dest_layout,
+                                     int samplesize)
+{
+    int si = layout_index(src_layout), di = layout_index(dest_layout);
+    int slot = samplesize == 8 ? 4 : samplesize - 1;
+    struct reorder_plan *p;
+    void *alloc;
+    int ch, k;
+
+    if (si < 0 || di < 0 || slot < 0 || slot >= SAMPLESIZE_SLOTS)
+        return NULL;
+    p = plans[si][di][slot];
+    if (p)
+        return p;
+
+    alloc = calloc(1, sizeof(*p) + 15);
+    if (!alloc)
+        return NULL;
+    p = (void *)(((uintptr_t)alloc + 15) & ~(uintptr_t)15);
+    p->alloc = alloc;
+    p->nch = AF_GET_CH_NUM(src_layout);
+    p->samplesize = samplesize;
+    for (ch = 0; ch < p->nch; ch++) {
+        for (k = 0; k < p->nch; k++)
+            if (layouts[si].ch[k] == layouts[di].ch[ch])
+                break;
+        if (k == p->nch) {
+            free(alloc);
+            return NULL;
+        }
+        p->map[ch] = k;
+    }
+#if HAVE_SSSE3
+    // 32 bit and larger samples move faster through general registers
+    if (samplesize == 2 || samplesize == 3)
+        build_terms(p);
+#endif
+    // another thread may have built the same plan in the meantime
+    if (!__sync_bool_compare_and_swap(&plans[si][di][slot], NULL, p)) {
+        free(alloc);
+        p = plans[si][di][slot];
+    }
+    return p;
 }
 
-static int reorder_copy_8ch(void *dest, const void *src,
-                            unsigned int samples, uint8_t samplesize,
-                            int s0, int s1, int s2, int s3,
-                            int s4, int s5, int s6, int s7)
+typedef struct { uint8_t b[3]; } sample24_t;
+
+/* Map entries are kept in scalars and N is a constant at every use so
+ * the whole frame is moved through registers; entries past N are 0. */
+#define REORDER_FRAMES(type, N) \
+    for (i = 0; i < frames; i++) {\
+        const type *s = (const type *)src + i * N;\
+        type *d = (type *)dest + i * N;\
+        type t0 = s[m0], t1 = s[m1], t2 = s[m2], t3 = s[m3];\
+        type t4 = s[m4], t5 = s[m5], t6 = s[m6], t7 = s[m7];\
+        d[0] = t0; d[1] = t1;\
+        if (N > 2) d[2] = t2;\
+        if (N > 3) d[3] = t3;\
+        if (N > 4) d[4] = t4;\
+        if (N > 5) d[5] = t5;\
+        if (N > 6) d[6] = t6;\
+        if (N > 7) d[7] = t7;\
+    }
+
+#define REORDER_FRAMES_NCH(type) \
+    switch (nch) {\
+    case 2: REORDER_FRAMES(type, 2); break;\
+    case 3: REORDER_FRAMES(type, 3); break;\
+    case 4: REORDER_FRAMES(type, 4); break;\
+    case 5: REORDER_FRAMES(type, 5); break;\
+    case 6: REORDER_FRAMES(type, 6); break;\
+    case 7: REORDER_FRAMES(type, 7); break;\
+    case 8: REORDER_FRAMES(type, 8); break;\
+    }
+
+/* Works in place if src == dest. samples counts single channel samples,
+ * like the public functions. */
+static void run_plan(const struct reorder_plan *p, const void *src,
+                     void *dest, int samples)
 {
+    int nch = p->nch;
+    int frames = samples / nch;
+    int m0 = p->map[0], m1 = p->map[1], m2 = p->map[2], m3 = p->map[3];
+    int m4 = p->map[4], m5 = p->map[5], m6 = p->map[6], m7 = p->map[7];
     int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        REORDER_COPY_8(dest_8,src_8,samples,s0,s1,s2,s3,s4,s5,s6,s7);
-        break;
-    }
-    case 2:
-    {
-        int16_t *dest_16 = dest;
-        const int16_t *src_16 = src;
-        REORDER_COPY_8(dest_16,src_16,samples,s0,s1,s2,s3,s4,s5,s6,s7);
-        break;
-    }
-    case 3:
-    {
-        int8_t *dest_8 = dest;
-        const int8_t *src_8 = src;
-        for (i = 0; i < samples * 3; i += 24) {
-            dest_8[i]    = src_8[i+s0*3];
-            dest_8[i+1]  = src_8[i+s0*3+1];
-            dest_8[i+2]  = src_8[i+s0*3+2];
-            dest_8[i+3]  = src_8[i+s1*3];
-            dest_8[i+4]  = src_8[i+s1*3+1];
-            dest_8[i+5]  = src_8[i+s1*3+2];
-            dest_8[i+6]  = src_8[i+s2*3];
-            dest_8[i+7]  = src_8[i+s2*3+1];
-            dest_8[i+8]  = src_8[i+s2*3+2];
-            dest_8[i+9]  = src_8[i+s3*3];
-            dest_8[i+10] = src_8[i+s3*3+1];
-            dest_8[i+11] = src_8[i+s3*3+2];
-            dest_8[i+12] = src_8[i+s4*3];
-            dest_8[i+13] = src_8[i+s4*3+1];
-            dest_8[i+14] = src_8[i+s4*3+2];
-            dest_8[i+15] = src_8[i+s5*3];
-            dest_8[i+16] = src_8[i+s5*3+1];
-            dest_8[i+17] = src_8[i+s5*3+2];
-            dest_8[i+18] = src_8[i+s6*3];
-            dest_8[i+19] = src_8[i+s6*3+1];
-            dest_8[i+20] = src_8[i+s6*3+2];
-            dest_8[i+21] = src_8[i+s7*3];
-            dest_8[i+22] = src_8[i+s7*3+1];
-            dest_8[i+23] = src_8[i+s7*3+2];
+
+#if HAVE_SSSE3
+    if (p->block && gCpuCaps.hasSSSE3) {
+        uint8_t __attribute__((aligned(16))) tmp[MAX_BLOCK_BYTES];
+        int bytes = frames * nch * p->samplesize;
+        int done = bytes - bytes % p->block;
+        if (src != dest) {
+            if (done)
+                reorder_blocks_ssse3(p, src, dest, done / p->block);
+        } else {
+            for (i = 0; i < done; i += p->block) {
+                memcpy(tmp, (uint8_t *)dest + i, p->block);
+                reorder_blocks_ssse3(p, tmp, (uint8_t *)dest + i, 1);
+            }
         }
-        break;
-    }
-    case 4:
-    {
-        int32_t *dest_32 = dest;
-        const int32_t *src_32 = src;
-        REORDER_COPY_8(dest_32,src_32,samples,s0,s1,s2,s3,s4,s5,s6,s7);
-        break;
+        frames -= done / (nch * p->samplesize);
+        src = (const uint8_t *)src + done;
+        dest = (uint8_t *)dest + done;
     }
-    case 8:
-    {
-        int64_t *dest_64 = dest;
-        const int64_t *src_64 = src;
-        REORDER_COPY_8(dest_64,src_64,samples,s0,s1,s2,s3,s4,s5,s6,s7);
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
+#endif
+
+    switch (p->samplesize) {
+    case 1: REORDER_FRAMES_NCH(int8_t);     break;
+    case 2: REORDER_FRAMES_NCH(int16_t);    break;
+    case 3: REORDER_FRAMES_NCH(sample24_t); break;
+    case 4: REORDER_FRAMES_NCH(int32_t);    break;
+    case 8: REORDER_FRAMES_NCH(int64_t);    break;
     }
-    return 1;
 }
 
 void reorder_channel_copy(void *src,
@@ -284,6 +318,8 @@ void reorder_channel_copy(void *src,
                           int samples,
                           int samplesize)
 {
+    struct reorder_plan *p;
+
     if (dest_layout==src_layout) {
         fast_memcpy(dest, src, samples*samplesize);
         return;
@@ -295,843 +331,15 @@ void reorder_channel_copy(void *src,
                AF_GET_CH_NUM_WITH_LFE(dest_layout));
         return;
     }
-    switch ((src_layout<<16)|dest_layout) {
-    // AF_CHANNEL_LAYOUT_5_0_A   L R C Ls Rs
-    // AF_CHANNEL_LAYOUT_5_0_B   L R Ls Rs C
-    // AF_CHANNEL_LAYOUT_5_0_C   L C R Ls Rs
-    // AF_CHANNEL_LAYOUT_5_0_D   C L R Ls Rs
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 1, 3, 4, 2);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 2, 1, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_copy_5ch(dest, src, samples, samplesize, 2, 0, 1, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 1, 4, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 4, 1, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_copy_5ch(dest, src, samples, samplesize, 4, 0, 1, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 2, 1, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_copy_5ch(dest, src, samples, samplesize, 0, 2, 3, 4, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_copy_5ch(dest, src, samples, samplesize, 1, 0, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_copy_5ch(dest, src, samples, samplesize, 1, 2, 0, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_copy_5ch(dest, src, samples, samplesize, 1, 2, 3, 4, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_copy_5ch(dest, src, samples, samplesize, 1, 0, 2, 3, 4);
-        break;
-    // AF_CHANNEL_LAYOUT_5_1_A   L R C LFE Ls Rs
-    // AF_CHANNEL_LAYOUT_5_1_B   L R Ls Rs C LFE
-    // AF_CHANNEL_LAYOUT_5_1_C   L C R Ls Rs LFE
-    // AF_CHANNEL_LAYOUT_5_1_D   C L R Ls Rs LFE
-    // AF_CHANNEL_LAYOUT_5_1_E   LFE L C R Ls Rs
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 1, 4, 5, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 2, 1, 4, 5, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_copy_6ch(dest, src, samples, samplesize, 2, 0, 1, 4, 5, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 1, 4, 5, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 4, 1, 2, 3, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_copy_6ch(dest, src, samples, samplesize, 4, 0, 1, 2, 3, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_E:
-        reorder_copy_6ch(dest, src, samples, samplesize, 5, 0, 4, 1, 2, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 2, 1, 5, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_copy_6ch(dest, src, samples, samplesize, 0, 2, 3, 4, 1, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 0, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 2, 0, 5, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 2, 3, 4, 0, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 0, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_E << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 3, 4, 5, 2, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_F << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_copy_6ch(dest, src, samples, samplesize, 1, 2, 4, 5, 0, 3);
-        break;
-    // AF_CHANNEL_LAYOUT_7_1_A   L R C LFE Ls Rs Rls Rrs
-    // AF_CHANNEL_LAYOUT_7_1_B   L R Ls Rs C LFE Rls Rrs
-    // AF_CHANNEL_LAYOUT_7_1_D   C L R Ls Rs Rls Rrs LFE
-    case AF_CHANNEL_LAYOUT_7_1_A << 16 | AF_CHANNEL_LAYOUT_7_1_B:
-    case AF_CHANNEL_LAYOUT_7_1_B << 16 | AF_CHANNEL_LAYOUT_7_1_A:
-        reorder_copy_8ch(dest, src, samples, samplesize, 0, 1, 4, 5, 2, 3, 6, 7);
-        break;
-    case AF_CHANNEL_LAYOUT_7_1_D << 16 | AF_CHANNEL_LAYOUT_7_1_B:
-        reorder_copy_8ch(dest, src, samples, samplesize, 1, 2, 3, 4, 0, 7, 5, 6);
-        break;
-    default:
+    p = get_plan(src_layout, dest_layout, samplesize);
+    if (!p) {
         mp_msg(MSGT_GLOBAL, MSGL_WARN, "[reorder_channel_copy] unsupport "
                "from %x to %x, %d * %d\n", src_layout, dest_layout,
                samples, samplesize);
         fast_memcpy(dest, src, samples*samplesize);
+        return;
     }
-}
-
-
-#define REORDER_SELF_SWAP_2(SRC,TMP,SAMPLES,CHNUM,S0,S1) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = TMP;\
-}
-
-static int reorder_self_2(void *src, unsigned int samples,
-                          unsigned int samplesize, unsigned int chnum,
-                          int s0, int s1)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2(src_8,tmp,samples,6,s0,s1);
-        }
-        else if (chnum==8) {
-            REORDER_SELF_SWAP_2(src_8,tmp,samples,8,s0,s1);
-        }
-        else {
-            REORDER_SELF_SWAP_2(src_8,tmp,samples,5,s0,s1);
-        }
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2(src_16,tmp,samples,6,s0,s1);
-        }
-        else if (chnum==3) {
-            REORDER_SELF_SWAP_2(src_16,tmp,samples,3,s0,s1);
-        }
-        else if (chnum==4) {
-            REORDER_SELF_SWAP_2(src_16,tmp,samples,3,s0,s1);
-        }
-        else {
-            REORDER_SELF_SWAP_2(src_16,tmp,samples,5,s0,s1);
-        }
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = tmp0;
-            src_8[i+s1*3+1] = tmp1;
-            src_8[i+s1*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2(src_32,tmp,samples,6,s0,s1);
-        }
-        else if (chnum==3) {
-            REORDER_SELF_SWAP_2(src_32,tmp,samples,3,s0,s1);
-        }
-        else if (chnum==4) {
-            REORDER_SELF_SWAP_2(src_32,tmp,samples,4,s0,s1);
-        }
-        else {
-            REORDER_SELF_SWAP_2(src_32,tmp,samples,5,s0,s1);
-        }
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2(src_64,tmp,samples,6,s0,s1);
-        }
-        else if (chnum==3) {
-            REORDER_SELF_SWAP_2(src_64,tmp,samples,3,s0,s1);
-        }
-        else if (chnum==4) {
-            REORDER_SELF_SWAP_2(src_64,tmp,samples,4,s0,s1);
-        }
-        else {
-            REORDER_SELF_SWAP_2(src_64,tmp,samples,5,s0,s1);
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_3(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = SRC[i+S2];\
-    SRC[i+S2] = TMP;\
-}
-
-static int reorder_self_3(void *src, unsigned int samples,
-                          unsigned int samplesize, unsigned int chnum,
-                          int s0, int s1, int s2)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_3(src_8,tmp,samples,6,s0,s1,s2);
-        }
-        else {
-            REORDER_SELF_SWAP_3(src_8,tmp,samples,5,s0,s1,s2);
-        }
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_3(src_16,tmp,samples,6,s0,s1,s2);
-        }
-        else {
-            REORDER_SELF_SWAP_3(src_16,tmp,samples,5,s0,s1,s2);
-        }
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = src_8[i+s2*3];
-            src_8[i+s1*3+1] = src_8[i+s2*3+1];
-            src_8[i+s1*3+2] = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = tmp0;
-            src_8[i+s2*3+1] = tmp1;
-            src_8[i+s2*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_3(src_32,tmp,samples,6,s0,s1,s2);
-        }
-        else {
-            REORDER_SELF_SWAP_3(src_32,tmp,samples,5,s0,s1,s2);
-        }
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_3(src_64,tmp,samples,6,s0,s1,s2);
-        }
-        else {
-            REORDER_SELF_SWAP_3(src_64,tmp,samples,5,s0,s1,s2);
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_4_STEP_1(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = SRC[i+S2];\
-    SRC[i+S2] = SRC[i+S3];\
-    SRC[i+S3] = TMP;\
-}
-
-static int reorder_self_4_step_1(void *src, unsigned int samples,
-                                 unsigned int samplesize, unsigned int chnum,
-                                 int s0, int s1, int s2, int s3)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_4_STEP_1(src_8,tmp,samples,6,s0,s1,s2,s3);
-        }
-        else if (chnum==8) {
-            REORDER_SELF_SWAP_4_STEP_1(src_8,tmp,samples,8,s0,s1,s2,s3);
-        }
-        else {
-            REORDER_SELF_SWAP_4_STEP_1(src_8,tmp,samples,5,s0,s1,s2,s3);
-        }
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_4_STEP_1(src_16,tmp,samples,6,s0,s1,s2,s3);
-        }
-        else if (chnum==8) {
-            REORDER_SELF_SWAP_4_STEP_1(src_16,tmp,samples,8,s0,s1,s2,s3);
-        }
-        else {
-            REORDER_SELF_SWAP_4_STEP_1(src_16,tmp,samples,5,s0,s1,s2,s3);
-        }
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = src_8[i+s2*3];
-            src_8[i+s1*3+1] = src_8[i+s2*3+1];
-            src_8[i+s1*3+2] = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = src_8[i+s3*3];
-            src_8[i+s2*3+1] = src_8[i+s3*3+1];
-            src_8[i+s2*3+2] = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = tmp0;
-            src_8[i+s3*3+1] = tmp1;
-            src_8[i+s3*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_4_STEP_1(src_32,tmp,samples,6,s0,s1,s2,s3);
-        }
-        else if (chnum==8) {
-            REORDER_SELF_SWAP_4_STEP_1(src_32,tmp,samples,8,s0,s1,s2,s3);
-        }
-        else {
-            REORDER_SELF_SWAP_4_STEP_1(src_32,tmp,samples,5,s0,s1,s2,s3);
-        }
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_4_STEP_1(src_64,tmp,samples,6,s0,s1,s2,s3);
-        }
-        else if (chnum==8) {
-            REORDER_SELF_SWAP_4_STEP_1(src_64,tmp,samples,8,s0,s1,s2,s3);
-        }
-        else {
-            REORDER_SELF_SWAP_4_STEP_1(src_64,tmp,samples,5,s0,s1,s2,s3);
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_4_STEP_2(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S2];\
-    SRC[i+S2] = TMP;\
-    TMP = SRC[i+S1];\
-    SRC[i+S1] = SRC[i+S3];\
-    SRC[i+S3] = TMP;\
-}
-
-static int reorder_self_4_step_2(void *src, unsigned int samples,
-                                 unsigned int samplesize, unsigned int chnum,
-                                 int s0, int s1, int s2, int s3)
-{
-    int i;
-    switch (samplesize) {
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s2*3];
-            src_8[i+s0*3+1] = src_8[i+s2*3+1];
-            src_8[i+s0*3+2] = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = tmp0;
-            src_8[i+s2*3+1] = tmp1;
-            src_8[i+s2*3+2] = tmp2;
-            tmp0 = src_8[i+s1*3];
-            tmp1 = src_8[i+s1*3+1];
-            tmp2 = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = src_8[i+s3*3];
-            src_8[i+s1*3+1] = src_8[i+s3*3+1];
-            src_8[i+s1*3+2] = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = tmp0;
-            src_8[i+s3*3+1] = tmp1;
-            src_8[i+s3*3+2] = tmp2;
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_5_STEP_1(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3,S4) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = SRC[i+S2];\
-    SRC[i+S2] = SRC[i+S3];\
-    SRC[i+S3] = SRC[i+S4];\
-    SRC[i+S4] = TMP;\
-}
-
-static int reorder_self_5_step_1(void *src, unsigned int samples,
-                                 unsigned int samplesize, unsigned int chnum,
-                                 int s0, int s1, int s2, int s3, int s4)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_5_STEP_1(src_8,tmp,samples,6,s0,s1,s2,s3,s4);
-        }
-        else {
-            REORDER_SELF_SWAP_5_STEP_1(src_8,tmp,samples,5,s0,s1,s2,s3,s4);
-        }
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_5_STEP_1(src_16,tmp,samples,6,s0,s1,s2,s3,s4);
-        }
-        else {
-            REORDER_SELF_SWAP_5_STEP_1(src_16,tmp,samples,5,s0,s1,s2,s3,s4);
-        }
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = src_8[i+s2*3];
-            src_8[i+s1*3+1] = src_8[i+s2*3+1];
-            src_8[i+s1*3+2] = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = src_8[i+s3*3];
-            src_8[i+s2*3+1] = src_8[i+s3*3+1];
-            src_8[i+s2*3+2] = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = src_8[i+s4*3];
-            src_8[i+s3*3+1] = src_8[i+s4*3+1];
-            src_8[i+s3*3+2] = src_8[i+s4*3+2];
-            src_8[i+s4*3]   = tmp0;
-            src_8[i+s4*3+1] = tmp1;
-            src_8[i+s4*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_5_STEP_1(src_32,tmp,samples,6,s0,s1,s2,s3,s4);
-        }
-        else {
-            REORDER_SELF_SWAP_5_STEP_1(src_32,tmp,samples,5,s0,s1,s2,s3,s4);
-        }
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_5_STEP_1(src_64,tmp,samples,6,s0,s1,s2,s3,s4);
-        }
-        else {
-            REORDER_SELF_SWAP_5_STEP_1(src_64,tmp,samples,5,s0,s1,s2,s3,s4);
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_2_3(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3,S4) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = TMP;\
-    TMP = SRC[i+S2];\
-    SRC[i+S2] = SRC[i+S3];\
-    SRC[i+S3] = SRC[i+S4];\
-    SRC[i+S4] = TMP;\
-}
-
-static int reorder_self_2_3(void *src, unsigned int samples,
-                            unsigned int samplesize,
-                            int s0, int s1, int s2, int s3, int s4)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        REORDER_SELF_SWAP_2_3(src_8,tmp,samples,6,s0,s1,s2,s3,s4);
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        REORDER_SELF_SWAP_2_3(src_16,tmp,samples,6,s0,s1,s2,s3,s4);
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += 18) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = tmp0;
-            src_8[i+s1*3+1] = tmp1;
-            src_8[i+s1*3+2] = tmp2;
-            tmp0 = src_8[i+s2*3];
-            tmp1 = src_8[i+s2*3+1];
-            tmp2 = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = src_8[i+s3*3];
-            src_8[i+s2*3+1] = src_8[i+s3*3+1];
-            src_8[i+s2*3+2] = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = src_8[i+s4*3];
-            src_8[i+s3*3+1] = src_8[i+s4*3+1];
-            src_8[i+s3*3+2] = src_8[i+s4*3+2];
-            src_8[i+s4*3]   = tmp0;
-            src_8[i+s4*3+1] = tmp1;
-            src_8[i+s4*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        REORDER_SELF_SWAP_2_3(src_32,tmp,samples,6,s0,s1,s2,s3,s4);
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        REORDER_SELF_SWAP_2_3(src_64,tmp,samples,6,s0,s1,s2,s3,s4);
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_3_3(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3,S4,S5) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = SRC[i+S2];\
-    SRC[i+S2] = TMP;\
-    TMP = SRC[i+S3];\
-    SRC[i+S3] = SRC[i+S4];\
-    SRC[i+S4] = SRC[i+S5];\
-    SRC[i+S5] = TMP;\
-}
-
-static int reorder_self_3_3(void *src, unsigned int samples,
-                            unsigned int samplesize,
-                            int s0, int s1, int s2, int s3, int s4, int s5)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        REORDER_SELF_SWAP_3_3(src_8,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        REORDER_SELF_SWAP_3_3(src_16,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += 18) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = src_8[i+s2*3];
-            src_8[i+s1*3+1] = src_8[i+s2*3+1];
-            src_8[i+s1*3+2] = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = tmp0;
-            src_8[i+s2*3+1] = tmp1;
-            src_8[i+s2*3+2] = tmp2;
-            tmp0 = src_8[i+s3*3];
-            tmp1 = src_8[i+s3*3+1];
-            tmp2 = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = src_8[i+s4*3];
-            src_8[i+s3*3+1] = src_8[i+s4*3+1];
-            src_8[i+s3*3+2] = src_8[i+s4*3+2];
-            src_8[i+s4*3]   = src_8[i+s5*3];
-            src_8[i+s4*3+1] = src_8[i+s5*3+1];
-            src_8[i+s4*3+2] = src_8[i+s5*3+2];
-            src_8[i+s5*3]   = tmp0;
-            src_8[i+s5*3+1] = tmp1;
-            src_8[i+s5*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        REORDER_SELF_SWAP_3_3(src_32,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        REORDER_SELF_SWAP_3_3(src_64,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
-}
-
-#define REORDER_SELF_SWAP_2_4(SRC,TMP,SAMPLES,CHNUM,S0,S1,S2,S3,S4,S5) \
-for (i = 0; i < SAMPLES; i += CHNUM) {\
-    TMP = SRC[i+S0];\
-    SRC[i+S0] = SRC[i+S1];\
-    SRC[i+S1] = TMP;\
-    TMP = SRC[i+S2];\
-    SRC[i+S2] = SRC[i+S3];\
-    SRC[i+S3] = SRC[i+S4];\
-    SRC[i+S4] = SRC[i+S5];\
-    SRC[i+S5] = TMP;\
-}
-
-static int reorder_self_2_4(void *src, unsigned int samples,
-                            unsigned int samplesize, int chnum,
-                            int s0, int s1, int s2, int s3, int s4, int s5)
-{
-    int i;
-    switch (samplesize) {
-    case 1:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2_4(src_8,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        } else {
-            REORDER_SELF_SWAP_2_4(src_8,tmp,samples,8,s0,s1,s2,s3,s4,s5);
-        }
-        break;
-    }
-    case 2:
-    {
-        int16_t *src_16 = src;
-        int16_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2_4(src_16,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        } else {
-            REORDER_SELF_SWAP_2_4(src_16,tmp,samples,8,s0,s1,s2,s3,s4,s5);
-        }
-        break;
-    }
-    case 3:
-    {
-        int8_t *src_8 = src;
-        int8_t tmp0, tmp1, tmp2;
-        for (i = 0; i < samples * 3; i += chnum * 3) {
-            tmp0 = src_8[i+s0*3];
-            tmp1 = src_8[i+s0*3+1];
-            tmp2 = src_8[i+s0*3+2];
-            src_8[i+s0*3]   = src_8[i+s1*3];
-            src_8[i+s0*3+1] = src_8[i+s1*3+1];
-            src_8[i+s0*3+2] = src_8[i+s1*3+2];
-            src_8[i+s1*3]   = tmp0;
-            src_8[i+s1*3+1] = tmp1;
-            src_8[i+s1*3+2] = tmp2;
-            tmp0 = src_8[i+s2*3];
-            tmp1 = src_8[i+s2*3+1];
-            tmp2 = src_8[i+s2*3+2];
-            src_8[i+s2*3]   = src_8[i+s3*3];
-            src_8[i+s2*3+1] = src_8[i+s3*3+1];
-            src_8[i+s2*3+2] = src_8[i+s3*3+2];
-            src_8[i+s3*3]   = src_8[i+s4*3];
-            src_8[i+s3*3+1] = src_8[i+s4*3+1];
-            src_8[i+s3*3+2] = src_8[i+s4*3+2];
-            src_8[i+s4*3]   = src_8[i+s5*3];
-            src_8[i+s4*3+1] = src_8[i+s5*3+1];
-            src_8[i+s4*3+2] = src_8[i+s5*3+2];
-            src_8[i+s5*3]   = tmp0;
-            src_8[i+s5*3+1] = tmp1;
-            src_8[i+s5*3+2] = tmp2;
-        }
-        break;
-    }
-    case 4:
-    {
-        int32_t *src_32 = src;
-        int32_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2_4(src_32,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        } else {
-            REORDER_SELF_SWAP_2_4(src_32,tmp,samples,8,s0,s1,s2,s3,s4,s5);
-        }
-        break;
-    }
-    case 8:
-    {
-        int64_t *src_64 = src;
-        int64_t tmp;
-        if (chnum==6) {
-            REORDER_SELF_SWAP_2_4(src_64,tmp,samples,6,s0,s1,s2,s3,s4,s5);
-        } else {
-            REORDER_SELF_SWAP_2_4(src_64,tmp,samples,8,s0,s1,s2,s3,s4,s5);
-        }
-        break;
-    }
-    default:
-        mp_msg(MSGT_GLOBAL, MSGL_WARN,
-               "[reorder_ch] Unsupported sample size: %d, please "
-               "report this error on the MPlayer mailing list.\n",samplesize);
-        return 0;
-    }
-    return 1;
+    run_plan(p, src, dest, samples);
 }
 
 void reorder_channel(void *src,
@@ -1140,6 +348,8 @@ void reorder_channel(void *src,
                      int samples,
                      int samplesize)
 {
+    struct reorder_plan *p;
+
     if (dest_layout==src_layout)
         return;
     if (!AF_IS_SAME_CH_NUM(dest_layout,src_layout)) {
@@ -1150,125 +360,14 @@ void reorder_channel(void *src,
                AF_GET_CH_NUM_WITH_LFE(dest_layout));
         return;
     }
-    switch ((src_layout<<16)|dest_layout) {
-    // AF_CHANNEL_LAYOUT_5_0_A   L R C Ls Rs
-    // AF_CHANNEL_LAYOUT_5_0_B   L R Ls Rs C
-    // AF_CHANNEL_LAYOUT_5_0_C   L C R Ls Rs
-    // AF_CHANNEL_LAYOUT_5_0_D   C L R Ls Rs
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_self_3(src, samples, samplesize, 5, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_self_2(src, samples, samplesize, 5, 1, 2);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_A << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_self_3(src, samples, samplesize, 5, 2, 1, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_self_3(src, samples, samplesize, 5, 4, 3, 2);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_self_4_step_1(src, samples, samplesize, 5, 4, 3, 2, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_B << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_self_5_step_1(src, samples, samplesize, 5, 4, 3, 2, 1, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_self_2(src, samples, samplesize, 5, 1, 2);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_self_4_step_1(src, samples, samplesize, 5, 1, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_C << 16 | AF_CHANNEL_LAYOUT_5_0_D:
-        reorder_self_2(src, samples, samplesize, 5, 0, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_A:
-        reorder_self_3(src, samples, samplesize, 5, 0, 1, 2);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_B:
-        reorder_self_5_step_1(src, samples, samplesize, 5, 0, 1, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_0_D << 16 | AF_CHANNEL_LAYOUT_5_0_C:
-        reorder_self_2(src, samples, samplesize, 5, 0, 1);
-        break;
-    // AF_CHANNEL_LAYOUT_5_1_A   L R C LFE Ls Rs
-    // AF_CHANNEL_LAYOUT_5_1_B   L R Ls Rs C LFE
-    // AF_CHANNEL_LAYOUT_5_1_C   L C R Ls Rs LFE
-    // AF_CHANNEL_LAYOUT_5_1_D   C L R Ls Rs LFE
-    // AF_CHANNEL_LAYOUT_5_1_E   LFE L C R Ls Rs
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        if (samplesize != 3)
-            reorder_self_2(src, samples/2, samplesize*2, 3, 1, 2);
-        else
-            reorder_self_4_step_2(src, samples, samplesize, 6, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_self_2_3(src, samples, samplesize, 1, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_A << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_self_3_3(src, samples, samplesize, 2, 1, 0, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        if (samplesize != 3)
-            reorder_self_2(src, samples/2, samplesize*2, 3, 1, 2);
-        else
-            reorder_self_4_step_2(src, samples, samplesize, 6, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_self_4_step_1(src, samples, samplesize, 6, 4, 3, 2, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_self_5_step_1(src, samples, samplesize, 6, 4, 3, 2, 1, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_B << 16 | AF_CHANNEL_LAYOUT_5_1_E:
-        reorder_self_2_4(src, samples, samplesize, 6, 2, 4, 5, 3, 1, 0);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        reorder_self_2_3(src, samples, samplesize, 1, 2, 5, 4, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_self_4_step_1(src, samples, samplesize, 6, 1, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_C << 16 | AF_CHANNEL_LAYOUT_5_1_D:
-        reorder_self_2(src, samples, samplesize, 6, 0, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_A:
-        reorder_self_3_3(src, samples, samplesize, 0, 1, 2, 5, 4, 3);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_self_5_step_1(src, samples, samplesize, 6, 0, 1, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_D << 16 | AF_CHANNEL_LAYOUT_5_1_C:
-        reorder_self_2(src, samples, samplesize, 6, 0, 1);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_E << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_self_2_4(src, samples, samplesize, 6, 2, 4, 0, 1, 3, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_5_1_F << 16 | AF_CHANNEL_LAYOUT_5_1_B:
-        reorder_self_2_4(src, samples, samplesize, 6, 3, 5, 0, 1, 2, 4);
-        break;
-    // AF_CHANNEL_LAYOUT_7_1_A   L R C LFE Ls Rs Rls Rrs
-    // AF_CHANNEL_LAYOUT_7_1_B   L R Ls Rs C LFE Rls Rrs
-    // AF_CHANNEL_LAYOUT_7_1_C   L C R Ls Rs LFE Rls Rrs
-    // AF_CHANNEL_LAYOUT_7_1_F   C L R LFE Ls Rs Rls Rrs
-    case AF_CHANNEL_LAYOUT_7_1_A << 16 | AF_CHANNEL_LAYOUT_7_1_B:
-    case AF_CHANNEL_LAYOUT_7_1_B << 16 | AF_CHANNEL_LAYOUT_7_1_A:
-        if (samplesize != 3)
-            reorder_self_2(src, samples/2, samplesize*2, 4, 1, 2);
-        else
-            reorder_self_4_step_2(src, samples, samplesize, 8, 2, 3, 4, 5);
-        break;
-    case AF_CHANNEL_LAYOUT_7_1_C << 16 | AF_CHANNEL_LAYOUT_7_1_B:
-        reorder_self_4_step_1(src, samples, samplesize, 8, 1, 2, 3, 4);
-        break;
-    case AF_CHANNEL_LAYOUT_7_1_F << 16 | AF_CHANNEL_LAYOUT_7_1_B:
-        reorder_self_2_4(src, samples, samplesize, 8, 3, 5, 0, 1, 2, 4);
-        break;
-    default:
+    p = get_plan(src_layout, dest_layout, samplesize);
+    if (!p) {
         mp_msg(MSGT_GLOBAL, MSGL_WARN,
                "[reorder_channel] unsupported from %x to %x, %d * %d\n",
                src_layout, dest_layout, samples, samplesize);
+        return;
     }
+    run_plan(p, src, src, samples);
 }
 
 
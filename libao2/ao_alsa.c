@@ -34,10 +34,13 @@
 #include <math.h>
 #include <string.h>
 #include <alloca.h>
+#include <poll.h>
 
 #include "config.h"
+#include "options.h"
 #include "subopt-helper.h"
 #include "mixer.h"
+#include "input/input.h"
 #include "mp_msg.h"
 
 #define ALSA_PCM_NEW_HW_PARAMS_API
@@ -69,6 +72,12 @@ static snd_pcm_sw_params_t *alsa_swparams;
 
 static size_t bytes_per_sample;
 
+static int alsa_use_mmap;
+static snd_pcm_uframes_t alsa_start_threshold;
+// poll descriptors registered with the input loop
+static struct pollfd *alsa_pollfds;
+static int alsa_num_pollfds;
+
 static int alsa_can_pause;
 static snd_pcm_sframes_t prepause_frames;
 
@@ -275,6 +284,12 @@ static void print_help (void)
     "[AO_ALSA] Options:\n"\
     "[AO_ALSA]   noblock\n"\
     "[AO_ALSA]     Opens device in non-blocking mode.\n"\
+    "[AO_ALSA]   nommap\n"\
+    "[AO_ALSA]     Use snd_pcm_writei() instead of writing to the mmapped buffer.\n"\
+    "[AO_ALSA]   buffer=<ms>\n"\
+    "[AO_ALSA]     Device buffer length in milliseconds (default 500).\n"\
+    "[AO_ALSA]   periods=<count>\n"\
+    "[AO_ALSA]     Number of periods the buffer is split into (default 16).\n"\
     "[AO_ALSA]   device=<device-name>\n"\
     "[AO_ALSA]     Sets device (change , to . and : to =)\n");
 }
@@ -329,6 +344,70 @@ static int try_open_device(const char *device, int open_mode, int try_ac3)
                       open_mode);
 }
 
+/* Let the input loop wake the player when the device wants more data.
+ * Not done with --ao-thread, where play() runs outside the main thread. */
+static void register_poll_fds(void)
+{
+    struct input_ctx *ictx = ao_data.input_ctx;
+    int count;
+
+    ao_data.event_wakeup = false;
+    if (!ictx || ao_data.opts->ao_thread_ms > 0)
+        return;
+    count = snd_pcm_poll_descriptors_count(alsa_handler);
+    if (count <= 0)
+        return;
+    alsa_pollfds = calloc(count, sizeof(struct pollfd));
+    if (!alsa_pollfds)
+        return;
+    count = snd_pcm_poll_descriptors(alsa_handler, alsa_pollfds, count);
+    // Wait for what ALSA asks for; what a wakeup means for the PCM is
+    // decided by snd_pcm_poll_descriptors_revents() in get_space().
+    for (alsa_num_pollfds = 0; alsa_num_pollfds < count; alsa_num_pollfds++) {
+        struct pollfd *pfd = &alsa_pollfds[alsa_num_pollfds];
+        if (!mp_input_add_event_fd(ictx, pfd->fd, pfd->events & POLLOUT))
+            break;
+    }
+    ao_data.event_wakeup = alsa_num_pollfds == count;
+    mp_msg(MSGT_AO,MSGL_V,"alsa-init: %d poll descriptors\n", alsa_num_pollfds);
+}
+
+static void unregister_poll_fds(void)
+{
+    for (int i = 0; i < alsa_num_pollfds; i++)
+        mp_input_rm_event_fd(ao_data.input_ctx, alsa_pollfds[i].fd);
+    free(alsa_pollfds);
+    alsa_pollfds = NULL;
+    alsa_num_pollfds = 0;
+    ao_data.event_wakeup = false;
+}
+
+static void arm_poll_fds(bool arm)
+{
+    for (int i = 0; i < alsa_num_pollfds; i++)
+        mp_input_arm_event_fd(ao_data.input_ctx, alsa_pollfds[i].fd, arm);
+}
+
+/* A descriptor firing does not have to mean room in the buffer (plugins
+ * can poll timers or other directions). Let ALSA translate the events,
+ * which also acknowledges them, and keep waiting if it was not POLLOUT. */
+static void check_poll_fds(void)
+{
+    unsigned short revents;
+
+    if (!alsa_num_pollfds)
+        return;
+    for (int i = 0; i < alsa_num_pollfds; i++)
+        alsa_pollfds[i].revents = 0;
+    if (poll(alsa_pollfds, alsa_num_pollfds, 0) < 0)
+        return;
+    if (snd_pcm_poll_descriptors_revents(alsa_handler, alsa_pollfds,
+                                         alsa_num_pollfds, &revents) < 0)
+        return;
+    if (!(revents & POLLOUT))
+        arm_poll_fds(true);
+}
+
 /*
     open & setup audio device
     return: 1=success 0=fail
@@ -337,12 +416,17 @@ static int init(int rate_hz, int channels, int format, int flags)
 {
     int err;
     int block;
+    int buffer_ms;
+    int periods;
     strarg_t device;
     snd_pcm_uframes_t chunk_size;
     snd_pcm_uframes_t bufsize;
     snd_pcm_uframes_t boundary;
     const opt_t subopts[] = {
       {"block", OPT_ARG_BOOL, &block, NULL},
+      {"mmap", OPT_ARG_BOOL, &alsa_use_mmap, NULL},
+      {"buffer", OPT_ARG_INT, &buffer_ms, int_pos},
+      {"periods", OPT_ARG_INT, &periods, int_pos},
       {"device", OPT_ARG_STR, &device, str_maxlen},
       {NULL}
     };
@@ -431,6 +515,9 @@ static int init(int rate_hz, int channels, int format, int flags)
     //subdevice parsing
     // set defaults
     block = 1;
+    alsa_use_mmap = 1;
+    buffer_ms = BUFFER_TIME / 1000;
+    periods = FRAGCOUNT;
     /* switch for spdif
      * sets opening sequence for SPDIF
      * sets also the playback and other switches 'on the fly'
@@ -521,8 +608,18 @@ static int init(int rate_hz, int channels, int format, int flags)
 	  return 0;
 	}
 
-      err = snd_pcm_hw_params_set_access(alsa_handler, alsa_hwparams,
-					 SND_PCM_ACCESS_RW_INTERLEAVED);
+      if (alsa_use_mmap) {
+        err = snd_pcm_hw_params_set_access(alsa_handler, alsa_hwparams,
+                                           SND_PCM_ACCESS_MMAP_INTERLEAVED);
+        if (err < 0) {
+          mp_msg(MSGT_AO,MSGL_V,"alsa-init: mmap access not available, "
+                 "using snd_pcm_writei\n");
+          alsa_use_mmap = 0;
+        }
+      }
+      if (!alsa_use_mmap)
+        err = snd_pcm_hw_params_set_access(alsa_handler, alsa_hwparams,
+                                           SND_PCM_ACCESS_RW_INTERLEAVED);
       if (err < 0) {
 	mp_tmsg(MSGT_AO,MSGL_ERR,"[AO_ALSA] Unable to set access type: %s\n",
 	       snd_strerror(err));
@@ -583,7 +680,7 @@ static int init(int rate_hz, int channels, int format, int flags)
       ao_data.bps = ao_data.samplerate * bytes_per_sample;
 
 	if ((err = snd_pcm_hw_params_set_buffer_time_near(alsa_handler, alsa_hwparams,
-							  &(unsigned int){BUFFER_TIME}, NULL)) < 0)
+							  &(unsigned int){buffer_ms * 1000}, NULL)) < 0)
 	  {
 	    mp_tmsg(MSGT_AO,MSGL_ERR,"[AO_ALSA] Unable to set buffer time near: %s\n",
 		   snd_strerror(err));
@@ -591,7 +688,7 @@ static int init(int rate_hz, int channels, int format, int flags)
 	  }
 
 	if ((err = snd_pcm_hw_params_set_periods_near(alsa_handler, alsa_hwparams,
-						      &(unsigned int){FRAGCOUNT}, NULL)) < 0) {
+						      &(unsigned int){periods}, NULL)) < 0) {
 	  mp_tmsg(MSGT_AO,MSGL_ERR,"[AO_ALSA] Unable to set periods: %s\n",
 		 snd_strerror(err));
 	  return 0;
@@ -638,6 +735,7 @@ static int init(int rate_hz, int channels, int format, int flags)
 	return 0;
       }
       /* start playing when one period has been written */
+      alsa_start_threshold = chunk_size;
       if ((err = snd_pcm_sw_params_set_start_threshold(alsa_handler, alsa_swparams, chunk_size)) < 0) {
 	mp_tmsg(MSGT_AO,MSGL_ERR,"[AO_ALSA] Unable to set start threshold: %s\n",
 	       snd_strerror(err));
@@ -668,6 +766,7 @@ static int init(int rate_hz, int channels, int format, int flags)
 
     } // end switch alsa_handler (spdif)
     alsa_can_pause = snd_pcm_hw_params_can_pause(alsa_hwparams);
+    register_poll_fds();
     return 1;
 } // end init
 
@@ -679,6 +778,7 @@ static void uninit(int immed)
   if (alsa_handler) {
     int err;
 
+    unregister_poll_fds();
     if (!immed)
       snd_pcm_drain(alsa_handler);
 
@@ -701,6 +801,8 @@ static void audio_pause(void)
 {
     int err;
 
+    arm_poll_fds(false);
+
     if (alsa_can_pause) {
         if ((err = snd_pcm_pause(alsa_handler, 1)) < 0)
         {
@@ -756,6 +858,7 @@ static void reset(void)
     int err;
 
     prepause_frames = 0;
+    arm_poll_fds(false);
     if ((err = snd_pcm_drop(alsa_handler)) < 0)
     {
 	mp_tmsg(MSGT_AO,MSGL_ERR,"[AO_ALSA] pcm prepare error: %s\n", snd_strerror(err));
@@ -769,6 +872,52 @@ static void reset(void)
     return;
 }
 
+/* Copy as many frames as fit into the mmapped ring buffer. Unlike
+ * snd_pcm_writei() this never blocks, and the stream has to be started
+ * explicitly once enough data is queued. */
+static snd_pcm_sframes_t write_mmap(void *data, snd_pcm_uframes_t frames,
+                                    int flags)
+{
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(alsa_handler);
+    snd_pcm_uframes_t done = 0;
+
+    if (avail < 0)
+        return avail;
+    if (frames > (snd_pcm_uframes_t)avail)
+        frames = avail;
+    while (done < frames) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, n = frames - done;
+        snd_pcm_sframes_t committed;
+        int err = snd_pcm_mmap_begin(alsa_handler, &areas, &offset, &n);
+        if (err < 0)
+            return done ? done : err;
+        // interleaved: channel 0 area covers whole frames
+        memcpy((char *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8,
+               (char *)data + done * bytes_per_sample, n * bytes_per_sample);
+        committed = snd_pcm_mmap_commit(alsa_handler, offset, n);
+        if (committed < 0)
+            return done ? done : committed;
+        done += committed;
+        if ((snd_pcm_uframes_t)committed != n)
+            break;
+    }
+    if (snd_pcm_state(alsa_handler) == SND_PCM_STATE_PREPARED) {
+        snd_pcm_sframes_t queued = snd_pcm_avail_update(alsa_handler);
+        if (queued < 0) {
+            // xrun since the commit: recover like play() does, nothing queued
+            mp_tmsg(MSGT_AO,MSGL_INFO,"[AO_ALSA] Trying to reset soundcard.\n");
+            snd_pcm_prepare(alsa_handler);
+            queued = 0;
+        } else
+            queued = ao_data.buffersize / bytes_per_sample - queued;
+        if (queued >= (snd_pcm_sframes_t)alsa_start_threshold
+            || flags & AOPLAY_FINAL_CHUNK)
+            snd_pcm_start(alsa_handler);
+    }
+    return done;
+}
+
 /*
     plays 'len' bytes of 'data'
     returns: number of bytes played
@@ -795,7 +944,10 @@ static int play(void* data, int len, int flags)
     return 0;
 
   do {
-    res = snd_pcm_writei(alsa_handler, data, num_frames);
+    if (alsa_use_mmap)
+      res = write_mmap(data, num_frames, flags);
+    else
+      res = snd_pcm_writei(alsa_handler, data, num_frames);
 
       if (res == -EINTR) {
 	/* nothing to do */
@@ -815,8 +967,10 @@ static int play(void* data, int len, int flags)
 	  break;
 	}
       }
-  } while (res == 0);
+  } while (res == 0 && !alsa_use_mmap);
 
+  if (res > 0)
+    arm_poll_fds(true);
   return res < 0 ? res : res * bytes_per_sample;
 }
 
@@ -837,6 +991,8 @@ static int get_space(void)
     unsigned space = snd_pcm_status_get_avail(status) * bytes_per_sample;
     if (space > ao_data.buffersize) // Buffer underrun?
         space = ao_data.buffersize;
+    if (space < ao_data.outburst)
+        check_poll_fds();
     return space;
 }
 
@@ -33,6 +33,7 @@
 #include "libaf/reorder_ch.h"
 #include "audio_out.h"
 #include "mp_msg.h"
+#include "osdep/timer.h"
 
 #ifdef __MINGW32__
 // for GetFileType to detect pipes
@@ -45,8 +46,13 @@ struct priv {
     int waveheader;
     uint64_t data_length;
     FILE *fp;
+    int fast;
+    unsigned int start_time;    // ms, at the first play() call
 };
 
+// audio accepted per play() call with "fast"
+#define FAST_BLOCK_SECONDS 2
+
 #define WAV_ID_RIFF 0x46464952 /* "RIFF" */
 #define WAV_ID_WAVE 0x45564157 /* "WAVE" */
 #define WAV_ID_FMT  0x20746d66 /* "fmt " */
@@ -127,11 +133,10 @@ static int init(struct ao *ao, char *params)
     struct priv *priv = talloc_zero(ao, struct priv);
     ao->priv = priv;
 
-    int fast = 0;
     const opt_t subopts[] = {
         {"waveheader", OPT_ARG_BOOL,  &priv->waveheader, NULL},
         {"file",       OPT_ARG_MSTRZ, &priv->outputfilename, NULL},
-        {"fast",       OPT_ARG_BOOL,  &fast, NULL},
+        {"fast",       OPT_ARG_BOOL,  &priv->fast, NULL},
         {NULL}
     };
     // set defaults
@@ -140,11 +145,6 @@ static int init(struct ao *ao, char *params)
     if (subopt_parse(params, subopts) != 0)
         return -1;
 
-    if (fast)
-        mp_msg(MSGT_AO, MSGL_WARN,
-               "[AO PCM] Suboption \"fast\" is deprecated.\n"
-               "[AO PCM] Use -novideo, or -benchmark if you want "
-               "faster playback with video.\n");
     if (!priv->outputfilename)
         priv->outputfilename =
             strdup(priv->waveheader ? "audiodump.wav" : "audiodump.pcm");
@@ -168,15 +168,24 @@ static int init(struct ao *ao, char *params)
 
     ao->outburst = 65536;
     ao->bps = ao->channels * ao->samplerate * (af_fmt2bits(ao->format) / 8);
+    if (priv->fast) {
+        // offline extraction: the player does no pacing for untimed
+        // outputs, so bigger blocks only cut the per-iteration overhead
+        int frame_size = ao->channels * (af_fmt2bits(ao->format) / 8);
+        ao->outburst = FFMAX(ao->bps * FAST_BLOCK_SECONDS, ao->outburst);
+        ao->outburst -= ao->outburst % frame_size;
+    }
 
     mp_tmsg(MSGT_AO, MSGL_INFO, "[AO PCM] File: %s (%s)\n"
             "PCM: Samplerate: %d Hz   Channels: %d   Format: %s\n",
             priv->outputfilename,
             priv->waveheader ? "WAVE" : "RAW PCM", ao->samplerate,
             ao->channels, af_fmt2str_short(ao->format));
-    mp_tmsg(MSGT_AO, MSGL_INFO,
-            "[AO PCM] Info: Faster dumping is achieved with -novideo\n"
-            "[AO PCM] Info: To write WAVE files use -ao pcm:waveheader (default).\n");
+    if (!priv->fast)
+        mp_tmsg(MSGT_AO, MSGL_INFO,
+                "[AO PCM] Info: Faster dumping is achieved with -novideo "
+                "and -ao pcm:fast\n"
+                "[AO PCM] Info: To write WAVE files use -ao pcm:waveheader (default).\n");
 
     priv->fp = fopen(priv->outputfilename, "wb");
     if (!priv->fp) {
@@ -218,6 +227,14 @@ static void uninit(struct ao *ao, bool cut_audio)
     }
     fclose(priv->fp);
     free(priv->outputfilename);
+
+    if (priv->data_length && ao->bps > 0) {
+        double audio = (double)priv->data_length / ao->bps;
+        double wall = (GetTimerMS() - priv->start_time) / 1000.0;
+        mp_msg(MSGT_AO, priv->fast ? MSGL_INFO : MSGL_V,
+               "[AO PCM] Wrote %.1f s of audio in %.1f s (%.1fx realtime)\n",
+               audio, wall, wall > 0 ? audio / wall : 0);
+    }
 }
 
 static int get_space(struct ao *ao)
@@ -229,6 +246,8 @@ static int play(struct ao *ao, void *data, int len, int flags)
 {
     struct priv *priv = ao->priv;
 
+    if (!priv->data_length)
+        priv->start_time = GetTimerMS();
     if (ao->channels == 5 || ao->channels == 6 || ao->channels == 8) {
         int frame_size = af_fmt2bits(ao->format) / 8;
         len -= len % (frame_size * ao->channels);
@@ -20,10 +20,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+
+#include <libavutil/common.h>
 
 #include "talloc.h"
 
 #include "config.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+#include "options.h"
 #include "audio_out.h"
 
 #include "mp_msg.h"
@@ -102,6 +111,157 @@ void list_audio_out(void)
     mp_msg(MSGT_GLOBAL, MSGL_INFO,"\n");
 }
 
+#ifdef HAVE_PTHREADS
+/* With --ao-thread the device is owned by a thread that moves data from a
+ * single-producer/single-consumer ring buffer to the driver. ao_play()
+ * only copies into the ring and, except to mark the final chunk, never
+ * blocks on the thread; all other
+ * calls into the driver are serialized with the thread by "lock".
+ * read_pos and write_pos count bytes since the start and wrap around;
+ * write_pos is only changed by the player, read_pos only with "lock" held. */
+struct ao_thread {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;      // new data, resume or termination
+    pthread_cond_t drained;     // thread made progress emptying the ring
+    unsigned char *ring;
+    unsigned char *bounce;      // linear copy of data wrapping around
+    unsigned int size;
+    volatile unsigned int read_pos;
+    volatile unsigned int write_pos;
+    // the ring ends with a chunk that was played with AOPLAY_FINAL_CHUNK;
+    // both only used with "lock" held
+    bool final_chunk;
+    unsigned int final_pos;
+    bool paused;
+    bool terminate;
+    double period;              // seconds between polls of the device
+};
+
+static unsigned int ring_buffered(struct ao_thread *t)
+{
+    return t->write_pos - t->read_pos;
+}
+
+static void *ao_thread_main(void *arg)
+{
+    struct ao *ao = arg;
+    struct ao_thread *t = ao->thread;
+
+    pthread_mutex_lock(&t->lock);
+    while (!t->terminate) {
+        unsigned int read_pos = t->read_pos;
+        int len = ring_buffered(t);
+        __sync_synchronize();  // don't read ring data older than write_pos
+        int space = t->paused || !len ? 0 : ao->driver->get_space(ao);
+        int flags = 0;
+        len = FFMIN(len, space);
+        if (t->final_chunk && read_pos + len == t->final_pos)
+            flags = AOPLAY_FINAL_CHUNK;
+        else
+            len -= len % ao->outburst;
+        if (len > 0) {
+            unsigned int pos = read_pos % t->size;
+            unsigned char *data = t->ring + pos;
+            if (pos + len > t->size) {
+                int part = t->size - pos;
+                memcpy(t->bounce, data, part);
+                memcpy(t->bounce + part, t->ring, len - part);
+                data = t->bounce;
+            }
+            int played = ao->driver->play(ao, data, len, flags);
+            if (played > 0) {
+                __sync_synchronize();  // finish reading before freeing
+                t->read_pos = read_pos + played;
+                if ((int)(t->read_pos - t->final_pos) >= 0)
+                    t->final_chunk = false;
+                pthread_cond_broadcast(&t->drained);
+                continue;
+            }
+        }
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        int64_t ns = (now.tv_usec * 1000LL) + (int64_t)(t->period * 1e9);
+        struct timespec ts = {
+            .tv_sec = now.tv_sec + ns / 1000000000,
+            .tv_nsec = ns % 1000000000,
+        };
+        pthread_cond_timedwait(&t->wakeup, &t->lock, &ts);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static void start_thread(struct ao *ao)
+{
+    int ms = ao->opts->ao_thread_ms;
+    if (ms <= 0 || ao->untimed || !ao->driver->get_delay || ao->bps <= 0)
+        return;
+    struct ao_thread *t = talloc_zero(ao, struct ao_thread);
+    // whole bursts only, so that the driver never has to split one
+    int bursts = ((int64_t)ms * ao->bps / 1000 + ao->outburst - 1)
+                 / ao->outburst;
+    t->size = FFMAX(bursts, 2) * ao->outburst;
+    t->ring = talloc_size(t, t->size);
+    t->bounce = talloc_size(t, t->size);
+    // poll about twice per burst, but not more often than every 2 ms
+    t->period = av_clipd(ao->outburst / 2.0 / ao->bps, 0.002, 0.050);
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wakeup, NULL);
+    pthread_cond_init(&t->drained, NULL);
+    ao->thread = t;
+    if (pthread_create(&t->thread, NULL, ao_thread_main, ao)) {
+        mp_msg(MSGT_AO, MSGL_ERR, "Could not create audio thread.\n");
+        pthread_cond_destroy(&t->drained);
+        pthread_cond_destroy(&t->wakeup);
+        pthread_mutex_destroy(&t->lock);
+        ao->thread = NULL;
+        talloc_free(t);
+        return;
+    }
+    mp_msg(MSGT_AO, MSGL_V, "Audio thread with a %d byte ring buffer.\n",
+           t->size);
+}
+
+static void stop_thread(struct ao *ao, bool cut_audio)
+{
+    struct ao_thread *t = ao->thread;
+    pthread_mutex_lock(&t->lock);
+    if (!cut_audio && !t->paused && ring_buffered(t)) {
+        // let the thread flush the remaining partial burst too
+        t->final_pos = t->write_pos;
+        t->final_chunk = true;
+        pthread_cond_signal(&t->wakeup);
+        while (ring_buffered(t)) {
+            unsigned int left = ring_buffered(t);
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            struct timespec ts = { .tv_sec = now.tv_sec + 1,
+                                   .tv_nsec = now.tv_usec * 1000 };
+            pthread_cond_timedwait(&t->drained, &t->lock, &ts);
+            if (ring_buffered(t) == left)
+                break;  // device doesn't take data any more
+        }
+    }
+    t->terminate = true;
+    pthread_cond_signal(&t->wakeup);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    pthread_cond_destroy(&t->drained);
+    pthread_cond_destroy(&t->wakeup);
+    pthread_mutex_destroy(&t->lock);
+    ao->thread = NULL;
+    talloc_free(t);
+}
+
+#define LOCK_THREAD(ao) if (ao->thread) pthread_mutex_lock(&ao->thread->lock)
+#define UNLOCK_THREAD(ao) if (ao->thread) pthread_mutex_unlock(&ao->thread->lock)
+#else
+static void start_thread(struct ao *ao) {}
+#define LOCK_THREAD(ao)
+#define UNLOCK_THREAD(ao)
+#endif
+
 struct ao *ao_create(struct MPOpts *opts, struct input_ctx *input)
 {
     struct ao *r = talloc(NULL, struct ao);
@@ -151,6 +311,7 @@ void ao_init(struct ao *ao, char **ao_list)
             if (audio_out->init(ao, params) >= 0) {
                 ao->driver = audio_out;
                 ao->initialized = true;
+                start_thread(ao);
                 return;
             }
             mp_tmsg(MSGT_AO, MSGL_WARN,
@@ -174,6 +335,7 @@ void ao_init(struct ao *ao, char **ao_list)
         if (audio_out->init(ao, NULL) >= 0) {
             ao->initialized = true;
             ao->driver = audio_out;
+            start_thread(ao);
             return;
         }
         talloc_free_children(ao);
@@ -186,6 +348,10 @@ void ao_uninit(struct ao *ao, bool cut_audio)
 {
     assert(ao->buffer.len >= ao->buffer_playable_size);
     ao->buffer.len = ao->buffer_playable_size;
+#ifdef HAVE_PTHREADS
+    if (ao->thread)
+        stop_thread(ao, cut_audio);
+#endif
     if (ao->initialized)
         ao->driver->uninit(ao, cut_audio);
     if (!cut_audio && ao->buffer.len)
@@ -195,14 +361,43 @@ void ao_uninit(struct ao *ao, bool cut_audio)
 
 int ao_play(struct ao *ao, void *data, int len, int flags)
 {
+#ifdef HAVE_PTHREADS
+    struct ao_thread *t = ao->thread;
+    if (t) {
+        unsigned int write_pos = t->write_pos;
+        int space = t->size - (write_pos - t->read_pos);
+        if (len > space) {
+            len = space;
+            flags &= ~AOPLAY_FINAL_CHUNK;
+        }
+        unsigned int pos = write_pos % t->size;
+        int part = FFMIN(len, t->size - pos);
+        memcpy(t->ring + pos, data, part);
+        memcpy(t->ring, (char *)data + part, len - part);
+        if (flags & AOPLAY_FINAL_CHUNK) {
+            // the thread may be about to clear the flag of an older chunk
+            pthread_mutex_lock(&t->lock);
+            t->final_pos = write_pos + len;
+            t->final_chunk = true;
+            pthread_mutex_unlock(&t->lock);
+        }
+        __sync_synchronize();  // data must be visible before write_pos
+        t->write_pos = write_pos + len;
+        pthread_cond_signal(&t->wakeup);
+        return len;
+    }
+#endif
     return ao->driver->play(ao, data, len, flags);
 }
 
 int ao_control(struct ao *ao, enum aocontrol cmd, void *arg)
 {
+    int r = CONTROL_UNKNOWN;
+    LOCK_THREAD(ao);
     if (ao->driver->control)
-        return ao->driver->control(ao, cmd, arg);
-    return CONTROL_UNKNOWN;
+        r = ao->driver->control(ao, cmd, arg);
+    UNLOCK_THREAD(ao);
+    return r;
 }
 
 double ao_get_delay(struct ao *ao)
@@ -211,11 +406,24 @@ double ao_get_delay(struct ao *ao)
         assert(ao->untimed);
         return 0;
     }
+#ifdef HAVE_PTHREADS
+    if (ao->thread) {
+        pthread_mutex_lock(&ao->thread->lock);
+        double delay = ao->driver->get_delay(ao)
+                       + (double)ring_buffered(ao->thread) / ao->bps;
+        pthread_mutex_unlock(&ao->thread->lock);
+        return delay;
+    }
+#endif
     return ao->driver->get_delay(ao);
 }
 
 int ao_get_space(struct ao *ao)
 {
+#ifdef HAVE_PTHREADS
+    if (ao->thread)
+        return ao->thread->size - ring_buffered(ao->thread);
+#endif
     return ao->driver->get_space(ao);
 }
 
@@ -223,20 +431,42 @@ void ao_reset(struct ao *ao)
 {
     ao->buffer.len = 0;
     ao->buffer_playable_size = 0;
+    LOCK_THREAD(ao);
+#ifdef HAVE_PTHREADS
+    if (ao->thread) {
+        ao->thread->read_pos = ao->thread->write_pos;
+        ao->thread->final_chunk = false;
+    }
+#endif
     if (ao->driver->reset)
         ao->driver->reset(ao);
+    UNLOCK_THREAD(ao);
 }
 
 void ao_pause(struct ao *ao)
 {
+    LOCK_THREAD(ao);
+#ifdef HAVE_PTHREADS
+    if (ao->thread)
+        ao->thread->paused = true;
+#endif
     if (ao->driver->pause)
         ao->driver->pause(ao);
+    UNLOCK_THREAD(ao);
 }
 
 void ao_resume(struct ao *ao)
 {
+    LOCK_THREAD(ao);
+#ifdef HAVE_PTHREADS
+    if (ao->thread) {
+        ao->thread->paused = false;
+        pthread_cond_signal(&ao->thread->wakeup);
+    }
+#endif
     if (ao->driver->resume)
         ao->driver->resume(ao);
+    UNLOCK_THREAD(ao);
 }
 
 
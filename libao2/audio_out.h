@@ -103,8 +103,11 @@ struct ao {
     bool initialized;
     bool untimed;
     bool no_persistent_volume;
+    // driver wakes up the input loop when the device needs more data
+    bool event_wakeup;
     const struct ao_driver *driver;
     void *priv;
+    struct ao_thread *thread;   // non-NULL if the device is fed by a thread
     struct MPOpts *opts;
     struct input_ctx *input_ctx;
 };
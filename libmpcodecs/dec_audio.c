@@ -369,7 +369,10 @@ static int filter_n_bytes(sh_audio_t *sh, struct bstr *outbuf, int len)
 	.format = sh->sample_format
     };
     af_fix_parameters(&filter_input);
-    af_data_t *filter_output = af_play(sh->afilter, &filter_input);
+    // at the end of the file, get the audio the filters still hold back
+    int drain = error == -1 && sh->ds->eof;
+    af_data_t *filter_output = drain ? af_drain(sh->afilter, &filter_input)
+                                     : af_play(sh->afilter, &filter_input);
     if (!filter_output)
 	return -1;
     set_min_out_buffer_size(outbuf, outbuf->len + filter_output->len);
@@ -454,6 +457,8 @@ void resync_audio_stream(sh_audio_t *sh_audio)
     if (!sh_audio->initialized)
 	return;
     sh_audio->ad_driver->control(sh_audio, ADCTRL_RESYNC_STREAM, NULL);
+    if (sh_audio->afilter)
+	af_control_all(sh_audio->afilter, AF_CONTROL_RESET, NULL);
 }
 
 void skip_audio_frame(sh_audio_t *sh_audio)
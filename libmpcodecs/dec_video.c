@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <unistd.h>
 
@@ -210,6 +211,19 @@ void resync_video_stream(sh_video_t *sh_video)
     sh_video->prev_sorted_pts = MP_NOPTS_VALUE;
 }
 
+// decode calls after which the decode time of an unseen frame type expires
+#define DECODE_TIME_MAX_AGE 100
+
+void set_video_framedrop_level(sh_video_t *sh_video, int level)
+{
+    const struct vd_functions *vd = sh_video->vd_driver;
+    if (level == sh_video->framedrop_level)
+        return;
+    if (vd && vd->control(sh_video, VDCTRL_SET_FRAMEDROP_LEVEL, &level)
+              == CONTROL_TRUE)
+        sh_video->framedrop_level = level;
+}
+
 void video_reset_aspect(struct sh_video *sh_video)
 {
     int r = sh_video->vd_driver->control(sh_video, VDCTRL_RESET_ASPECT, NULL);
@@ -236,6 +250,10 @@ void uninit_video(sh_video_t *sh_video)
     sh_video->vd_driver->uninit(sh_video);
     vf_uninit_filter_chain(sh_video->vfilter);
     sh_video->initialized = 0;
+    sh_video->framedrop_level = FRAMEDROP_NONE;
+    memset(sh_video->decode_time, 0, sizeof(sh_video->decode_time));
+    memset(sh_video->decode_time_age, 0, sizeof(sh_video->decode_time_age));
+    sh_video->avg_decode_time = 0;
 }
 
 void vfm_help(void)
@@ -473,6 +491,25 @@ void *decode_video(sh_video_t *sh_video, struct demux_packet *packet,
     tt = t * 0.000001f;
     video_time_usage += tt;
 
+    // Forget the time of a type not seen for a while, e.g. P/B frames the
+    // decoder skips at a high framedrop level: it may no longer be true.
+    for (int i = 0; i < 4; i++) {
+        if (++sh_video->decode_time_age[i] > DECODE_TIME_MAX_AGE)
+            sh_video->decode_time[i] = 0;
+    }
+    if (mpi && !drop_frame) {
+        int type = mpi->pict_type >= 1 && mpi->pict_type <= 3 ?
+                   mpi->pict_type : 0;
+        sh_video->decode_time_age[type] = 0;
+        // exponential moving averages over roughly the last 16 frames
+        if (sh_video->decode_time[type] > 0)
+            sh_video->decode_time[type] += (tt - sh_video->decode_time[type])
+                                           / 16;
+        else
+            sh_video->decode_time[type] = tt;
+        sh_video->avg_decode_time += (tt - sh_video->avg_decode_time) / 16;
+    }
+
     if (!mpi || drop_frame)
         return NULL;            // error / skipped frame
 
@@ -45,6 +45,17 @@ void get_detected_video_colorspace(struct sh_video *sh, struct mp_csp_details *c
 void set_video_colorspace(struct sh_video *sh);
 int set_rectangle(sh_video_t *sh_video, int param, int value);
 void resync_video_stream(sh_video_t *sh_video);
+
+// Decoder work skipped by adaptive framedrop, each level includes the
+// previous ones.
+enum {
+    FRAMEDROP_NONE,
+    FRAMEDROP_LOOP_FILTER,  // skip the deblocking filter
+    FRAMEDROP_NONREF,       // don't decode non-reference frames
+    FRAMEDROP_NONKEY,       // decode keyframes only
+    FRAMEDROP_MAX = FRAMEDROP_NONKEY,
+};
+void set_video_framedrop_level(sh_video_t *sh_video, int level);
 void video_reset_aspect(struct sh_video *sh_video);
 int get_current_video_decoder_lag(sh_video_t *sh_video);
 
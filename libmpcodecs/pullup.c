@@ -210,6 +210,111 @@ static int var_y_mmx(unsigned char *a, unsigned char *b, int s)
 	return 4*ret;
 }
 #endif
+
+#if HAVE_MMX2
+/* psadbw sums the absolute differences of 8 bytes at once. The sums of
+ * 4 rows cannot exceed 16 bits, so they can be added as words. */
+static int diff_y_mmx2(unsigned char *a, unsigned char *b, int s)
+{
+	int ret;
+	__asm__ volatile (
+		"movq (%1), %%mm0 \n\t"
+		"movq (%1,%3), %%mm1 \n\t"
+		"psadbw (%2), %%mm0 \n\t"
+		"psadbw (%2,%3), %%mm1 \n\t"
+		"lea (%1,%3,2), %1 \n\t"
+		"lea (%2,%3,2), %2 \n\t"
+		"paddw %%mm1, %%mm0 \n\t"
+		"movq (%1), %%mm1 \n\t"
+		"movq (%1,%3), %%mm2 \n\t"
+		"psadbw (%2), %%mm1 \n\t"
+		"psadbw (%2,%3), %%mm2 \n\t"
+		"paddw %%mm1, %%mm0 \n\t"
+		"paddw %%mm2, %%mm0 \n\t"
+		"movd %%mm0, %0 \n\t"
+		"emms \n\t"
+		: "=r" (ret), "+r" (a), "+r" (b)
+		: "r" ((x86_reg)s)
+		);
+	return ret;
+}
+
+static int var_y_mmx2(unsigned char *a, unsigned char *b, int s)
+{
+	int ret;
+	__asm__ volatile (
+		"movq (%1), %%mm0 \n\t"
+		"movq (%1,%2), %%mm1 \n\t"
+		"movq (%1,%2,2), %%mm2 \n\t"
+		"add %2, %1 \n\t"
+		"movq (%1,%2,2), %%mm3 \n\t"
+		"psadbw %%mm1, %%mm0 \n\t"
+		"psadbw %%mm2, %%mm1 \n\t"
+		"psadbw %%mm3, %%mm2 \n\t"
+		"paddw %%mm1, %%mm0 \n\t"
+		"paddw %%mm2, %%mm0 \n\t"
+		"movd %%mm0, %0 \n\t"
+		"emms \n\t"
+		: "=r" (ret), "+r" (a)
+		: "r" ((x86_reg)s)
+		);
+	return 4*ret;
+}
+#endif
+
+#if HAVE_SSE2
+/* The MMX2 versions with two rows in each register. */
+static int diff_y_sse2(unsigned char *a, unsigned char *b, int s)
+{
+	int ret;
+	__asm__ volatile (
+		"movq (%1), %%xmm0 \n\t"
+		"movhps (%1,%3), %%xmm0 \n\t"
+		"movq (%2), %%xmm1 \n\t"
+		"movhps (%2,%3), %%xmm1 \n\t"
+		"lea (%1,%3,2), %1 \n\t"
+		"lea (%2,%3,2), %2 \n\t"
+		"movq (%1), %%xmm2 \n\t"
+		"movhps (%1,%3), %%xmm2 \n\t"
+		"movq (%2), %%xmm3 \n\t"
+		"movhps (%2,%3), %%xmm3 \n\t"
+		"psadbw %%xmm1, %%xmm0 \n\t"
+		"psadbw %%xmm3, %%xmm2 \n\t"
+		"paddd %%xmm2, %%xmm0 \n\t"
+		"pshufd $0xEE, %%xmm0, %%xmm1 \n\t"
+		"paddd %%xmm1, %%xmm0 \n\t"
+		"movd %%xmm0, %0 \n\t"
+		: "=r" (ret), "+r" (a), "+r" (b)
+		: "r" ((x86_reg)s)
+		: "xmm0", "xmm1", "xmm2", "xmm3"
+		);
+	return ret;
+}
+
+static int var_y_sse2(unsigned char *a, unsigned char *b, int s)
+{
+	int ret;
+	__asm__ volatile (
+		"movq (%1), %%xmm0 \n\t"
+		"movhps (%1,%2), %%xmm0 \n\t"
+		"movq (%1,%2), %%xmm1 \n\t"
+		"movhps (%1,%2,2), %%xmm1 \n\t"
+		"movq (%1,%2,2), %%xmm2 \n\t"
+		"add %2, %1 \n\t"
+		"movq (%1,%2,2), %%xmm3 \n\t"
+		"psadbw %%xmm1, %%xmm0 \n\t"
+		"psadbw %%xmm3, %%xmm2 \n\t"
+		"paddd %%xmm2, %%xmm0 \n\t"
+		"pshufd $0xEE, %%xmm0, %%xmm1 \n\t"
+		"paddd %%xmm1, %%xmm0 \n\t"
+		"movd %%xmm0, %0 \n\t"
+		: "=r" (ret), "+r" (a)
+		: "r" ((x86_reg)s)
+		: "xmm0", "xmm1", "xmm2", "xmm3"
+		);
+	return 4*ret;
+}
+#endif
 #endif
 
 #define ABS(a) (((a)^((a)>>31))-((a)>>31))
@@ -801,6 +906,18 @@ void pullup_init_context(struct pullup_context *c)
 			c->var = var_y_mmx;
 		}
 #endif
+#if HAVE_MMX2
+		if (c->cpu & PULLUP_CPU_MMX2) {
+			c->diff = diff_y_mmx2;
+			c->var = var_y_mmx2;
+		}
+#endif
+#if HAVE_SSE2
+		if (c->cpu & PULLUP_CPU_SSE2) {
+			c->diff = diff_y_sse2;
+			c->var = var_y_sse2;
+		}
+#endif
 #endif
 		/* c->comb = qpcomb_y; */
 		break;
@@ -51,6 +51,7 @@ extern const vd_functions_t *const mpcodecs_vd_drivers[];
 #define VDCTRL_RESYNC_STREAM 8 // reset decode state after seeking
 #define VDCTRL_QUERY_UNSEEN_FRAMES 9 // current decoder lag
 #define VDCTRL_RESET_ASPECT 10 // reinit filter/VO chain for new aspect ratio
+#define VDCTRL_SET_FRAMEDROP_LEVEL 11 // skip decoding work, see FRAMEDROP_*
 
 // callbacks:
 int mpcodecs_config_vo2(sh_video_t *sh, int w, int h,
@@ -37,6 +37,7 @@
 #include "fmt-conversion.h"
 
 #include "vd.h"
+#include "dec_video.h"
 #include "img_format.h"
 #include "libmpdemux/stheader.h"
 #include "libmpdemux/demux_packet.h"
@@ -74,6 +75,8 @@ typedef struct {
     int b_count;
     AVRational last_sample_aspect_ratio;
     enum AVDiscard skip_frame;
+    enum AVDiscard skip_loop_filter;
+    int framedrop_level;
 } vd_ffmpeg_ctx;
 
 #include "m_option.h"
@@ -250,6 +253,7 @@ static int init(sh_video_t *sh)
 
     // Do this after the above avopt handling in case it changes values
     ctx->skip_frame = avctx->skip_frame;
+    ctx->skip_loop_filter = avctx->skip_loop_filter;
 
     mp_dbg(MSGT_DECVIDEO, MSGL_DBG2,
            "libavcodec.size: %d x %d\n", avctx->width, avctx->height);
@@ -639,8 +643,14 @@ static struct mp_image *decode(struct sh_video *sh, struct demux_packet *packet,
         avctx->skip_frame = AVDISCARD_ALL;
     else if (flags & 1)
         avctx->skip_frame = AVDISCARD_NONREF;
+    else if (ctx->framedrop_level >= FRAMEDROP_NONKEY)
+        avctx->skip_frame = FFMAX(ctx->skip_frame, AVDISCARD_NONKEY);
+    else if (ctx->framedrop_level >= FRAMEDROP_NONREF)
+        avctx->skip_frame = FFMAX(ctx->skip_frame, AVDISCARD_NONREF);
     else
         avctx->skip_frame = ctx->skip_frame;
+    avctx->skip_loop_filter = ctx->framedrop_level >= FRAMEDROP_LOOP_FILTER ?
+                              AVDISCARD_ALL : ctx->skip_loop_filter;
 
     av_init_packet(&pkt);
     pkt.data = data;
@@ -845,6 +855,9 @@ static int control(sh_video_t *sh, int cmd, void *arg, ...)
         if (avctx->active_thread_type & FF_THREAD_FRAME)
             delay += avctx->thread_count - 1;
         return delay + 10;
+    case VDCTRL_SET_FRAMEDROP_LEVEL:
+        ctx->framedrop_level = *(int *)arg;
+        return CONTROL_TRUE;
     case VDCTRL_RESET_ASPECT:
         if (ctx->vo_initialized)
             ctx->vo_initialized = false;
@@ -29,6 +29,8 @@
 #include "config.h"
 #include "mp_msg.h"
 #include "options.h"
+#include "cpudetect.h"
+#include "ffmpeg_files/x86_cpu.h"
 
 #include "img_format.h"
 #include "mp_image.h"
@@ -63,11 +65,9 @@ static const struct vf_priv_s {
     struct osd_state *osd;
     double aspect_correction;
 
-    unsigned char *planes[3];
-    struct line_limits {
-        uint16_t start;
-        uint16_t end;
-    } *line_limits;
+    // per-pixel opacity of two luma rows and the chroma row between them
+    unsigned char *kbuf;
+    int kbuf_stride;
 } vf_priv_dflt;
 
 static int config(struct vf_instance *vf,
@@ -86,9 +86,9 @@ static int config(struct vf_instance *vf,
         d_height = d_height * vf->priv->outh / height;
     }
 
-    vf->priv->planes[1]   = malloc(vf->priv->outw * vf->priv->outh);
-    vf->priv->planes[2]   = malloc(vf->priv->outw * vf->priv->outh);
-    vf->priv->line_limits = malloc((vf->priv->outh + 1) / 2 * sizeof(*vf->priv->line_limits));
+    free(vf->priv->kbuf);
+    vf->priv->kbuf_stride = (vf->priv->outw + 2 + 15) & ~15;
+    vf->priv->kbuf = malloc(3 * vf->priv->kbuf_stride);
 
     vf->priv->aspect_correction = (double)width / height * d_height / d_width;
 
@@ -223,128 +223,169 @@ static int prepare_image(struct vf_instance *vf, mp_image_t *mpi)
     return 0;
 }
 
-static void update_limits(struct vf_instance *vf, int starty, int endy,
-                          int startx, int endx)
+#if HAVE_SSE2
+static const uint16_t __attribute__((aligned(16))) w255[8] = {
+    255, 255, 255, 255, 255, 255, 255, 255
+};
+
+static int alpha_row_sse2(unsigned char *k, const unsigned char *src, int n,
+                          int opacity)
 {
-    starty >>= 1;
-    endy = (endy + 1) >> 1;
-    startx >>= 1;
-    endx = (endx + 1) >> 1;
-    for (int i = starty; i < endy; i++) {
-        struct line_limits *ll = vf->priv->line_limits + i;
-        if (startx < ll->start)
-            ll->start = startx;
-        if (endx > ll->end)
-            ll->end = endx;
-    }
+    x86_reg x = -(n & ~15);
+    if (x)
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7 \n\t"
+        "movd      %[op], %%xmm6 \n\t"
+        "pshuflw   $0, %%xmm6, %%xmm6 \n\t"
+        "punpcklqdq %%xmm6, %%xmm6 \n\t"
+        "movdqa    %[c255], %%xmm5 \n\t"
+        "1: \n\t"
+        "movdqu  (%[s],%[x]), %%xmm0 \n\t"
+        "movdqa    %%xmm0, %%xmm1 \n\t"
+        "punpcklbw %%xmm7, %%xmm0 \n\t"
+        "punpckhbw %%xmm7, %%xmm1 \n\t"
+        "pmullw    %%xmm6, %%xmm0 \n\t"
+        "pmullw    %%xmm6, %%xmm1 \n\t"
+        "paddw     %%xmm5, %%xmm0 \n\t"
+        "paddw     %%xmm5, %%xmm1 \n\t"
+        "psrlw        $8, %%xmm0 \n\t"
+        "psrlw        $8, %%xmm1 \n\t"
+        "packuswb  %%xmm1, %%xmm0 \n\t"
+        "movdqu    %%xmm0, (%[k],%[x]) \n\t"
+        "add         $16, %[x] \n\t"
+        "jl 1b \n\t"
+        :[x]"+&r"(x)
+        :[s]"r"(src + (n & ~15)), [k]"r"(k + (n & ~15)), [op]"r"(opacity),
+         [c255]"m"(*w255)
+        :"memory", "xmm0", "xmm1", "xmm5", "xmm6", "xmm7"
+    );
+    return n & ~15;
 }
 
-/**
- * \brief Copy specified rows from render_context.dmpi to render_context.planes, upsampling to 4:4:4
- */
-static void copy_from_image(struct vf_instance *vf)
+static int blend_row_sse2(unsigned char *dst, const unsigned char *k, int n,
+                          int color)
 {
-    int pl;
-
-    for (pl = 1; pl < 3; ++pl) {
-        int dst_stride = vf->priv->outw;
-        int src_stride = vf->dmpi->stride[pl];
-
-        unsigned char *src = vf->dmpi->planes[pl];
-        unsigned char *dst = vf->priv->planes[pl];
-        for (int i = 0; i < (vf->priv->outh + 1) / 2; i++) {
-            struct line_limits *ll = vf->priv->line_limits + i;
-            unsigned char *dst_next = dst + dst_stride;
-            for (int j = ll->start; j < ll->end; j++) {
-                unsigned char val = src[j];
-                dst[j << 1] = val;
-                dst[(j << 1) + 1] = val;
-                dst_next[j << 1] = val;
-                dst_next[(j << 1) + 1] = val;
-            }
-            src += src_stride;
-            dst = dst_next + dst_stride;
-        }
-    }
+    x86_reg x = -(n & ~15);
+    if (x)
+    __asm__ volatile(
+        "pxor      %%xmm7, %%xmm7 \n\t"
+        "movd      %[c], %%xmm6 \n\t"
+        "pshuflw   $0, %%xmm6, %%xmm6 \n\t"
+        "punpcklqdq %%xmm6, %%xmm6 \n\t"
+        "movdqa    %[c255], %%xmm5 \n\t"
+        "1: \n\t"
+        "movdqu  (%[k],%[x]), %%xmm0 \n\t"
+        "movdqa    %%xmm0, %%xmm1 \n\t"
+        "punpcklbw %%xmm7, %%xmm0 \n\t"     // k
+        "punpckhbw %%xmm7, %%xmm1 \n\t"
+        "movdqu  (%[d],%[x]), %%xmm2 \n\t"
+        "movdqa    %%xmm2, %%xmm3 \n\t"
+        "punpcklbw %%xmm7, %%xmm2 \n\t"     // dst
+        "punpckhbw %%xmm7, %%xmm3 \n\t"
+        "movdqa    %%xmm5, %%xmm4 \n\t"
+        "psubw     %%xmm0, %%xmm4 \n\t"     // 255 - k
+        "pmullw    %%xmm4, %%xmm2 \n\t"
+        "movdqa    %%xmm5, %%xmm4 \n\t"
+        "psubw     %%xmm1, %%xmm4 \n\t"
+        "pmullw    %%xmm4, %%xmm3 \n\t"
+        "pmullw    %%xmm6, %%xmm0 \n\t"     // k * color
+        "pmullw    %%xmm6, %%xmm1 \n\t"
+        "paddw     %%xmm2, %%xmm0 \n\t"
+        "paddw     %%xmm3, %%xmm1 \n\t"
+        "paddw     %%xmm5, %%xmm0 \n\t"
+        "paddw     %%xmm5, %%xmm1 \n\t"
+        "psrlw        $8, %%xmm0 \n\t"
+        "psrlw        $8, %%xmm1 \n\t"
+        "packuswb  %%xmm1, %%xmm0 \n\t"
+        "movdqu    %%xmm0, (%[d],%[x]) \n\t"
+        "add         $16, %[x] \n\t"
+        "jl 1b \n\t"
+        :[x]"+&r"(x)
+        :[k]"r"(k + (n & ~15)), [d]"r"(dst + (n & ~15)), [c]"r"(color),
+         [c255]"m"(*w255)
+        :"memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+         "xmm7"
+    );
+    return n & ~15;
 }
+#endif /* HAVE_SSE2 */
 
-/**
- * \brief Copy all previously copied rows back to render_context.dmpi
- */
-static void copy_to_image(struct vf_instance *vf)
+// k = bitmap value scaled by the opacity of the image
+static void alpha_row(unsigned char *k, const unsigned char *src, int n,
+                      int opacity)
 {
-    int pl;
-    int i, j;
-    for (pl = 1; pl < 3; ++pl) {
-        int dst_stride = vf->dmpi->stride[pl];
-        int src_stride = vf->priv->outw;
-
-        unsigned char *dst      = vf->dmpi->planes[pl];
-        unsigned char *src      = vf->priv->planes[pl];
-        unsigned char *src_next = vf->priv->planes[pl] + src_stride;
-        for (i = 0; i < vf->dmpi->chroma_height; ++i) {
-            for (j = vf->priv->line_limits[i].start; j < vf->priv->line_limits[i].end; j++) {
-                unsigned val = 0;
-                val += src[j << 1];
-                val += src[(j << 1) + 1];
-                val += src_next[j << 1];
-                val += src_next[(j << 1) + 1];
-                dst[j] = val >> 2;
-            }
-            dst += dst_stride;
-            src      = src_next + src_stride;
-            src_next = src + src_stride;
-        }
-    }
+    int i = 0;
+#if HAVE_SSE2
+    if (gCpuCaps.hasSSE2)
+        i = alpha_row_sse2(k, src, n, opacity);
+#endif
+    for (; i < n; i++)
+        k[i] = (src[i] * opacity + 255) >> 8;
 }
 
-static void my_draw_bitmap(struct vf_instance *vf, unsigned char *bitmap,
-			   int bitmap_w, int bitmap_h, int stride,
-			   int dst_x, int dst_y, unsigned color)
+static void blend_row(unsigned char *dst, const unsigned char *k, int n,
+                      int color)
 {
+    int i = 0;
+#if HAVE_SSE2
+    if (gCpuCaps.hasSSE2)
+        i = blend_row_sse2(dst, k, n, color);
+#endif
+    for (; i < n; i++)
+        dst[i] = (k[i] * color + (255 - k[i]) * dst[i] + 255) >> 8;
+}
+
+/**
+ * \brief Blend one libass image into the YV12 planes of vf->dmpi
+ *
+ * Luma is blended per pixel. Each chroma sample is blended with the mean
+ * opacity of the 2x2 luma pixels it covers, counting pixels outside the
+ * bitmap as transparent, so odd positions and sizes come out right.
+ */
+static void draw_bitmap(struct vf_instance *vf, const ASS_Image *img)
+{
+    struct vf_priv_s *priv = vf->priv;
+    mp_image_t *dmpi = vf->dmpi;
+    unsigned color = img->color;
+    int opacity = 255 - _a(color);
     unsigned char y = rgba2y(color);
     unsigned char u = rgba2u(color);
     unsigned char v = rgba2v(color);
-    unsigned char opacity = 255 - _a(color);
-    unsigned char *src, *dsty, *dstu, *dstv;
-    int i, j;
-    mp_image_t *dmpi = vf->dmpi;
+    int x0 = img->dst_x, y0 = img->dst_y, w = img->w, h = img->h;
+    int pad = x0 & 1;
+    int cx0 = x0 >> 1, nc = ((x0 + w + 1) >> 1) - cx0;
+    unsigned char *krow[2] = { priv->kbuf, priv->kbuf + priv->kbuf_stride };
+    unsigned char *kc = priv->kbuf + 2 * priv->kbuf_stride;
 
-    src = bitmap;
-    dsty = dmpi->planes[0] + dst_x + dst_y * dmpi->stride[0];
-    dstu = vf->priv->planes[1] + dst_x + dst_y * vf->priv->outw;
-    dstv = vf->priv->planes[2] + dst_x + dst_y * vf->priv->outw;
-    for (i = 0; i < bitmap_h; ++i) {
-        for (j = 0; j < bitmap_w; ++j) {
-            unsigned k = (src[j] * opacity + 255) >> 8;
-            dsty[j] = (k * y + (255 - k) * dsty[j] + 255) >> 8;
-            dstu[j] = (k * u + (255 - k) * dstu[j] + 255) >> 8;
-            dstv[j] = (k * v + (255 - k) * dstv[j] + 255) >> 8;
+    if (w <= 0 || h <= 0)
+        return;
+    for (int cy = y0 >> 1; cy <= (y0 + h - 1) >> 1; cy++) {
+        for (int r = 0; r < 2; r++) {
+            int ly = 2 * cy + r;
+            unsigned char *k = krow[r];
+            if (ly < y0 || ly >= y0 + h) {
+                memset(k, 0, 2 * nc);
+                continue;
+            }
+            k[0] = k[pad + w] = 0;
+            alpha_row(k + pad, img->bitmap + (ly - y0) * img->stride, w,
+                      opacity);
+            blend_row(dmpi->planes[0] + ly * dmpi->stride[0] + x0, k + pad,
+                      w, y);
         }
-        src  += stride;
-        dsty += dmpi->stride[0];
-        dstu += vf->priv->outw;
-        dstv += vf->priv->outw;
+        for (int j = 0; j < nc; j++)
+            kc[j] = (krow[0][2 * j] + krow[0][2 * j + 1] +
+                     krow[1][2 * j] + krow[1][2 * j + 1] + 2) >> 2;
+        blend_row(dmpi->planes[1] + cy * dmpi->stride[1] + cx0, kc, nc, u);
+        blend_row(dmpi->planes[2] + cy * dmpi->stride[2] + cx0, kc, nc, v);
     }
 }
 
 static int render_frame(struct vf_instance *vf, mp_image_t *mpi,
 			const ASS_Image *img)
 {
-    if (img) {
-        for (int i = 0; i < (vf->priv->outh + 1) / 2; i++)
-            vf->priv->line_limits[i] = (struct line_limits){65535, 0};
-        for (const ASS_Image *im = img; im; im = im->next)
-            update_limits(vf, im->dst_y, im->dst_y + im->h,
-			  im->dst_x, im->dst_x + im->w);
-        copy_from_image(vf);
-        while (img) {
-            my_draw_bitmap(vf, img->bitmap, img->w, img->h, img->stride,
-                           img->dst_x, img->dst_y, img->color);
-            img = img->next;
-        }
-        copy_to_image(vf);
-    }
+    for (; img; img = img->next)
+        draw_bitmap(vf, img);
     return 0;
 }
 
@@ -401,9 +442,7 @@ static int control(vf_instance_t *vf, int request, void *data)
 
 static void uninit(struct vf_instance *vf)
 {
-    free(vf->priv->planes[1]);
-    free(vf->priv->planes[2]);
-    free(vf->priv->line_limits);
+    free(vf->priv->kbuf);
     free(vf->priv);
 }
 
@@ -35,6 +35,7 @@ struct vf_priv_s {
 	int hi, lo;
 	float frac;
 	int max, last, cnt;
+	int (*diff)(unsigned char *, unsigned char *, int, int);
 };
 
 #if HAVE_MMX && HAVE_EBX_AVAILABLE
@@ -92,18 +93,16 @@ static int diff_C(unsigned char *old, unsigned char *new, int os, int ns)
 	return d;
 }
 
-static int (*diff)(unsigned char *, unsigned char *, int, int);
-
-static int diff_to_drop_plane(int hi, int lo, float frac, unsigned char *old, unsigned char *new, int w, int h, int os, int ns)
+static int diff_to_drop_plane(struct vf_priv_s *p, unsigned char *old, unsigned char *new, int w, int h, int os, int ns)
 {
 	int x, y;
 	int d, c=0;
-	int t = (w/16)*(h/16)*frac;
+	int t = (w/16)*(h/16)*p->frac;
 	for (y = 0; y < h-7; y += 4) {
 		for (x = 8; x < w-7; x += 4) {
-			d = diff(old+x+y*os, new+x+y*ns, os, ns);
-			if (d > hi) return 0;
-			if (d > lo) {
+			d = p->diff(old+x+y*os, new+x+y*ns, os, ns);
+			if (d > p->hi) return 0;
+			if (d > p->lo) {
 				c++;
 				if (c > t) return 0;
 			}
@@ -112,19 +111,19 @@ static int diff_to_drop_plane(int hi, int lo, float frac, unsigned char *old, un
 	return 1;
 }
 
-static int diff_to_drop(int hi, int lo, float frac, mp_image_t *old, mp_image_t *new)
+static int diff_to_drop(struct vf_priv_s *p, mp_image_t *old, mp_image_t *new)
 {
 	if (new->flags & MP_IMGFLAG_PLANAR) {
-		return diff_to_drop_plane(hi,lo,frac, old->planes[0], new->planes[0],
+		return diff_to_drop_plane(p, old->planes[0], new->planes[0],
 			new->w, new->h, old->stride[0], new->stride[0])
-			&& diff_to_drop_plane(hi,lo,frac, old->planes[1], new->planes[1],
+			&& diff_to_drop_plane(p, old->planes[1], new->planes[1],
 			new->chroma_width, new->chroma_height,
 			old->stride[1], new->stride[1])
-			&& diff_to_drop_plane(hi,lo,frac, old->planes[2], new->planes[2],
+			&& diff_to_drop_plane(p, old->planes[2], new->planes[2],
 			new->chroma_width, new->chroma_height,
 			old->stride[2], new->stride[2]);
 	}
-	return diff_to_drop_plane(hi,lo,frac, old->planes[0], new->planes[0],
+	return diff_to_drop_plane(p, old->planes[0], new->planes[0],
 		new->w*(new->bpp/8), new->h, old->stride[0], new->stride[0]);
 }
 
@@ -140,7 +139,7 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
 	dmpi->qstride = mpi->qstride;
 	dmpi->qscale_type = mpi->qscale_type;
 
-	if (diff_to_drop(vf->priv->hi, vf->priv->lo, vf->priv->frac, dmpi, mpi)) {
+	if (diff_to_drop(vf->priv, dmpi, mpi)) {
 		if (vf->priv->max == 0)
 			return 0;
 		else if ((vf->priv->max > 0) && (vf->priv->cnt++ < vf->priv->max))
@@ -181,9 +180,9 @@ static int vf_open(vf_instance_t *vf, char *args)
 	p->lo = 64*5;
 	p->frac = 0.33;
 	if (args) sscanf(args, "%d:%d:%d:%f", &p->max, &p->hi, &p->lo, &p->frac);
-	diff = diff_C;
+	p->diff = diff_C;
 #if HAVE_MMX && HAVE_EBX_AVAILABLE
-	if(gCpuCaps.hasMMX) diff = diff_MMX;
+	if(gCpuCaps.hasMMX) p->diff = diff_MMX;
 #endif
 	return 1;
 }
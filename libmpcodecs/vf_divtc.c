@@ -46,6 +46,7 @@ struct vf_priv_s
    unsigned int *csdata;
    int *history;
    struct vf_detc_pts_buf ptsbuf;
+   int (*diff)(unsigned char *, unsigned char *, int, int);
    };
 
 /*
@@ -105,10 +106,8 @@ static int diff_C(unsigned char *old, unsigned char *new, int os, int ns)
    return d;
    }
 
-static int (*diff)(unsigned char *, unsigned char *, int, int);
-
-static int diff_plane(unsigned char *old, unsigned char *new,
-		      int w, int h, int os, int ns, int arg)
+static int diff_plane(struct vf_priv_s *p, unsigned char *old,
+		      unsigned char *new, int w, int h, int os, int ns)
    {
    int x, y, d, max=0, sum=0, n=0;
 
@@ -116,7 +115,7 @@ static int diff_plane(unsigned char *old, unsigned char *new,
       {
       for(x=0; x<w-7; x+=8)
 	 {
-	 d=diff(old+x+y*os, new+x+y*ns, os, ns);
+	 d=p->diff(old+x+y*os, new+x+y*ns, os, ns);
 	 if(d>max) max=d;
 	 sum+=d;
 	 n++;
@@ -214,6 +213,27 @@ static int imgop(int(*planeop)(unsigned char *, unsigned char *,
 		  dst->stride[0], src?src->stride[0]:0, arg);
    }
 
+/*
+ * imgop() with diff_plane, which needs the kernel of this instance.
+ */
+
+static int diff_img(struct vf_priv_s *p, mp_image_t *dst, mp_image_t *src)
+   {
+   if(dst->flags&MP_IMGFLAG_PLANAR)
+      return diff_plane(p, dst->planes[0], src->planes[0],
+			dst->w, dst->h, dst->stride[0], src->stride[0])+
+	     diff_plane(p, dst->planes[1], src->planes[1],
+			dst->chroma_width, dst->chroma_height,
+			dst->stride[1], src->stride[1])+
+	     diff_plane(p, dst->planes[2], src->planes[2],
+			dst->chroma_width, dst->chroma_height,
+			dst->stride[2], src->stride[2]);
+
+   return diff_plane(p, dst->planes[0], src->planes[0],
+		     dst->w*(dst->bpp/8), dst->h,
+		     dst->stride[0], src->stride[0]);
+   }
+
 /*
  * Find the phase in which the telecine pattern fits best to the
  * given 5 frame slice of frame difference measurements.
@@ -279,7 +299,7 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
       case 1:
 	 fprintf(p->file, "%08x %d\n",
 		 (unsigned int)imgop((void *)checksum_plane, mpi, 0, 0),
-		 p->frameno?imgop(diff_plane, dmpi, mpi, 0):0);
+		 p->frameno?diff_img(p, dmpi, mpi):0);
 	 break;
 
       case 2:
@@ -337,7 +357,7 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
 	       *histp=p->history+p->frameno%p->window;
 
 	    *sump-=*histp;
-	    *sump+=(*histp=imgop(diff_plane, dmpi, mpi, 0));
+	    *sump+=(*histp=diff_img(p, dmpi, mpi));
 	    }
 
 	 m=match(p, p->sum, -1, -1, &d);
@@ -702,9 +722,9 @@ static int vf_open(vf_instance_t *vf, char *args)
    if(!(p->history=calloc(sizeof *p->history, p->window)))
       goto nomem;
 
-   diff = diff_C;
+   p->diff = diff_C;
 #if HAVE_MMX && HAVE_EBX_AVAILABLE
-   if(gCpuCaps.hasMMX) diff = diff_MMX;
+   if(gCpuCaps.hasMMX) p->diff = diff_MMX;
 #endif
 
    free(args);
@@ -38,6 +38,8 @@ static struct vf_priv_s {
 	unsigned char *buf;
 	int brightness;
 	int contrast;
+	void (*process)(unsigned char *dest, int dstride, unsigned char *src, int sstride,
+			int w, int h, int brightness, int contrast);
 } const vf_priv_dflt = {
   NULL,
   0,
@@ -104,6 +106,68 @@ static void process_MMX(unsigned char *dest, int dstride, unsigned char *src, in
 }
 #endif
 
+#if HAVE_SSE2
+static void process_SSE2(unsigned char *dest, int dstride, unsigned char *src, int sstride,
+		    int w, int h, int brightness, int contrast)
+{
+	int i;
+	int pel;
+	int dstep = dstride-w;
+	int sstep = sstride-w;
+	short brvec[8] __attribute__((aligned(16)));
+	short contvec[8] __attribute__((aligned(16)));
+
+	contrast = ((contrast+100)*256*16)/100;
+	brightness = ((brightness+100)*511)/200-128 - contrast/32;
+
+	for (i = 0; i < 8; i++) {
+		brvec[i] = brightness;
+		contvec[i] = contrast;
+	}
+
+	while (h--) {
+		if (w>>4)
+		__asm__ volatile (
+			"movdqa (%5), %%xmm3 \n\t"
+			"movdqa (%6), %%xmm4 \n\t"
+			"pxor %%xmm0, %%xmm0 \n\t"
+			"movl %4, %%eax\n\t"
+			ASMALIGN(4)
+			"1: \n\t"
+			"movdqu (%0), %%xmm1 \n\t"
+			"movdqa %%xmm1, %%xmm2 \n\t"
+			"punpcklbw %%xmm0, %%xmm1 \n\t"
+			"punpckhbw %%xmm0, %%xmm2 \n\t"
+			"psllw $4, %%xmm1 \n\t"
+			"psllw $4, %%xmm2 \n\t"
+			"pmulhw %%xmm4, %%xmm1 \n\t"
+			"pmulhw %%xmm4, %%xmm2 \n\t"
+			"paddw %%xmm3, %%xmm1 \n\t"
+			"paddw %%xmm3, %%xmm2 \n\t"
+			"packuswb %%xmm2, %%xmm1 \n\t"
+			"add $16, %0 \n\t"
+			"movdqu %%xmm1, (%1) \n\t"
+			"add $16, %1 \n\t"
+			"decl %%eax \n\t"
+			"jnz 1b \n\t"
+			: "=r" (src), "=r" (dest)
+			: "0" (src), "1" (dest), "r" (w>>4), "r" (brvec), "r" (contvec)
+			: "%eax", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4"
+		);
+
+		for (i = w&15; i; i--)
+		{
+			pel = ((*src++* contrast)>>12) + brightness;
+			if(pel&768) pel = (-pel)>>31;
+			*dest++ = pel;
+		}
+
+		src += sstep;
+		dest += dstep;
+	}
+}
+#endif
+
 static void process_C(unsigned char *dest, int dstride, unsigned char *src, int sstride,
 		    int w, int h, int brightness, int contrast)
 {
@@ -127,9 +191,6 @@ static void process_C(unsigned char *dest, int dstride, unsigned char *src, int
 	}
 }
 
-static void (*process)(unsigned char *dest, int dstride, unsigned char *src, int sstride,
-		       int w, int h, int brightness, int contrast);
-
 /* FIXME: add packed yuv version of process */
 
 static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
@@ -152,7 +213,7 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
 		dmpi->planes[0] = mpi->planes[0];
 	else {
 		dmpi->planes[0] = vf->priv->buf;
-		process(dmpi->planes[0], dmpi->stride[0],
+		vf->priv->process(dmpi->planes[0], dmpi->stride[0],
 			mpi->planes[0], mpi->stride[0],
 			mpi->w, mpi->h, vf->priv->brightness,
 			vf->priv->contrast);
@@ -226,9 +287,12 @@ static int vf_open(vf_instance_t *vf, char *args)
 	vf->put_image=put_image;
 	vf->uninit=uninit;
 
-	process = process_C;
+	vf->priv->process = process_C;
 #if HAVE_MMX
-	if(gCpuCaps.hasMMX) process = process_MMX;
+	if(gCpuCaps.hasMMX) vf->priv->process = process_MMX;
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2) vf->priv->process = process_SSE2;
 #endif
 
 	return 1;
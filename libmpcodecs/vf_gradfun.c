@@ -141,6 +141,60 @@ static void filter_line_mmx2(uint8_t *dst, uint8_t *src, uint16_t *dc,
 }
 #endif
 
+#if HAVE_SSE2
+// naming the xmm registers tells the compiler which ones the asm uses
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", \
+                     "xmm4", "xmm5", "xmm6", "xmm7"
+
+// the MMX2 version on 8 pixels at a time, for CPUs without SSSE3
+static void filter_line_sse2(uint8_t *dst, uint8_t *src, uint16_t *dc,
+                             int width, int thresh, const uint16_t *dithers)
+{
+    intptr_t x;
+    if (width&7) {
+        x = width&~7;
+        filter_line_c(dst+x, src+x, dc+x/2, width-x, thresh, dithers);
+        width = x;
+    }
+    x = -width;
+    __asm__ volatile(
+        "movd           %4, %%xmm5 \n"
+        "pxor       %%xmm7, %%xmm7 \n"
+        "pshuflw $0,%%xmm5, %%xmm5 \n"
+        "movdqa         %6, %%xmm6 \n"
+        "punpcklqdq %%xmm5, %%xmm5 \n"
+        "movdqa         %5, %%xmm4 \n"
+        "1: \n"
+        "movq      (%2,%0), %%xmm0 \n"
+        "movq      (%3,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm7, %%xmm0 \n"
+        "punpcklwd  %%xmm1, %%xmm1 \n"
+        "psllw          $7, %%xmm0 \n"
+        "pxor       %%xmm2, %%xmm2 \n"
+        "psubw      %%xmm0, %%xmm1 \n" // delta = dc - pix
+        "psubw      %%xmm1, %%xmm2 \n"
+        "pmaxsw     %%xmm1, %%xmm2 \n"
+        "pmulhuw    %%xmm5, %%xmm2 \n" // m = abs(delta) * thresh >> 16
+        "psubw      %%xmm6, %%xmm2 \n"
+        "pminsw     %%xmm7, %%xmm2 \n" // m = -max(0, 127-m)
+        "pmullw     %%xmm2, %%xmm2 \n"
+        "paddw      %%xmm4, %%xmm0 \n" // pix += dither
+        "pmulhw     %%xmm2, %%xmm1 \n"
+        "psllw          $2, %%xmm1 \n" // m = m*m*delta >> 14
+        "paddw      %%xmm1, %%xmm0 \n" // pix += m
+        "psraw          $7, %%xmm0 \n"
+        "packuswb   %%xmm0, %%xmm0 \n"
+        "movq       %%xmm0, (%1,%0) \n" // dst = clip(pix>>7)
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(dst+width), "r"(src+width), "r"(dc+width/2),
+         "rm"(thresh), "m"(*dithers), "m"(*pw_7f)
+        :"memory", XMM_CLOBBERS
+    );
+}
+#endif // HAVE_SSE2
+
 #if HAVE_SSSE3
 static void filter_line_ssse3(uint8_t *dst, uint8_t *src, uint16_t *dc,
                               int width, int thresh, const uint16_t *dithers)
@@ -184,7 +238,7 @@ static void filter_line_ssse3(uint8_t *dst, uint8_t *src, uint16_t *dc,
         :"+&r"(x)
         :"r"(dst+width), "r"(src+width), "r"(dc+width/2),
          "rm"(thresh), "m"(*dithers), "m"(*pw_7f)
-        :"memory"
+        :"memory", XMM_CLOBBERS
     );
 }
 #endif // HAVE_SSSE3
@@ -220,7 +274,7 @@ static void filter_line_ssse3(uint8_t *dst, uint8_t *src, uint16_t *dc,
          "r"(src+width*2),\
          "r"(src+width*2+sstride),\
          "m"(*pw_ff)\
-        :"memory"\
+        :"memory", XMM_CLOBBERS\
     );
 
 static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -233,6 +287,7 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
     }
 }
 #endif // HAVE_6REGS && HAVE_SSE2
+#undef XMM_CLOBBERS
 
 static void filter(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
                    int width, int height, int dstride, int sstride, int r)
@@ -394,6 +449,10 @@ static int vf_open(vf_instance_t *vf, char *args)
     if (gCpuCaps.hasMMX2)
         vf->priv->filter_line = filter_line_mmx2;
 #endif
+#if HAVE_SSE2
+    if (gCpuCaps.hasSSE2)
+        vf->priv->filter_line = filter_line_sse2;
+#endif
 #if HAVE_SSSE3
     if (gCpuCaps.hasSSSE3)
         vf->priv->filter_line = filter_line_ssse3;
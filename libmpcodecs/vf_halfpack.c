@@ -36,6 +36,8 @@
 struct vf_priv_s {
 	int field;
 	struct SwsContext *ctx;
+	void (*halfpack)(unsigned char *dst, unsigned char *src[3],
+		int dststride, int srcstride[3], int w, int h);
 };
 
 #if HAVE_MMX
@@ -124,6 +126,95 @@ static void halfpack_MMX(unsigned char *dst, unsigned char *src[3],
 }
 #endif
 
+#if HAVE_SSE2
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6"
+
+// halfpack_MMX on 16 pixels at a time
+static void halfpack_SSE2(unsigned char *dst, unsigned char *src[3],
+		     int dststride, int srcstride[3],
+		     int w, int h)
+{
+	int i, j;
+	unsigned char *y1, *y2, *u, *v, *d;
+	int yinc, uinc, vinc;
+
+	y1 = src[0];
+	y2 = src[0] + srcstride[0];
+	u = src[1];
+	v = src[2];
+
+	yinc = 2*srcstride[0] - w;
+	uinc = srcstride[1] - w/2;
+	vinc = srcstride[2] - w/2;
+
+	for (h/=2; h; h--) {
+		d = dst;
+		i = w/16;
+		if (i) __asm__ volatile (
+			"pxor %%xmm0, %%xmm0 \n\t"
+			ASMALIGN(4)
+			"1: \n\t"
+			"movdqu (%0), %%xmm1 \n\t"
+			"movdqu (%1), %%xmm3 \n\t"
+			"movdqa %%xmm1, %%xmm2 \n\t"
+			"movdqa %%xmm3, %%xmm4 \n\t"
+			"punpcklbw %%xmm0, %%xmm1 \n\t"
+			"punpckhbw %%xmm0, %%xmm2 \n\t"
+			"punpcklbw %%xmm0, %%xmm3 \n\t"
+			"punpckhbw %%xmm0, %%xmm4 \n\t"
+			"paddw %%xmm3, %%xmm1 \n\t"
+			"paddw %%xmm4, %%xmm2 \n\t"
+			"psrlw $1, %%xmm1 \n\t"
+			"psrlw $1, %%xmm2 \n\t"
+
+			"movq (%2), %%xmm3 \n\t"
+			"movq (%3), %%xmm5 \n\t"
+			"punpcklbw %%xmm0, %%xmm3 \n\t"
+			"punpcklbw %%xmm0, %%xmm5 \n\t"
+			"movdqa %%xmm3, %%xmm4 \n\t"
+			"movdqa %%xmm5, %%xmm6 \n\t"
+			"punpcklwd %%xmm0, %%xmm3 \n\t"
+			"punpckhwd %%xmm0, %%xmm4 \n\t"
+			"punpcklwd %%xmm0, %%xmm5 \n\t"
+			"punpckhwd %%xmm0, %%xmm6 \n\t"
+			"pslld $8, %%xmm3 \n\t"
+			"pslld $8, %%xmm4 \n\t"
+			"pslld $24, %%xmm5 \n\t"
+			"pslld $24, %%xmm6 \n\t"
+
+			"por %%xmm3, %%xmm1 \n\t"
+			"por %%xmm4, %%xmm2 \n\t"
+			"por %%xmm5, %%xmm1 \n\t"
+			"por %%xmm6, %%xmm2 \n\t"
+
+			"add $16, %0 \n\t"
+			"add $16, %1 \n\t"
+			"add $8, %2 \n\t"
+			"add $8, %3 \n\t"
+			"movdqu %%xmm1, (%4) \n\t"
+			"movdqu %%xmm2, 16(%4) \n\t"
+			"add $32, %4 \n\t"
+			"decl %5 \n\t"
+			"jnz 1b \n\t"
+			: "+r" (y1), "+r" (y2), "+r" (u), "+r" (v), "+r" (d), "+r" (i)
+			:: "memory", XMM_CLOBBERS
+		);
+		for (j = (w&15)/2; j; j--) {
+			*d++ = (*y1++ + *y2++)/2;
+			*d++ = *u++;
+			*d++ = (*y1++ + *y2++)/2;
+			*d++ = *v++;
+		}
+		y1 += yinc;
+		y2 += yinc;
+		u += uinc;
+		v += vinc;
+		dst += dststride;
+	}
+}
+#undef XMM_CLOBBERS
+#endif
+
 
 
 static void halfpack_C(unsigned char *dst, unsigned char *src[3],
@@ -159,9 +250,6 @@ static void halfpack_C(unsigned char *dst, unsigned char *src[3],
 	}
 }
 
-static void (*halfpack)(unsigned char *dst, unsigned char *src[3],
-	int dststride, int srcstride[3], int w, int h);
-
 
 static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
 {
@@ -183,7 +271,7 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
 		          0, mpi->h/2, dmpi->planes, dmpi->stride);
 		break;
 	default:
-		halfpack(dmpi->planes[0], mpi->planes, dmpi->stride[0],
+		vf->priv->halfpack(dmpi->planes[0], mpi->planes, dmpi->stride[0],
 			mpi->stride, mpi->w, mpi->h);
 	}
 
@@ -237,9 +325,12 @@ static int vf_open(vf_instance_t *vf, char *args)
 	vf->priv->field = 2;
 	if (args) sscanf(args, "%d", &vf->priv->field);
 
-	halfpack = halfpack_C;
+	vf->priv->halfpack = halfpack_C;
 #if HAVE_MMX
-	if(gCpuCaps.hasMMX) halfpack = halfpack_MMX;
+	if(gCpuCaps.hasMMX) vf->priv->halfpack = halfpack_MMX;
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2) vf->priv->halfpack = halfpack_SSE2;
 #endif
 	return 1;
 }
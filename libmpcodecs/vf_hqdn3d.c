@@ -24,10 +24,14 @@
 #include <inttypes.h>
 #include <math.h>
 
+#include "config.h"
+#include "cpudetect.h"
 #include "mp_msg.h"
 #include "img_format.h"
 #include "mp_image.h"
 #include "vf.h"
+#include "libavutil/common.h"
+#include "ffmpeg_files/x86_cpu.h"
 
 #define PARAM1_DEFAULT 4.0
 #define PARAM2_DEFAULT 3.0
@@ -38,7 +42,12 @@
 struct vf_priv_s {
         int Coefs[4][512*16];
         unsigned int *Line;
+        unsigned int *LineH;    // 4 horizontally filtered lines
 	unsigned short *Frame[3];
+        void (*lowpass_v)(unsigned int *LineAnt, const unsigned int *Line,
+                          int W, int *Vertical);
+        void (*lowpass_t)(unsigned char *FrameDest, unsigned short *FrameAnt,
+                          const unsigned int *Line, int W, int *Temporal);
 };
 
 
@@ -47,11 +56,13 @@ struct vf_priv_s {
 static void uninit(struct vf_instance *vf)
 {
 	free(vf->priv->Line);
+	free(vf->priv->LineH);
 	free(vf->priv->Frame[0]);
 	free(vf->priv->Frame[1]);
 	free(vf->priv->Frame[2]);
 
 	vf->priv->Line     = NULL;
+	vf->priv->LineH    = NULL;
 	vf->priv->Frame[0] = NULL;
 	vf->priv->Frame[1] = NULL;
 	vf->priv->Frame[2] = NULL;
@@ -63,6 +74,7 @@ static int config(struct vf_instance *vf,
 
 	uninit(vf);
         vf->priv->Line = malloc(width*sizeof(int));
+        vf->priv->LineH = malloc(4*width*sizeof(int));
 
 	return vf_next_config(vf,width,height,d_width,d_height,flags,outfmt);
 }
@@ -74,7 +86,272 @@ static inline unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul
     return CurrMul + Coef[d];
 }
 
-static void deNoiseTemporal(
+/* The horizontal filter is recursive along each line and cannot be
+ * vectorized, but up to 4 lines are run side by side so that their
+ * dependency chains overlap. Line n is stored at LineH[n*W]. */
+static void lowpass_h(unsigned int *LineH, unsigned char *Frame,
+                      int W, int N, int sStride, int *Horizontal)
+{
+    long X;
+    int n;
+
+    if (N == 4) {
+        unsigned char *Frame1 = Frame +   sStride;
+        unsigned char *Frame2 = Frame + 2*sStride;
+        unsigned char *Frame3 = Frame + 3*sStride;
+        unsigned int PixelAnt0 = LineH[0]     = Frame [0]<<16;
+        unsigned int PixelAnt1 = LineH[W]     = Frame1[0]<<16;
+        unsigned int PixelAnt2 = LineH[2*W]   = Frame2[0]<<16;
+        unsigned int PixelAnt3 = LineH[3*W]   = Frame3[0]<<16;
+        for (X = 1; X < W; X++){
+            LineH[X]     = PixelAnt0 = LowPassMul(PixelAnt0, Frame [X]<<16, Horizontal);
+            LineH[W+X]   = PixelAnt1 = LowPassMul(PixelAnt1, Frame1[X]<<16, Horizontal);
+            LineH[2*W+X] = PixelAnt2 = LowPassMul(PixelAnt2, Frame2[X]<<16, Horizontal);
+            LineH[3*W+X] = PixelAnt3 = LowPassMul(PixelAnt3, Frame3[X]<<16, Horizontal);
+        }
+        return;
+    }
+
+    for (n = 0; n < N; n++){
+        unsigned int PixelAnt = LineH[0] = Frame[0]<<16;
+        for (X = 1; X < W; X++)
+            LineH[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        LineH += W;
+        Frame += sStride;
+    }
+}
+
+static void lowpass_v_c(unsigned int *LineAnt, const unsigned int *Line,
+                        int W, int *Vertical)
+{
+    long X;
+
+    for (X = 0; X < W; X++)
+        LineAnt[X] = LowPassMul(LineAnt[X], Line[X], Vertical);
+}
+
+static void lowpass_t_c(unsigned char *FrameDest, unsigned short *FrameAnt,
+                        const unsigned int *Line, int W, int *Temporal)
+{
+    long X;
+    unsigned int PixelDst;
+
+    for (X = 0; X < W; X++){
+        PixelDst = LowPassMul(FrameAnt[X]<<8, Line[X], Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+}
+
+/* The SIMD versions compute exactly the same as the C ones. Only the bits
+ * that survive the final shifts are extracted, so the 0x10000000 offsets
+ * of the C code do not matter. */
+
+#if (HAVE_SSE4 || HAVE_AVX2) && HAVE_6REGS
+// naming the xmm registers covers the ymm ones too
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", \
+                     "xmm4", "xmm5", "xmm6", "xmm7"
+#endif
+
+#if HAVE_SSE4 && HAVE_6REGS
+#define SSE4_LOWPASS(prev,coef) \
+        "psubd    %%xmm1, "prev" \n\t"\
+        "paddd    %%xmm5, "prev" \n\t"\
+        "psrld       $12, "prev" \n\t" /* d */\
+        "movd    "prev", %k[i] \n\t"\
+        "movd    ("coef",%[i],4), %%xmm2 \n\t"\
+        "pextrd   $1, "prev", %k[i] \n\t"\
+        "pinsrd   $1, ("coef",%[i],4), %%xmm2 \n\t"\
+        "pextrd   $2, "prev", %k[i] \n\t"\
+        "pinsrd   $2, ("coef",%[i],4), %%xmm2 \n\t"\
+        "pextrd   $3, "prev", %k[i] \n\t"\
+        "pinsrd   $3, ("coef",%[i],4), %%xmm2 \n\t"\
+        "paddd    %%xmm1, %%xmm2 \n\t" /* CurrMul + Coef[d] */
+
+#define SSE4_SETUP \
+        "mov     $0x10007FF, %k[i] \n\t"\
+        "movd        %k[i], %%xmm5 \n\t"\
+        "pshufd  $0, %%xmm5, %%xmm5 \n\t"
+
+static void lowpass_v_sse4(unsigned int *LineAnt, const unsigned int *Line,
+                           int W, int *Vertical)
+{
+    x86_reg x = -(W & ~3), i;
+
+    if (x)
+    __asm__ volatile(
+        SSE4_SETUP
+        "1: \n\t"
+        "movdqu  (%[ant],%[x],4), %%xmm0 \n\t"
+        "movdqu  (%[cur],%[x],4), %%xmm1 \n\t"
+        SSE4_LOWPASS("%%xmm0", "%[coef]")
+        "movdqu  %%xmm2, (%[ant],%[x],4) \n\t"
+        "add          $4, %[x] \n\t"
+        "jl 1b \n\t"
+        :[x]"+&r"(x), [i]"=&r"(i)
+        :[ant]"r"(LineAnt + (W & ~3)),
+         [cur]"r"(Line + (W & ~3)),
+         [coef]"r"(Vertical)
+        :"memory", XMM_CLOBBERS
+    );
+    if (W & 3)
+        lowpass_v_c(LineAnt + (W & ~3), Line + (W & ~3), W & 3, Vertical);
+}
+
+static void lowpass_t_sse4(unsigned char *FrameDest, unsigned short *FrameAnt,
+                           const unsigned int *Line, int W, int *Temporal)
+{
+    x86_reg x = -(W & ~3), i;
+
+    if (x)
+    __asm__ volatile(
+        SSE4_SETUP
+        "pcmpeqd  %%xmm6, %%xmm6 \n\t"
+        "pcmpeqd  %%xmm7, %%xmm7 \n\t"
+        "psrld       $25, %%xmm6 \n\t" /* 0x7F */
+        "psrld       $17, %%xmm7 \n\t" /* 0x7FFF */
+        "1: \n\t"
+        "pmovzxwd (%[ant],%[x],2), %%xmm0 \n\t"
+        "movdqu  (%[cur],%[x],4), %%xmm1 \n\t"
+        "pslld        $8, %%xmm0 \n\t" /* FrameAnt[X]<<8 */
+        SSE4_LOWPASS("%%xmm0", "%[coef]")
+        "movdqa   %%xmm2, %%xmm3 \n\t"
+        "paddd    %%xmm6, %%xmm2 \n\t"
+        "paddd    %%xmm7, %%xmm3 \n\t"
+        "pslld        $8, %%xmm2 \n\t"
+        "pslld        $8, %%xmm3 \n\t"
+        "psrld       $16, %%xmm2 \n\t" /* bits 8..23 */
+        "psrld       $24, %%xmm3 \n\t" /* bits 16..23 */
+        "packusdw %%xmm2, %%xmm2 \n\t"
+        "packusdw %%xmm3, %%xmm3 \n\t"
+        "packuswb %%xmm3, %%xmm3 \n\t"
+        "movq     %%xmm2, (%[ant],%[x],2) \n\t"
+        "movd     %%xmm3, %k[i] \n\t"
+        "mov      %k[i], (%[dst],%[x]) \n\t"
+        "add          $4, %[x] \n\t"
+        "jl 1b \n\t"
+        :[x]"+&r"(x), [i]"=&r"(i)
+        :[ant]"r"(FrameAnt + (W & ~3)),
+         [cur]"r"(Line + (W & ~3)),
+         [dst]"r"(FrameDest + (W & ~3)),
+         [coef]"r"(Temporal)
+        :"memory", XMM_CLOBBERS
+    );
+    if (W & 3)
+        lowpass_t_c(FrameDest + (W & ~3), FrameAnt + (W & ~3),
+                    Line + (W & ~3), W & 3, Temporal);
+}
+#undef SSE4_LOWPASS
+#undef SSE4_SETUP
+#endif /* HAVE_SSE4 && HAVE_6REGS */
+
+#if HAVE_AVX2 && HAVE_6REGS
+static const unsigned int pd_10007ff = 0x10007FF;
+static const unsigned int pd_7f      = 0x7F;
+static const unsigned int pd_7fff    = 0x7FFF;
+// per 128 bit lane: bits 8..23 of each dword, then bits 16..23
+static const uint8_t __attribute__((aligned(32))) pb_shuf_ant[32] = {
+    1, 2, 5, 6, 9, 10, 13, 14, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    1, 2, 5, 6, 9, 10, 13, 14, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint8_t __attribute__((aligned(32))) pb_shuf_dst[32] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 6, 10, 14, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 2, 6, 10, 14, 0x80, 0x80, 0x80, 0x80,
+};
+
+#define AVX2_LOWPASS(prev,coef) \
+        "vpsubd   %%ymm1, "prev", "prev" \n\t"\
+        "vpaddd   %%ymm5, "prev", "prev" \n\t"\
+        "vpsrld      $12, "prev", "prev" \n\t" /* d */\
+        "vpcmpeqd %%ymm3, %%ymm3, %%ymm3 \n\t"\
+        "vpgatherdd %%ymm3, ("coef","prev",4), %%ymm2 \n\t"\
+        "vpaddd   %%ymm1, %%ymm2, %%ymm2 \n\t" /* CurrMul + Coef[d] */
+
+static void lowpass_v_avx2(unsigned int *LineAnt, const unsigned int *Line,
+                           int W, int *Vertical)
+{
+    x86_reg x = -(W & ~7);
+
+    if (x)
+    __asm__ volatile(
+        "vpbroadcastd %[c1], %%ymm5 \n\t"
+        "1: \n\t"
+        "vmovdqu (%[ant],%[x],4), %%ymm0 \n\t"
+        "vmovdqu (%[cur],%[x],4), %%ymm1 \n\t"
+        AVX2_LOWPASS("%%ymm0", "%[coef]")
+        "vmovdqu  %%ymm2, (%[ant],%[x],4) \n\t"
+        "add          $8, %[x] \n\t"
+        "jl 1b \n\t"
+        "vzeroupper \n\t"
+        :[x]"+&r"(x)
+        :[ant]"r"(LineAnt + (W & ~7)),
+         [cur]"r"(Line + (W & ~7)),
+         [coef]"r"(Vertical),
+         [c1]"m"(pd_10007ff)
+        :"memory", XMM_CLOBBERS
+    );
+    if (W & 7)
+        lowpass_v_c(LineAnt + (W & ~7), Line + (W & ~7), W & 7, Vertical);
+}
+
+static void lowpass_t_avx2(unsigned char *FrameDest, unsigned short *FrameAnt,
+                           const unsigned int *Line, int W, int *Temporal)
+{
+    x86_reg x = -(W & ~7);
+
+    if (x)
+    __asm__ volatile(
+        "vpbroadcastd %[c1], %%ymm5 \n\t"
+        "vpbroadcastd %[c2], %%ymm6 \n\t"
+        "vpbroadcastd %[c3], %%ymm7 \n\t"
+        "vmovdqa      %[s1], %%ymm4 \n\t"
+        "1: \n\t"
+        "vpmovzxwd (%[ant],%[x],2), %%ymm0 \n\t"
+        "vmovdqu   (%[cur],%[x],4), %%ymm1 \n\t"
+        "vpslld        $8, %%ymm0, %%ymm0 \n\t" /* FrameAnt[X]<<8 */
+        AVX2_LOWPASS("%%ymm0", "%[coef]")
+        "vpaddd    %%ymm6, %%ymm2, %%ymm0 \n\t"
+        "vpaddd    %%ymm7, %%ymm2, %%ymm1 \n\t"
+        "vpshufb   %%ymm4, %%ymm0, %%ymm0 \n\t"
+        "vpshufb    %[s2], %%ymm1, %%ymm1 \n\t"
+        "vpor      %%ymm1, %%ymm0, %%ymm0 \n\t"
+        "vextracti128  $1, %%ymm0, %%xmm1 \n\t"
+        "vpunpcklqdq %%xmm1, %%xmm0, %%xmm2 \n\t"
+        "vpunpckhdq  %%xmm1, %%xmm0, %%xmm3 \n\t"
+        "vmovdqu   %%xmm2, (%[ant],%[x],2) \n\t"
+        "vmovq     %%xmm3, (%[dst],%[x]) \n\t"
+        "add           $8, %[x] \n\t"
+        "jl 1b \n\t"
+        "vzeroupper \n\t"
+        :[x]"+&r"(x)
+        :[ant]"r"(FrameAnt + (W & ~7)),
+         [cur]"r"(Line + (W & ~7)),
+         [dst]"r"(FrameDest + (W & ~7)),
+         [coef]"r"(Temporal),
+         [c1]"m"(pd_10007ff),
+         [c2]"m"(pd_7f),
+         [c3]"m"(pd_7fff),
+         [s1]"m"(*pb_shuf_ant),
+         [s2]"m"(*pb_shuf_dst)
+        :"memory", XMM_CLOBBERS
+    );
+    if (W & 7)
+        lowpass_t_c(FrameDest + (W & ~7), FrameAnt + (W & ~7),
+                    Line + (W & ~7), W & 7, Temporal);
+}
+#undef AVX2_LOWPASS
+#endif /* HAVE_AVX2 && HAVE_6REGS */
+#undef XMM_CLOBBERS
+
+static void store_line(unsigned char *FrameDest, const unsigned int *Line, int W)
+{
+    long X;
+
+    for (X = 0; X < W; X++)
+        FrameDest[X]= ((Line[X]+0x10007FFF)>>16);
+}
+
+static void deNoiseTemporal(struct vf_priv_s *p,
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned short *FrameAnt,
@@ -82,21 +359,19 @@ static void deNoiseTemporal(
                     int *Temporal)
 {
     long X, Y;
-    unsigned int PixelDst;
+    unsigned int *Line = p->LineH;
 
     for (Y = 0; Y < H; Y++){
-        for (X = 0; X < W; X++){
-            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
-            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-        }
+        for (X = 0; X < W; X++)
+            Line[X] = Frame[X]<<16;
+        p->lowpass_t(FrameDest, FrameAnt, Line, W, Temporal);
         Frame += sStride;
         FrameDest += dStride;
         FrameAnt += W;
     }
 }
 
-static void deNoiseSpacial(
+static void deNoiseSpacial(struct vf_priv_s *p,
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
@@ -104,7 +379,7 @@ static void deNoiseSpacial(
                     int *Horizontal, int *Vertical)
 {
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
+    int n, N;
     unsigned int PixelAnt;
     unsigned int PixelDst;
 
@@ -118,25 +393,18 @@ static void deNoiseSpacial(
         FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
     }
 
-    for (Y = 1; Y < H; Y++){
-	unsigned int PixelAnt;
-	sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+    for (Y = 1; Y < H; Y += N){
+        N = FFMIN(H - Y, 4);
+        lowpass_h(p->LineH, Frame + Y*sStride, W, N, sStride, Horizontal);
+        for (n = 0; n < N; n++){
+            p->lowpass_v(LineAnt, p->LineH + n*W, W, Vertical);
+            store_line(FrameDest + (Y+n)*dStride, LineAnt, W);
         }
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+static void deNoise(struct vf_priv_s *p,
+                    unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,      // vf->priv->Line (width bytes)
 		    unsigned short **FrameAntPtr,
@@ -144,9 +412,7 @@ static void deNoise(unsigned char *Frame,        // mpi->planes[x]
                     int *Horizontal, int *Vertical, int *Temporal)
 {
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
+    int n, N;
     unsigned short* FrameAnt=(*FrameAntPtr);
 
     if(!FrameAnt){
@@ -159,50 +425,28 @@ static void deNoise(unsigned char *Frame,        // mpi->planes[x]
     }
 
     if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
+        deNoiseTemporal(p, Frame, FrameDest, FrameAnt,
                         W, H, sStride, dStride, Temporal);
         return;
     }
     if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
+        deNoiseSpacial(p, Frame, FrameDest, LineAnt,
                        W, H, sStride, dStride, Horizontal, Vertical);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
     /* First line has no top neighbor. Only left one for each pixel and
      * last frame */
-    for (X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
-
-    for (Y = 1; Y < H; Y++){
-	unsigned int PixelAnt;
-	unsigned short* LinePrev=&FrameAnt[Y*W];
-	sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-	PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-	    PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+    lowpass_h(LineAnt, Frame, W, 1, sStride, Horizontal);
+    p->lowpass_t(FrameDest, FrameAnt, LineAnt, W, Temporal);
+
+    for (Y = 1; Y < H; Y += N){
+        N = FFMIN(H - Y, 4);
+        lowpass_h(p->LineH, Frame + Y*sStride, W, N, sStride, Horizontal);
+        for (n = 0; n < N; n++){
+            p->lowpass_v(LineAnt, p->LineH + n*W, W, Vertical);
+            p->lowpass_t(FrameDest + (Y+n)*dStride, &FrameAnt[(Y+n)*W],
+                         LineAnt, W, Temporal);
         }
     }
 }
@@ -219,19 +463,19 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts){
 
 	if(!dmpi) return 0;
 
-        deNoise(mpi->planes[0], dmpi->planes[0],
+        deNoise(vf->priv, mpi->planes[0], dmpi->planes[0],
 		vf->priv->Line, &vf->priv->Frame[0], W, H,
                 mpi->stride[0], dmpi->stride[0],
                 vf->priv->Coefs[0],
                 vf->priv->Coefs[0],
                 vf->priv->Coefs[1]);
-        deNoise(mpi->planes[1], dmpi->planes[1],
+        deNoise(vf->priv, mpi->planes[1], dmpi->planes[1],
 		vf->priv->Line, &vf->priv->Frame[1], cw, ch,
                 mpi->stride[1], dmpi->stride[1],
                 vf->priv->Coefs[2],
                 vf->priv->Coefs[2],
                 vf->priv->Coefs[3]);
-        deNoise(mpi->planes[2], dmpi->planes[2],
+        deNoise(vf->priv, mpi->planes[2], dmpi->planes[2],
 		vf->priv->Line, &vf->priv->Frame[2], cw, ch,
                 mpi->stride[2], dmpi->stride[2],
                 vf->priv->Coefs[2],
@@ -358,6 +602,21 @@ static int vf_open(vf_instance_t *vf, char *args){
         PrecalcCoefs(vf->priv->Coefs[2], ChromSpac);
         PrecalcCoefs(vf->priv->Coefs[3], ChromTmp);
 
+        vf->priv->lowpass_v = lowpass_v_c;
+        vf->priv->lowpass_t = lowpass_t_c;
+#if HAVE_SSE4 && HAVE_6REGS
+        if (gCpuCaps.hasSSE4) {
+            vf->priv->lowpass_v = lowpass_v_sse4;
+            vf->priv->lowpass_t = lowpass_t_sse4;
+        }
+#endif
+#if HAVE_AVX2 && HAVE_6REGS
+        if (gCpuCaps.hasAVX2) {
+            vf->priv->lowpass_v = lowpass_v_avx2;
+            vf->priv->lowpass_t = lowpass_t_avx2;
+        }
+#endif
+
 	return 1;
 }
 
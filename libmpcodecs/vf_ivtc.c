@@ -50,6 +50,7 @@ struct vf_priv_s {
 	int drop, lastdrop, dropnext;
 	int inframes, outframes;
 	struct vf_detc_pts_buf ptsbuf;
+	void (*block_diffs)(struct metrics *, unsigned char *, unsigned char *, int, int);
 };
 
 enum {
@@ -277,11 +278,9 @@ static void block_diffs_C(struct metrics *m, unsigned char *old, unsigned char *
 	m->d = e+o;
 }
 
-static void (*block_diffs)(struct metrics *, unsigned char *, unsigned char *, int, int);
-
 #define MAXUP(a,b) ((a) = ((a)>(b)) ? (a) : (b))
 
-static void diff_planes(struct frameinfo *fi,
+static void diff_planes(struct vf_priv_s *p, struct frameinfo *fi,
 	unsigned char *old, unsigned char *new, int w, int h, int os, int ns)
 {
 	int x, y;
@@ -292,7 +291,7 @@ static void diff_planes(struct frameinfo *fi,
 	memset(mean, 0, sizeof(struct metrics));
 	for (y = 0; y < h-7; y += 8) {
 		for (x = 8; x < w-8-7; x += 8) {
-			block_diffs(&l, old+x+y*os, new+x+y*ns, os, ns);
+			p->block_diffs(&l, old+x+y*os, new+x+y*ns, os, ns);
 			mean->d += l.d;
 			mean->e += l.e;
 			mean->o += l.o;
@@ -322,9 +321,10 @@ static void diff_planes(struct frameinfo *fi,
 	mean->t /= x;
 }
 
-static void diff_fields(struct frameinfo *fi, mp_image_t *old, mp_image_t *new)
+static void diff_fields(struct vf_priv_s *p, struct frameinfo *fi,
+	mp_image_t *old, mp_image_t *new)
 {
-	diff_planes(fi, old->planes[0], new->planes[0],
+	diff_planes(p, fi, old->planes[0], new->planes[0],
 		new->w, new->h, old->stride[0], new->stride[0]);
 }
 
@@ -339,7 +339,7 @@ static int foo(struct vf_priv_s *p, mp_image_t *new, mp_image_t *cur)
 	struct frameinfo *f = p->fi;
 
 	f[0] = f[1];
-	diff_fields(&f[1], cur, new);
+	diff_fields(p, &f[1], cur, new);
 	stats(&f[1]);
 
 	// Immediately drop this frame if it's already been used.
@@ -537,9 +537,9 @@ static int vf_open(vf_instance_t *vf, char *args)
 	p->drop = 0;
 	p->first = 1;
 	if (args) sscanf(args, "%d", &p->drop);
-	block_diffs = block_diffs_C;
+	p->block_diffs = block_diffs_C;
 #if HAVE_MMX && HAVE_EBX_AVAILABLE
-	if(gCpuCaps.hasMMX) block_diffs = block_diffs_MMX;
+	if(gCpuCaps.hasMMX) p->block_diffs = block_diffs_MMX;
 #endif
 	vf_detc_init_pts_buf(&p->ptsbuf);
 	return 1;
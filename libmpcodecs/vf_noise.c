@@ -43,9 +43,6 @@
 static inline void lineNoise_C(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift);
 static inline void lineNoiseAvg_C(uint8_t *dst, uint8_t *src, int len, int8_t **shift);
 
-static void (*lineNoise)(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift)= lineNoise_C;
-static void (*lineNoiseAvg)(uint8_t *dst, uint8_t *src, int len, int8_t **shift)= lineNoiseAvg_C;
-
 typedef struct FilterParam{
 	int strength;
 	int uniform;
@@ -62,6 +59,8 @@ struct vf_priv_s {
 	FilterParam lumaParam;
 	FilterParam chromaParam;
 	unsigned int outfmt;
+	void (*lineNoise)(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift);
+	void (*lineNoiseAvg)(uint8_t *dst, uint8_t *src, int len, int8_t **shift);
 };
 
 static int nonTempRandShift_init;
@@ -199,6 +198,49 @@ static inline void lineNoise_MMX2(uint8_t *dst, uint8_t *src, int8_t *noise, int
 }
 #endif
 
+//16 bytes at a time, non-temporal stores if dst is aligned
+#if HAVE_SSE2
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", \
+                     "xmm4", "xmm5", "xmm6", "xmm7"
+
+#define LINENOISE_SSE2(store, fence)\
+	__asm__ volatile(\
+		"mov %3, %%"REG_a"		\n\t"\
+		"pcmpeqb %%xmm7, %%xmm7		\n\t"\
+		"psllw $15, %%xmm7		\n\t"\
+		"packsswb %%xmm7, %%xmm7	\n\t"\
+		ASMALIGN(4)\
+		"1:				\n\t"\
+		"movdqu (%0, %%"REG_a"), %%xmm0	\n\t"\
+		"movdqu (%1, %%"REG_a"), %%xmm1	\n\t"\
+		"pxor %%xmm7, %%xmm0		\n\t"\
+		"paddsb %%xmm1, %%xmm0		\n\t"\
+		"pxor %%xmm7, %%xmm0		\n\t"\
+		store" %%xmm0, (%2, %%"REG_a")	\n\t"\
+		"add $16, %%"REG_a"		\n\t"\
+		" js 1b				\n\t"\
+		fence\
+		:: "r" (src+sse_len), "r" (noise+sse_len), "r" (dst+sse_len), "g" (-sse_len)\
+		: "%"REG_a, "memory", XMM_CLOBBERS\
+	);
+
+static inline void lineNoise_SSE2(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift){
+	x86_reg sse_len= len&(~15);
+	noise+=shift;
+
+	if(sse_len){
+		if((intptr_t)dst&15){
+			LINENOISE_SSE2("movdqu", "")
+		}else{
+			LINENOISE_SSE2("movntdq", "sfence		\n\t")
+		}
+	}
+	if(sse_len!=len)
+		lineNoise_C(dst+sse_len, src+sse_len, noise+sse_len, len-sse_len, 0);
+}
+#undef LINENOISE_SSE2
+#endif
+
 static inline void lineNoise_C(uint8_t *dst, uint8_t *src, int8_t *noise, int len, int shift){
 	int i;
 	noise+= shift;
@@ -255,6 +297,52 @@ static inline void lineNoiseAvg_MMX(uint8_t *dst, uint8_t *src, int len, int8_t
 }
 #endif
 
+#if HAVE_SSE2
+static inline void lineNoiseAvg_SSE2(uint8_t *dst, uint8_t *src, int len, int8_t **shift){
+	x86_reg sse_len= len&(~15);
+
+	if(sse_len)
+	__asm__ volatile(
+		"mov %5, %%"REG_a"		\n\t"
+		ASMALIGN(4)
+		"1:				\n\t"
+		"movdqu (%1, %%"REG_a"), %%xmm1	\n\t"
+		"movdqu (%2, %%"REG_a"), %%xmm4	\n\t"
+		"movdqu (%3, %%"REG_a"), %%xmm5	\n\t"
+		"movdqu (%0, %%"REG_a"), %%xmm0	\n\t"
+		"paddb %%xmm4, %%xmm1		\n\t"
+		"paddb %%xmm5, %%xmm1		\n\t"
+		"movdqa %%xmm0, %%xmm2		\n\t"
+		"movdqa %%xmm1, %%xmm3		\n\t"
+		"punpcklbw %%xmm0, %%xmm0	\n\t"
+		"punpckhbw %%xmm2, %%xmm2	\n\t"
+		"punpcklbw %%xmm1, %%xmm1	\n\t"
+		"punpckhbw %%xmm3, %%xmm3	\n\t"
+		"pmulhw %%xmm0, %%xmm1		\n\t"
+		"pmulhw %%xmm2, %%xmm3		\n\t"
+		"paddw %%xmm1, %%xmm1		\n\t"
+		"paddw %%xmm3, %%xmm3		\n\t"
+		"paddw %%xmm0, %%xmm1		\n\t"
+		"paddw %%xmm2, %%xmm3		\n\t"
+		"psrlw $8, %%xmm1		\n\t"
+		"psrlw $8, %%xmm3		\n\t"
+		"packuswb %%xmm3, %%xmm1	\n\t"
+		"movdqu %%xmm1, (%4, %%"REG_a")	\n\t"
+		"add $16, %%"REG_a"		\n\t"
+		" js 1b				\n\t"
+		:: "r" (src+sse_len), "r" (shift[0]+sse_len), "r" (shift[1]+sse_len), "r" (shift[2]+sse_len),
+		   "r" (dst+sse_len), "g" (-sse_len)
+		: "%"REG_a, "memory", XMM_CLOBBERS
+	);
+
+	if(sse_len!=len){
+		int8_t *shift2[3]={shift[0]+sse_len, shift[1]+sse_len, shift[2]+sse_len};
+		lineNoiseAvg_C(dst+sse_len, src+sse_len, len-sse_len, shift2);
+	}
+}
+#undef XMM_CLOBBERS
+#endif
+
 static inline void lineNoiseAvg_C(uint8_t *dst, uint8_t *src, int len, int8_t **shift){
 	int i;
         int8_t *src2= (int8_t*)src;
@@ -268,7 +356,7 @@ static inline void lineNoiseAvg_C(uint8_t *dst, uint8_t *src, int len, int8_t **
 
 /***************************************************************************/
 
-static void noise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp){
+static void noise(struct vf_priv_s *p, uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp){
 	int8_t *noise= fp->noise;
 	int y;
 	int shift=0;
@@ -297,10 +385,10 @@ static void noise(uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int
 
 		if(fp->quality==0) shift&= ~7;
 		if (fp->averaged) {
-		    lineNoiseAvg(dst, src, width, fp->prev_shift[y]);
+		    p->lineNoiseAvg(dst, src, width, fp->prev_shift[y]);
 		    fp->prev_shift[y][fp->shiftptr] = noise + shift;
 		} else {
-		    lineNoise(dst, src, noise, width, shift);
+		    p->lineNoise(dst, src, noise, width, shift);
 		}
 		dst+= dstStride;
 		src+= srcStride;
@@ -347,9 +435,9 @@ static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts){
 //else printf("dr\n");
 	dmpi= vf->dmpi;
 
-	noise(dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam);
-	noise(dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
-	noise(dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
+	noise(vf->priv, dmpi->planes[0], mpi->planes[0], dmpi->stride[0], mpi->stride[0], mpi->w, mpi->h, &vf->priv->lumaParam);
+	noise(vf->priv, dmpi->planes[1], mpi->planes[1], dmpi->stride[1], mpi->stride[1], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
+	noise(vf->priv, dmpi->planes[2], mpi->planes[2], dmpi->stride[2], mpi->stride[2], mpi->w/2, mpi->h/2, &vf->priv->chromaParam);
 
         vf_clone_mpi_attributes(dmpi, mpi);
 
@@ -443,16 +531,21 @@ static int vf_open(vf_instance_t *vf, char *args){
         return 0; // no csp match :(
     }
 
-
+    vf->priv->lineNoise= lineNoise_C;
+    vf->priv->lineNoiseAvg= lineNoiseAvg_C;
 #if HAVE_MMX
     if(gCpuCaps.hasMMX){
-        lineNoise= lineNoise_MMX;
-        lineNoiseAvg= lineNoiseAvg_MMX;
+        vf->priv->lineNoise= lineNoise_MMX;
+        vf->priv->lineNoiseAvg= lineNoiseAvg_MMX;
     }
 #endif
 #if HAVE_MMX2
-    if(gCpuCaps.hasMMX2) lineNoise= lineNoise_MMX2;
+    if(gCpuCaps.hasMMX2) vf->priv->lineNoise= lineNoise_MMX2;
 //    if(gCpuCaps.hasMMX) lineNoiseAvg= lineNoiseAvg_MMX2;
+#endif
+#if HAVE_SSE2
+    if(gCpuCaps.hasSSE2) vf->priv->lineNoise= lineNoise_SSE2;
+    if(gCpuCaps.hasSSE2) vf->priv->lineNoiseAvg= lineNoiseAvg_SSE2;
 #endif
 
     return 1;
@@ -60,6 +60,8 @@ struct vf_priv_s {
     int mpeg2;
     int temp_stride;
     uint8_t *src;
+    void (*dctB)(DCTELEM *dst, DCTELEM *src);
+    int (*requantize)(DCTELEM *src, int qp);
 };
 #if 0
 static inline void dct7_c(DCTELEM *dst, int s0, int s1, int s2, int s3, int step){
@@ -187,8 +189,6 @@ static void dctB_mmx(DCTELEM *dst, DCTELEM *src){
 }
 #endif
 
-static void (*dctB)(DCTELEM *dst, DCTELEM *src)= dctB_c;
-
 #define N0 4
 #define N1 5
 #define N2 10
@@ -278,8 +278,6 @@ static int softthresh_c(DCTELEM *src, int qp){
     return (a + (1<<11))>>12;
 }
 
-static int (*requantize)(DCTELEM *src, int qp)= hardthresh_c;
-
 static void filter(struct vf_priv_s *p, uint8_t *dst, uint8_t *src, int dst_stride, int src_stride, int width, int height, uint8_t *qp_store, int qp_stride, int is_luma){
     int x, y;
     const int stride= is_luma ? p->temp_stride : ((width+16+15)&(~15));
@@ -330,9 +328,9 @@ static void filter(struct vf_priv_s *p, uint8_t *dst, uint8_t *src, int dst_stri
                 if((x&3)==0)
                     dctA_c(tp+4*8, src, stride);
 
-                dctB(block, tp);
+                p->dctB(block, tp);
 
-                v= requantize(block, qp);
+                v= p->requantize(block, qp);
                 v= (v + dither[y&7][x&7])>>6;
                 if((unsigned)v > 255)
                     v= (-v)>>31;
@@ -456,22 +454,23 @@ static int vf_open(vf_instance_t *vf, char *args){
     init_thres2();
 
     switch(vf->priv->mode){
-	case 0: requantize= hardthresh_c; break;
-	case 1: requantize= softthresh_c; break;
+	case 0: vf->priv->requantize= hardthresh_c; break;
+	case 1: vf->priv->requantize= softthresh_c; break;
         default:
-	case 2: requantize= mediumthresh_c; break;
+	case 2: vf->priv->requantize= mediumthresh_c; break;
     }
 
+    vf->priv->dctB= dctB_c;
 #if HAVE_MMX
     if(gCpuCaps.hasMMX){
-        dctB= dctB_mmx;
+        vf->priv->dctB= dctB_mmx;
     }
 #endif
 #if 0
     if(gCpuCaps.hasMMX){
 	switch(vf->priv->mode){
-	    case 0: requantize= hardthresh_mmx; break;
-	    case 1: requantize= softthresh_mmx; break;
+	    case 0: vf->priv->requantize= hardthresh_mmx; break;
+	    case 1: vf->priv->requantize= softthresh_mmx; break;
 	}
     }
 #endif
@@ -37,6 +37,8 @@ struct vf_priv_s {
 	int buffered_i;
 	mp_image_t *buffered_mpi;
 	double buffered_pts;
+	void (*qpel_li)(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up);
+	void (*qpel_4tap)(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up);
 };
 
 static void deint(unsigned char *dest, int ds, unsigned char *src, int ss, int w, int h, int field)
@@ -144,6 +146,43 @@ static void qpel_li_MMX2(unsigned char *d, unsigned char *s, int w, int h, int d
 }
 #endif
 
+#if HAVE_SSE2
+// qpel_li_MMX2 on 16 pixels at a time
+static void qpel_li_SSE2(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up)
+{
+	int i, j, ssd=ss;
+	x86_reg n, k;
+	if (up) {
+		ssd = -ss;
+		fast_memcpy(d, s, w);
+		d += ds;
+		s += ss;
+	}
+	for (i=h-1; i; i--) {
+		n = w&~15;
+		k = -n;
+		if (n) __asm__ volatile(
+			"2: \n\t"
+			"movdqu (%1,%0), %%xmm0 \n\t"
+			"movdqu (%2,%0), %%xmm1 \n\t"
+			"pavgb %%xmm0, %%xmm1 \n\t"
+			"pavgb %%xmm0, %%xmm1 \n\t"
+			"movdqu %%xmm1, (%3,%0) \n\t"
+			"add $16, %0 \n\t"
+			"jnz 2b \n\t"
+			: "+r"(k)
+			: "r"(s+n), "r"(s+ssd+n), "r"(d+n)
+			: "memory", "xmm0", "xmm1"
+		);
+		for (j=w&~15; j<w; j++)
+			d[j] = (s[j+ssd] + 3*s[j])>>2;
+		d += ds;
+		s += ss;
+	}
+	if (!up) fast_memcpy(d, s, w);
+}
+#endif
+
 #if HAVE_MMX
 static void qpel_li_MMX(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up)
 {
@@ -323,9 +362,6 @@ static void qpel_4tap_C(unsigned char *d, unsigned char *s, int w, int h, int ds
 	if (!up) fast_memcpy(d, s, w);
 }
 
-static void (*qpel_li)(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up);
-static void (*qpel_4tap)(unsigned char *d, unsigned char *s, int w, int h, int ds, int ss, int up);
-
 static int continue_buffered_image(struct vf_instance *vf);
 
 static int put_image(struct vf_instance *vf, mp_image_t *mpi, double pts)
@@ -406,14 +442,14 @@ static int continue_buffered_image(struct vf_instance *vf)
 		}
 		break;
 	case 2:
-		qpel = qpel_li;
+		qpel = vf->priv->qpel_li;
 	case 3:
 		// TODO: add 3tap filter
 		if (!qpel)
-			qpel = qpel_4tap;
+			qpel = vf->priv->qpel_4tap;
 	case 4:
 		if (!qpel)
-			qpel = qpel_4tap;
+			qpel = vf->priv->qpel_4tap;
 
 		for (; i<2; i++) {
 			dmpi = vf_get_image(vf->next, mpi->imgfmt,
@@ -488,19 +524,22 @@ static int vf_open(vf_instance_t *vf, char *args)
 	vf->priv->mode = 4;
 	vf->priv->parity = -1;
 	if (args) sscanf(args, "%d:%d", &vf->priv->mode, &vf->priv->parity);
-	qpel_li = qpel_li_C;
-	qpel_4tap = qpel_4tap_C;
+	p->qpel_li = qpel_li_C;
+	p->qpel_4tap = qpel_4tap_C;
 #if HAVE_MMX
-	if(gCpuCaps.hasMMX) qpel_li = qpel_li_MMX;
+	if(gCpuCaps.hasMMX) p->qpel_li = qpel_li_MMX;
 #if HAVE_EBX_AVAILABLE
-	if(gCpuCaps.hasMMX) qpel_4tap = qpel_4tap_MMX;
+	if(gCpuCaps.hasMMX) p->qpel_4tap = qpel_4tap_MMX;
 #endif
 #endif
 #if HAVE_MMX2
-	if(gCpuCaps.hasMMX2) qpel_li = qpel_li_MMX2;
+	if(gCpuCaps.hasMMX2) p->qpel_li = qpel_li_MMX2;
 #endif
 #if HAVE_AMD3DNOW
-	if(gCpuCaps.has3DNow) qpel_li = qpel_li_3DNOW;
+	if(gCpuCaps.has3DNow) p->qpel_li = qpel_li_3DNOW;
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2) p->qpel_li = qpel_li_SSE2;
 #endif
 	return 1;
 }
@@ -48,10 +48,10 @@ struct vf_priv_s {
     int stride[3];
     uint8_t *ref[4][3];
     int do_deinterlace;
+    int bps; // bytes per sample, 2 for the 9 to 16 bit formats
+    void (*filter_line)(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity);
 };
 
-static void (*filter_line)(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity);
-
 static void store_ref(struct vf_priv_s *p, uint8_t *src[3], int src_stride[3], int width, int height){
     int i;
 
@@ -61,131 +61,244 @@ static void store_ref(struct vf_priv_s *p, uint8_t *src[3], int src_stride[3], i
     for(i=0; i<3; i++){
         int is_chroma= !!i;
 
-        memcpy_pic(p->ref[2][i], src[i], width>>is_chroma, height>>is_chroma, p->stride[i], src_stride[i]);
+        memcpy_pic(p->ref[2][i], src[i], (width>>is_chroma)*p->bps, height>>is_chroma, p->stride[i], src_stride[i]);
+    }
+}
+
+
+static void filter_line_c(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
+    int x;
+    uint8_t *prev2= parity ? prev : cur ;
+    uint8_t *next2= parity ? cur  : next;
+    for(x=0; x<w; x++){
+        int c= cur[-refs];
+        int d= (prev2[0] + next2[0])>>1;
+        int e= cur[+refs];
+        int temporal_diff0= FFABS(prev2[0] - next2[0]);
+        int temporal_diff1=( FFABS(prev[-refs] - c) + FFABS(prev[+refs] - e) )>>1;
+        int temporal_diff2=( FFABS(next[-refs] - c) + FFABS(next[+refs] - e) )>>1;
+        int diff= FFMAX3(temporal_diff0>>1, temporal_diff1, temporal_diff2);
+        int spatial_pred= (c+e)>>1;
+        int spatial_score= FFABS(cur[-refs-1] - cur[+refs-1]) + FFABS(c-e)
+                         + FFABS(cur[-refs+1] - cur[+refs+1]) - 1;
+
+#define CHECK(j)\
+    {   int score= FFABS(cur[-refs-1+j] - cur[+refs-1-j])\
+                 + FFABS(cur[-refs  +j] - cur[+refs  -j])\
+                 + FFABS(cur[-refs+1+j] - cur[+refs+1-j]);\
+        if(score < spatial_score){\
+            spatial_score= score;\
+            spatial_pred= (cur[-refs  +j] + cur[+refs  -j])>>1;\
+
+        CHECK(-1) CHECK(-2) }} }}
+        CHECK( 1) CHECK( 2) }} }}
+
+        if(p->mode<2){
+            int b= (prev2[-2*refs] + next2[-2*refs])>>1;
+            int f= (prev2[+2*refs] + next2[+2*refs])>>1;
+#if 0
+            int a= cur[-3*refs];
+            int g= cur[+3*refs];
+            int max= FFMAX3(d-e, d-c, FFMIN3(FFMAX(b-c,f-e),FFMAX(b-c,b-a),FFMAX(f-g,f-e)) );
+            int min= FFMIN3(d-e, d-c, FFMAX3(FFMIN(b-c,f-e),FFMIN(b-c,b-a),FFMIN(f-g,f-e)) );
+#else
+            int max= FFMAX3(d-e, d-c, FFMIN(b-c, f-e));
+            int min= FFMIN3(d-e, d-c, FFMAX(b-c, f-e));
+#endif
+
+            diff= FFMAX3(diff, min, -max);
+        }
+
+        if(spatial_pred > d + diff)
+           spatial_pred = d + diff;
+        else if(spatial_pred < d - diff)
+           spatial_pred = d - diff;
+
+        dst[0] = spatial_pred;
+
+        dst++;
+        cur++;
+        prev++;
+        next++;
+        prev2++;
+        next2++;
+    }
+}
+
+static void filter_line_c_16bit(struct vf_priv_s *p, uint8_t *dst8, uint8_t *prev8, uint8_t *cur8, uint8_t *next8, int w, int refs, int parity){
+    int x;
+    uint16_t *dst = (uint16_t *)dst8;
+    uint16_t *prev= (uint16_t *)prev8;
+    uint16_t *cur = (uint16_t *)cur8;
+    uint16_t *next= (uint16_t *)next8;
+    uint16_t *prev2= parity ? prev : cur ;
+    uint16_t *next2= parity ? cur  : next;
+    refs /= 2;
+    for(x=0; x<w; x++){
+        int c= cur[-refs];
+        int d= (prev2[0] + next2[0])>>1;
+        int e= cur[+refs];
+        int temporal_diff0= FFABS(prev2[0] - next2[0]);
+        int temporal_diff1=( FFABS(prev[-refs] - c) + FFABS(prev[+refs] - e) )>>1;
+        int temporal_diff2=( FFABS(next[-refs] - c) + FFABS(next[+refs] - e) )>>1;
+        int diff= FFMAX3(temporal_diff0>>1, temporal_diff1, temporal_diff2);
+        int spatial_pred= (c+e)>>1;
+        int spatial_score= FFABS(cur[-refs-1] - cur[+refs-1]) + FFABS(c-e)
+                         + FFABS(cur[-refs+1] - cur[+refs+1]) - 1;
+
+        CHECK(-1) CHECK(-2) }} }}
+        CHECK( 1) CHECK( 2) }} }}
+
+        if(p->mode<2){
+            int b= (prev2[-2*refs] + next2[-2*refs])>>1;
+            int f= (prev2[+2*refs] + next2[+2*refs])>>1;
+            int max= FFMAX3(d-e, d-c, FFMIN(b-c, f-e));
+            int min= FFMIN3(d-e, d-c, FFMAX(b-c, f-e));
+
+            diff= FFMAX3(diff, min, -max);
+        }
+
+        if(spatial_pred > d + diff)
+           spatial_pred = d + diff;
+        else if(spatial_pred < d - diff)
+           spatial_pred = d - diff;
+
+        dst[0] = spatial_pred;
+
+        dst++;
+        cur++;
+        prev++;
+        next++;
+        prev2++;
+        next2++;
     }
 }
+#undef CHECK
 
 #if HAVE_MMX
+static const uint64_t __attribute__((aligned(32))) pw_1[4] = {0x0001000100010001ULL, 0x0001000100010001ULL, 0x0001000100010001ULL, 0x0001000100010001ULL};
+static const uint64_t __attribute__((aligned(16))) pb_1[2] = {0x0101010101010101ULL, 0x0101010101010101ULL};
+
+#define COMPILE_TEMPLATE_SSE2 0
+#define COMPILE_TEMPLATE_SSSE3 0
+#define RENAME(a) a ## _mmx2
+#include "vf_yadif_template.c"
+#undef RENAME
+#undef COMPILE_TEMPLATE_SSE2
+#undef COMPILE_TEMPLATE_SSSE3
+
+#if HAVE_SSE2
+#define COMPILE_TEMPLATE_SSE2 1
+#define COMPILE_TEMPLATE_SSSE3 0
+#define RENAME(a) a ## _sse2
+#include "vf_yadif_template.c"
+#undef RENAME
+#undef COMPILE_TEMPLATE_SSE2
+#undef COMPILE_TEMPLATE_SSSE3
+#endif
+
+#if HAVE_SSSE3
+#define COMPILE_TEMPLATE_SSE2 1
+#define COMPILE_TEMPLATE_SSSE3 1
+#define RENAME(a) a ## _ssse3
+#include "vf_yadif_template.c"
+#undef RENAME
+#undef COMPILE_TEMPLATE_SSE2
+#undef COMPILE_TEMPLATE_SSSE3
+#endif
+
+#if HAVE_AVX2
+/* 16 pixels per iteration. The template's byte shifts do not cross the
+ * 128 bit lanes of ymm registers, so the neighbours are loaded at their
+ * offsets instead, bytes are compared in xmm registers and widened to words
+ * with vpmovzxbw. Otherwise it follows the template step by step. */
 
-#define LOAD4(mem,dst) \
-            "movd      "mem", "#dst" \n\t"\
-            "punpcklbw %%mm7, "#dst" \n\t"
+#define LOAD_W(mem,dst) \
+            "vpmovzxbw "mem", %%ymm"#dst" \n\t"
 
-#define PABS(tmp,dst) \
-            "pxor     "#tmp", "#tmp" \n\t"\
-            "psubw    "#dst", "#tmp" \n\t"\
-            "pmaxsw   "#tmp", "#dst" \n\t"
+/* ABS(cur[x-refs+pj] - cur[x+refs+mj]) as words in ymm d */
+#define ABSDIFF(pj,mj,d,t1,t2) \
+            "vmovdqu   "#pj"(%[cur],%[mrefs]), %%xmm"#d" \n\t"\
+            "vmovdqu   "#mj"(%[cur],%[prefs]), %%xmm"#t1" \n\t"\
+            "vpsubusb  %%xmm"#t1", %%xmm"#d", %%xmm"#t2" \n\t"\
+            "vpsubusb  %%xmm"#d", %%xmm"#t1", %%xmm"#t1" \n\t"\
+            "vpor      %%xmm"#t1", %%xmm"#t2", %%xmm"#d" \n\t"\
+            "vpmovzxbw %%xmm"#d", %%ymm"#d" \n\t"
 
 #define CHECK(pj,mj) \
-            "movq "#pj"(%[cur],%[mrefs]), %%mm2 \n\t" /* cur[x-refs-1+j] */\
-            "movq "#mj"(%[cur],%[prefs]), %%mm3 \n\t" /* cur[x+refs-1-j] */\
-            "movq      %%mm2, %%mm4 \n\t"\
-            "movq      %%mm2, %%mm5 \n\t"\
-            "pxor      %%mm3, %%mm4 \n\t"\
-            "pavgb     %%mm3, %%mm5 \n\t"\
-            "pand     %[pb1], %%mm4 \n\t"\
-            "psubusb   %%mm4, %%mm5 \n\t"\
-            "psrlq     $8,    %%mm5 \n\t"\
-            "punpcklbw %%mm7, %%mm5 \n\t" /* (cur[x-refs+j] + cur[x+refs-j])>>1 */\
-            "movq      %%mm2, %%mm4 \n\t"\
-            "psubusb   %%mm3, %%mm2 \n\t"\
-            "psubusb   %%mm4, %%mm3 \n\t"\
-            "pmaxub    %%mm3, %%mm2 \n\t"\
-            "movq      %%mm2, %%mm3 \n\t"\
-            "movq      %%mm2, %%mm4 \n\t" /* ABS(cur[x-refs-1+j] - cur[x+refs-1-j]) */\
-            "psrlq      $8,   %%mm3 \n\t" /* ABS(cur[x-refs  +j] - cur[x+refs  -j]) */\
-            "psrlq     $16,   %%mm4 \n\t" /* ABS(cur[x-refs+1+j] - cur[x+refs+1-j]) */\
-            "punpcklbw %%mm7, %%mm2 \n\t"\
-            "punpcklbw %%mm7, %%mm3 \n\t"\
-            "punpcklbw %%mm7, %%mm4 \n\t"\
-            "paddw     %%mm3, %%mm2 \n\t"\
-            "paddw     %%mm4, %%mm2 \n\t" /* score */
+            LOAD_W(#pj"+1(%[cur],%[mrefs])", 5)\
+            LOAD_W(#mj"+1(%[cur],%[prefs])", 4)\
+            "vpaddw    %%ymm4, %%ymm5, %%ymm5 \n\t"\
+            "vpsrlw    $1, %%ymm5, %%ymm5 \n\t" /* (cur[x-refs+j] + cur[x+refs-j])>>1 */\
+            ABSDIFF(pj, mj, 2, 3, 4)\
+            ABSDIFF(pj+1, mj+1, 3, 4, 7)\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            ABSDIFF(pj+2, mj+2, 3, 4, 7)\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n\t" /* score */
 
 #define CHECK1 \
-            "movq      %%mm0, %%mm3 \n\t"\
-            "pcmpgtw   %%mm2, %%mm3 \n\t" /* if(score < spatial_score) */\
-            "pminsw    %%mm2, %%mm0 \n\t" /* spatial_score= score; */\
-            "movq      %%mm3, %%mm6 \n\t"\
-            "pand      %%mm3, %%mm5 \n\t"\
-            "pandn     %%mm1, %%mm3 \n\t"\
-            "por       %%mm5, %%mm3 \n\t"\
-            "movq      %%mm3, %%mm1 \n\t" /* spatial_pred= (cur[x-refs+j] + cur[x+refs-j])>>1; */
-
-#define CHECK2 /* pretend not to have checked dir=2 if dir=1 was bad.\
-                  hurts both quality and speed, but matches the C version. */\
-            "paddw    %[pw1], %%mm6 \n\t"\
-            "psllw     $14,   %%mm6 \n\t"\
-            "paddsw    %%mm6, %%mm2 \n\t"\
-            "movq      %%mm0, %%mm3 \n\t"\
-            "pcmpgtw   %%mm2, %%mm3 \n\t"\
-            "pminsw    %%mm2, %%mm0 \n\t"\
-            "pand      %%mm3, %%mm5 \n\t"\
-            "pandn     %%mm1, %%mm3 \n\t"\
-            "por       %%mm5, %%mm3 \n\t"\
-            "movq      %%mm3, %%mm1 \n\t"
-
-static void filter_line_mmx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
-    static const uint64_t pw_1 = 0x0001000100010001ULL;
-    static const uint64_t pb_1 = 0x0101010101010101ULL;
+            "vpcmpgtw  %%ymm2, %%ymm0, %%ymm3 \n\t" /* if(score < spatial_score) */\
+            "vpminsw   %%ymm2, %%ymm0, %%ymm0 \n\t" /* spatial_score= score; */\
+            "vmovdqa   %%ymm3, %%ymm6 \n\t"\
+            "vpblendvb %%ymm3, %%ymm5, %%ymm1, %%ymm1 \n\t" /* spatial_pred= ... */
+
+#define CHECK2 /* see the template */\
+            "vpaddw   %[pw1], %%ymm6, %%ymm6 \n\t"\
+            "vpsllw    $14, %%ymm6, %%ymm6 \n\t"\
+            "vpaddsw   %%ymm6, %%ymm2, %%ymm2 \n\t"\
+            "vpcmpgtw  %%ymm2, %%ymm0, %%ymm3 \n\t"\
+            "vpminsw   %%ymm2, %%ymm0, %%ymm0 \n\t"\
+            "vpblendvb %%ymm3, %%ymm5, %%ymm1, %%ymm1 \n\t"
+
+static void filter_line_avx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
     const int mode = p->mode;
-    uint64_t tmp0, tmp1, tmp2, tmp3;
+    uint8_t __attribute__((aligned(32))) tmp0[32], tmp1[32], tmp2[32], tmp3[32];
     int x;
 
 #define FILTER\
-    for(x=0; x<w; x+=4){\
+    for(x=0; x+16<=w; x+=16){\
         __asm__ volatile(\
-            "pxor      %%mm7, %%mm7 \n\t"\
-            LOAD4("(%[cur],%[mrefs])", %%mm0) /* c = cur[x-refs] */\
-            LOAD4("(%[cur],%[prefs])", %%mm1) /* e = cur[x+refs] */\
-            LOAD4("(%["prev2"])", %%mm2) /* prev2[x] */\
-            LOAD4("(%["next2"])", %%mm3) /* next2[x] */\
-            "movq      %%mm3, %%mm4 \n\t"\
-            "paddw     %%mm2, %%mm3 \n\t"\
-            "psraw     $1,    %%mm3 \n\t" /* d = (prev2[x] + next2[x])>>1 */\
-            "movq      %%mm0, %[tmp0] \n\t" /* c */\
-            "movq      %%mm3, %[tmp1] \n\t" /* d */\
-            "movq      %%mm1, %[tmp2] \n\t" /* e */\
-            "psubw     %%mm4, %%mm2 \n\t"\
-            PABS(      %%mm4, %%mm2) /* temporal_diff0 */\
-            LOAD4("(%[prev],%[mrefs])", %%mm3) /* prev[x-refs] */\
-            LOAD4("(%[prev],%[prefs])", %%mm4) /* prev[x+refs] */\
-            "psubw     %%mm0, %%mm3 \n\t"\
-            "psubw     %%mm1, %%mm4 \n\t"\
-            PABS(      %%mm5, %%mm3)\
-            PABS(      %%mm5, %%mm4)\
-            "paddw     %%mm4, %%mm3 \n\t" /* temporal_diff1 */\
-            "psrlw     $1,    %%mm2 \n\t"\
-            "psrlw     $1,    %%mm3 \n\t"\
-            "pmaxsw    %%mm3, %%mm2 \n\t"\
-            LOAD4("(%[next],%[mrefs])", %%mm3) /* next[x-refs] */\
-            LOAD4("(%[next],%[prefs])", %%mm4) /* next[x+refs] */\
-            "psubw     %%mm0, %%mm3 \n\t"\
-            "psubw     %%mm1, %%mm4 \n\t"\
-            PABS(      %%mm5, %%mm3)\
-            PABS(      %%mm5, %%mm4)\
-            "paddw     %%mm4, %%mm3 \n\t" /* temporal_diff2 */\
-            "psrlw     $1,    %%mm3 \n\t"\
-            "pmaxsw    %%mm3, %%mm2 \n\t"\
-            "movq      %%mm2, %[tmp3] \n\t" /* diff */\
-\
-            "paddw     %%mm0, %%mm1 \n\t"\
-            "paddw     %%mm0, %%mm0 \n\t"\
-            "psubw     %%mm1, %%mm0 \n\t"\
-            "psrlw     $1,    %%mm1 \n\t" /* spatial_pred */\
-            PABS(      %%mm2, %%mm0)      /* ABS(c-e) */\
+            LOAD_W("(%[cur],%[mrefs])", 0) /* c = cur[x-refs] */\
+            LOAD_W("(%[cur],%[prefs])", 1) /* e = cur[x+refs] */\
+            LOAD_W("(%["prev2"])", 2) /* prev2[x] */\
+            LOAD_W("(%["next2"])", 3) /* next2[x] */\
+            "vpaddw    %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpsrlw    $1, %%ymm4, %%ymm4 \n\t" /* d = (prev2[x] + next2[x])>>1 */\
+            "vmovdqa   %%ymm0, %[tmp0] \n\t" /* c */\
+            "vmovdqa   %%ymm4, %[tmp1] \n\t" /* d */\
+            "vmovdqa   %%ymm1, %[tmp2] \n\t" /* e */\
+            "vpsubw    %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vpabsw    %%ymm2, %%ymm2 \n\t" /* temporal_diff0 */\
+            LOAD_W("(%[prev],%[mrefs])", 3) /* prev[x-refs] */\
+            LOAD_W("(%[prev],%[prefs])", 4) /* prev[x+refs] */\
+            "vpsubw    %%ymm0, %%ymm3, %%ymm3 \n\t"\
+            "vpsubw    %%ymm1, %%ymm4, %%ymm4 \n\t"\
+            "vpabsw    %%ymm3, %%ymm3 \n\t"\
+            "vpabsw    %%ymm4, %%ymm4 \n\t"\
+            "vpaddw    %%ymm4, %%ymm3, %%ymm3 \n\t" /* temporal_diff1 */\
+            "vpsrlw    $1, %%ymm2, %%ymm2 \n\t"\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            LOAD_W("(%[next],%[mrefs])", 3) /* next[x-refs] */\
+            LOAD_W("(%[next],%[prefs])", 4) /* next[x+refs] */\
+            "vpsubw    %%ymm0, %%ymm3, %%ymm3 \n\t"\
+            "vpsubw    %%ymm1, %%ymm4, %%ymm4 \n\t"\
+            "vpabsw    %%ymm3, %%ymm3 \n\t"\
+            "vpabsw    %%ymm4, %%ymm4 \n\t"\
+            "vpaddw    %%ymm4, %%ymm3, %%ymm3 \n\t" /* temporal_diff2 */\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm2 \n\t"\
+            "vmovdqa   %%ymm2, %[tmp3] \n\t" /* diff */\
 \
-            "movq -1(%[cur],%[mrefs]), %%mm2 \n\t" /* cur[x-refs-1] */\
-            "movq -1(%[cur],%[prefs]), %%mm3 \n\t" /* cur[x+refs-1] */\
-            "movq      %%mm2, %%mm4 \n\t"\
-            "psubusb   %%mm3, %%mm2 \n\t"\
-            "psubusb   %%mm4, %%mm3 \n\t"\
-            "pmaxub    %%mm3, %%mm2 \n\t"\
-            "pshufw $9,%%mm2, %%mm3 \n\t"\
-            "punpcklbw %%mm7, %%mm2 \n\t" /* ABS(cur[x-refs-1] - cur[x+refs-1]) */\
-            "punpcklbw %%mm7, %%mm3 \n\t" /* ABS(cur[x-refs+1] - cur[x+refs+1]) */\
-            "paddw     %%mm2, %%mm0 \n\t"\
-            "paddw     %%mm3, %%mm0 \n\t"\
-            "psubw    %[pw1], %%mm0 \n\t" /* spatial_score */\
+            "vpsubw    %%ymm1, %%ymm0, %%ymm2 \n\t"\
+            "vpaddw    %%ymm1, %%ymm0, %%ymm1 \n\t"\
+            "vpsrlw    $1, %%ymm1, %%ymm1 \n\t" /* spatial_pred */\
+            "vpabsw    %%ymm2, %%ymm0 \n\t" /* ABS(c-e) */\
+            ABSDIFF(-1, -1, 2, 3, 4)\
+            "vpaddw    %%ymm2, %%ymm0, %%ymm0 \n\t"\
+            ABSDIFF(1, 1, 2, 3, 4)\
+            "vpaddw    %%ymm2, %%ymm0, %%ymm0 \n\t"\
+            "vpsubw   %[pw1], %%ymm0, %%ymm0 \n\t" /* spatial_score */\
 \
             CHECK(-2,0)\
             CHECK1\
@@ -197,45 +310,44 @@ static void filter_line_mmx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, u
             CHECK2\
 \
             /* if(p->mode<2) ... */\
-            "movq    %[tmp3], %%mm6 \n\t" /* diff */\
+            "vmovdqa %[tmp3], %%ymm6 \n\t" /* diff */\
             "cmpl      $2, %[mode] \n\t"\
             "jge       1f \n\t"\
-            LOAD4("(%["prev2"],%[mrefs],2)", %%mm2) /* prev2[x-2*refs] */\
-            LOAD4("(%["next2"],%[mrefs],2)", %%mm4) /* next2[x-2*refs] */\
-            LOAD4("(%["prev2"],%[prefs],2)", %%mm3) /* prev2[x+2*refs] */\
-            LOAD4("(%["next2"],%[prefs],2)", %%mm5) /* next2[x+2*refs] */\
-            "paddw     %%mm4, %%mm2 \n\t"\
-            "paddw     %%mm5, %%mm3 \n\t"\
-            "psrlw     $1,    %%mm2 \n\t" /* b */\
-            "psrlw     $1,    %%mm3 \n\t" /* f */\
-            "movq    %[tmp0], %%mm4 \n\t" /* c */\
-            "movq    %[tmp1], %%mm5 \n\t" /* d */\
-            "movq    %[tmp2], %%mm7 \n\t" /* e */\
-            "psubw     %%mm4, %%mm2 \n\t" /* b-c */\
-            "psubw     %%mm7, %%mm3 \n\t" /* f-e */\
-            "movq      %%mm5, %%mm0 \n\t"\
-            "psubw     %%mm4, %%mm5 \n\t" /* d-c */\
-            "psubw     %%mm7, %%mm0 \n\t" /* d-e */\
-            "movq      %%mm2, %%mm4 \n\t"\
-            "pminsw    %%mm3, %%mm2 \n\t"\
-            "pmaxsw    %%mm4, %%mm3 \n\t"\
-            "pmaxsw    %%mm5, %%mm2 \n\t"\
-            "pminsw    %%mm5, %%mm3 \n\t"\
-            "pmaxsw    %%mm0, %%mm2 \n\t" /* max */\
-            "pminsw    %%mm0, %%mm3 \n\t" /* min */\
-            "pxor      %%mm4, %%mm4 \n\t"\
-            "pmaxsw    %%mm3, %%mm6 \n\t"\
-            "psubw     %%mm2, %%mm4 \n\t" /* -max */\
-            "pmaxsw    %%mm4, %%mm6 \n\t" /* diff= MAX3(diff, min, -max); */\
+            LOAD_W("(%["prev2"],%[mrefs],2)", 2) /* prev2[x-2*refs] */\
+            LOAD_W("(%["next2"],%[mrefs],2)", 4) /* next2[x-2*refs] */\
+            LOAD_W("(%["prev2"],%[prefs],2)", 3) /* prev2[x+2*refs] */\
+            LOAD_W("(%["next2"],%[prefs],2)", 5) /* next2[x+2*refs] */\
+            "vpaddw    %%ymm4, %%ymm2, %%ymm2 \n\t"\
+            "vpaddw    %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpsrlw    $1, %%ymm2, %%ymm2 \n\t" /* b */\
+            "vpsrlw    $1, %%ymm3, %%ymm3 \n\t" /* f */\
+            "vmovdqa %[tmp0], %%ymm4 \n\t" /* c */\
+            "vmovdqa %[tmp1], %%ymm5 \n\t" /* d */\
+            "vmovdqa %[tmp2], %%ymm7 \n\t" /* e */\
+            "vpsubw    %%ymm4, %%ymm2, %%ymm2 \n\t" /* b-c */\
+            "vpsubw    %%ymm7, %%ymm3, %%ymm3 \n\t" /* f-e */\
+            "vpsubw    %%ymm7, %%ymm5, %%ymm0 \n\t" /* d-e */\
+            "vpsubw    %%ymm4, %%ymm5, %%ymm5 \n\t" /* d-c */\
+            "vpminsw   %%ymm3, %%ymm2, %%ymm4 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm2, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm5, %%ymm4, %%ymm2 \n\t"\
+            "vpminsw   %%ymm5, %%ymm3, %%ymm3 \n\t"\
+            "vpmaxsw   %%ymm0, %%ymm2, %%ymm2 \n\t" /* max */\
+            "vpminsw   %%ymm0, %%ymm3, %%ymm3 \n\t" /* min */\
+            "vpxor     %%ymm4, %%ymm4, %%ymm4 \n\t"\
+            "vpmaxsw   %%ymm3, %%ymm6, %%ymm6 \n\t"\
+            "vpsubw    %%ymm2, %%ymm4, %%ymm4 \n\t" /* -max */\
+            "vpmaxsw   %%ymm4, %%ymm6, %%ymm6 \n\t" /* diff= MAX3(diff, min, -max); */\
             "1: \n\t"\
 \
-            "movq    %[tmp1], %%mm2 \n\t" /* d */\
-            "movq      %%mm2, %%mm3 \n\t"\
-            "psubw     %%mm6, %%mm2 \n\t" /* d-diff */\
-            "paddw     %%mm6, %%mm3 \n\t" /* d+diff */\
-            "pmaxsw    %%mm2, %%mm1 \n\t"\
-            "pminsw    %%mm3, %%mm1 \n\t" /* d = clip(spatial_pred, d-diff, d+diff); */\
-            "packuswb  %%mm1, %%mm1 \n\t"\
+            "vmovdqa %[tmp1], %%ymm2 \n\t" /* d */\
+            "vpsubw    %%ymm6, %%ymm2, %%ymm3 \n\t" /* d-diff */\
+            "vpaddw    %%ymm6, %%ymm2, %%ymm2 \n\t" /* d+diff */\
+            "vpmaxsw   %%ymm3, %%ymm1, %%ymm1 \n\t"\
+            "vpminsw   %%ymm2, %%ymm1, %%ymm1 \n\t" /* d = clip(spatial_pred, d-diff, d+diff); */\
+            "vextracti128 $1, %%ymm1, %%xmm2 \n\t"\
+            "vpackuswb %%xmm2, %%xmm1, %%xmm1 \n\t"\
+            "vmovdqu   %%xmm1, (%[dst]) \n\t"\
 \
             :[tmp0]"=m"(tmp0),\
              [tmp1]"=m"(tmp1),\
@@ -247,14 +359,15 @@ static void filter_line_mmx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, u
              [prefs]"r"((x86_reg)refs),\
              [mrefs]"r"((x86_reg)-refs),\
              [pw1]  "m"(pw_1),\
-             [pb1]  "m"(pb_1),\
-             [mode] "g"(mode)\
+             [mode] "g"(mode),\
+             [dst]  "r"(dst)\
+            :"memory", "xmm0", "xmm1", "xmm2", "xmm3",\
+                       "xmm4", "xmm5", "xmm6", "xmm7"\
         );\
-        __asm__ volatile("movd %%mm1, %0" :"=m"(*dst));\
-        dst += 4;\
-        prev+= 4;\
-        cur += 4;\
-        next+= 4;\
+        dst += 16;\
+        prev+= 16;\
+        cur += 16;\
+        next+= 16;\
     }
 
     if(parity){
@@ -270,75 +383,21 @@ static void filter_line_mmx2(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, u
 #undef prev2
 #undef next2
     }
+    __asm__ volatile("vzeroupper \n\t");
+
+    if(x < w)
+        filter_line_c(p, dst, prev, cur, next, w-x, refs, parity);
 }
-#undef LOAD4
-#undef PABS
+
+#undef LOAD_W
+#undef ABSDIFF
 #undef CHECK
 #undef CHECK1
 #undef CHECK2
 #undef FILTER
-
+#endif /* HAVE_AVX2 */
 #endif /* HAVE_MMX */
 
-static void filter_line_c(struct vf_priv_s *p, uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int refs, int parity){
-    int x;
-    uint8_t *prev2= parity ? prev : cur ;
-    uint8_t *next2= parity ? cur  : next;
-    for(x=0; x<w; x++){
-        int c= cur[-refs];
-        int d= (prev2[0] + next2[0])>>1;
-        int e= cur[+refs];
-        int temporal_diff0= FFABS(prev2[0] - next2[0]);
-        int temporal_diff1=( FFABS(prev[-refs] - c) + FFABS(prev[+refs] - e) )>>1;
-        int temporal_diff2=( FFABS(next[-refs] - c) + FFABS(next[+refs] - e) )>>1;
-        int diff= FFMAX3(temporal_diff0>>1, temporal_diff1, temporal_diff2);
-        int spatial_pred= (c+e)>>1;
-        int spatial_score= FFABS(cur[-refs-1] - cur[+refs-1]) + FFABS(c-e)
-                         + FFABS(cur[-refs+1] - cur[+refs+1]) - 1;
-
-#define CHECK(j)\
-    {   int score= FFABS(cur[-refs-1+j] - cur[+refs-1-j])\
-                 + FFABS(cur[-refs  +j] - cur[+refs  -j])\
-                 + FFABS(cur[-refs+1+j] - cur[+refs+1-j]);\
-        if(score < spatial_score){\
-            spatial_score= score;\
-            spatial_pred= (cur[-refs  +j] + cur[+refs  -j])>>1;\
-
-        CHECK(-1) CHECK(-2) }} }}
-        CHECK( 1) CHECK( 2) }} }}
-
-        if(p->mode<2){
-            int b= (prev2[-2*refs] + next2[-2*refs])>>1;
-            int f= (prev2[+2*refs] + next2[+2*refs])>>1;
-#if 0
-            int a= cur[-3*refs];
-            int g= cur[+3*refs];
-            int max= FFMAX3(d-e, d-c, FFMIN3(FFMAX(b-c,f-e),FFMAX(b-c,b-a),FFMAX(f-g,f-e)) );
-            int min= FFMIN3(d-e, d-c, FFMAX3(FFMIN(b-c,f-e),FFMIN(b-c,b-a),FFMIN(f-g,f-e)) );
-#else
-            int max= FFMAX3(d-e, d-c, FFMIN(b-c, f-e));
-            int min= FFMIN3(d-e, d-c, FFMAX(b-c, f-e));
-#endif
-
-            diff= FFMAX3(diff, min, -max);
-        }
-
-        if(spatial_pred > d + diff)
-           spatial_pred = d + diff;
-        else if(spatial_pred < d - diff)
-           spatial_pred = d - diff;
-
-        dst[0] = spatial_pred;
-
-        dst++;
-        cur++;
-        prev++;
-        next++;
-        prev2++;
-        next2++;
-    }
-}
-
 static void filter(struct vf_priv_s *p, uint8_t *dst[3], int dst_stride[3], int width, int height, int parity, int tff){
     int y, i;
 
@@ -354,9 +413,9 @@ static void filter(struct vf_priv_s *p, uint8_t *dst[3], int dst_stride[3], int
                 uint8_t *cur = &p->ref[1][i][y*refs];
                 uint8_t *next= &p->ref[2][i][y*refs];
                 uint8_t *dst2= &dst[i][y*dst_stride[i]];
-                filter_line(p, dst2, prev, cur, next, w, refs, parity ^ tff);
+                p->filter_line(p, dst2, prev, cur, next, w, refs, parity ^ tff);
             }else{
-                fast_memcpy(&dst[i][y*dst_stride[i]], &p->ref[1][i][y*refs], w);
+                fast_memcpy(&dst[i][y*dst_stride[i]], &p->ref[1][i][y*refs], w*p->bps);
             }
         }
     }
@@ -370,9 +429,28 @@ static int config(struct vf_instance *vf,
 	unsigned int flags, unsigned int outfmt){
         int i, j;
 
+        vf->priv->bps = IMGFMT_IS_YUVP16(outfmt) ? 2 : 1;
+        if(vf->priv->bps == 2){
+            vf->priv->filter_line = filter_line_c_16bit;
+        }else{
+            vf->priv->filter_line = filter_line_c;
+#if HAVE_MMX
+            if(gCpuCaps.hasMMX2) vf->priv->filter_line = filter_line_mmx2;
+#endif
+#if HAVE_SSE2
+            if(gCpuCaps.hasSSE2) vf->priv->filter_line = filter_line_sse2;
+#endif
+#if HAVE_SSSE3
+            if(gCpuCaps.hasSSSE3) vf->priv->filter_line = filter_line_ssse3;
+#endif
+#if HAVE_AVX2
+            if(gCpuCaps.hasAVX2) vf->priv->filter_line = filter_line_avx2;
+#endif
+        }
+
         for(i=0; i<3; i++){
             int is_chroma= !!i;
-            int w= ((width   + 31) & (~31))>>is_chroma;
+            int w= (((width   + 31) & (~31))>>is_chroma)*vf->priv->bps;
             int h= ((height+6+ 31) & (~31))>>is_chroma;
 
             vf->priv->stride[i]= w;
@@ -471,6 +549,9 @@ static int query_format(struct vf_instance *vf, unsigned int fmt){
 	case IMGFMT_IYUV:
 	case IMGFMT_Y800:
 	case IMGFMT_Y8:
+	case IMGFMT_420P16:
+	case IMGFMT_420P10:
+	case IMGFMT_420P9:
 	    return vf_next_query_format(vf,fmt);
     }
     return 0;
@@ -504,11 +585,6 @@ static int vf_open(vf_instance_t *vf, char *args){
 
     if (args) sscanf(args, "%d:%d", &vf->priv->mode, &vf->priv->parity);
 
-    filter_line = filter_line_c;
-#if HAVE_MMX
-    if(gCpuCaps.hasMMX2) filter_line = filter_line_mmx2;
-#endif
-
     return 1;
 }
 
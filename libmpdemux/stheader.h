@@ -107,6 +107,12 @@ typedef struct sh_video {
     double prev_sorted_pts;
     int num_sorted_pts_problems;
     int pts_assoc_mode;
+    // average decode time in seconds per picture type (index 0: unknown,
+    // 1: I, 2: P, 3: B) and over all frames, used by adaptive framedrop
+    double decode_time[4];
+    int decode_time_age[4]; // decode calls since that type was last timed
+    double avg_decode_time;
+    int framedrop_level;    // FRAMEDROP_* level the decoder is using
     // output format: (set by demuxer)
     float fps;            // frames per second (set only if constant fps)
     float frametime;      // 1/fps
@@ -20,6 +20,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include <libavutil/common.h>
 
@@ -204,3 +206,384 @@ int packer_pack_from_subbitmaps(struct bitmap_packer *packer,
         packer->in[i] = (struct pos){b->parts[i].w + a, b->parts[i].h + a};
     return packer_pack(packer);
 }
+
+
+#define ATLAS_MIN_SIZE 256
+#define SHELF_ALIGN 4
+
+struct atlas_entry {
+    uint64_t hash;
+    unsigned char *bitmap;      // w * h copy to check hash hits against
+    int w, h;
+    int x, y;
+    int shelf;
+    unsigned int last_used;
+    bool dirty;
+};
+
+struct atlas_seg {
+    int x, w;
+};
+
+struct atlas_shelf {
+    int y, h;
+    struct atlas_seg *free;     // sorted by x, no two adjacent
+    int num_free;
+};
+
+struct atlas_item {
+    uint64_t hash;
+    int w, h;
+    const unsigned char *bitmap;
+    int stride;
+};
+
+static uint64_t hash_bitmap(const unsigned char *p, int w, int h, int stride)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int y = 0; y < h; y++, p += stride) {
+        int x = 0;
+        for (; x + 8 <= w; x += 8) {
+            uint64_t v;
+            memcpy(&v, p + x, 8);
+            hash = (hash ^ v) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        }
+        for (; x < w; x++)
+            hash = (hash ^ p[x]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool same_bitmap(struct atlas_entry *e, struct atlas_item *it)
+{
+    if (e->hash != it->hash || e->w != it->w || e->h != it->h)
+        return false;
+    for (int y = 0; y < it->h; y++) {
+        if (memcmp(e->bitmap + y * e->w, it->bitmap + y * it->stride, it->w))
+            return false;
+    }
+    return true;
+}
+
+static struct atlas_entry *atlas_find(struct bitmap_atlas *a,
+                                      struct atlas_item *it)
+{
+    if (!a->index_size)
+        return NULL;
+    int mask = a->index_size - 1;
+    for (int i = it->hash & mask; a->index[i]; i = (i + 1) & mask) {
+        struct atlas_entry *e = &a->entries[a->index[i] - 1];
+        if (same_bitmap(e, it))
+            return e;
+    }
+    return NULL;
+}
+
+static void index_add(struct bitmap_atlas *a, int n)
+{
+    int mask = a->index_size - 1;
+    int i = a->entries[n].hash & mask;
+    while (a->index[i])
+        i = (i + 1) & mask;
+    a->index[i] = n + 1;
+}
+
+static void index_rebuild(struct bitmap_atlas *a)
+{
+    int size = 64;
+    while (size < a->num_entries * 2)
+        size *= 2;
+    if (size != a->index_size) {
+        a->index = talloc_realloc(a, a->index, int, size);
+        a->index_size = size;
+    }
+    memset(a->index, 0, size * sizeof(a->index[0]));
+    for (int n = 0; n < a->num_entries; n++)
+        index_add(a, n);
+}
+
+static void shelf_release(struct bitmap_atlas *a, struct atlas_shelf *s,
+                          int x, int w)
+{
+    int i = 0;
+    while (i < s->num_free && s->free[i].x < x)
+        i++;
+    struct atlas_seg *prev = i > 0 ? &s->free[i - 1] : NULL;
+    struct atlas_seg *next = i < s->num_free ? &s->free[i] : NULL;
+    bool join_prev = prev && prev->x + prev->w == x;
+    bool join_next = next && x + w == next->x;
+    if (join_prev && join_next) {
+        prev->w += w + next->w;
+        memmove(next, next + 1, (s->num_free - i - 1) * sizeof(*next));
+        s->num_free--;
+    } else if (join_prev) {
+        prev->w += w;
+    } else if (join_next) {
+        next->x = x;
+        next->w += w;
+    } else {
+        if (!s->free || s->num_free == MP_TALLOC_ELEMS(s->free))
+            MP_RESIZE_ARRAY(a, s->free, FFMAX(s->num_free * 2, 4));
+        memmove(s->free + i + 1, s->free + i,
+                (s->num_free - i) * sizeof(*s->free));
+        s->free[i] = (struct atlas_seg){x, w};
+        s->num_free++;
+    }
+}
+
+static int shelves_bottom(struct bitmap_atlas *a)
+{
+    if (!a->num_shelves)
+        return 0;
+    struct atlas_shelf *s = &a->shelves[a->num_shelves - 1];
+    return s->y + s->h;
+}
+
+static void clear_shelves(struct bitmap_atlas *a)
+{
+    for (int n = 0; n < a->num_entries; n++)
+        talloc_free(a->entries[n].bitmap);
+    for (int n = 0; n < a->num_shelves; n++)
+        talloc_free(a->shelves[n].free);
+    a->num_shelves = 0;
+    a->num_entries = 0;
+    index_rebuild(a);
+}
+
+/* Prefer the free segment on the shelf that wastes the least height. While
+ * there is room below the last shelf, only shelves at most about 1/4 taller
+ * than the bitmap are considered, and a new shelf is opened otherwise.
+ */
+static bool atlas_place(struct bitmap_atlas *a, struct atlas_item *it)
+{
+    int w = it->w, h = it->h;
+    if (w > a->w || h > a->h)
+        return false;
+    int bottom = shelves_bottom(a);
+    bool can_open = bottom + h <= a->h;
+    int best = -1, best_seg = 0, best_waste = INT_MAX;
+    for (int n = 0; n < a->num_shelves; n++) {
+        struct atlas_shelf *s = &a->shelves[n];
+        int waste = s->h - h;
+        if (waste < 0 || waste >= best_waste)
+            continue;
+        if (can_open && waste > h / 4 + SHELF_ALIGN)
+            continue;
+        for (int i = 0; i < s->num_free; i++) {
+            if (s->free[i].w >= w) {
+                best = n;
+                best_seg = i;
+                best_waste = waste;
+                break;
+            }
+        }
+    }
+    if (best < 0) {
+        if (!can_open)
+            return false;
+        if (!a->shelves || a->num_shelves == MP_TALLOC_ELEMS(a->shelves))
+            MP_RESIZE_ARRAY(a, a->shelves, FFMAX(a->num_shelves * 2, 16));
+        struct atlas_shelf *s = &a->shelves[a->num_shelves];
+        *s = (struct atlas_shelf){
+            .y = bottom,
+            .h = FFMIN(FFALIGN(h, SHELF_ALIGN), a->h - bottom),
+        };
+        shelf_release(a, s, 0, a->w);
+        best = a->num_shelves++;
+    }
+
+    struct atlas_shelf *s = &a->shelves[best];
+    struct atlas_seg *seg = &s->free[best_seg];
+    if (!a->entries || a->num_entries == MP_TALLOC_ELEMS(a->entries))
+        MP_RESIZE_ARRAY(a, a->entries, FFMAX(a->num_entries * 2, 64));
+    unsigned char *copy = talloc_size(a, w * h);
+    for (int y = 0; y < h; y++)
+        memcpy(copy + y * w, it->bitmap + y * it->stride, w);
+    a->entries[a->num_entries] = (struct atlas_entry){
+        .hash = it->hash, .bitmap = copy, .w = w, .h = h,
+        .x = seg->x, .y = s->y, .shelf = best,
+        .last_used = a->frame, .dirty = true,
+    };
+    seg->x += w;
+    seg->w -= w;
+    if (!seg->w) {
+        memmove(seg, seg + 1, (s->num_free - best_seg - 1) * sizeof(*seg));
+        s->num_free--;
+    }
+    if (++a->num_entries * 2 > a->index_size)
+        index_rebuild(a);
+    else
+        index_add(a, a->num_entries - 1);
+    return true;
+}
+
+// Drop the bitmaps not used in the current frame.
+static void atlas_evict(struct bitmap_atlas *a)
+{
+    int n = 0;
+    for (int i = 0; i < a->num_entries; i++) {
+        struct atlas_entry *e = &a->entries[i];
+        if (e->last_used == a->frame) {
+            a->entries[n++] = *e;
+        } else {
+            shelf_release(a, &a->shelves[e->shelf], e->x, e->w);
+            talloc_free(e->bitmap);
+        }
+    }
+    a->num_entries = n;
+    while (a->num_shelves) {
+        struct atlas_shelf *s = &a->shelves[a->num_shelves - 1];
+        if (s->num_free != 1 || s->free[0].w != a->w)
+            break;
+        talloc_free(s->free);
+        a->num_shelves--;
+    }
+    index_rebuild(a);
+}
+
+/* Make the atlas larger, keeping the existing placements (shelves are
+ * extended to the new width). The texture contents are lost when it is
+ * recreated, so everything has to be uploaded again.
+ */
+static bool atlas_grow(struct bitmap_atlas *a, int w, int h)
+{
+    int nw = FFMAX(a->w, ATLAS_MIN_SIZE), nh = FFMAX(a->h, ATLAS_MIN_SIZE);
+    while (nw < w)
+        nw *= 2;
+    while (nh < h)
+        nh *= 2;
+    if (nw == a->w && nh == a->h) {
+        if (nw <= nh && nw < a->w_max)
+            nw *= 2;
+        else if (nh < a->h_max)
+            nh *= 2;
+        else
+            nw *= 2;
+    }
+    nw = FFMIN(nw, a->w_max);
+    nh = FFMIN(nh, a->h_max);
+    if (nw < w || nh < h || (nw == a->w && nh == a->h))
+        return false;
+    for (int n = 0; n < a->num_shelves && nw > a->w; n++)
+        shelf_release(a, &a->shelves[n], a->w, nw - a->w);
+    for (int n = 0; n < a->num_entries; n++)
+        a->entries[n].dirty = true;
+    a->w = nw;
+    a->h = nh;
+    return true;
+}
+
+static bool atlas_insert(struct bitmap_atlas *a, struct atlas_item *it)
+{
+    if (atlas_place(a, it))
+        return true;
+    atlas_evict(a);
+    if (atlas_place(a, it))
+        return true;
+    while (atlas_grow(a, it->w, it->h)) {
+        if (atlas_place(a, it))
+            return true;
+    }
+    return false;
+}
+
+static int cmp_item_height(const void *pa, const void *pb)
+{
+    const struct atlas_item *a = pa, *b = pb;
+    return b->h - a->h;
+}
+
+// Start over with only the current bitmaps, tallest first.
+static bool atlas_relayout(struct bitmap_atlas *a, struct atlas_item *items,
+                           int count)
+{
+    struct atlas_item *sorted = talloc_memdup(NULL, items,
+                                              count * sizeof(items[0]));
+    qsort(sorted, count, sizeof(sorted[0]), cmp_item_height);
+    clear_shelves(a);
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        if (sorted[i].w && !atlas_find(a, &sorted[i]))
+            ok = atlas_insert(a, &sorted[i]);
+    }
+    talloc_free(sorted);
+    return ok;
+}
+
+int atlas_update_from_subbitmaps(struct bitmap_atlas *a, struct sub_bitmaps *b)
+{
+    int w_orig = a->w, h_orig = a->h;
+    a->count = 0;
+    a->num_dirty = 0;
+    if (b->type != SUBBITMAP_LIBASS)
+        return 0;
+    a->frame++;
+
+    int count = 0;
+    for (struct ass_image *img = b->imgs; img; img = img->next)
+        count++;
+    if (count > a->asize) {
+        a->asize = FFMAX(a->asize * 2, count);
+        a->result = talloc_realloc(a, a->result, struct pos, a->asize);
+        a->dirty = talloc_realloc(a, a->dirty, int, a->asize);
+    }
+    struct atlas_item *items = talloc_array(NULL, struct atlas_item, count);
+    struct ass_image *img = b->imgs;
+    for (int i = 0; i < count; i++, img = img->next) {
+        items[i] = (struct atlas_item){0};
+        if (img->w <= 0 || img->h <= 0)
+            continue;
+        if (img->w > 65535 || img->h > 65535) {
+            mp_msg(MSGT_VO, MSGL_FATAL, "Invalid OSD / subtitle bitmap size\n");
+            abort();
+        }
+        items[i] = (struct atlas_item){
+            hash_bitmap(img->bitmap, img->w, img->h, img->stride),
+            img->w, img->h, img->bitmap, img->stride,
+        };
+    }
+
+    // mark everything still in use first so that it won't be evicted
+    for (int i = 0; i < count; i++) {
+        struct atlas_entry *e = items[i].w ? atlas_find(a, &items[i]) : NULL;
+        if (e)
+            e->last_used = a->frame;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!items[i].w || atlas_find(a, &items[i]))
+            continue;
+        if (!atlas_insert(a, &items[i])) {
+            if (!atlas_relayout(a, items, count)) {
+                clear_shelves(a);
+                a->w = w_orig;
+                a->h = h_orig;
+                talloc_free(items);
+                return -1;
+            }
+            break;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        a->result[i] = (struct pos){0, 0};
+        if (!items[i].w)
+            continue;
+        struct atlas_entry *e = atlas_find(a, &items[i]);
+        a->result[i] = (struct pos){e->x, e->y};
+        if (e->dirty)
+            a->dirty[a->num_dirty++] = i;
+        e->dirty = false;
+    }
+    a->count = count;
+    talloc_free(items);
+    return a->w != w_orig || a->h != h_orig;
+}
+
+void atlas_reset(struct bitmap_atlas *a)
+{
+    clear_shelves(a);
+    a->w = a->h = 0;
+    a->count = 0;
+    a->num_dirty = 0;
+}
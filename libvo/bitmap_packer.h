@@ -1,6 +1,9 @@
 #ifndef MPLAYER_PACK_RECTANGLES_H
 #define MPLAYER_PACK_RECTANGLES_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 struct pos {
     int x;
     int y;
@@ -48,4 +51,44 @@ int packer_pack(struct bitmap_packer *packer);
 int packer_pack_from_subbitmaps(struct bitmap_packer *packer,
                                 struct sub_bitmaps *b, int padding_pixels);
 
+/* Incremental packer for libass bitmaps. Bitmaps are identified by their
+ * contents, and a bitmap that was already in the atlas keeps its place, so
+ * between frames only new bitmaps have to be uploaded. Space is allocated
+ * in shelves (rows of fixed height); bitmaps not used in the current frame
+ * are kept until their space is needed.
+ */
+struct bitmap_atlas {
+    int w;
+    int h;
+    int w_max;
+    int h_max;
+    int count;
+    struct pos *result;
+    // indices into result whose bitmaps must be uploaded, ascending
+    int *dirty;
+    int num_dirty;
+
+    // internal
+    struct atlas_entry *entries;
+    int num_entries;
+    struct atlas_shelf *shelves;
+    int num_shelves;
+    int *index;
+    int index_size;
+    int asize;
+    unsigned int frame;
+};
+
+/* Set atlas->count and atlas->result from the image list (positions of
+ * zero-size images are undefined) and atlas->dirty to the images that are
+ * not in the atlas texture yet. Return -1 if the images don't fit in
+ * w_max * h_max, 1 if w or h changed (the texture must be recreated and
+ * all images are dirty), and 0 otherwise.
+ */
+int atlas_update_from_subbitmaps(struct bitmap_atlas *atlas,
+                                 struct sub_bitmaps *b);
+
+// Forget all placements and set the size to 0, e.g. when the texture is lost.
+void atlas_reset(struct bitmap_atlas *atlas);
+
 #endif
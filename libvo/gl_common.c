@@ -352,6 +352,14 @@ static const extfunc_desc_t extfuncs[] = {
                  ("glUnmapBuffer", "glUnmapBufferARB")),
     DEF_EXT_DESC(BufferData, NULL,
                  ("glBufferData", "glBufferDataARB")),
+    DEF_EXT_DESC(MapBufferRange, "_map_buffer_range",
+                 ("glMapBufferRange")),
+    DEF_EXT_DESC(FenceSync, "_sync",
+                 ("glFenceSync")),
+    DEF_EXT_DESC(ClientWaitSync, "_sync",
+                 ("glClientWaitSync")),
+    DEF_EXT_DESC(DeleteSync, "_sync",
+                 ("glDeleteSync")),
     DEF_EXT_DESC(ActiveTexture, NULL,
                  ("glActiveTexture", "glActiveTextureARB")),
     DEF_EXT_DESC(BindTexture, NULL,
@@ -397,6 +405,7 @@ static const extfunc_desc_t extfuncs[] = {
     DEF_GL3_DESC(MapBuffer),
     DEF_GL3_DESC(UnmapBuffer),
     DEF_GL3_DESC(BufferData),
+    DEF_GL3_DESC(MapBufferRange),
     DEF_GL3_DESC(ActiveTexture),
     DEF_GL3_DESC(BindTexture),
     DEF_GL3_DESC(GenVertexArrays),
@@ -430,6 +439,7 @@ static const extfunc_desc_t extfuncs[] = {
     DEF_GL3_DESC(Uniform1f),
     DEF_GL3_DESC(Uniform3f),
     DEF_GL3_DESC(Uniform1i),
+    DEF_GL3_DESC(Uniform2i),
     DEF_GL3_DESC(UniformMatrix3fv),
     DEF_GL3_DESC(UniformMatrix4x3fv),
 
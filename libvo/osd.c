@@ -25,6 +25,7 @@
 #include "mp_msg.h"
 #include <inttypes.h>
 #include "cpudetect.h"
+#include "ffmpeg_files/x86_cpu.h"
 
 #if ARCH_X86
 static const uint64_t bFF __attribute__((aligned(8))) = 0xFFFFFFFFFFFFFFFFULL;
@@ -130,7 +131,498 @@ static const unsigned long long mask24hl  __attribute__((aligned(8))) = 0x0000FF
 
 #endif /* ARCH_X86 */
 
+#if HAVE_SSE2
+/* SSE2/SSSE3/AVX2 blenders. Unlike the MMX ones above they give exactly the
+ * result of the C versions: pixels with srca 0 stay untouched, all others
+ * become ((dst * srca) >> 8) + src. Each row is handled in whole vectors
+ * and the remaining pixels in C, so nothing is read past w. */
+
+#define XMM_CLOBBERS "xmm0", "xmm1", "xmm2", "xmm3", \
+                     "xmm4", "xmm5", "xmm6", "xmm7"
+
+static const uint16_t __attribute__((aligned(32))) w00ff[16] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+static const uint16_t __attribute__((aligned(32))) w0080[16] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+static const uint32_t __attribute__((aligned(16))) rgb32_mask[4] = {
+    0x00ffffff, 0x00ffffff, 0x00ffffff, 0x00ffffff,
+};
+
+// in: xmm0 dst, xmm2 srca, xmm4 src, xmm6 (srca == 0), xmm7 zero
+// out: xmm5 blended bytes
+#define BLEND16_SSE2 \
+    "movdqa    %%xmm0, %%xmm5 \n\t" \
+    "movdqa    %%xmm0, %%xmm1 \n\t" \
+    "punpcklbw %%xmm7, %%xmm0 \n\t" \
+    "punpckhbw %%xmm7, %%xmm1 \n\t" \
+    "movdqa    %%xmm2, %%xmm3 \n\t" \
+    "punpcklbw %%xmm7, %%xmm2 \n\t" \
+    "punpckhbw %%xmm7, %%xmm3 \n\t" \
+    "pmullw    %%xmm2, %%xmm0 \n\t" \
+    "pmullw    %%xmm3, %%xmm1 \n\t" \
+    "psrlw        $8, %%xmm0 \n\t" \
+    "psrlw        $8, %%xmm1 \n\t" \
+    "packuswb  %%xmm1, %%xmm0 \n\t" \
+    "paddb     %%xmm4, %%xmm0 \n\t" \
+    "pand      %%xmm6, %%xmm5 \n\t" \
+    "pandn     %%xmm0, %%xmm6 \n\t" \
+    "por       %%xmm6, %%xmm5 \n\t"
+
+static void vo_draw_alpha_yv12_SSE2(int w, int h, unsigned char *src,
+                                    unsigned char *srca, int srcstride,
+                                    unsigned char *dstbase, int dststride)
+{
+    int n = w & ~15;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "pxor      %%xmm7, %%xmm7 \n\t"
+            "1: \n\t"
+            "movdqu  (%[a],%[x]), %%xmm2 \n\t"
+            "movdqa    %%xmm2, %%xmm6 \n\t"
+            "pcmpeqb   %%xmm7, %%xmm6 \n\t"
+            "pmovmskb  %%xmm6, %k[t] \n\t"
+            "cmp      $0xffff, %k[t] \n\t"
+            "je 2f \n\t"
+            "movdqu  (%[d],%[x]), %%xmm0 \n\t"
+            "movdqu  (%[s],%[x]), %%xmm4 \n\t"
+            BLEND16_SSE2
+            "movdqu    %%xmm5, (%[d],%[x]) \n\t"
+            "2: \n\t"
+            "add         $16, %[x] \n\t"
+            "jl 1b \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + n)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++)
+            if (srca[i])
+                dstbase[i] = ((dstbase[i] * srca[i]) >> 8) + src[i];
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+static void vo_draw_alpha_yuy2_SSE2(int w, int h, unsigned char *src,
+                                    unsigned char *srca, int srcstride,
+                                    unsigned char *dstbase, int dststride)
+{
+    int n = w & ~7;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "pxor      %%xmm7, %%xmm7 \n\t"
+            "1: \n\t"
+            "movq    (%[a],%[x]), %%xmm2 \n\t"
+            "punpcklbw %%xmm7, %%xmm2 \n\t"
+            "movdqa    %%xmm2, %%xmm6 \n\t"
+            "pcmpeqw   %%xmm7, %%xmm6 \n\t"
+            "pmovmskb  %%xmm6, %k[t] \n\t"
+            "cmp      $0xffff, %k[t] \n\t"
+            "je 2f \n\t"
+            "movq    (%[s],%[x]), %%xmm4 \n\t"
+            "punpcklbw %%xmm7, %%xmm4 \n\t"
+            "movdqu  (%[d],%[x],2), %%xmm0 \n\t"
+            "movdqa    %%xmm0, %%xmm5 \n\t"
+            "movdqa    %%xmm0, %%xmm1 \n\t"
+            "pand      %[lo], %%xmm0 \n\t"      // Y
+            "psrlw        $8, %%xmm1 \n\t"      // U/V
+            "pmullw    %%xmm2, %%xmm0 \n\t"
+            "psrlw        $8, %%xmm0 \n\t"
+            "paddw     %%xmm4, %%xmm0 \n\t"
+            "pand      %[lo], %%xmm0 \n\t"
+            "psubw     %[c], %%xmm1 \n\t"
+            "pmullw    %%xmm2, %%xmm1 \n\t"
+            "psraw        $8, %%xmm1 \n\t"
+            "paddw     %[c], %%xmm1 \n\t"
+            "psllw        $8, %%xmm1 \n\t"
+            "por       %%xmm1, %%xmm0 \n\t"
+            "pand      %%xmm6, %%xmm5 \n\t"
+            "pandn     %%xmm0, %%xmm6 \n\t"
+            "por       %%xmm6, %%xmm5 \n\t"
+            "movdqu    %%xmm5, (%[d],%[x],2) \n\t"
+            "2: \n\t"
+            "add          $8, %[x] \n\t"
+            "jl 1b \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + 2 * n),
+             [lo]"m"(*w00ff), [c]"m"(*w0080)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++) {
+            if (srca[i]) {
+                dstbase[2*i] = ((dstbase[2*i] * srca[i]) >> 8) + src[i];
+                dstbase[2*i+1] = ((((signed)dstbase[2*i+1] - 128) * srca[i]) >> 8) + 128;
+            }
+        }
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+static void vo_draw_alpha_rgb32_SSE2(int w, int h, unsigned char *src,
+                                     unsigned char *srca, int srcstride,
+                                     unsigned char *dstbase, int dststride)
+{
+    int n = w & ~3;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "pxor      %%xmm7, %%xmm7 \n\t"
+            "1: \n\t"
+            "mov     (%[a],%[x]), %k[t] \n\t"
+            "test     %k[t], %k[t] \n\t"
+            "jz 2f \n\t"
+            "movd     %k[t], %%xmm2 \n\t"
+            "punpcklbw %%xmm2, %%xmm2 \n\t"
+            "punpcklwd %%xmm2, %%xmm2 \n\t"     // each alpha 4 times
+            "pand      %[m], %%xmm2 \n\t"       // but not for the 4th byte
+            "movd    (%[s],%[x]), %%xmm4 \n\t"
+            "punpcklbw %%xmm4, %%xmm4 \n\t"
+            "punpcklwd %%xmm4, %%xmm4 \n\t"
+            "movdqa    %%xmm2, %%xmm6 \n\t"
+            "pcmpeqb   %%xmm7, %%xmm6 \n\t"
+            "movdqu  (%[d],%[x],4), %%xmm0 \n\t"
+            BLEND16_SSE2
+            "movdqu    %%xmm5, (%[d],%[x],4) \n\t"
+            "2: \n\t"
+            "add          $4, %[x] \n\t"
+            "jl 1b \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + 4 * n),
+             [m]"m"(*rgb32_mask)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++) {
+            if (srca[i]) {
+                dstbase[4*i+0] = ((dstbase[4*i+0] * srca[i]) >> 8) + src[i];
+                dstbase[4*i+1] = ((dstbase[4*i+1] * srca[i]) >> 8) + src[i];
+                dstbase[4*i+2] = ((dstbase[4*i+2] * srca[i]) >> 8) + src[i];
+            }
+        }
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+static void draw_alpha_rgb24_tail(int n, int w, unsigned char *src,
+                                  unsigned char *srca, unsigned char *dst)
+{
+    for (int i = n; i < w; i++) {
+        if (srca[i]) {
+            dst[3*i+0] = ((dst[3*i+0] * srca[i]) >> 8) + src[i];
+            dst[3*i+1] = ((dst[3*i+1] * srca[i]) >> 8) + src[i];
+            dst[3*i+2] = ((dst[3*i+2] * srca[i]) >> 8) + src[i];
+        }
+    }
+}
+
+#if HAVE_SSSE3
+// pixel index for each byte of three consecutive 16 byte blocks of RGB24
+static const uint8_t __attribute__((aligned(16))) rgb24_shuf[3][16] = {
+    {  0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5 },
+    {  5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10 },
+    { 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15 },
+};
+
+#define RGB24_BLOCK_SSSE3(k) \
+    "movdqu     (%[a],%[x]), %%xmm2 \n\t" \
+    "movdqu     (%[s],%[x]), %%xmm4 \n\t" \
+    "pshufb    %[m" #k "], %%xmm2 \n\t" \
+    "pshufb    %[m" #k "], %%xmm4 \n\t" \
+    "movdqa    %%xmm2, %%xmm6 \n\t" \
+    "pcmpeqb   %%xmm7, %%xmm6 \n\t" \
+    "movdqu  " #k "*16(%[d]), %%xmm0 \n\t" \
+    BLEND16_SSE2 \
+    "movdqu    %%xmm5, " #k "*16(%[d]) \n\t"
+
+// SSE2 has no byte shuffle to spread the alpha over 3 bytes
+static void vo_draw_alpha_rgb24_SSSE3(int w, int h, unsigned char *src,
+                                      unsigned char *srca, int srcstride,
+                                      unsigned char *dstbase, int dststride)
+{
+    int n = w & ~15;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        unsigned char *d = dstbase;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "pxor      %%xmm7, %%xmm7 \n\t"
+            "1: \n\t"
+            "movdqu  (%[a],%[x]), %%xmm2 \n\t"
+            "pcmpeqb   %%xmm7, %%xmm2 \n\t"
+            "pmovmskb  %%xmm2, %k[t] \n\t"
+            "cmp      $0xffff, %k[t] \n\t"
+            "je 2f \n\t"
+            RGB24_BLOCK_SSSE3(0)
+            RGB24_BLOCK_SSSE3(1)
+            RGB24_BLOCK_SSSE3(2)
+            "2: \n\t"
+            "add         $48, %[d] \n\t"
+            "add         $16, %[x] \n\t"
+            "jl 1b \n\t"
+            :[x]"+&r"(x), [d]"+&r"(d), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n),
+             [m0]"m"(*rgb24_shuf[0]), [m1]"m"(*rgb24_shuf[1]),
+             [m2]"m"(*rgb24_shuf[2])
+            :"memory", XMM_CLOBBERS
+        );
+        draw_alpha_rgb24_tail(n, w, src, srca, dstbase);
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+#endif /* HAVE_SSSE3 */
+
+#if HAVE_AVX2
+// in: ymm0 dst, ymm2 srca, ymm4 src, ymm6 (srca == 0), ymm7 zero
+// out: ymm0 blended bytes
+#define BLEND32_AVX2 \
+    "vpunpcklbw %%ymm7, %%ymm0, %%ymm1 \n\t" \
+    "vpunpckhbw %%ymm7, %%ymm0, %%ymm3 \n\t" \
+    "vpunpcklbw %%ymm7, %%ymm2, %%ymm5 \n\t" \
+    "vpunpckhbw %%ymm7, %%ymm2, %%ymm2 \n\t" \
+    "vpmullw    %%ymm5, %%ymm1, %%ymm1 \n\t" \
+    "vpmullw    %%ymm2, %%ymm3, %%ymm3 \n\t" \
+    "vpsrlw        $8, %%ymm1, %%ymm1 \n\t" \
+    "vpsrlw        $8, %%ymm3, %%ymm3 \n\t" \
+    "vpackuswb  %%ymm3, %%ymm1, %%ymm1 \n\t" \
+    "vpaddb     %%ymm4, %%ymm1, %%ymm1 \n\t" \
+    "vpblendvb  %%ymm6, %%ymm0, %%ymm1, %%ymm0 \n\t"
+
+static void vo_draw_alpha_yv12_AVX2(int w, int h, unsigned char *src,
+                                    unsigned char *srca, int srcstride,
+                                    unsigned char *dstbase, int dststride)
+{
+    int n = w & ~31;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "vpxor      %%ymm7, %%ymm7, %%ymm7 \n\t"
+            "1: \n\t"
+            "vmovdqu  (%[a],%[x]), %%ymm2 \n\t"
+            "vpcmpeqb   %%ymm7, %%ymm2, %%ymm6 \n\t"
+            "vpmovmskb  %%ymm6, %k[t] \n\t"
+            "cmp          $-1, %k[t] \n\t"
+            "je 2f \n\t"
+            "vmovdqu  (%[d],%[x]), %%ymm0 \n\t"
+            "vmovdqu  (%[s],%[x]), %%ymm4 \n\t"
+            BLEND32_AVX2
+            "vmovdqu    %%ymm0, (%[d],%[x]) \n\t"
+            "2: \n\t"
+            "add          $32, %[x] \n\t"
+            "jl 1b \n\t"
+            "vzeroupper \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + n)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++)
+            if (srca[i])
+                dstbase[i] = ((dstbase[i] * srca[i]) >> 8) + src[i];
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+static void vo_draw_alpha_yuy2_AVX2(int w, int h, unsigned char *src,
+                                    unsigned char *srca, int srcstride,
+                                    unsigned char *dstbase, int dststride)
+{
+    int n = w & ~15;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "vpxor      %%ymm7, %%ymm7, %%ymm7 \n\t"
+            "vmovdqa    %[lo], %%ymm3 \n\t"
+            "1: \n\t"
+            "vpmovzxbw (%[a],%[x]), %%ymm2 \n\t"
+            "vpcmpeqw   %%ymm7, %%ymm2, %%ymm6 \n\t"
+            "vpmovmskb  %%ymm6, %k[t] \n\t"
+            "cmp          $-1, %k[t] \n\t"
+            "je 2f \n\t"
+            "vpmovzxbw (%[s],%[x]), %%ymm4 \n\t"
+            "vmovdqu  (%[d],%[x],2), %%ymm5 \n\t"
+            "vpand      %%ymm3, %%ymm5, %%ymm0 \n\t"    // Y
+            "vpsrlw        $8, %%ymm5, %%ymm1 \n\t"     // U/V
+            "vpmullw    %%ymm2, %%ymm0, %%ymm0 \n\t"
+            "vpsrlw        $8, %%ymm0, %%ymm0 \n\t"
+            "vpaddw     %%ymm4, %%ymm0, %%ymm0 \n\t"
+            "vpand      %%ymm3, %%ymm0, %%ymm0 \n\t"
+            "vpsubw     %[c], %%ymm1, %%ymm1 \n\t"
+            "vpmullw    %%ymm2, %%ymm1, %%ymm1 \n\t"
+            "vpsraw        $8, %%ymm1, %%ymm1 \n\t"
+            "vpaddw     %[c], %%ymm1, %%ymm1 \n\t"
+            "vpsllw        $8, %%ymm1, %%ymm1 \n\t"
+            "vpor       %%ymm1, %%ymm0, %%ymm0 \n\t"
+            "vpblendvb  %%ymm6, %%ymm5, %%ymm0, %%ymm0 \n\t"
+            "vmovdqu    %%ymm0, (%[d],%[x],2) \n\t"
+            "2: \n\t"
+            "add          $16, %[x] \n\t"
+            "jl 1b \n\t"
+            "vzeroupper \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + 2 * n),
+             [lo]"m"(*w00ff), [c]"m"(*w0080)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++) {
+            if (srca[i]) {
+                dstbase[2*i] = ((dstbase[2*i] * srca[i]) >> 8) + src[i];
+                dstbase[2*i+1] = ((((signed)dstbase[2*i+1] - 128) * srca[i]) >> 8) + 128;
+            }
+        }
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+// lane 0 takes pixels 0-3, lane 1 pixels 4-7; 0x80 leaves the 4th byte alone
+static const uint8_t __attribute__((aligned(32))) rgb32_shuf_avx2[32] = {
+    0, 0, 0, 0x80, 1, 1, 1, 0x80, 2, 2, 2, 0x80, 3, 3, 3, 0x80,
+    4, 4, 4, 0x80, 5, 5, 5, 0x80, 6, 6, 6, 0x80, 7, 7, 7, 0x80,
+};
+
+static void vo_draw_alpha_rgb32_AVX2(int w, int h, unsigned char *src,
+                                     unsigned char *srca, int srcstride,
+                                     unsigned char *dstbase, int dststride)
+{
+    int n = w & ~7;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "vpxor      %%ymm7, %%ymm7, %%ymm7 \n\t"
+            "1: \n\t"
+            "vpbroadcastq (%[a],%[x]), %%ymm2 \n\t"
+            "vpshufb    %[m], %%ymm2, %%ymm2 \n\t"
+            "vpcmpeqb   %%ymm7, %%ymm2, %%ymm6 \n\t"
+            "vpmovmskb  %%ymm6, %k[t] \n\t"
+            "cmp          $-1, %k[t] \n\t"
+            "je 2f \n\t"
+            "vpbroadcastq (%[s],%[x]), %%ymm4 \n\t"
+            "vpshufb    %[m], %%ymm4, %%ymm4 \n\t"
+            "vmovdqu  (%[d],%[x],4), %%ymm0 \n\t"
+            BLEND32_AVX2
+            "vmovdqu    %%ymm0, (%[d],%[x],4) \n\t"
+            "2: \n\t"
+            "add           $8, %[x] \n\t"
+            "jl 1b \n\t"
+            "vzeroupper \n\t"
+            :[x]"+&r"(x), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n), [d]"r"(dstbase + 4 * n),
+             [m]"m"(*rgb32_shuf_avx2)
+            :"memory", XMM_CLOBBERS
+        );
+        for (int i = n; i < w; i++) {
+            if (srca[i]) {
+                dstbase[4*i+0] = ((dstbase[4*i+0] * srca[i]) >> 8) + src[i];
+                dstbase[4*i+1] = ((dstbase[4*i+1] * srca[i]) >> 8) + src[i];
+                dstbase[4*i+2] = ((dstbase[4*i+2] * srca[i]) >> 8) + src[i];
+            }
+        }
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+
+/* Three 32 byte blocks of RGB24 cover 32 pixels. Block k gets 16 pixels
+ * starting at 8 * k in both lanes, which vpshufb then spreads out. */
+static const uint8_t __attribute__((aligned(32))) rgb24_shuf_avx2[3][32] = {
+    {  0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5,
+       5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10 },
+    {  2,  3,  3,  3,  4,  4,  4,  5,  5,  5,  6,  6,  6,  7,  7,  7,
+       8,  8,  8,  9,  9,  9, 10, 10, 10, 11, 11, 11, 12, 12, 12, 13 },
+    {  5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10,
+      10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15 },
+};
+
+#define RGB24_BLOCK_AVX2(k) \
+    "vbroadcasti128 " #k "*8(%[a],%[x]), %%ymm2 \n\t" \
+    "vbroadcasti128 " #k "*8(%[s],%[x]), %%ymm4 \n\t" \
+    "vpshufb    %[m" #k "], %%ymm2, %%ymm2 \n\t" \
+    "vpshufb    %[m" #k "], %%ymm4, %%ymm4 \n\t" \
+    "vpcmpeqb   %%ymm7, %%ymm2, %%ymm6 \n\t" \
+    "vmovdqu  " #k "*32(%[d]), %%ymm0 \n\t" \
+    BLEND32_AVX2 \
+    "vmovdqu    %%ymm0, " #k "*32(%[d]) \n\t"
+
+static void vo_draw_alpha_rgb24_AVX2(int w, int h, unsigned char *src,
+                                     unsigned char *srca, int srcstride,
+                                     unsigned char *dstbase, int dststride)
+{
+    int n = w & ~31;
+    for (int y = 0; y < h; y++) {
+        x86_reg x = -n;
+        unsigned char *d = dstbase;
+        int t;
+        if (x)
+        __asm__ volatile(
+            "vpxor      %%ymm7, %%ymm7, %%ymm7 \n\t"
+            "1: \n\t"
+            "vpcmpeqb (%[a],%[x]), %%ymm7, %%ymm6 \n\t"
+            "vpmovmskb  %%ymm6, %k[t] \n\t"
+            "cmp          $-1, %k[t] \n\t"
+            "je 2f \n\t"
+            RGB24_BLOCK_AVX2(0)
+            RGB24_BLOCK_AVX2(1)
+            RGB24_BLOCK_AVX2(2)
+            "2: \n\t"
+            "add          $96, %[d] \n\t"
+            "add          $32, %[x] \n\t"
+            "jl 1b \n\t"
+            "vzeroupper \n\t"
+            :[x]"+&r"(x), [d]"+&r"(d), [t]"=&r"(t)
+            :[a]"r"(srca + n), [s]"r"(src + n),
+             [m0]"m"(*rgb24_shuf_avx2[0]), [m1]"m"(*rgb24_shuf_avx2[1]),
+             [m2]"m"(*rgb24_shuf_avx2[2])
+            :"memory", XMM_CLOBBERS
+        );
+        draw_alpha_rgb24_tail(n, w, src, srca, dstbase);
+        src += srcstride;
+        srca += srcstride;
+        dstbase += dststride;
+    }
+}
+#endif /* HAVE_AVX2 */
+#endif /* HAVE_SSE2 */
+
 void vo_draw_alpha_yv12(int w,int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase,int dststride){
+#if HAVE_SSE2 && HAVE_AVX2
+	if(gCpuCaps.hasAVX2){
+		vo_draw_alpha_yv12_AVX2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2){
+		vo_draw_alpha_yv12_SSE2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
 #if CONFIG_RUNTIME_CPUDETECT
 #if ARCH_X86
 	// ordered by speed / fastest first
@@ -161,6 +653,18 @@ void vo_draw_alpha_yv12(int w,int h, unsigned char* src, unsigned char *srca, in
 }
 
 void vo_draw_alpha_yuy2(int w,int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase,int dststride){
+#if HAVE_SSE2 && HAVE_AVX2
+	if(gCpuCaps.hasAVX2){
+		vo_draw_alpha_yuy2_AVX2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2){
+		vo_draw_alpha_yuy2_SSE2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
 #if CONFIG_RUNTIME_CPUDETECT
 #if ARCH_X86
 	// ordered by speed / fastest first
@@ -191,6 +695,18 @@ void vo_draw_alpha_yuy2(int w,int h, unsigned char* src, unsigned char *srca, in
 }
 
 void vo_draw_alpha_rgb24(int w,int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase,int dststride){
+#if HAVE_SSE2 && HAVE_AVX2
+	if(gCpuCaps.hasAVX2){
+		vo_draw_alpha_rgb24_AVX2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
+#if HAVE_SSE2 && HAVE_SSSE3
+	if(gCpuCaps.hasSSSE3){
+		vo_draw_alpha_rgb24_SSSE3(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
 #if CONFIG_RUNTIME_CPUDETECT
 #if ARCH_X86
 	// ordered by speed / fastest first
@@ -221,6 +737,18 @@ void vo_draw_alpha_rgb24(int w,int h, unsigned char* src, unsigned char *srca, i
 }
 
 void vo_draw_alpha_rgb32(int w,int h, unsigned char* src, unsigned char *srca, int srcstride, unsigned char* dstbase,int dststride){
+#if HAVE_SSE2 && HAVE_AVX2
+	if(gCpuCaps.hasAVX2){
+		vo_draw_alpha_rgb32_AVX2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
+#if HAVE_SSE2
+	if(gCpuCaps.hasSSE2){
+		vo_draw_alpha_rgb32_SSE2(w, h, src, srca, srcstride, dstbase, dststride);
+		return;
+	}
+#endif
 #if CONFIG_RUNTIME_CPUDETECT
 #if ARCH_X86
 	// ordered by speed / fastest first
@@ -254,6 +782,18 @@ void vo_draw_alpha_init(void){
 //FIXME the optimized stuff is a lie for 15/16bpp as they aren't optimized yet
 	if( mp_msg_test(MSGT_OSD,MSGL_V) )
 	{
+#if HAVE_SSE2 && HAVE_AVX2
+		if(gCpuCaps.hasAVX2){
+			mp_msg(MSGT_OSD,MSGL_INFO,"Using AVX2 Optimized OnScreenDisplay\n");
+			return;
+		}
+#endif
+#if HAVE_SSE2
+		if(gCpuCaps.hasSSE2){
+			mp_msg(MSGT_OSD,MSGL_INFO,"Using SSE2 Optimized OnScreenDisplay\n");
+			return;
+		}
+#endif
 #if CONFIG_RUNTIME_CPUDETECT
 #if ARCH_X86
 		// ordered per speed fasterst first
@@ -23,10 +23,13 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <math.h>
 
 #include <unistd.h>
 //#include <sys/mman.h>
 
+#include <libavutil/common.h>
+
 #include "config.h"
 #include "options.h"
 #include "talloc.h"
@@ -40,6 +43,7 @@
 #include "mp_msg.h"
 
 #include "osdep/shmem.h"
+#include "osdep/timer.h"
 #ifdef CONFIG_X11
 #include "x11_common.h"
 #endif
@@ -82,6 +86,7 @@ extern struct vo_driver video_out_gl;
 extern struct vo_driver video_out_gl3;
 extern struct vo_driver video_out_sdl;
 extern struct vo_driver video_out_null;
+extern struct vo_driver video_out_bench;
 extern struct vo_driver video_out_png;
 extern struct vo_driver video_out_caca;
 extern struct vo_driver video_out_yuv4mpeg;
@@ -137,6 +142,7 @@ const struct vo_driver *video_out_drivers[] =
 #endif
         &video_out_null,
         // should not be auto-selected
+        &video_out_bench,
 #ifdef CONFIG_DIRECTFB
         // vo directfb can call exit() if initialization fails
         &video_out_directfb,
@@ -192,6 +198,9 @@ static int vo_preinit(struct vo *vo, char *arg)
 
 int vo_control(struct vo *vo, uint32_t request, void *data)
 {
+    // vsyncs passing while paused are not duplicated frames
+    if (request == VOCTRL_RESUME)
+        vo->pacer.last_pts_us = 0;
     return vo->driver->control(vo, request, data);
 }
 
@@ -278,6 +287,95 @@ void vo_draw_osd(struct vo *vo, struct osd_state *osd)
     vo->driver->draw_osd(vo, osd);
 }
 
+/* Flip pacing for drivers without flip_page_timed. The player hands each
+ * frame over up to <ahead> display refreshes early (flip_queue_offset); it
+ * is drawn then (into the next image of the xv/x11 shm rings), and
+ * vo_flip_page() sleeps until its time before flipping. So one rendered
+ * frame waits at most; a deeper queue would need the playloop to decode
+ * further ahead. If the driver's flip returns at the vsync that shows the
+ * frame, the flips give the vsync phase and refine the interval, each flip
+ * is issued in the vsync interval before the wanted one, and frames that
+ * were never shown or stayed on screen too long are counted. Only gl3 can
+ * do that: the ShmCompletion events of xv/x11 say when the X server has
+ * read an image, not when it was shown.
+ */
+static void pacer_init(struct vo *vo)
+{
+    struct MPOpts *opts = vo->opts;
+    struct vo_pacer *q = &vo->pacer;
+    double fps = opts->vo_display_fps;
+
+    *q = (struct vo_pacer){ .ahead = opts->vo_pacing };
+    if (vo->driver->flip_page_timed)
+        q->ahead = 0;
+    if (!q->ahead)
+        return;
+#ifdef CONFIG_XF86VM
+    if (!fps && vo->x11)
+        fps = vo_vm_get_fps(vo);
+#endif
+    if (fps > 0) {
+        q->vsync_interval = 1 / fps;
+        mp_msg(MSGT_VO, MSGL_V, "[vo] Display refresh rate %.3f Hz.\n", fps);
+    } else {
+        mp_msg(MSGT_VO, MSGL_WARN, "[vo] Unknown display refresh rate, not "
+               "aligning frames to vsync. Use --display-fps.\n");
+    }
+    if (!vo->flip_waits_vsync)
+        mp_msg(MSGT_VO, MSGL_V, "[vo] Flips do not wait for vsync, only "
+               "sleeping until the frame times.\n");
+    vo->flip_queue_offset = q->ahead * (fps > 0 ? q->vsync_interval : 1 / 60.);
+}
+
+static void pacer_wait(struct vo *vo, unsigned int pts_us)
+{
+    struct vo_pacer *q = &vo->pacer;
+    unsigned int target = pts_us;
+
+    if (q->vsync_interval > 0 && vo->flip_waits_vsync && q->last_pts_us) {
+        double vi = q->vsync_interval * 1e6;
+        int64_t n = q->vsync_count + llrint((int)(pts_us - q->vsync_time) / vi);
+        n = FFMAX(n, q->last_vsync + 1);
+        target = q->vsync_time + (int)llrint((n - q->vsync_count - 0.75) * vi);
+    }
+    int wait = target - GetTimer();
+    if (wait > 0)
+        usec_sleep(wait);
+}
+
+static void pacer_update(struct vo *vo, unsigned int pts_us)
+{
+    struct vo_pacer *q = &vo->pacer;
+    unsigned int now = GetTimer();
+    double vi = q->vsync_interval * 1e6;
+
+    if (!(vi > 0) || !vo->flip_waits_vsync)
+        return;
+    if (!q->last_pts_us) {
+        q->vsync_time = now;
+        q->last_vsync = q->last_want = q->vsync_count;
+        q->last_pts_us = pts_us;
+        return;
+    }
+    int64_t want = q->vsync_count + llrint((int)(pts_us - q->vsync_time) / vi);
+    double d = (int)(now - q->vsync_time);
+    int64_t k = llrint(d / vi);
+    if (k >= 1 && k <= 8 && fabs(d - k * vi) < vi / 8)
+        q->vsync_interval += (d / k * 1e-6 - q->vsync_interval) / 32;
+    q->vsync_time = now;
+    q->vsync_count += k;
+
+    int64_t shown = q->vsync_count - q->last_vsync;
+    int64_t expected = FFMAX(want - q->last_want, 1);
+    if (shown == 0)
+        q->skipped++;
+    else if (shown > expected)
+        q->duplicated += shown - expected;
+    q->last_vsync = q->vsync_count;
+    q->last_want = want;
+    q->last_pts_us = pts_us;
+}
+
 void vo_flip_page(struct vo *vo, unsigned int pts_us, int duration)
 {
     if (!vo->config_ok)
@@ -290,9 +388,16 @@ void vo_flip_page(struct vo *vo, unsigned int pts_us, int duration)
     vo->redrawing = false;
     if (vo->driver->flip_page_timed)
         vo->driver->flip_page_timed(vo, pts_us, duration);
-    else
+    else {
+        if (vo->pacer.ahead && pts_us)
+            pacer_wait(vo, pts_us);
         vo->driver->flip_page(vo);
+        if (vo->pacer.ahead && pts_us)
+            pacer_update(vo, pts_us);
+    }
     vo->hasframe = true;
+    vo->decode_time_us = 0;
+    vo->filter_time_us = 0;
 }
 
 void vo_check_events(struct vo *vo)
@@ -311,6 +416,7 @@ void vo_seek_reset(struct vo *vo)
     vo_control(vo, VOCTRL_RESET, NULL);
     vo->frame_loaded = false;
     vo->hasframe = false;
+    vo->pacer.last_pts_us = 0;
 }
 
 void vo_destroy(struct vo *vo)
@@ -427,6 +533,8 @@ int vo_config(struct vo *vo, uint32_t width, uint32_t height,
                                  format);
     vo->config_ok = (ret == 0);
     vo->config_count += vo->config_ok;
+    if (vo->config_ok)
+        pacer_init(vo);
     if (vo->registered_fd == -1 && vo->event_fd != -1 && vo->config_ok) {
         mp_input_add_key_fd(vo->input_ctx, vo->event_fd, 1, event_fd_callback,
                             NULL, vo);
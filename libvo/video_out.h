@@ -255,6 +255,27 @@ struct vo {
     bool hasframe;      // >= 1 frame has been drawn, so redraw is possible
 
     double flip_queue_offset; // queue flip events at most this much in advance
+    bool flip_waits_vsync;    // flip_page() returns at the vsync showing it
+
+    // Set by the player for -vo bench: microseconds spent in the decoder
+    // since the last flip, and in the filters for the frame being drawn.
+    unsigned int decode_time_us;
+    unsigned int filter_time_us;
+
+    // Flip timing done by the VO layer for drivers without flip_page_timed
+    // (see vo_flip_page()). Times are GetTimer() values. The vsync grid and
+    // the counters are only kept if flip_waits_vsync is set.
+    struct vo_pacer {
+        int ahead;                // refreshes frames are passed early, 0 = off
+        double vsync_interval;    // in seconds, 0 if unknown
+        unsigned int vsync_time;  // a vsync on the grid...
+        int64_t vsync_count;      // ...and its number
+        int64_t last_vsync;       // vsync the previous frame went to
+        int64_t last_want;        // vsync the previous frame was meant for
+        unsigned int last_pts_us; // target time of the previous frame, or 0
+        int skipped;              // frames replaced before being shown
+        int duplicated;           // vsyncs frames stayed on screen too long
+    } pacer;
 
     const struct vo_driver *driver;
     void *priv;
@@ -0,0 +1,287 @@
+/*
+ * Video output that discards frames and reports pipeline timing
+ *
+ * This file is part of mplayer2.
+ *
+ * mplayer2 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * mplayer2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with mplayer2; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* For every shown frame the time spent in each stage is recorded:
+ *   decode  decoder calls since the previous frame (including dropped ones)
+ *   filter  the filter chain for this frame
+ *   draw    draw_image() here, the copy with copy=yes; the player calls
+ *           it after the filters, when the frame is about to be shown
+ *   flip    from the end of draw to flip_page(): OSD, subtitles and the
+ *           player's A/V sync wait (none with -benchmark)
+ *   total   the sum of the above
+ * and the interval between flips. The summary is printed at exit as
+ * BENCH_* key=value lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include <libavutil/common.h>
+
+#include "config.h"
+#include "talloc.h"
+#include "mp_msg.h"
+#include "mpcommon.h"
+#include "subopt-helper.h"
+#include "video_out.h"
+#include "libmpcodecs/vfcap.h"
+#include "libmpcodecs/mp_image.h"
+#include "libmpcodecs/img_format.h"
+#include "osdep/timer.h"
+
+enum {
+    STAGE_DECODE,
+    STAGE_FILTER,
+    STAGE_DRAW,
+    STAGE_FLIP,
+    STAGE_TOTAL,
+    STAGE_INTERVAL,
+    NUM_STAGES
+};
+
+static const char *const stage_names[NUM_STAGES] = {
+    "DECODE", "FILTER", "DRAW", "FLIP", "TOTAL", "INTERVAL",
+};
+
+struct frame_times {
+    unsigned int us[NUM_STAGES];
+};
+
+struct priv {
+    int copy;
+    char *log_name;
+    FILE *log;
+
+    mp_image_t *image;          // destination of copy=yes
+    struct frame_times cur;
+    bool have_frame;
+    unsigned int draw_end;
+    unsigned int first_flip, last_flip;
+
+    struct frame_times *frames;
+    int num_frames;
+};
+
+static int query_format(uint32_t format)
+{
+    if (IMGFMT_IS_HWACCEL(format))
+        return 0;
+    // whole frames only, so that the draw is timed in one call
+    return VFCAP_CSP_SUPPORTED | VFCAP_ACCEPT_STRIDE | VOCAP_NOSLICES;
+}
+
+static int config(struct vo *vo, uint32_t width, uint32_t height,
+                  uint32_t d_width, uint32_t d_height, uint32_t flags,
+                  uint32_t format)
+{
+    struct priv *p = vo->priv;
+
+    if (p->image)
+        free_mp_image(p->image);
+    p->image = NULL;
+    if (p->copy)
+        p->image = alloc_mpi(width, height, format);
+    p->have_frame = false;
+    return 0;
+}
+
+static uint32_t draw_image(struct vo *vo, mp_image_t *mpi)
+{
+    struct priv *p = vo->priv;
+    unsigned int t = GetTimer();
+
+    if (!p->have_frame)
+        p->cur = (struct frame_times){{0}};
+    p->have_frame = true;
+    if (p->image && !(mpi->flags & MP_IMGFLAG_DRAW_CALLBACK))
+        copy_mpi(p->image, mpi);
+    p->draw_end = GetTimer();
+    p->cur.us[STAGE_DRAW] += p->draw_end - t;
+    return VO_TRUE;
+}
+
+static void draw_osd(struct vo *vo, struct osd_state *osd)
+{
+}
+
+static void flip_page(struct vo *vo)
+{
+    struct priv *p = vo->priv;
+    unsigned int now = GetTimer();
+
+    // redraws of a paused frame are not counted
+    if (!p->have_frame)
+        return;
+    p->have_frame = false;
+
+    struct frame_times *f = &p->cur;
+    f->us[STAGE_DECODE] = vo->decode_time_us;
+    f->us[STAGE_FILTER] = vo->filter_time_us;
+    f->us[STAGE_FLIP] = now - p->draw_end;
+    for (int n = 0; n < STAGE_TOTAL; n++)
+        f->us[STAGE_TOTAL] += f->us[n];
+    f->us[STAGE_INTERVAL] = p->num_frames ? now - p->last_flip : 0;
+    if (!p->num_frames)
+        p->first_flip = now;
+    p->last_flip = now;
+
+    if (p->log) {
+        fprintf(p->log, "%d", p->num_frames);
+        for (int n = 0; n < NUM_STAGES; n++)
+            fprintf(p->log, ",%u", f->us[n]);
+        fprintf(p->log, "\n");
+    }
+    if (!p->frames || p->num_frames == MP_TALLOC_ELEMS(p->frames))
+        MP_RESIZE_ARRAY(p, p->frames, FFMAX(p->num_frames * 2, 1024));
+    p->frames[p->num_frames++] = *f;
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+    unsigned int ua = *(const unsigned int *)a, ub = *(const unsigned int *)b;
+    return ua < ub ? -1 : ua > ub;
+}
+
+static void print_stats(struct vo *vo)
+{
+    struct priv *p = vo->priv;
+    int n = p->num_frames;
+    double seconds = (p->last_flip - p->first_flip) * 1e-6;
+
+    mp_msg(MSGT_VO, MSGL_INFO, "BENCH_FRAMES=%d\n", n);
+    mp_msg(MSGT_VO, MSGL_INFO, "BENCH_SECONDS=%.6f\n", seconds);
+    mp_msg(MSGT_VO, MSGL_INFO, "BENCH_FPS=%.3f\n",
+           seconds > 0 ? (n - 1) / seconds : 0);
+    if (!n)
+        return;
+
+    unsigned int *v = talloc_array(NULL, unsigned int, n);
+    for (int s = 0; s < NUM_STAGES; s++) {
+        // the first frame has no interval
+        int first = s == STAGE_INTERVAL;
+        int count = n - first;
+        if (!count)
+            continue;
+        double sum = 0;
+        for (int i = 0; i < count; i++) {
+            v[i] = p->frames[i + first].us[s];
+            sum += v[i];
+        }
+        qsort(v, count, sizeof(v[0]), cmp_uint);
+        int p99 = (count * 99 + 99) / 100 - 1;
+        mp_msg(MSGT_VO, MSGL_INFO, "BENCH_%s_MIN_MS=%.3f\n",
+               stage_names[s], v[0] / 1e3);
+        mp_msg(MSGT_VO, MSGL_INFO, "BENCH_%s_MEAN_MS=%.3f\n",
+               stage_names[s], sum / count / 1e3);
+        mp_msg(MSGT_VO, MSGL_INFO, "BENCH_%s_P99_MS=%.3f\n",
+               stage_names[s], v[p99] / 1e3);
+        mp_msg(MSGT_VO, MSGL_INFO, "BENCH_%s_MAX_MS=%.3f\n",
+               stage_names[s], v[count - 1] / 1e3);
+    }
+    talloc_free(v);
+}
+
+static void uninit(struct vo *vo)
+{
+    struct priv *p = vo->priv;
+
+    print_stats(vo);
+    if (p->log)
+        fclose(p->log);
+    if (p->image)
+        free_mp_image(p->image);
+    free(p->log_name);
+}
+
+static void check_events(struct vo *vo)
+{
+}
+
+static int preinit(struct vo *vo, const char *arg)
+{
+    struct priv *p = talloc_zero(vo, struct priv);
+    vo->priv = p;
+
+    const opt_t subopts[] = {
+        {"copy", OPT_ARG_BOOL,  &p->copy,     NULL},
+        {"log",  OPT_ARG_MSTRZ, &p->log_name, NULL},
+        {NULL}
+    };
+    if (subopt_parse(arg, subopts) != 0) {
+        mp_msg(MSGT_VO, MSGL_FATAL,
+               "\n-vo bench command line help:\n"
+               "Example: mplayer -benchmark -vo bench:copy:log=frames.csv\n"
+               "\nOptions:\n"
+               "  copy\n"
+               "    Copy each frame into a buffer, like a VO upload.\n"
+               "  log=<filename>\n"
+               "    Write the times of every frame as CSV.\n"
+               "\n");
+        return -1;
+    }
+    if (p->log_name) {
+        p->log = fopen(p->log_name, "w");
+        if (!p->log) {
+            mp_msg(MSGT_VO, MSGL_ERR, "[vo_bench] Cannot open %s\n",
+                   p->log_name);
+            return -1;
+        }
+        fprintf(p->log, "frame");
+        for (int n = 0; n < NUM_STAGES; n++) {
+            fprintf(p->log, ",");
+            for (const char *c = stage_names[n]; *c; c++)
+                fputc(tolower(*c), p->log);
+            fprintf(p->log, "_us");
+        }
+        fprintf(p->log, "\n");
+    }
+    return 0;
+}
+
+static int control(struct vo *vo, uint32_t request, void *data)
+{
+    switch (request) {
+    case VOCTRL_QUERY_FORMAT:
+        return query_format(*(uint32_t *)data);
+    case VOCTRL_DRAW_IMAGE:
+        return draw_image(vo, data);
+    }
+    return VO_NOTIMPL;
+}
+
+const struct vo_driver video_out_bench = {
+    .is_new = 1,
+    .info = &(const vo_info_t) {
+        "Benchmark: discard frames and report timing",
+        "bench",
+        "",
+        ""
+    },
+    .preinit = preinit,
+    .config = config,
+    .control = control,
+    .draw_osd = draw_osd,
+    .flip_page = flip_page,
+    .check_events = check_events,
+    .uninit = uninit,
+};
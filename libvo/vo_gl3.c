@@ -120,9 +120,17 @@ struct vertex {
 struct texplane {
     int shift_x, shift_y;
     GLuint gl_texture;
-    int gl_buffer;
-    int buffer_size;
-    void *buffer_ptr;
+};
+
+#define MAX_PBOS 8
+
+// One video frame (all planes) worth of pixel buffer. The fence is set
+// after the texture upload reading from the buffer has been queued, and
+// the buffer isn't written again before the fence has signalled.
+struct pbo {
+    GLuint buffer;
+    int size;
+    GLsync fence;
 };
 
 struct scaler {
@@ -158,9 +166,12 @@ struct gl_priv {
     int use_lut_3d;
     int use_npot;
     int use_pbo;
+    int pbo_count;
     int use_glFinish;
     int use_gl_debug;
     int use_gl2;
+    int use_deint;
+    float denoise;
 
     int dither_depth;
     int swap_interval;
@@ -172,6 +183,7 @@ struct gl_priv {
 
     GLuint osd_program, eosd_program;
     GLuint indirect_program, scale_sep_program, final_program;
+    GLuint deint_program, denoise_program;
 
     GLuint osd_textures[MAX_OSD_PARTS];
     int osd_textures_count;
@@ -181,7 +193,7 @@ struct gl_priv {
     int eosd_texture_width, eosd_texture_height;
     GLuint eosd_buffer;
     struct vertex *eosd_va;
-    struct bitmap_packer *eosd;
+    struct bitmap_atlas *eosd;
     int eosd_render_count;
     unsigned int bitmap_id;
     unsigned int bitmap_pos_id;
@@ -215,9 +227,24 @@ struct gl_priv {
     int plane_count;
     struct texplane planes[3];
 
+    struct pbo pbos[MAX_PBOS];
+    int pbo_index;              // buffer used for the next frame
+    void *pbo_ptr;              // mapping of pbos[pbo_index], or NULL
+    int pbo_offsets[3];         // start of each plane in the buffer
+
     struct fbotex indirect_fbo;         // RGB target
     struct fbotex scale_sep_fbo;        // first pass when doing 2 pass scaling
 
+    // Temporal passes. The indirect and denoise targets are swapped with
+    // the previous frame's on each new frame.
+    struct fbotex prev_fbo;             // indirect_fbo of the previous frame
+    struct fbotex deint_fbo;
+    struct fbotex denoise_fbo;
+    struct fbotex denoise_prev_fbo;
+    int hist_frames;            // frames in the history, up to 2
+    bool new_frame;             // set by draw_image(), cleared by do_render()
+    bool field_tff;
+
     // state for luma (0) and chroma (1) scalers
     struct scaler scalers[2];
     // luma scaler parameters (the same are used for chroma)
@@ -465,6 +492,9 @@ static void update_uniforms(struct gl_priv *p, GLuint program)
     gl->Uniform1f(gl->GetUniformLocation(program, "filter_param1"),
                   isnan(sparam1) ? 0.5f : sparam1);
 
+    gl->Uniform1f(gl->GetUniformLocation(program, "denoise_strength"),
+                  p->denoise);
+
     gl->UseProgram(0);
 
     debug_check_gl(p, "update_uniforms()");
@@ -477,6 +507,8 @@ static void update_all_uniforms(struct gl_priv *p)
     update_uniforms(p, p->indirect_program);
     update_uniforms(p, p->scale_sep_program);
     update_uniforms(p, p->final_program);
+    update_uniforms(p, p->deint_program);
+    update_uniforms(p, p->denoise_program);
 }
 
 #define SECTION_HEADER "#!section "
@@ -639,6 +671,8 @@ static void compile_shaders(struct gl_priv *p)
     char *s_video = get_section(tmp, src, "frag_video");
     char *s_eosd = get_section(tmp, src, "frag_eosd");
     char *s_osd = get_section(tmp, src, "frag_osd");
+    char *s_deint = get_section(tmp, src, "frag_deint");
+    char *s_denoise = get_section(tmp, src, "frag_denoise");
 
     char *header = talloc_asprintf(tmp, "#version %s\n%s", p->shader_version,
                                    shader_prelude);
@@ -703,6 +737,10 @@ static void compile_shaders(struct gl_priv *p)
     if (header_sep && p->plane_count > 1)
         use_indirect = true;
 
+    // The temporal passes work on the video-sized RGB frames it renders.
+    if (p->use_deint || p->denoise > 0)
+        use_indirect = true;
+
     if (input_is_subsampled(p)) {
         shader_setup_scaler(&header_conv, &p->scalers[1], -1);
     } else {
@@ -732,6 +770,16 @@ static void compile_shaders(struct gl_priv *p)
             create_program(gl, "scale_sep", header_sep, vertex_shader, s_video);
     }
 
+    char *header_temporal = t_concat(tmp, header, "#define FIXED_SCALE 1\n");
+    if (p->use_deint) {
+        p->deint_program =
+            create_program(gl, "deint", header_temporal, vertex_shader, s_deint);
+    }
+    if (p->denoise > 0) {
+        p->denoise_program = create_program(gl, "denoise", header_temporal,
+                                            vertex_shader, s_denoise);
+    }
+
     header_final = t_concat(tmp, header, header_final);
     p->final_program =
         create_program(gl, "final", header_final, vertex_shader, s_video);
@@ -756,6 +804,8 @@ static void delete_shaders(struct gl_priv *p)
     delete_program(gl, &p->indirect_program);
     delete_program(gl, &p->scale_sep_program);
     delete_program(gl, &p->final_program);
+    delete_program(gl, &p->deint_program);
+    delete_program(gl, &p->denoise_program);
 }
 
 static double get_scale_factor(struct gl_priv *p)
@@ -908,8 +958,18 @@ static void reinit_rendering(struct gl_priv *p)
 
     compile_shaders(p);
 
+    int w = p->texture_width, h = p->texture_height;
     if (p->indirect_program && !p->indirect_fbo.fbo)
-        fbotex_init(p, &p->indirect_fbo, p->texture_width, p->texture_height);
+        fbotex_init(p, &p->indirect_fbo, w, h);
+    if (p->deint_program && !p->deint_fbo.fbo) {
+        fbotex_init(p, &p->prev_fbo, w, h);
+        fbotex_init(p, &p->deint_fbo, w, h);
+    }
+    if (p->denoise_program && !p->denoise_fbo.fbo) {
+        fbotex_init(p, &p->denoise_fbo, w, h);
+        fbotex_init(p, &p->denoise_prev_fbo, w, h);
+    }
+    p->hist_frames = 0;
 }
 
 static void uninit_rendering(struct gl_priv *p)
@@ -1006,14 +1066,29 @@ static void uninit_video(struct gl_priv *p)
 
         gl->DeleteTextures(1, &plane->gl_texture);
         plane->gl_texture = 0;
-        gl->DeleteBuffers(1, &plane->gl_buffer);
-        plane->gl_buffer = 0;
-        plane->buffer_ptr = NULL;
-        plane->buffer_size = 0;
     }
 
+    if (p->pbo_ptr) {
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, p->pbos[p->pbo_index].buffer);
+        gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        p->pbo_ptr = NULL;
+    }
+    for (int n = 0; n < MAX_PBOS; n++) {
+        struct pbo *pbo = &p->pbos[n];
+        if (pbo->fence)
+            gl->DeleteSync(pbo->fence);
+        gl->DeleteBuffers(1, &pbo->buffer);
+        *pbo = (struct pbo) {0};
+    }
+    p->pbo_index = 0;
+
     fbotex_uninit(p, &p->indirect_fbo);
     fbotex_uninit(p, &p->scale_sep_fbo);
+    fbotex_uninit(p, &p->prev_fbo);
+    fbotex_uninit(p, &p->deint_fbo);
+    fbotex_uninit(p, &p->denoise_fbo);
+    fbotex_uninit(p, &p->denoise_prev_fbo);
 }
 
 static void render_to_fbo(struct gl_priv *p, struct fbotex *fbo, int w, int h,
@@ -1051,6 +1126,26 @@ static void handle_pass(struct gl_priv *p, struct fbotex **source,
     *source = fbo;
 }
 
+// Like handle_pass(), with ref bound as texture2.
+static void handle_temporal_pass(struct gl_priv *p, struct fbotex **source,
+                                 struct fbotex *fbo, GLuint program,
+                                 struct fbotex *ref)
+{
+    GL *gl = p->gl;
+
+    if (!program)
+        return;
+
+    gl->ActiveTexture(GL_TEXTURE0 + 1);
+    gl->BindTexture(GL_TEXTURE_2D, ref->texture);
+    gl->ActiveTexture(GL_TEXTURE0);
+    handle_pass(p, source, fbo, program);
+    // the indirect pass of a redraw expects the video plane there
+    gl->ActiveTexture(GL_TEXTURE0 + 1);
+    gl->BindTexture(GL_TEXTURE_2D, p->planes[1].gl_texture);
+    gl->ActiveTexture(GL_TEXTURE0);
+}
+
 static void do_render(struct gl_priv *p)
 {
     GL *gl = p->gl;
@@ -1058,7 +1153,7 @@ static void do_render(struct gl_priv *p)
     bool is_flipped = p->mpi_flipped ^ p->vo_flipped;
 
     // Order of processing:
-    //  [indirect -> [scale_sep ->]] final
+    //  [indirect -> [deint ->] [denoise ->] [scale_sep ->]] final
 
     struct fbotex dummy = {
         .vp_w = p->image_width, .vp_h = p->image_height,
@@ -1067,7 +1162,36 @@ static void do_render(struct gl_priv *p)
     };
     struct fbotex *source = &dummy;
 
+    // Redraws run the temporal passes again against the same history.
+    if (p->new_frame) {
+        if (p->deint_program)
+            FFSWAP(struct fbotex, p->indirect_fbo, p->prev_fbo);
+        if (p->denoise_program)
+            FFSWAP(struct fbotex, p->denoise_fbo, p->denoise_prev_fbo);
+        p->hist_frames = FFMIN(p->hist_frames + 1, 2);
+        p->new_frame = false;
+    }
+    bool have_prev = p->hist_frames > 1;
+
     handle_pass(p, &source, &p->indirect_fbo, p->indirect_program);
+
+    if (p->deint_program) {
+        // Keep the first field; texture row 0 is the last image line of
+        // flipped images.
+        int parity = p->field_tff ? 0 : 1;
+        if (p->mpi_flipped)
+            parity ^= !(p->image_height & 1);
+        gl->UseProgram(p->deint_program);
+        gl->Uniform1i(gl->GetUniformLocation(p->deint_program, "field_parity"),
+                      parity);
+        gl->Uniform2i(gl->GetUniformLocation(p->deint_program, "video_size"),
+                      source->vp_w, source->vp_h);
+        handle_temporal_pass(p, &source, &p->deint_fbo, p->deint_program,
+                             have_prev ? &p->prev_fbo : source);
+    }
+    handle_temporal_pass(p, &source, &p->denoise_fbo, p->denoise_program,
+                         have_prev ? &p->denoise_prev_fbo : source);
+
     handle_pass(p, &source, &p->scale_sep_fbo, p->scale_sep_program);
 
     gl->BindTexture(GL_TEXTURE_2D, source->texture);
@@ -1203,6 +1327,10 @@ static void flip_page(struct vo *vo)
 
     p->glctx->swapGlBuffers(p->glctx);
 
+    // With vsync, return when the frame is shown (see flip_waits_vsync)
+    if (p->use_glFinish && p->swap_interval > 0)
+        gl->Finish();
+
     if (p->dst_rect.left > p->vp_x || p->dst_rect.top > p->vp_y
         || p->dst_rect.right < p->vp_x + p->vp_w
         || p->dst_rect.bottom < p->vp_y + p->vp_h)
@@ -1231,10 +1359,54 @@ static int draw_slice(struct vo *vo, uint8_t *src[], int stride[], int w, int h,
     return 0;
 }
 
+static bool pbo_use_sync(GL *gl)
+{
+    return gl->MapBufferRange && gl->FenceSync && gl->ClientWaitSync
+           && gl->DeleteSync;
+}
+
+// Map the next buffer of the ring, waiting for the GPU to finish reading
+// from it if needed. With fences, the GPU is only waited on once it is
+// pbo_count frames behind, and the mapping itself never stalls. Without
+// fences, the old storage is orphaned, and the driver does the ring.
+// A single buffer keeps its contents for static images.
+static void *map_pbo(struct gl_priv *p, int size)
+{
+    GL *gl = p->gl;
+    struct pbo *pbo = &p->pbos[p->pbo_index];
+    bool sync = pbo_use_sync(gl);
+    void *ptr;
+
+    if (pbo->fence) {
+        GLenum res = gl->ClientWaitSync(pbo->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                        1000000000);
+        if (res == GL_TIMEOUT_EXPIRED || res == GL_WAIT_FAILED)
+            mp_msg(MSGT_VO, MSGL_V, "[gl] Waiting for PBO fence failed.\n");
+        gl->DeleteSync(pbo->fence);
+        pbo->fence = NULL;
+    }
+
+    if (!pbo->buffer)
+        gl->GenBuffers(1, &pbo->buffer);
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo->buffer);
+    if (size > pbo->size || (!sync && p->pbo_count > 1)) {
+        pbo->size = FFMAX(size, pbo->size);
+        gl->BufferData(GL_PIXEL_UNPACK_BUFFER, pbo->size, NULL,
+                       GL_STREAM_DRAW);
+    }
+    if (sync) {
+        ptr = gl->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, pbo->size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    } else {
+        ptr = gl->MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    }
+    gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return ptr;
+}
+
 static uint32_t get_image(struct vo *vo, mp_image_t *mpi)
 {
     struct gl_priv *p = vo->priv;
-    GL *gl = p->gl;
 
     if (!p->use_pbo)
         return VO_FALSE;
@@ -1246,28 +1418,27 @@ static uint32_t get_image(struct vo *vo, mp_image_t *mpi)
 
     if (mpi->flags & MP_IMGFLAG_READABLE)
         return VO_FALSE;
+    // The decoder would expect the previous contents of a static image,
+    // but the next frame goes to a different buffer of the ring.
+    if (mpi->type == MP_IMGTYPE_STATIC && p->pbo_count > 1)
+        return VO_FALSE;
     if (mpi->type != MP_IMGTYPE_STATIC && mpi->type != MP_IMGTYPE_TEMP &&
         (mpi->type != MP_IMGTYPE_NUMBERED || mpi->number))
         return VO_FALSE;
     mpi->flags &= ~MP_IMGFLAG_COMMON_PLANE;
+    int size = 0;
     for (int n = 0; n < p->plane_count; n++) {
         struct texplane *plane = &p->planes[n];
         mpi->stride[n] = (mpi->width >> plane->shift_x) * p->plane_bytes;
-        int needed_size = (mpi->height >> plane->shift_y) * mpi->stride[n];
-        if (!plane->gl_buffer)
-            gl->GenBuffers(1, &plane->gl_buffer);
-        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, plane->gl_buffer);
-        if (needed_size > plane->buffer_size) {
-            plane->buffer_size = needed_size;
-            gl->BufferData(GL_PIXEL_UNPACK_BUFFER, plane->buffer_size,
-                           NULL, GL_DYNAMIC_DRAW);
-        }
-        if (!plane->buffer_ptr)
-            plane->buffer_ptr = gl->MapBuffer(GL_PIXEL_UNPACK_BUFFER,
-                                              GL_WRITE_ONLY);
-        mpi->planes[n] = plane->buffer_ptr;
-        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        p->pbo_offsets[n] = size;
+        size += FFALIGN((mpi->height >> plane->shift_y) * mpi->stride[n], 64);
     }
+    if (!p->pbo_ptr)
+        p->pbo_ptr = map_pbo(p, size);
+    if (!p->pbo_ptr)
+        return VO_FALSE;
+    for (int n = 0; n < p->plane_count; n++)
+        mpi->planes[n] = (uint8_t *)p->pbo_ptr + p->pbo_offsets[n];
     mpi->flags |= MP_IMGFLAG_DIRECT;
     return VO_TRUE;
 }
@@ -1279,6 +1450,10 @@ static uint32_t draw_image(struct gl_priv *p, mp_image_t *mpi)
 
     assert(mpi->num_planes >= p->plane_count);
 
+    p->new_frame = true;
+    p->field_tff = !(mpi->fields & MP_IMGFIELD_ORDERED)
+                   || (mpi->fields & MP_IMGFIELD_TOP_FIRST);
+
     mp_image_t mpi2 = *mpi;
     int w = mpi->w, h = mpi->h;
     if (mpi->flags & MP_IMGFLAG_DRAW_CALLBACK)
@@ -1288,7 +1463,7 @@ static uint32_t draw_image(struct gl_priv *p, mp_image_t *mpi)
     mpi2.width = mpi2.w;
     mpi2.height = mpi2.h;
     if (!(mpi->flags & MP_IMGFLAG_DIRECT)
-        && !p->planes[0].buffer_ptr
+        && !p->pbo_ptr
         && get_image(p->vo, &mpi2) == VO_TRUE)
     {
         for (n = 0; n < p->plane_count; n++) {
@@ -1301,18 +1476,21 @@ static uint32_t draw_image(struct gl_priv *p, mp_image_t *mpi)
         mpi = &mpi2;
     }
     p->mpi_flipped = mpi->stride[0] < 0;
+    struct pbo *pbo = NULL;
+    if (mpi->flags & MP_IMGFLAG_DIRECT) {
+        pbo = &p->pbos[p->pbo_index];
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo->buffer);
+        if (!gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+            mp_msg(MSGT_VO, MSGL_FATAL, "[gl] Video PBO upload failed. "
+                   "Remove the 'pbo' suboption.\n");
+        p->pbo_ptr = NULL;
+    }
     for (n = 0; n < p->plane_count; n++) {
         struct texplane *plane = &p->planes[n];
         int xs = plane->shift_x, ys = plane->shift_y;
         void *plane_ptr = mpi->planes[n];
-        if (mpi->flags & MP_IMGFLAG_DIRECT) {
-            gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, plane->gl_buffer);
-            if (!gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
-                mp_msg(MSGT_VO, MSGL_FATAL, "[gl] Video PBO upload failed. "
-                       "Remove the 'pbo' suboption.\n");
-            plane->buffer_ptr = NULL;
-            plane_ptr = NULL; // PBO offset 0
-        }
+        if (pbo)
+            plane_ptr = (void *)(intptr_t)p->pbo_offsets[n]; // PBO offset
         gl->ActiveTexture(GL_TEXTURE0 + n);
         gl->BindTexture(GL_TEXTURE_2D, plane->gl_texture);
         glUploadTex(gl, GL_TEXTURE_2D, p->gl_format, p->gl_type, plane_ptr,
@@ -1320,6 +1498,11 @@ static uint32_t draw_image(struct gl_priv *p, mp_image_t *mpi)
     }
     gl->ActiveTexture(GL_TEXTURE0);
     gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (pbo) {
+        if (pbo_use_sync(gl))
+            pbo->fence = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        p->pbo_index = (p->pbo_index + 1) % p->pbo_count;
+    }
 skip_upload:
     do_render(p);
     return VO_TRUE;
@@ -1488,7 +1671,7 @@ static void gen_eosd(struct gl_priv *p, mp_eosd_images_t *imgs)
 
     if (imgs->bitmap_id != p->bitmap_id) {
         need_upload = true;
-        int res = packer_pack_from_subbitmaps(p->eosd, imgs, 0);
+        int res = atlas_update_from_subbitmaps(p->eosd, imgs);
         if (res < 0) {
             mp_msg(MSGT_VO, MSGL_ERR,
                    "[gl] subtitle bitmaps do not fit in maximum texture\n");
@@ -1511,7 +1694,7 @@ static void gen_eosd(struct gl_priv *p, mp_eosd_images_t *imgs)
     }
     p->bitmap_id = imgs->bitmap_id;
     p->bitmap_pos_id = imgs->bitmap_pos_id;
-    if (p->eosd->used_width == 0)
+    if (p->eosd->count == 0)
         return;
 
     p->eosd_va = talloc_realloc_size(p->eosd, p->eosd_va,
@@ -1519,7 +1702,11 @@ static void gen_eosd(struct gl_priv *p, mp_eosd_images_t *imgs)
                                      * sizeof(struct vertex)
                                      * VERTICES_PER_QUAD);
 
-    if (need_upload && p->use_pbo) {
+    // Only bitmaps that are not in the texture yet are uploaded; the
+    // others keep their place in the atlas.
+    int *dirty = p->eosd->dirty;
+    int num_dirty = need_upload ? p->eosd->num_dirty : 0;
+    if (num_dirty && p->use_pbo) {
         gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, p->eosd_buffer);
         char *data = gl->MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
         if (!data) {
@@ -1528,10 +1715,10 @@ static void gen_eosd(struct gl_priv *p, mp_eosd_images_t *imgs)
         } else {
             ASS_Image *i = imgs->imgs;
             struct pos *spos = p->eosd->result;
-            for (int n = 0; n < p->eosd->count; n++, i = i->next) {
-                if (i->w == 0 || i->h == 0)
+            for (int n = 0, d = 0; d < num_dirty; n++, i = i->next) {
+                if (n != dirty[d])
                     continue;
-
+                d++;
                 void *pdata = data + spos[n].y * p->eosd->w + spos[n].x;
                 memcpy_pic(pdata, i->bitmap, i->w, i->h,
                            p->eosd->w, i->stride);
@@ -1539,18 +1726,26 @@ static void gen_eosd(struct gl_priv *p, mp_eosd_images_t *imgs)
             if (!gl->UnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
                 mp_msg(MSGT_VO, MSGL_FATAL, "[gl] EOSD PBO upload failed. "
                        "Remove the 'pbo' suboption.\n");
-            glUploadTex(gl, GL_TEXTURE_2D, GL_RED, GL_UNSIGNED_BYTE, NULL,
-                        p->eosd->w, 0, 0,
-                        p->eosd->used_width, p->eosd->used_height, 0);
+            i = imgs->imgs;
+            for (int n = 0, d = 0; d < num_dirty; n++, i = i->next) {
+                if (n != dirty[d])
+                    continue;
+                d++;
+                intptr_t offset = spos[n].y * p->eosd->w + spos[n].x;
+                glUploadTex(gl, GL_TEXTURE_2D, GL_RED, GL_UNSIGNED_BYTE,
+                            (void *)offset, p->eosd->w,
+                            spos[n].x, spos[n].y, i->w, i->h, 0);
+            }
         }
         gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-    } else if (need_upload) {
+    } else if (num_dirty) {
         // non-PBO upload
         ASS_Image *i = imgs->imgs;
         struct pos *spos = p->eosd->result;
-        for (int n = 0; n < p->eosd->count; n++, i = i->next) {
-            if (i->w == 0 || i->h == 0)
+        for (int n = 0, d = 0; d < num_dirty; n++, i = i->next) {
+            if (n != dirty[d])
                 continue;
+            d++;
             glUploadTex(gl, GL_TEXTURE_2D, GL_RED, GL_UNSIGNED_BYTE, i->bitmap,
                         i->stride, spos[n].x, spos[n].y, i->w, i->h, 0);
         }
@@ -1665,6 +1860,8 @@ static int init_gl(struct gl_priv *p)
     gl->Clear(GL_COLOR_BUFFER_BIT);
     if (gl->SwapInterval && p->swap_interval >= 0)
         gl->SwapInterval(p->swap_interval);
+    p->vo->flip_waits_vsync = p->use_glFinish && gl->SwapInterval
+                              && p->swap_interval > 0;
 
     debug_check_gl(p, "after init_gl");
 
@@ -1692,7 +1889,7 @@ static void uninit_gl(struct gl_priv *p)
     gl->DeleteBuffers(1, &p->eosd_buffer);
     p->eosd_buffer = 0;
     p->bitmap_id = p->bitmap_pos_id = 0;
-    p->eosd->w = p->eosd->h = 0;
+    atlas_reset(p->eosd);
 
     gl->DeleteTextures(1, &p->lut_3d_texture);
     p->lut_3d_texture = 0;
@@ -1944,6 +2141,20 @@ static int control(struct vo *vo, uint32_t request, void *data)
     case VOCTRL_REDRAW_FRAME:
         do_render(p);
         return true;
+    case VOCTRL_RESET:
+        p->hist_frames = 0;
+        return VO_TRUE;
+    case VOCTRL_GET_DEINTERLACE:
+        *(int *)data = p->use_deint;
+        return VO_TRUE;
+    case VOCTRL_SET_DEINTERLACE:
+        p->use_deint = *(int *)data;
+        if (p->image_format) {
+            reinit_rendering(p);
+            update_all_uniforms(p);
+        }
+        vo->want_redraw = true;
+        return VO_TRUE;
     }
     return VO_NOTIMPL;
 }
@@ -2112,6 +2323,18 @@ static int lut3d_size_valid(void *arg)
     return parse_3dlut_size(s, &p1, &p2, &p3);
 }
 
+static int pbo_count_valid(void *arg)
+{
+    int n = *(int *)arg;
+    return n >= 1 && n <= MAX_PBOS;
+}
+
+static int denoise_valid(void *arg)
+{
+    float f = *(float *)arg;
+    return f >= 0.0f && f <= 1.0f;
+}
+
 static int backend_valid(void *arg)
 {
     return mpgl_find_backend(*(const char **)arg) >= 0;
@@ -2197,6 +2420,7 @@ static int preinit(struct vo *vo, const char *arg)
         .colorspace = MP_CSP_DETAILS_DEFAULTS,
         .use_npot = 1,
         .use_pbo = 0,
+        .pbo_count = 3,
         .swap_interval = 1,
         .fbo_format = GL_RGB16,
         .use_scale_sep = 1,
@@ -2222,6 +2446,7 @@ static int preinit(struct vo *vo, const char *arg)
         {"srgb",                OPT_ARG_BOOL,   &p->use_srgb},
         {"npot",                OPT_ARG_BOOL,   &p->use_npot},
         {"pbo",                 OPT_ARG_BOOL,   &p->use_pbo},
+        {"pbo-count",           OPT_ARG_INT,    &p->pbo_count, pbo_count_valid},
         {"glfinish",            OPT_ARG_BOOL,   &p->use_glFinish},
         {"swapinterval",        OPT_ARG_INT,    &p->swap_interval},
         {"stereo",              OPT_ARG_INT,    &p->stereo_mode},
@@ -2242,6 +2467,8 @@ static int preinit(struct vo *vo, const char *arg)
         {"3dlut-size",          OPT_ARG_MSTRZ,  &icc_size_str,
          lut3d_size_valid},
         {"dither-depth",        OPT_ARG_INT,    &p->dither_depth},
+        {"deint",               OPT_ARG_BOOL,   &p->use_deint},
+        {"denoise",             OPT_ARG_FLOAT,  &p->denoise, denoise_valid},
         {NULL}
     };
 
@@ -2279,7 +2506,7 @@ static int preinit(struct vo *vo, const char *arg)
     if (!success)
         goto err_out;
 
-    p->eosd = talloc_zero(vo, struct bitmap_packer);
+    p->eosd = talloc_zero(vo, struct bitmap_atlas);
 
     p->glctx = init_mpglcontext(backend, vo);
     if (!p->glctx)
@@ -2361,6 +2588,8 @@ static const char help_text[] =
 "  pbo\n"
 "    Enable use of PBOs. This is faster, but can sometimes lead to\n"
 "    sporadic and temporary image corruption.\n"
+"  pbo-count=<1-8>\n"
+"    Number of PBOs uploads rotate through. Default: 3.\n"
 "  dither-depth=<n>\n"
 "    Positive non-zero values select the target bit depth.\n"
 "    -1: Disable any dithering done by mplayer.\n"
@@ -2372,6 +2601,12 @@ static const char help_text[] =
 "    of the video is lower or qual to the detected dither-depth.\n"
 "    If color management is enabled, input depth is assumed to be\n"
 "    16 bits, because the 3D LUT output is 16 bit wide.\n"
+"  deint\n"
+"    Deinterlace in a shader pass, similar to vf_yadif without the\n"
+"    frame of delay. Can be toggled at runtime.\n"
+"  denoise=<0.0-1.0>\n"
+"    Strength of a temporal denoise pass, similar to the temporal\n"
+"    part of vf_hqdn3d. Default: 0 (disabled).\n"
 "  debug\n"
 "    Check for OpenGL errors, i.e. call glGetError(). Also request a\n"
 "    debug OpenGL context.\n"
@@ -2399,7 +2634,7 @@ static const char help_text[] =
 "    Force use of power-of-2 texture sizes. For debugging only.\n"
 "    Borders will look discolored due to filtering.\n"
 "  glfinish\n"
-"    Call glFinish() before swapping buffers\n"
+"    Call glFinish() before swapping buffers, and after it with vsync\n"
 "  backend=<sys>\n"
 "    auto: auto-select (default)\n"
 "    cocoa: Cocoa/OSX\n"
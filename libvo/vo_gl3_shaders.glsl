@@ -314,3 +314,92 @@ void main() {
 #endif
     out_color = vec4(color, 1);
 }
+
+// The temporal passes map output pixels 1:1 to texels of the video-sized
+// RGB frames: texture1 is the current frame, texture2 the reference.
+#!section frag_deint
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+uniform int field_parity;
+uniform ivec2 video_size;
+
+out vec4 out_color;
+
+// The textures are padded past the video size; don't read the padding.
+vec3 fetch(sampler2D tex, ivec2 pos, int dx, int dy) {
+    ivec2 maxpos = video_size - 1;
+    return texelFetch(tex, clamp(pos + ivec2(dx, dy), ivec2(0), maxpos), 0).rgb;
+}
+
+float diff3(vec3 a, vec3 b) {
+    return dot(abs(a - b), vec3(1));
+}
+
+// yadif with the current frame in place of the next one: the missing line
+// is predicted temporally from the other field of the previous and the
+// current frame (which are half a field before and after the kept field),
+// spatially along the best of 5 edge directions, and the spatial prediction
+// is clamped to the range the temporal neighbours allow.
+void main() {
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    if ((pos.y & 1) == field_parity) {
+        out_color = vec4(fetch(texture1, pos, 0, 0), 1);
+        return;
+    }
+
+    vec3 c = fetch(texture1, pos, 0, 1);
+    vec3 e = fetch(texture1, pos, 0, -1);
+    vec3 p0 = fetch(texture2, pos, 0, 0);
+    vec3 n0 = fetch(texture1, pos, 0, 0);
+    vec3 d = (p0 + n0) * 0.5;
+
+    vec3 tdiff0 = abs(p0 - n0) * 0.5;
+    vec3 tdiff1 = (abs(fetch(texture2, pos, 0, 1) - c)
+                 + abs(fetch(texture2, pos, 0, -1) - e)) * 0.5;
+    vec3 diff = max(tdiff0, tdiff1);
+
+    vec3 spatial = (c + e) * 0.5;
+    float score = diff3(fetch(texture1, pos, -1, 1), fetch(texture1, pos, -1, -1))
+                + diff3(c, e)
+                + diff3(fetch(texture1, pos, 1, 1), fetch(texture1, pos, 1, -1));
+    for (int j = -2; j <= 2; j++) {
+        if (j == 0)
+            continue;
+        float s = diff3(fetch(texture1, pos, j - 1, 1), fetch(texture1, pos, -j - 1, -1))
+                + diff3(fetch(texture1, pos, j, 1), fetch(texture1, pos, -j, -1))
+                + diff3(fetch(texture1, pos, j + 1, 1), fetch(texture1, pos, -j + 1, -1));
+        if (s < score) {
+            score = s;
+            spatial = (fetch(texture1, pos, j, 1) + fetch(texture1, pos, -j, -1)) * 0.5;
+        }
+    }
+
+    vec3 b = (fetch(texture2, pos, 0, 2) + fetch(texture1, pos, 0, 2)) * 0.5;
+    vec3 f = (fetch(texture2, pos, 0, -2) + fetch(texture1, pos, 0, -2)) * 0.5;
+    vec3 hi = max(max(d - e, d - c), min(b - c, f - e));
+    vec3 lo = min(min(d - e, d - c), max(b - c, f - e));
+    diff = max(max(diff, lo), -hi);
+
+    out_color = vec4(clamp(spatial, d - diff, d + diff), 1);
+}
+
+#!section frag_denoise
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+uniform float denoise_strength;
+
+out vec4 out_color;
+
+// changes larger than this are treated as motion and not smoothed
+#define DENOISE_THRESHOLD (16.0/255.0)
+
+// Recursive temporal lowpass like vf_hqdn3d's: texture2 is the previous
+// output, which is blended in less the more the pixel changed.
+void main() {
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    vec3 cur = texelFetch(texture1, pos, 0).rgb;
+    vec3 prev = texelFetch(texture2, pos, 0).rgb;
+    vec3 w = denoise_strength
+             * (1 - smoothstep(0, DENOISE_THRESHOLD, abs(cur - prev)));
+    out_color = vec4(mix(cur, prev, w), 1);
+}
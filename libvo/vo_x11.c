@@ -33,6 +33,11 @@
 
 #include "x11_common.h"
 
+/* With XShm, the server reads the image after XShmPutImage() returns, so
+ * the next frame goes to another image. ShmCompletion events tell when
+ * an image can be written again. */
+#define NUM_BUFFERS 2
+
 #ifdef HAVE_SHM
 #include <sys/ipc.h>
 #include <sys/shm.h>
@@ -41,7 +46,7 @@
 static int Shmem_Flag;
 
 //static int Quiet_Flag;  Here also what is this for. It's used but isn't initialized?
-static XShmSegmentInfo Shminfo[1];
+static XShmSegmentInfo Shminfo[NUM_BUFFERS];
 static int gXErrorFlag;
 static int CompletionType = -1;
 #endif
@@ -64,6 +69,7 @@ static const vo_info_t info = {
 
 const LIBVO_EXTERN(x11)
 /* private prototypes */
+static void Display_Image(XImage * myximage, uint8_t * ImageData);
 static void (*draw_alpha_fnc) (int x0, int y0, int w, int h,
                                unsigned char *src, unsigned char *srca,
                                int stride);
@@ -74,6 +80,11 @@ static unsigned char *ImageData;
 static unsigned char *ImageDataOrig;
 
 /* X11 related variables */
+static XImage *ximages[NUM_BUFFERS];
+static int num_buffers;
+static int current_buf;
+static int visible_buf;
+// the image the next frame is drawn into, ximages[current_buf]
 static XImage *myximage = NULL;
 static int depth, bpp;
 static XWindowAttributes attribs;
@@ -105,8 +116,10 @@ static void check_events(void)
     else if (ret & VO_EVENT_EXPOSE)
         vo_x11_clearwindow_part(mDisplay, vo_window, myximage->width,
                                 myximage->height);
-    if (ret & VO_EVENT_EXPOSE && int_pause)
-        flip_page();
+    if (ret & VO_EVENT_EXPOSE && int_pause) {
+        Display_Image(ximages[visible_buf], NULL);
+        XFlush(mDisplay);
+    }
 }
 
 static void draw_alpha_32(int x0, int y0, int w, int h, unsigned char *src,
@@ -205,6 +218,67 @@ static int vo_find_depth_from_visuals(Display * dpy, int screen,
     return bestvisual_depth;
 }
 
+#ifdef HAVE_SHM
+static int getMyShmImage(int n)
+{
+    XImage *image =
+        XShmCreateImage(mDisplay, vinfo.visual, depth, ZPixmap, NULL,
+                        &Shminfo[n], image_width, image_height);
+    if (image == NULL)
+    {
+        mp_msg(MSGT_VO, MSGL_WARN,
+               "Shared memory error,disabling ( Ximage error )\n");
+        return 0;
+    }
+    Shminfo[n].shmid = shmget(IPC_PRIVATE,
+                              image->bytes_per_line * image->height,
+                              IPC_CREAT | 0777);
+    if (Shminfo[n].shmid < 0)
+    {
+        XDestroyImage(image);
+        mp_msg(MSGT_VO, MSGL_V, "%s\n", strerror(errno));
+        //perror( strerror( errno ) );
+        mp_msg(MSGT_VO, MSGL_WARN,
+               "Shared memory error,disabling ( seg id error )\n");
+        return 0;
+    }
+    Shminfo[n].shmaddr = (char *) shmat(Shminfo[n].shmid, 0, 0);
+
+    if (Shminfo[n].shmaddr == ((char *) -1))
+    {
+        XDestroyImage(image);
+        mp_msg(MSGT_VO, MSGL_WARN,
+               "Shared memory error,disabling ( address error )\n");
+        return 0;
+    }
+    image->data = Shminfo[n].shmaddr;
+    Shminfo[n].readOnly = False;
+    XShmAttach(mDisplay, &Shminfo[n]);
+
+    XSync(mDisplay, False);
+
+    if (gXErrorFlag)
+    {
+        XDestroyImage(image);
+        shmdt(Shminfo[n].shmaddr);
+        mp_msg(MSGT_VO, MSGL_WARN, "Shared memory error,disabling.\n");
+        gXErrorFlag = 0;
+        return 0;
+    }
+    shmctl(Shminfo[n].shmid, IPC_RMID, 0);
+    ximages[n] = image;
+    return 1;
+}
+
+static void freeMyShmImage(int n)
+{
+    XShmDetach(mDisplay, &Shminfo[n]);
+    XDestroyImage(ximages[n]);
+    shmdt(Shminfo[n].shmaddr);
+    ximages[n] = NULL;
+}
+#endif
+
 static void getMyXImage(void)
 {
 #ifdef HAVE_SHM
@@ -216,83 +290,46 @@ static void getMyXImage(void)
         mp_msg(MSGT_VO, MSGL_WARN,
                "Shared memory not supported\nReverting to normal Xlib\n");
     }
-    if (Shmem_Flag)
-        CompletionType = XShmGetEventBase(mDisplay) + ShmCompletion;
-
     if (Shmem_Flag)
     {
-        myximage =
-            XShmCreateImage(mDisplay, vinfo.visual, depth, ZPixmap, NULL,
-                            &Shminfo[0], image_width, image_height);
-        if (myximage == NULL)
-        {
-            mp_msg(MSGT_VO, MSGL_WARN,
-                   "Shared memory error,disabling ( Ximage error )\n");
-            goto shmemerror;
-        }
-        Shminfo[0].shmid = shmget(IPC_PRIVATE,
-                                  myximage->bytes_per_line *
-                                  myximage->height, IPC_CREAT | 0777);
-        if (Shminfo[0].shmid < 0)
-        {
-            XDestroyImage(myximage);
-            mp_msg(MSGT_VO, MSGL_V, "%s\n", strerror(errno));
-            //perror( strerror( errno ) );
-            mp_msg(MSGT_VO, MSGL_WARN,
-                   "Shared memory error,disabling ( seg id error )\n");
-            goto shmemerror;
-        }
-        Shminfo[0].shmaddr = (char *) shmat(Shminfo[0].shmid, 0, 0);
+        int n;
 
-        if (Shminfo[0].shmaddr == ((char *) -1))
-        {
-            XDestroyImage(myximage);
-            if (Shminfo[0].shmaddr != ((char *) -1))
-                shmdt(Shminfo[0].shmaddr);
-            mp_msg(MSGT_VO, MSGL_WARN,
-                   "Shared memory error,disabling ( address error )\n");
-            goto shmemerror;
-        }
-        myximage->data = Shminfo[0].shmaddr;
-        ImageData = (unsigned char *) myximage->data;
-        Shminfo[0].readOnly = False;
-        XShmAttach(mDisplay, &Shminfo[0]);
-
-        XSync(mDisplay, False);
-
-        if (gXErrorFlag)
+        CompletionType = XShmGetEventBase(mDisplay) + ShmCompletion;
+        global_vo->x11->ShmCompletionEvent = CompletionType;
+        for (n = 0; n < NUM_BUFFERS; n++)
+            if (!getMyShmImage(n))
+                break;
+        if (n < NUM_BUFFERS)
         {
-            XDestroyImage(myximage);
-            shmdt(Shminfo[0].shmaddr);
-            mp_msg(MSGT_VO, MSGL_WARN, "Shared memory error,disabling.\n");
-            gXErrorFlag = 0;
-            goto shmemerror;
+            while (n--)
+                freeMyShmImage(n);
+            Shmem_Flag = 0;
         } else
-            shmctl(Shminfo[0].shmid, IPC_RMID, 0);
-
         {
             static int firstTime = 1;
 
+            num_buffers = NUM_BUFFERS;
             if (firstTime)
             {
                 mp_msg(MSGT_VO, MSGL_V, "Sharing memory.\n");
                 firstTime = 0;
             }
         }
-    } else
-    {
-      shmemerror:
-        Shmem_Flag = 0;
-#endif
-        myximage = XCreateImage(mDisplay, vinfo.visual, depth, ZPixmap,
-                             0, NULL, image_width, image_height, 8, 0);
-        ImageDataOrig = malloc(myximage->bytes_per_line * image_height + 32);
-        myximage->data = ImageDataOrig + 16 - ((long)ImageDataOrig & 15);
-        memset(myximage->data, 0, myximage->bytes_per_line * image_height);
-        ImageData = myximage->data;
-#ifdef HAVE_SHM
     }
+    if (!Shmem_Flag)
 #endif
+    {
+        // XPutImage() copies the data, one image is enough
+        num_buffers = 1;
+        ximages[0] = XCreateImage(mDisplay, vinfo.visual, depth, ZPixmap,
+                                  0, NULL, image_width, image_height, 8, 0);
+        ImageDataOrig = malloc(ximages[0]->bytes_per_line * image_height + 32);
+        ximages[0]->data = ImageDataOrig + 16 - ((long)ImageDataOrig & 15);
+        memset(ximages[0]->data, 0, ximages[0]->bytes_per_line * image_height);
+    }
+    current_buf = visible_buf = 0;
+    myximage = ximages[0];
+    ImageData = (unsigned char *) myximage->data;
 }
 
 static void freeMyXImage(void)
@@ -300,14 +337,16 @@ static void freeMyXImage(void)
 #ifdef HAVE_SHM
     if (Shmem_Flag)
     {
-        XShmDetach(mDisplay, &Shminfo[0]);
-        XDestroyImage(myximage);
-        shmdt(Shminfo[0].shmaddr);
+        // keep the count of outstanding completion events right
+        vo_x11_wait_shm_completion(0);
+        for (int n = 0; n < num_buffers; n++)
+            freeMyShmImage(n);
     } else
 #endif
     {
-        myximage->data = ImageDataOrig;
-        XDestroyImage(myximage);
+        ximages[0]->data = ImageDataOrig;
+        XDestroyImage(ximages[0]);
+        ximages[0] = NULL;
         ImageDataOrig = NULL;
     }
     myximage = NULL;
@@ -525,6 +564,7 @@ static void Display_Image(XImage * myximage, uint8_t * ImageData)
                      0, 0,
                      x, y, dst_width,
                      myximage->height, True);
+        global_vo->x11->ShmCompletionWaitCount++;
     } else
 #endif
     {
@@ -544,6 +584,17 @@ static void draw_osd(void)
 static void flip_page(void)
 {
     Display_Image(myximage, ImageData);
+    visible_buf = current_buf;
+    current_buf = (current_buf + 1) % num_buffers;
+    myximage = ximages[current_buf];
+    ImageData = (unsigned char *) myximage->data;
+#ifdef HAVE_SHM
+    if (Shmem_Flag)
+    {
+        XFlush(mDisplay);
+        return;
+    }
+#endif
     XSync(mDisplay, False);
 }
 
@@ -585,6 +636,7 @@ static int draw_slice(uint8_t * src[], int stride[], int w, int h,
         dst_width = newW;
     }
 
+    vo_x11_wait_shm_completion(num_buffers - 1);
     dstStride[0] = image_width * ((bpp + 7) / 8);
     dst[0] = ImageData;
     if (Flip_Flag)
@@ -608,11 +660,15 @@ static uint32_t get_image(mp_image_t * mpi)
         (IMGFMT_BGR_DEPTH(mpi->imgfmt) != vo_depthonscreen) ||
         ((mpi->type != MP_IMGTYPE_STATIC)
          && (mpi->type != MP_IMGTYPE_TEMP))
+        // the next frame goes to another image
+        || (mpi->type == MP_IMGTYPE_STATIC && num_buffers > 1)
+        || (mpi->flags & MP_IMGFLAG_READABLE && num_buffers > 1)
         || (mpi->flags & MP_IMGFLAG_PLANAR)
         || (mpi->flags & MP_IMGFLAG_YUV) || (mpi->width != image_width)
         || (mpi->height != image_height))
         return VO_FALSE;
 
+    vo_x11_wait_shm_completion(num_buffers - 1);
     if (Flip_Flag)
     {
         mpi->stride[0] = -image_width * ((bpp + 7) / 8);
@@ -62,6 +62,8 @@ static const vo_info_t info = {
     ""
 };
 
+#define MAX_BUFFERS 10
+
 struct xvctx {
     XvAdaptorInfo *ai;
     XvImageFormatValues *fo;
@@ -70,10 +72,11 @@ struct xvctx {
     int current_ip_buf;
     int num_buffers;
     int total_buffers;
+    int cfg_buffers;
     bool have_image_copy;
     bool unchanged_image;
     int visible_buf;
-    XvImage *xvimage[2 + 1];
+    XvImage *xvimage[MAX_BUFFERS + 1];
     uint32_t image_width;
     uint32_t image_height;
     uint32_t image_format;
@@ -89,7 +92,7 @@ struct xvctx {
                            unsigned char *src, unsigned char *srca,
                            int stride);
 #ifdef HAVE_SHM
-    XShmSegmentInfo Shminfo[2 + 1];
+    XShmSegmentInfo Shminfo[MAX_BUFFERS + 1];
     int Shmem_Flag;
 #endif
 };
@@ -276,10 +279,11 @@ static int config(struct vo *vo, uint32_t width, uint32_t height,
     }
 
     // In case config has been called before
+    vo_x11_wait_shm_completion(vo, 0);
     for (i = 0; i < ctx->total_buffers; i++)
         deallocate_xvimage(vo, i);
 
-    ctx->num_buffers = 2;
+    ctx->num_buffers = ctx->cfg_buffers;
     ctx->total_buffers = ctx->num_buffers + 1;
 
     for (i = 0; i < ctx->total_buffers; i++)
@@ -310,6 +314,8 @@ static void allocate_xvimage(struct vo *vo, int foo)
         mp_tmsg(MSGT_VO, MSGL_INFO, "[VO_XV] Shared memory not supported\nReverting to normal Xv.\n");
     }
     if (ctx->Shmem_Flag) {
+        x11->ShmCompletionEvent = XShmGetEventBase(x11->display)
+                                  + ShmCompletion;
         ctx->xvimage[foo] =
             (XvImage *) XvShmCreateImage(x11->display, x11->xv_port,
                                          ctx->xv_format, NULL,
@@ -370,7 +376,8 @@ static inline void put_xvimage(struct vo *vo, XvImage *xvi)
         XvShmPutImage(x11->display, x11->xv_port, x11->window, x11->vo_gc, xvi,
                       src->left, src->top, src->width, src->height,
                       dst->left, dst->top, dst->width, dst->height,
-                      False);
+                      True);
+        x11->ShmCompletionWaitCount++;
     } else
 #endif
     {
@@ -420,6 +427,8 @@ static int redraw_frame(struct vo *vo)
 {
     struct xvctx *ctx = vo->priv;
 
+    // the visible image is written again, wait until the server is done
+    vo_x11_wait_shm_completion(vo, 0);
     if (ctx->have_image_copy)
         copy_backup_image(vo, ctx->visible_buf, ctx->num_buffers);
     else if (ctx->unchanged_image) {
@@ -451,6 +460,7 @@ static int draw_slice(struct vo *vo, uint8_t *image[], int stride[], int w,
     uint8_t *dst;
     XvImage *current_image = ctx->xvimage[ctx->current_buf];
 
+    vo_x11_wait_shm_completion(vo, ctx->num_buffers - 1);
     dst = current_image->data + current_image->offsets[0]
         + current_image->pitches[0] * y + x;
     memcpy_pic(dst, image[0], w, h, current_image->pitches[0], stride[0]);
@@ -520,23 +530,72 @@ static mp_image_t *get_screenshot(struct vo *vo)
     return image;
 }
 
+/* Let the decoder or filter write into the XvImage that flip_page() will
+ * show. The image is in the ring of num_buffers images, so only types
+ * that don't expect it to be kept or read back can be supported.
+ */
+static uint32_t get_image(struct vo *vo, mp_image_t *mpi)
+{
+    struct xvctx *ctx = vo->priv;
+
+    if (mpi->imgfmt != ctx->image_format)
+        return VO_FALSE;
+    if (mpi->flags & MP_IMGFLAG_READABLE)
+        return VO_FALSE;
+    if (mpi->type == MP_IMGTYPE_STATIC && ctx->num_buffers > 1)
+        return VO_FALSE;
+    if (mpi->type != MP_IMGTYPE_STATIC && mpi->type != MP_IMGTYPE_TEMP &&
+        (mpi->type != MP_IMGTYPE_NUMBERED || mpi->number))
+        return VO_FALSE;
+
+    int buf = ctx->current_buf;
+    XvImage *image = ctx->xvimage[buf];
+    if (mpi->width > image->width || mpi->height > image->height)
+        return VO_FALSE;
+    if (!(mpi->flags & (MP_IMGFLAG_ACCEPT_STRIDE | MP_IMGFLAG_ACCEPT_WIDTH))
+        && mpi->width * (mpi->bpp / 8) != image->pitches[0])
+        return VO_FALSE;
+
+    vo_x11_wait_shm_completion(vo, ctx->num_buffers - 1);
+    mpi->planes[0] = image->data + image->offsets[0];
+    mpi->stride[0] = image->pitches[0];
+    if (mpi->flags & MP_IMGFLAG_PLANAR) {
+        // YV12 stores V before U
+        int u = ctx->image_format == IMGFMT_YV12 ? 2 : 1;
+        int v = 3 - u;
+        mpi->planes[1] = image->data + image->offsets[u];
+        mpi->planes[2] = image->data + image->offsets[v];
+        mpi->stride[1] = image->pitches[u];
+        mpi->stride[2] = image->pitches[v];
+    }
+    mpi->flags &= ~MP_IMGFLAG_COMMON_PLANE;
+    mpi->flags |= MP_IMGFLAG_DIRECT;
+    mpi->priv = (void *)(intptr_t)buf;
+    return VO_TRUE;
+}
+
 static uint32_t draw_image(struct vo *vo, mp_image_t *mpi)
 {
     struct xvctx *ctx = vo->priv;
 
     ctx->have_image_copy = false;
 
-    if (mpi->flags & MP_IMGFLAG_DRAW_CALLBACK)
+    if (mpi->flags & MP_IMGFLAG_DIRECT)
+        // already in the XvImage, which might not be current_buf anymore
+        // if a redraw happened after get_image()
+        ctx->current_buf = (intptr_t)mpi->priv;
+    else if (mpi->flags & MP_IMGFLAG_DRAW_CALLBACK)
         ; // done
     else if (mpi->flags & MP_IMGFLAG_PLANAR)
         draw_slice(vo, mpi->planes, mpi->stride, mpi->w, mpi->h, 0, 0);
-    else if (mpi->flags & MP_IMGFLAG_YUV)
+    else if (mpi->flags & MP_IMGFLAG_YUV) {
         // packed YUV:
+        vo_x11_wait_shm_completion(vo, ctx->num_buffers - 1);
         memcpy_pic(ctx->xvimage[ctx->current_buf]->data +
                    ctx->xvimage[ctx->current_buf]->offsets[0], mpi->planes[0],
                    mpi->w * (mpi->bpp / 8), mpi->h,
                    ctx->xvimage[ctx->current_buf]->pitches[0], mpi->stride[0]);
-    else
+    } else
           return false;
 
     if (ctx->is_paused) {
@@ -573,6 +632,8 @@ static void uninit(struct vo *vo)
         XFree(ctx->fo);
         ctx->fo = NULL;
     }
+    // the server may still be reading from the shm segments
+    vo_x11_wait_shm_completion(vo, 0);
     for (i = 0; i < ctx->total_buffers; i++)
         deallocate_xvimage(vo, i);
 #ifdef CONFIG_XF86VM
@@ -583,6 +644,12 @@ static void uninit(struct vo *vo)
     vo_x11_uninit(vo);
 }
 
+static int buffers_valid(void *arg)
+{
+    int n = *(int *)arg;
+    return n >= 1 && n <= MAX_BUFFERS;
+}
+
 static int preinit(struct vo *vo, const char *arg)
 {
     XvPortID xv_p;
@@ -594,6 +661,8 @@ static int preinit(struct vo *vo, const char *arg)
     vo->priv = ctx;
     int xv_adaptor = -1;
 
+    ctx->cfg_buffers = 3;
+
     if (!vo_init(vo))
         return -1;
 
@@ -606,6 +675,7 @@ static int preinit(struct vo *vo, const char *arg)
       {  "adaptor",   OPT_ARG_INT, &xv_adaptor,    int_non_neg },
       {  "ck",        OPT_ARG_STR, &ck_src_arg,    xv_test_ck },
       {  "ck-method", OPT_ARG_STR, &ck_method_arg, xv_test_ckm },
+      {  "buffers",   OPT_ARG_INT, &ctx->cfg_buffers, buffers_valid },
       {  NULL }
     };
 
@@ -723,6 +793,8 @@ static int control(struct vo *vo, uint32_t request, void *data)
         return (ctx->is_paused = 0);
     case VOCTRL_QUERY_FORMAT:
         return query_format(ctx, *((uint32_t *) data));
+    case VOCTRL_GET_IMAGE:
+        return get_image(vo, data);
     case VOCTRL_DRAW_IMAGE:
         return draw_image(vo, data);
     case VOCTRL_GET_PANSCAN:
@@ -849,11 +849,40 @@ int vo_x11_check_events(struct vo *vo)
                     Event.xclient.data.l[0] == x11->XAWM_DELETE_WINDOW)
                     mplayer_put_key(vo->key_fifo, KEY_CLOSE_WIN);
                 break;
+            default:
+                if (Event.type == x11->ShmCompletionEvent &&
+                    x11->ShmCompletionEvent && x11->ShmCompletionWaitCount > 0)
+                    x11->ShmCompletionWaitCount--;
+                break;
         }
     }
     return ret;
 }
 
+static Bool is_shm_completion(Display *display, XEvent *event, XPointer arg)
+{
+    struct vo_x11_state *x11 = (struct vo_x11_state *)arg;
+    return event->type == x11->ShmCompletionEvent;
+}
+
+/* Block until at most max_pending XShm puts are still being processed by
+ * the server. The completion events arrive in the order of the puts, so
+ * this tells which of the images can be written again. Other events stay
+ * in the queue for vo_x11_check_events().
+ */
+void vo_x11_wait_shm_completion(struct vo *vo, int max_pending)
+{
+    struct vo_x11_state *x11 = vo->x11;
+    XEvent event;
+
+    if (!x11->ShmCompletionEvent)
+        return;
+    while (x11->ShmCompletionWaitCount > max_pending) {
+        XIfEvent(x11->display, &event, is_shm_completion, (XPointer)x11);
+        x11->ShmCompletionWaitCount--;
+    }
+}
+
 /**
  * \brief sets the size and position of the non-fullscreen window.
  */
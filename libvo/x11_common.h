@@ -79,6 +79,11 @@ struct vo_x11_state {
     unsigned int oldfuncs;
     XComposeStatus compose_status;
 
+    /* Event type of XShm completion events (0 if the VO doesn't request
+     * them), and the number of XShm puts that are not completed yet. */
+    int ShmCompletionEvent;
+    int ShmCompletionWaitCount;
+
     Atom XA_NET_SUPPORTED;
     Atom XA_NET_WM_STATE;
     Atom XA_NET_WM_STATE_FULLSCREEN;
@@ -123,6 +128,7 @@ void vo_x11_decoration(struct vo *vo, int d );
 void vo_x11_classhint(struct vo *vo, Window window, const char *name);
 void vo_x11_sizehint(struct vo *vo, int x, int y, int width, int height, int max);
 int vo_x11_check_events(struct vo *vo);
+void vo_x11_wait_shm_completion(struct vo *vo, int max_pending);
 void vo_x11_selectinput_witherr(Display *display, Window w, long event_mask);
 void vo_x11_fullscreen(struct vo *vo);
 int vo_x11_update_geometry(struct vo *vo, bool update_pos);
@@ -192,6 +198,7 @@ void xscreensaver_heartbeat(struct vo_x11_state *x11);
 #define update_xinerama_info() update_xinerama_info(global_vo)
 #define vo_x11_uninit() vo_x11_uninit(global_vo)
 #define vo_x11_check_events(display) vo_x11_check_events(global_vo)
+#define vo_x11_wait_shm_completion(...) vo_x11_wait_shm_completion(global_vo, __VA_ARGS__)
 #define vo_x11_sizehint(...) vo_x11_sizehint(global_vo, __VA_ARGS__)
 #define vo_vm_switch() vo_vm_switch(global_vo)
 #define vo_x11_create_colormap(vinfo) vo_x11_create_colormap(global_vo, vinfo)
@@ -137,6 +137,10 @@ typedef struct MPContext {
     bool hrseek_active;
     bool hrseek_framedrop;
     double hrseek_pts;
+    // Number of frames decoded but not shown to reach hrseek_pts
+    int hrseek_skipped;
+    // frames left before adaptive framedrop may change its level again
+    int framedrop_hold;
     // AV sync: the next frame should be shown when the audio out has this
     // much (in seconds) buffered data left. Increased when more data is
     // written to the ao, decreased when moving to the next frame.
@@ -319,6 +319,7 @@ int use_filename_title;
 
 #include "mpcommon.h"
 #include "command.h"
+#include "audio_jobs.h"
 
 #include "metadata.h"
 
@@ -581,6 +582,7 @@ void uninit_player(struct MPContext *mpctx, unsigned int mask)
         if (mpctx->sh_video)
             uninit_video(mpctx->sh_video);
         mpctx->sh_video = NULL;
+        mpctx->framedrop_hold = 0;
     }
 
     if (mask & INITIALIZED_DEMUXER) {
@@ -2089,16 +2091,73 @@ static void update_teletext(sh_video_t *sh_video, demuxer_t *demuxer, int reset)
     teletext_control(demuxer->teletext, TV_VBI_CONTROL_MARK_UNCHANGED, NULL);
 }
 
+/* Adaptive framedrop: raise the decoder skip level step by step while video
+ * lags behind audio, and lower it again once the decode times measured
+ * for the frame types the lower level brings back fit into the frame time
+ * (a type not decoded for a while has no time, and is tried again).
+ * After each change the level is held for a few frames so that its effect
+ * shows up in the A-V difference before deciding again. */
+#define FRAMEDROP_HOLD_FRAMES 8
+
+static void update_framedrop_level(struct MPContext *mpctx, double av_lag,
+                                   double frame_time)
+{
+    struct sh_video *sh_video = mpctx->sh_video;
+    double *t = sh_video->decode_time;
+    int level = sh_video->framedrop_level;
+
+    if (mpctx->framedrop_hold > 0) {
+        mpctx->framedrop_hold--;
+        return;
+    }
+    if (av_lag < -0.1 && level < FRAMEDROP_MAX) {
+        level++;
+        // skipping non-reference frames is pointless without B-frames
+        if (level == FRAMEDROP_NONREF && t[3] == 0)
+            level++;
+    } else if (av_lag > -0.02 && level > FRAMEDROP_NONE) {
+        // expected decode time per frame at the next lower level
+        double cost;
+        switch (level) {
+        case FRAMEDROP_NONKEY:
+            cost = FFMAX(t[2], t[0]);
+            break;
+        case FRAMEDROP_NONREF:
+            cost = FFMAX(t[3], t[2]);
+            break;
+        default:
+            // guess: deblocking takes up to a third of the decode time
+            cost = sh_video->avg_decode_time * 1.33;
+        }
+        if (frame_time <= 0 || cost < frame_time * 0.8)
+            level--;
+    }
+    if (level == sh_video->framedrop_level)
+        return;
+    set_video_framedrop_level(sh_video, level);
+    mpctx->framedrop_hold = FRAMEDROP_HOLD_FRAMES;
+    mp_msg(MSGT_CPLAYER, MSGL_V, "Framedrop level %d (A-V: %5.3f, decode: "
+           "%5.3f/%5.3f)\n", sh_video->framedrop_level, -av_lag,
+           sh_video->avg_decode_time, frame_time);
+}
+
 static int check_framedrop(struct MPContext *mpctx, double frame_time)
 {
     struct MPOpts *opts = &mpctx->opts;
     // check for frame-drop:
     current_module = "check_framedrop";
+    if (frame_dropping != 3 && mpctx->sh_video->framedrop_level)
+        set_video_framedrop_level(mpctx->sh_video, FRAMEDROP_NONE);
     if (mpctx->sh_audio && !mpctx->ao->untimed && !mpctx->d_audio->eof) {
         static int dropped_frames;
         float delay = opts->playback_speed * ao_get_delay(mpctx->ao);
         float d = delay - mpctx->delay;
         ++total_frame_cnt;
+        if (frame_dropping == 3) {
+            if (!mpctx->paused && !mpctx->restart_playback)
+                update_framedrop_level(mpctx, d, frame_time);
+            return 0;
+        }
         // we should avoid dropping too many frames in sequence unless we
         // are too late. and we allow 100ms A-V delay here:
         if (d < -dropped_frames * frame_time - 0.100 && !mpctx->paused
@@ -2748,6 +2807,7 @@ static double update_video_nocorrect_pts(struct MPContext *mpctx)
         current_module = "decode video";
 
         void *decoded_frame;
+        unsigned int t = GetTimer();
 #ifdef CONFIG_DVDNAV
         decoded_frame = mp_dvdnav_restore_smpi(mpctx, &in_size, &packet, NULL);
         if (in_size >= 0 && !decoded_frame)
@@ -2758,9 +2818,12 @@ static double update_video_nocorrect_pts(struct MPContext *mpctx)
         // Save last still frame for future display
         mp_dvdnav_save_smpi(mpctx, in_size, packet, decoded_frame);
 #endif
+        video_out->decode_time_us += GetTimer() - t;
         if (decoded_frame) {
             current_module = "filter video";
+            t = GetTimer();
             filter_video(sh_video, decoded_frame, sh_video->pts);
+            video_out->filter_time_us = GetTimer() - t;
         }
         break;
     }
@@ -2798,6 +2861,9 @@ static void determine_frame_pts(struct MPContext *mpctx)
                     sh_video->codec_reordered_pts : sh_video->sorted_pts;
 }
 
+// frames before an hr-seek target that still go through the filters
+#define HRSEEK_FILTER_FRAMES 4
+
 static double update_video(struct MPContext *mpctx)
 {
     struct sh_video *sh_video = mpctx->sh_video;
@@ -2839,16 +2905,41 @@ static double update_video(struct MPContext *mpctx)
         if (in_size > max_framesize)
             max_framesize = in_size;
         current_module = "decode video";
-        if (pts >= mpctx->hrseek_pts - .005)
+        /* Frames well before the hr-seek target are only needed as
+         * references in the decoder: it skips non-reference frames and
+         * returns none of them. The last few before the target are
+         * decoded and filtered, so temporal filters have history and
+         * filters that change the frame rate or timestamps work; the
+         * final decision is made on the filtered pts below. */
+        double frametime = sh_video->frametime > 0 ?
+                           sh_video->frametime : 0.04;
+        double filter_start = mpctx->hrseek_pts - .005
+                              - HRSEEK_FILTER_FRAMES * frametime;
+        if (pts >= filter_start)
             mpctx->hrseek_framedrop = false;
         int framedrop_type = mpctx->hrseek_framedrop ? 1 :
                              check_framedrop(mpctx, sh_video->frametime);
+        unsigned int t = GetTimer();
         void *decoded_frame = decode_video(sh_video, pkt, buf, in_size,
                                            framedrop_type, pts);
+        video_out->decode_time_us += GetTimer() - t;
+        if (mpctx->hrseek_framedrop && in_size)
+            mpctx->hrseek_skipped++;
         if (decoded_frame) {
             determine_frame_pts(mpctx);
+            /* With reordering, frames from before the filter window can
+             * still come out once the decoder stops dropping; don't filter
+             * them either. Return to the main loop for each frame to keep
+             * input and OSD alive. */
+            if (mpctx->hrseek_active && sh_video->pts != MP_NOPTS_VALUE
+                && sh_video->pts < filter_start) {
+                mpctx->hrseek_skipped++;
+                return 0;
+            }
             current_module = "filter video";
+            t = GetTimer();
             filter_video(sh_video, decoded_frame, sh_video->pts);
+            video_out->filter_time_us = GetTimer() - t;
         } else if (!pkt) {
             if (vo_get_buffered_frame(video_out, true) < 0)
                 return -1;
@@ -2869,8 +2960,12 @@ static double update_video(struct MPContext *mpctx)
     }
     if (mpctx->hrseek_active && pts < mpctx->hrseek_pts - .005) {
         vo_skip_frame(video_out);
+        mpctx->hrseek_skipped++;
         return 0;
     }
+    if (mpctx->hrseek_active)
+        mp_msg(MSGT_CPLAYER, MSGL_V, "hr-seek: skipped %d frames to reach "
+               "%f\n", mpctx->hrseek_skipped, mpctx->hrseek_pts);
     mpctx->hrseek_active = false;
     sh_video->pts = pts;
     if (sh_video->last_pts == MP_NOPTS_VALUE)
@@ -3045,6 +3140,7 @@ static void seek_reset(struct MPContext *mpctx, bool reset_ao, bool reset_ac)
     mpctx->restart_playback = true;
     mpctx->hrseek_active = false;
     mpctx->hrseek_framedrop = false;
+    mpctx->framedrop_hold = 0;
     mpctx->total_avsync_change = 0;
     audio_time_usage = 0;
     video_time_usage = 0;
@@ -3188,6 +3284,7 @@ static int seek(MPContext *mpctx, struct seek_params seek,
     if (hr_seek || mpctx->timeline) {
         mpctx->hrseek_active = true;
         mpctx->hrseek_framedrop = true;
+        mpctx->hrseek_skipped = 0;
         mpctx->hrseek_pts = hr_seek ? seek.amount
                                  : mpctx->timeline[mpctx->timeline_part].start;
     }
@@ -3568,7 +3665,7 @@ static void run_playloop(struct MPContext *mpctx)
 
         mpctx->last_vo_flip_duration = (GetTimer() - t2) * 0.000001;
         vout_time_usage += mpctx->last_vo_flip_duration;
-        if (vo->driver->flip_page_timed) {
+        if (vo->driver->flip_page_timed || vo->pacer.ahead) {
             // No need to adjust sync based on flip speed
             mpctx->last_vo_flip_duration = 0;
             // For print_status - VO call finishing early is OK for sync
@@ -3693,6 +3790,10 @@ static void run_playloop(struct MPContext *mpctx)
             if (mpctx->ao->untimed) {
                 if (!video_left)
                     audio_sleep = 0;
+            } else if (full_audio_buffers && mpctx->ao->event_wakeup) {
+                /* The AO wakes us up through the input loop as soon as
+                 * the device has room again, this is only a fallback. */
+                audio_sleep = FFMAX(buffered_audio - 0.005, 0.005);
             } else if (full_audio_buffers) {
                 audio_sleep = buffered_audio - 0.050;
                 // Keep extra safety margin if the buffers are large
@@ -3819,10 +3920,11 @@ static void print_version(const char *name)
     GetCpuCaps(&gCpuCaps);
 #if ARCH_X86
     mp_msg(MSGT_CPLAYER, MSGL_V,
-           "CPUflags:  MMX: %d MMX2: %d 3DNow: %d 3DNowExt: %d SSE: %d SSE2: %d SSSE3: %d\n",
+           "CPUflags:  MMX: %d MMX2: %d 3DNow: %d 3DNowExt: %d SSE: %d SSE2: %d SSSE3: %d SSE4: %d AVX2: %d\n",
            gCpuCaps.hasMMX, gCpuCaps.hasMMX2,
            gCpuCaps.has3DNow, gCpuCaps.has3DNowExt,
-           gCpuCaps.hasSSE, gCpuCaps.hasSSE2, gCpuCaps.hasSSSE3);
+           gCpuCaps.hasSSE, gCpuCaps.hasSSE2, gCpuCaps.hasSSSE3,
+           gCpuCaps.hasSSE4, gCpuCaps.hasAVX2);
 #if CONFIG_RUNTIME_CPUDETECT
     mp_tmsg(MSGT_CPLAYER, MSGL_V, "Compiled with runtime CPU detection.\n");
 #else
@@ -3841,6 +3943,10 @@ static void print_version(const char *name)
         mp_msg(MSGT_CPLAYER, MSGL_V, " SSE2");
     if (HAVE_SSSE3)
         mp_msg(MSGT_CPLAYER, MSGL_V, " SSSE3");
+    if (HAVE_SSE4)
+        mp_msg(MSGT_CPLAYER, MSGL_V, " SSE4");
+    if (HAVE_AVX2)
+        mp_msg(MSGT_CPLAYER, MSGL_V, " AVX2");
     if (HAVE_CMOV)
         mp_msg(MSGT_CPLAYER, MSGL_V, " CMOV");
     mp_msg(MSGT_CPLAYER, MSGL_V, "\n");
@@ -4153,6 +4259,26 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
+    if (opts->audio_jobs > 0 && mpctx->playtree_iter && mpctx->filename) {
+        // batch mode: decode every playtree entry in parallel, then quit
+        char **files = talloc_array(NULL, char *, 16);
+        int num_files = 0;
+        char *file = mpctx->filename;
+        do {
+            while (file) {
+                MP_GROW_ARRAY(files, num_files);
+                files[num_files++] = file;
+                file = play_tree_iter_get_file(mpctx->playtree_iter, 1);
+            }
+            if (play_tree_iter_step(mpctx->playtree_iter, 1, 0) ==
+                    PLAY_TREE_ITER_ENTRY)
+                file = play_tree_iter_get_file(mpctx->playtree_iter, 1);
+        } while (file);
+        int failed = audio_jobs_run(opts, files, num_files, force_srate);
+        talloc_free(files);
+        exit_player_with_rc(mpctx, EXIT_EOF, failed ? 1 : 0);
+    }
+
     // ***************** Now, let's see the per-file stuff ******************
 
 play_next_file:
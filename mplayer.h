@@ -25,6 +25,7 @@
 
 extern char* current_module;
 
+extern char ** audio_codec_list;
 extern char ** audio_fm_list;
 extern char ** video_fm_list;
 extern char ** video_driver_list;
@@ -12,6 +12,9 @@ typedef struct MPOpts {
     float softvol_max;
     int gapless_audio;
     int ao_buffersize;
+    int ao_thread_ms;
+    int audio_jobs;
+    char **audio_jobs_aid;
     int screen_size_x;
     int screen_size_y;
     int vo_screenwidth;
@@ -29,6 +32,8 @@ typedef struct MPOpts {
     int requested_input_range;
     int requested_output_range;
     int cursor_autohide_delay;
+    int vo_pacing;
+    float vo_display_fps;
 
     // ranges -100 - 100, 1000 if the vo default should be used
     int vo_gamma_gamma;
@@ -19,6 +19,7 @@ typedef struct mp_eosd_res {
 struct osd_state {
     struct ass_library *ass_library;
     struct ass_renderer *ass_renderer;
+    unsigned int ass_render_count; // ass_render_frame() calls on ass_renderer
     struct sh_sub *sh_sub;
     unsigned int bitmap_id;
     unsigned int bitmap_pos_id;
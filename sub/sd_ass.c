@@ -21,6 +21,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include <libavutil/common.h>
+
 #include "talloc.h"
 
 #include "options.h"
@@ -32,10 +34,30 @@
 #include "sd.h"
 #include "subassconvert.h"
 
+// everything besides the track contents that affects ass_render_frame()
+struct render_key {
+    ASS_Renderer *renderer;
+    struct mp_eosd_res dim;
+    double scale;
+    bool unscaled;
+    int use_margins, hinting;
+    float font_scale, line_spacing;
+    int n_events, n_styles;
+};
+
 struct sd_ass_priv {
     struct ass_track *ass_track;
     bool vsfilter_aspect;
     bool incomplete_event;
+
+    // The last rendered frame. While the same events are on screen and none
+    // of them is animated it is returned again without calling libass.
+    bool have_last;
+    struct render_key last_key;
+    unsigned int last_render;   // osd->ass_render_count after rendering it
+    ASS_Image *last_imgs;
+    int *events, *last_events;
+    int num_last_events;
 };
 
 static void free_last_event(ASS_Track *track)
@@ -125,6 +147,40 @@ static void decode(struct sh_sub *sh, struct osd_state *osd, void *data,
     event->Text = strdup(buf);
 }
 
+// whether the event can look different at other times while it is shown
+static bool event_is_animated(ASS_Event *event)
+{
+    static const char *const tags[] = {
+        "\\t(", "\\move", "\\fad", "\\k", "\\K", NULL
+    };
+    if (event->Effect && event->Effect[0])
+        return true;
+    for (int i = 0; tags[i]; i++)
+        if (event->Text && strstr(event->Text, tags[i]))
+            return true;
+    return false;
+}
+
+// Collect the events shown at now into ctx->events. Return false if
+// one of them is animated.
+static bool get_active_events(struct sd_ass_priv *ctx, long long now,
+                              int *count)
+{
+    ASS_Track *track = ctx->ass_track;
+    bool animated = false;
+
+    ctx->events = talloc_realloc(ctx, ctx->events, int, track->n_events);
+    *count = 0;
+    for (int i = 0; i < track->n_events; i++) {
+        ASS_Event *event = track->events + i;
+        if (now < event->Start || now >= event->Start + event->Duration)
+            continue;
+        ctx->events[(*count)++] = i;
+        animated |= event_is_animated(event);
+    }
+    return !animated;
+}
+
 static void get_bitmaps(struct sh_sub *sh, struct osd_state *osd,
                         struct sub_bitmaps *res)
 {
@@ -138,16 +194,49 @@ static void get_bitmaps(struct sh_sub *sh, struct osd_state *osd,
     if (ctx->vsfilter_aspect && opts->ass_vsfilter_aspect_compat)
         scale = osd->vsfilter_scale;
     ASS_Renderer *renderer = osd->ass_renderer;
+    long long now = osd->sub_pts * 1000 + .5;
+    res->type = SUBBITMAP_LIBASS;
+
+    struct render_key key;
+    memset(&key, 0, sizeof(key));   // the key is compared with memcmp
+    key.renderer = renderer;
+    key.dim = osd->dim;
+    key.scale = scale;
+    key.unscaled = osd->unscaled;
+    key.use_margins = opts->ass_use_margins;
+    key.hinting = opts->ass_hinting;
+    key.font_scale = opts->ass_font_scale;
+    key.line_spacing = opts->ass_line_spacing;
+    key.n_events = ctx->ass_track->n_events;
+    key.n_styles = ctx->ass_track->n_styles;
+
+    int num_events;
+    bool is_static = get_active_events(ctx, now, &num_events);
+    if (ctx->have_last && is_static
+        && ctx->last_render == osd->ass_render_count
+        && !memcmp(&key, &ctx->last_key, sizeof(key))
+        && num_events == ctx->num_last_events
+        && !memcmp(ctx->events, ctx->last_events, num_events * sizeof(int))) {
+        // same picture as last time; the ids stay the same too
+        res->imgs = ctx->last_imgs;
+        return;
+    }
+
     mp_ass_configure(renderer, opts, &osd->dim, osd->unscaled);
     ass_set_aspect_ratio(renderer, scale, 1);
     int changed;
-    res->imgs = ass_render_frame(renderer, ctx->ass_track,
-                                 osd->sub_pts * 1000 + .5, &changed);
+    res->imgs = ass_render_frame(renderer, ctx->ass_track, now, &changed);
     if (changed == 2)
         res->bitmap_id = ++res->bitmap_pos_id;
     else if (changed)
         res->bitmap_pos_id++;
-    res->type = SUBBITMAP_LIBASS;
+
+    ctx->have_last = true;
+    ctx->last_key = key;
+    ctx->last_render = ++osd->ass_render_count;
+    ctx->last_imgs = res->imgs;
+    FFSWAP(int *, ctx->events, ctx->last_events);
+    ctx->num_last_events = num_events;
 }
 
 static void reset(struct sh_sub *sh, struct osd_state *osd)
@@ -156,6 +245,7 @@ static void reset(struct sh_sub *sh, struct osd_state *osd)
     if (ctx->incomplete_event)
         free_last_event(ctx->ass_track);
     ctx->incomplete_event = false;
+    ctx->have_last = false;
 }
 
 static void uninit(struct sh_sub *sh)
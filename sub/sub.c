@@ -113,17 +113,79 @@ void osd_alloc_buf(mp_osd_obj_t* obj)
     memset(obj->alpha_buffer, sub_bg_alpha, len);
 }
 
-// renders the buffer
+#define OSD_RECT_ROWS 16
+
+static int rect_area(const mp_osd_bbox_t *r)
+{
+    return (r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+// Find the parts of the bitmap that are not fully transparent (alpha 0),
+// in bands of OSD_RECT_ROWS lines. Bands are merged as long as that does not
+// add much empty area, so text lines of different width end up separate.
+static void osd_update_rects(mp_osd_obj_t *obj)
+{
+    int w = obj->bbox.x2 - obj->bbox.x1;
+    int h = obj->bbox.y2 - obj->bbox.y1;
+
+    obj->num_rects = 0;
+    obj->rects_generation = obj->generation;
+    if (obj->allocated <= 0)
+        return;
+    for (int y0 = 0; y0 < h; y0 += OSD_RECT_ROWS) {
+        int y1 = FFMIN(y0 + OSD_RECT_ROWS, h);
+        int left = w, right = 0, top = y1, bottom = y0;
+        for (int y = y0; y < y1; y++) {
+            unsigned char *a = obj->alpha_buffer + y * obj->stride;
+            int l = 0, r = w;
+            while (l < r && !a[l])
+                l++;
+            if (l == r)
+                continue;
+            while (!a[r - 1])
+                r--;
+            left = FFMIN(left, l);
+            right = FFMAX(right, r);
+            top = FFMIN(top, y);
+            bottom = y + 1;
+        }
+        if (left >= right)
+            continue;
+        // the blenders process up to 8 pixels at once and may read past w
+        // up to the stride; keep that within the same row of the buffer
+        left &= ~7;
+        mp_osd_bbox_t band = {
+            obj->bbox.x1 + left, obj->bbox.y1 + top,
+            obj->bbox.x1 + right, obj->bbox.y1 + bottom,
+        };
+        if (obj->num_rects) {
+            mp_osd_bbox_t *last = &obj->rects[obj->num_rects - 1];
+            mp_osd_bbox_t u = {
+                FFMIN(last->x1, band.x1), last->y1,
+                FFMAX(last->x2, band.x2), band.y2,
+            };
+            if (obj->num_rects == OSD_MAX_RECTS ||
+                rect_area(&u) * 8 <= (rect_area(last) + rect_area(&band)) * 9) {
+                *last = u;
+                continue;
+            }
+        }
+        obj->rects[obj->num_rects++] = band;
+    }
+}
+
+// renders the visible parts of the buffer
 static void vo_draw_text_from_buffer(mp_osd_obj_t* obj,void (*draw_alpha)(void *ctx, int x0,int y0, int w,int h, unsigned char* src, unsigned char *srca, int stride), void *ctx)
 {
-    if (obj->allocated > 0) {
-	draw_alpha(ctx,
-		   obj->bbox.x1,obj->bbox.y1,
-		   obj->bbox.x2-obj->bbox.x1,
-		   obj->bbox.y2-obj->bbox.y1,
-		   obj->bitmap_buffer,
-		   obj->alpha_buffer,
-		   obj->stride);
+    if (obj->rects_generation != obj->generation)
+        osd_update_rects(obj);
+    for (int i = 0; i < obj->num_rects; i++) {
+        mp_osd_bbox_t *r = &obj->rects[i];
+        int offset = (r->y1 - obj->bbox.y1) * obj->stride
+                     + r->x1 - obj->bbox.x1;
+        draw_alpha(ctx, r->x1, r->y1, r->x2 - r->x1, r->y2 - r->y1,
+                   obj->bitmap_buffer + offset, obj->alpha_buffer + offset,
+                   obj->stride);
     }
 }
 
@@ -240,6 +302,7 @@ static int osd_update_ext(struct osd_state *osd, int dxs, int dys,
       if(dxs!=obj->dxs || dys!=obj->dys || obj->flags&OSDFLAG_FORCE_UPDATE){
         int vis=obj->flags&OSDFLAG_VISIBLE;
 	obj->flags&=~OSDFLAG_BBOX;
+	obj->generation++;
 	switch(obj->type){
 #ifdef CONFIG_DVDNAV
         case OSDTYPE_DVDNAV:
@@ -404,15 +467,29 @@ int vo_osd_changed(int new_value)
     return ret;
 }
 
+static int bbox_intersects(const mp_osd_bbox_t *b, int x1, int y1, int x2,
+                           int y2)
+{
+    return b->x1 <= x2 && b->x2 >= x1 && b->y1 <= y2 && b->y2 >= y1 &&
+           b->y2 > b->y1 && b->x2 > b->x1;
+}
+
 // return TRUE if we have osd in the specified rectangular area:
 int vo_osd_check_range_update(int x1,int y1,int x2,int y2){
     mp_osd_obj_t* obj=vo_osd_list;
     while(obj){
 	if(obj->flags&OSDFLAG_VISIBLE){
-	    if(	(obj->bbox.x1<=x2 && obj->bbox.x2>=x1) &&
-		(obj->bbox.y1<=y2 && obj->bbox.y2>=y1) &&
-		obj->bbox.y2 > obj->bbox.y1 && obj->bbox.x2 > obj->bbox.x1
-		) return 1;
+	    if (obj->type == OSDTYPE_SPU) {
+		if (bbox_intersects(&obj->bbox, x1, y1, x2, y2))
+		    return 1;
+	    } else if (bbox_intersects(&obj->bbox, x1, y1, x2, y2)) {
+		// only the non-transparent parts get drawn
+		if (obj->rects_generation != obj->generation)
+		    osd_update_rects(obj);
+		for (int i = 0; i < obj->num_rects; i++)
+		    if (bbox_intersects(&obj->rects[i], x1, y1, x2, y2))
+			return 1;
+	    }
 	}
 	obj=obj->next;
     }
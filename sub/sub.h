@@ -44,6 +44,8 @@ typedef struct mp_osd_bbox_s {
 #define MAX_UCS 1600
 #define MAX_UCSLINES 16
 
+#define OSD_MAX_RECTS 4
+
 typedef struct mp_osd_obj_s {
     struct mp_osd_obj_s* next;
     unsigned char type;
@@ -53,6 +55,11 @@ typedef struct mp_osd_obj_s {
     int dxs,dys;
     mp_osd_bbox_t bbox; // bounding box
     mp_osd_bbox_t old_bbox; // the renderer will save bbox here
+    unsigned int generation; // incremented each time the bitmap is rebuilt
+    // parts of the bitmap that are not fully transparent (screen coordinates)
+    mp_osd_bbox_t rects[OSD_MAX_RECTS];
+    int num_rects;
+    unsigned int rects_generation; // generation the rects were computed for
     union {
 	struct {
 	    void* sub;			// value of vo_sub at last update